@@ -2,42 +2,75 @@
 #include <string>
 #include <vector>
 #include <sstream>
-#include <winsock2.h>
-#include <windows.h>
-#include <snmp.h>
-#include <mgmtapi.h>
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <atomic>
+#include <csignal>
+#include <cstdlib>
+#include <cstdio>
+#include <ctime>
+#include "snmp_archive.h"
+#include "snmp_async.h"
+#include "snmp_batch.h"
+#include "snmp_cache.h"
+#include "snmp_delta.h"
+#include "snmp_format.h"
+#include "snmp_mib.h"
+#include "snmp_oid.h"
+#include "snmp_metrics.h"
+#include "snmp_poller.h"
+#include "snmp_pwalk.h"
+#include "snmp_resolve.h"
+#include "snmp_sched.h"
+#include "snmp_sink.h"
+#include "snmp_syntax.h"
+#include "snmp_table.h"
+#include "snmp_udp.h"
 
+#ifdef _WIN32
+#include <io.h>
 #pragma comment(lib, "snmpapi.lib")
-#pragma comment(lib, "mgmtapi.lib")
 #pragma comment(lib, "ws2_32.lib")
+#endif
 
-// Функция для преобразования строки OID в массив UINT
-bool ParseOIDString(const std::string& oidStr, std::vector<UINT>& oidArray) {
-    std::istringstream iss(oidStr);
-    std::string token;
-    oidArray.clear();
+// Индекс MIB для символьных имён OID: файл SNMP_MIB_DEFAULT_INDEX или встроенная часть MIB-2
+static SnmpMibIndex mibIndex;
 
-    while (std::getline(iss, token, '.')) {
-        if (token.empty()) continue;
+// Буфер вывода результатов: строки обхода сбрасываются в std::cout блоками
+static SnmpOutput output;
 
-        for (char c : token) {
-            if (!isdigit(c)) {
-                std::cerr << "Invalid OID format: non-digit character found" << std::endl;
-                return false;
-            }
+// Кэш ответов перед SnmpGetRequest и SnmpWalkRequest; включается командой cache on
+static SnmpCache responseCache;
+static bool responseCacheEnabled = false;
+
+// Случайная добавка к началу цикла опроса - до 5% периода
+#define SNMP_POLL_JITTER_DIVISOR 20
+
+// Функция для преобразования строки OID в SnmpOid (числовой или имя из MIB: IF-MIB::ifTable)
+bool ParseOIDString(const std::string& oidStr, SnmpOid& oid) {
+    if (!oidStr.empty() && isalpha((unsigned char)oidStr[0])) {
+        if (!SnmpMibLookup(mibIndex, oidStr, oid)) {
+            std::cerr << "Unknown OID name: " << oidStr << std::endl;
+            return false;
         }
+        return true;
+    }
 
-        try {
-            UINT value = std::stoul(token);
-            oidArray.push_back(value);
+    if (!SnmpOidParse(oidStr, oid)) {
+        if (oidStr.find_first_not_of("0123456789.") != std::string::npos) {
+            std::cerr << "Invalid OID format: non-digit character found" << std::endl;
         }
-        catch (const std::exception& e) {
-            std::cerr << "Error parsing OID component: " << token << std::endl;
-            return false;
+        else {
+            std::cerr << "Error parsing OID component: " << oidStr << std::endl;
         }
+        return false;
     }
 
-    if (oidArray.empty()) {
+    if (oid.Empty()) {
         std::cerr << "OID is empty" << std::endl;
         return false;
     }
@@ -71,103 +104,30 @@ const char* SnmpErrorToString(AsnInteger error) {
     }
 }
 
-// Функция для печати значения SNMP
-void PrintSnmpValue(const AsnAny& value) {
-    switch (value.asnType) {
-    case ASN_INTEGER:
-        std::cout << "INTEGER: " << value.asnValue.number << std::endl;
-        break;
-    case ASN_COUNTER32:
-        std::cout << "COUNTER32: " << value.asnValue.number << std::endl;
-        break;
-    case ASN_GAUGE32:
-        std::cout << "GAUGE: " << value.asnValue.unsigned32 << std::endl;
-        break;
-    case ASN_OCTETSTRING:
-        std::cout << "OCTET STRING: ";
-        // Проверяем, может ли это быть MAC-адрес (6 байт)
-        if (value.asnValue.string.length == 6) {
-            // Выводим как MAC-адрес в формате XX-XX-XX-XX-XX-XX
-            for (DWORD i = 0; i < value.asnValue.string.length; i++) {
-                unsigned char byte = value.asnValue.string.stream[i];
-                std::cout << std::hex << std::uppercase << (int)byte;
-                if ((int)byte == 0) {
-                    std::cout << std::hex << std::uppercase << (int)byte;
-                }
-                if (i < value.asnValue.string.length - 1) {
-                    std::cout << "-";
-                }
-            }
-            std::cout << std::dec;
-        }
-        // Проверяем, может ли это быть IP-адрес (4 байта)
-        else if (value.asnValue.string.length == 4) {
-            // Выводим как IP-адрес
-            for (DWORD i = 0; i < value.asnValue.string.length; i++) {
-                std::cout << (int)value.asnValue.string.stream[i];
-                if (i < value.asnValue.string.length - 1) {
-                    std::cout << ".";
-                }
-            }
-        }
-        else {
-            // Проверяем, содержит ли строка только печатаемые символы
-            bool allPrintable = true;
-            for (DWORD i = 0; i < value.asnValue.string.length; i++) {
-                if (!isprint(value.asnValue.string.stream[i])) {
-                    allPrintable = false;
-                    break;
-                }
-            }
-
-            if (allPrintable && value.asnValue.string.length > 0) {
-                // Выводим как обычную строку
-                for (DWORD i = 0; i < value.asnValue.string.length; i++) {
-                    std::cout << value.asnValue.string.stream[i];
-                }
-            }
-            else {
-                // Выводим в hex формате
-                for (DWORD i = 0; i < value.asnValue.string.length; i++) {
-                    unsigned char byte = value.asnValue.string.stream[i];
-                    std::cout << std::hex << std::uppercase << (int)byte;
-                    if (i < value.asnValue.string.length - 1) {
-                        std::cout << " ";
-                    }
-                }
-                std::cout << std::dec;
-            }
-        }
-        break;
-    case ASN_OBJECTIDENTIFIER:
-        std::cout << "OID: ";
-        for (UINT i = 0; i < value.asnValue.object.idLength; i++) {
-            std::cout << value.asnValue.object.ids[i];
-            if (i < value.asnValue.object.idLength - 1) std::cout << ".";
-        }
-        LPSTR str_oid;
-        AsnObjectIdentifier oids = value.asnValue.object;
-        SnmpMgrOidToStr(&oids, &str_oid);
-        std::cout << "\t" << str_oid << "\t";
-        std::cout << std::endl;
-        break;
-    case ASN_NULL:
-        std::cout << "NULL" << std::endl;
-        break;
-    case ASN_RFC1155_IPADDRESS:
-        std::cout << "IPADDRESS: "
-            << (int)value.asnValue.address.stream[0] << "."
-            << (int)value.asnValue.address.stream[1] << "."
-            << (int)value.asnValue.address.stream[2] << "."
-            << (int)value.asnValue.address.stream[3] << std::endl;
-        break;
-    case ASN_TIMETICKS:
-        std::cout << "TIMETICKS: " << value.asnValue.ticks << std::endl;
-        break;
-    default:
-        std::cout << "UNKNOWN TYPE: " << value.asnType << std::endl;
-        break;
+// Функция для сообщения о неудачном запросе: недоступный агент объясняется отдельно
+void PrintRequestError(const char* operation, DWORD error) {
+    if (error == SNMP_UDP_ERROR_DOWN) {
+        std::cerr << "Agent is not responding; requests are skipped until the next probe succeeds" << std::endl;
+        return;
     }
+    if (error == SNMP_UDP_ERROR_AGENT) {
+        std::cerr << operation << " failed: the agent answered with an SNMP error" << std::endl;
+        return;
+    }
+    std::cerr << operation << " failed. System error: " << error << std::endl;
+}
+
+// Функция для получения символьного имени OID по индексу MIB
+std::string SnmpOidToName(const AsnObjectIdentifier& oid) {
+    std::string name;
+    SnmpMibResolve(mibIndex, oid.ids, oid.idLength, name);
+    return name;
+}
+
+// Функция для печати значения SNMP объекта oid (по синтаксису объекта, если он известен)
+void PrintSnmpValue(const SnmpOid& oid, const AsnAny& value) {
+    SnmpFormatTypedValue(output.buffer, oid.Data(), oid.Length(), value, mibIndex);
+    SnmpOutputFlush(output);
 }
 
 // Функция для выполнения SNMP GET запроса
@@ -337,253 +297,1565 @@ void PrintSnmpValue(const AsnAny& value) {
 //    return 0;
 //}
 
-// Функция для сравнения двух OID
-bool CompareOID(const AsnObjectIdentifier& oid1, const AsnObjectIdentifier& oid2) {
-    if (oid1.idLength != oid2.idLength) return false;
-    for (UINT i = 0; i < oid1.idLength; i++) {
-        if (oid1.ids[i] != oid2.ids[i]) return false;
+// Функция для печати одной строки результата обхода поддерева
+// Строка попадает в буфер вывода; в поток он пишется блоками по SNMP_OUTPUT_FLUSH_SIZE
+void PrintWalkItem(int itemNumber, RFC1157VarBind& varBind) {
+    SnmpFormatWalkItem(output.buffer, itemNumber, varBind, mibIndex);
+    SnmpOutputCommit(output);
+}
+
+// Функция для выполнения SNMP WALK
+bool SnmpWalkRequest(SnmpUdpSession& session, const SnmpOid& baseOid, SnmpSink& sink) {
+    SnmpSinkLog(sink) << "\n=== SNMP GET SUBTREE Results for OID: " << baseOid.ToString() << " ===" << std::endl;
+
+    int itemCount = 0;
+    auto onVarBind = [&itemCount, &sink](RFC1157VarBind& varBind) {
+        itemCount++;
+        SnmpSinkWrite(sink, itemCount, varBind);
+    };
+    bool success = responseCacheEnabled ? SnmpCacheWalk(responseCache, session, baseOid, 0, onVarBind)
+        : SnmpWalk(session, baseOid, onVarBind);
+    if (!success) {
+        DWORD lastError = GetLastError();
+        SnmpOutputFlush(*sink.output);
+        PrintRequestError("SnmpWalk", lastError);
+    }
+
+    SnmpOutputFlush(*sink.output);
+    SnmpSinkLog(sink) << "=== Found " << itemCount << " items ===" << std::endl;
+
+    return itemCount > 0;
+}
+
+// Функция для выполнения SNMP WALK через GETBULK (SNMPv2c).
+// За один запрос агент возвращает до maxRepetitions следующих OID.
+bool SnmpBulkWalkRequest(SnmpUdpSession& session, const SnmpOid& baseOid, UINT maxRepetitions, SnmpSink& sink) {
+    SnmpSinkLog(sink) << "\n=== SNMP GET SUBTREE Results for OID: " << baseOid.ToString() << " ===" << std::endl;
+
+    int itemCount = 0;
+    auto onVarBind = [&itemCount, &sink](RFC1157VarBind& varBind) {
+        itemCount++;
+        SnmpSinkWrite(sink, itemCount, varBind);
+    };
+
+    bool success = responseCacheEnabled ? SnmpCacheWalk(responseCache, session, baseOid, maxRepetitions, onVarBind)
+        : SnmpBulkWalk(session, baseOid, maxRepetitions, onVarBind);
+    if (!success) {
+        DWORD lastError = GetLastError();
+        SnmpOutputFlush(*sink.output);
+        PrintRequestError("SnmpBulkWalk", lastError);
+    }
+
+    SnmpOutputFlush(*sink.output);
+    SnmpSinkLog(sink) << "=== Found " << itemCount << " items ===" << std::endl;
+
+    return itemCount > 0;
+}
+
+// Функция для GET SUBTREE несколькими параллельными курсорами GETBULK
+bool SnmpParallelWalkRequest(SnmpUdpSession& session, const SnmpOid& baseOid, UINT streams, SnmpSink& sink) {
+    SnmpSinkLog(sink) << "\n=== SNMP GET SUBTREE Results for OID: " << baseOid.ToString()
+        << " (" << streams << " streams) ===" << std::endl;
+
+    int itemCount = 0;
+    auto onVarBind = [&itemCount, &sink](RFC1157VarBind& varBind) {
+        itemCount++;
+        SnmpSinkWrite(sink, itemCount, varBind);
+    };
+
+    if (!SnmpParallelWalk(session, baseOid, streams, 25, onVarBind)) {
+        DWORD lastError = GetLastError();
+        SnmpOutputFlush(*sink.output);
+        if (lastError == SNMP_UDP_ERROR_AGENT && itemCount == 0) {
+            // Агент не принимает GETBULK (SNMPv1) - обходим обычным GETNEXT
+            SnmpSinkLog(sink) << "Agent rejected GETBULK, falling back to GETNEXT walk" << std::endl;
+            return SnmpWalkRequest(session, baseOid, sink);
+        }
+        PrintRequestError("SnmpParallelWalk", lastError);
+    }
+
+    SnmpOutputFlush(*sink.output);
+    SnmpSinkLog(sink) << "=== Found " << itemCount << " items ===" << std::endl;
+
+    return itemCount > 0;
+}
+
+// Функция для выполнения SNMP GET запроса. Ничего не печатает: при ошибке агента возвращает
+// false с SNMP_UDP_ERROR_AGENT и его errorStatus, при ошибке транспорта - false с кодом ошибки.
+// Значение в result ссылается на буферы сессии и действительно до следующего запроса.
+// useCache = false - мимо кэша ответов, когда нужно значение на момент запроса.
+bool SnmpGetRequest(SnmpUdpSession& session, const SnmpOid& oid, AsnAny& result, AsnInteger& errorStatus,
+    bool useCache = true) {
+    if (useCache && responseCacheEnabled) {
+        return SnmpCacheGet(responseCache, session, oid, result, errorStatus);
     }
+
+    RFC1157VarBind requestVarBind;
+    requestVarBind.name = oid.AsAsn();
+    requestVarBind.value.asnType = ASN_NULL;
+
+    SnmpPdu request;
+    request.type = SNMP_PDU_GET;
+    request.errorStatus = 0;
+    request.errorIndex = 0;
+    request.varBinds.list = &requestVarBind;
+    request.varBinds.len = 1;
+
+    errorStatus = SNMP_ERRORSTATUS_NOERROR;
+    SnmpPdu response;
+    if (!SnmpUdpRequest(session, request, response)) {
+        return false;
+    }
+    if (response.errorStatus != SNMP_ERRORSTATUS_NOERROR || response.varBinds.len == 0) {
+        errorStatus = response.errorStatus != SNMP_ERRORSTATUS_NOERROR ? response.errorStatus : SNMP_ERRORSTATUS_GENERR;
+        SetLastError(SNMP_UDP_ERROR_AGENT);
+        return false;
+    }
+
+    result = response.varBinds.list[0].value;
     return true;
 }
 
-// Функция для выполнения SNMP WALK
-bool SnmpWalkRequest(HANDLE hSnmp, const std::vector<UINT>& baseOidArray) {
-    AsnObjectIdentifier baseOid;
-    RFC1157VarBindList varBindList;
-    AsnInteger errorStatus;
-    AsnInteger errorIndex;
+// Функция для чтения нескольких OID пакетными GET-запросами
+bool SnmpGetMultiRequest(SnmpUdpSession& session, const std::vector<SnmpOid>& oids) {
+    SnmpArena resultArena;
+    std::vector<SnmpBatchResult> results;
+
+    unsigned long requestsBefore = session.requestCount;
+    SetLastError(0);
+
+    if (!SnmpGetBatch(session, oids, resultArena, results)) {
+        DWORD lastError = GetLastError();
+        PrintRequestError("SnmpGetBatch", lastError);
+        return false;
+    }
+
+    for (size_t i = 0; i < oids.size(); i++) {
+        RFC1157VarBind varBind;
+        varBind.name = oids[i].AsAsn();
+        varBind.value = results[i].value;
 
-    // Настройка базового OID
-    baseOid.idLength = (UINT)baseOidArray.size();
-    baseOid.ids = (UINT*)SnmpUtilMemAlloc(baseOidArray.size() * sizeof(UINT));
-    if (!baseOid.ids) return false;
+        if (results[i].errorStatus != SNMP_ERRORSTATUS_NOERROR) {
+            SnmpFormatUnsigned(output.buffer, i + 1);
+            output.buffer.append(". OID: ");
+            SnmpFormatOid(output.buffer, oids[i].Data(), oids[i].Length());
+            output.buffer.append("\tSNMP Error: ");
+            output.buffer.append(SnmpErrorToString(results[i].errorStatus));
+            output.buffer.append(" (code: ");
+            SnmpFormatSigned(output.buffer, results[i].errorStatus);
+            output.buffer.append(")\n");
+            SnmpOutputCommit(output);
+            continue;
+        }
 
-    for (size_t i = 0; i < baseOidArray.size(); i++) {
-        baseOid.ids[i] = baseOidArray[i];
+        PrintWalkItem((int)i + 1, varBind);
     }
+    SnmpOutputFlush(output);
+
+    std::cout << "\n=== GET completed ===" << std::endl;
+    std::cout << "Total OIDs: " << oids.size() << ", requests sent: "
+        << session.requestCount - requestsBefore << std::endl;
+    return true;
+}
 
-    // Начальная настройка переменных
-    varBindList.list = (RFC1157VarBind*)SnmpUtilMemAlloc(sizeof(RFC1157VarBind));
-    if (!varBindList.list) {
-        SnmpUtilMemFree(baseOid.ids);
+// Функция загрузки списка целей опроса. Формат строки:
+// host[:port] community OID [OID ...]; пустые строки и строки с '#' пропускаются.
+bool LoadPollTargets(const std::string& path, std::vector<SnmpPollTarget>& targets) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Cannot open targets file: " << path << std::endl;
         return false;
     }
-    varBindList.len = 1;
 
-    // Инициализация начального varBind
-    varBindList.list[0].name = baseOid;
-    varBindList.list[0].value.asnType = ASN_NULL;
+    std::string line;
+    int lineNumber = 0;
+    std::vector<int> lineNumbers;
+    while (std::getline(file, line)) {
+        lineNumber++;
+
+        std::istringstream fields(line);
+        SnmpPollTarget target;
+        if (!(fields >> target.hostname) || target.hostname[0] == '#') continue;
+
+        std::string oidString;
+        fields >> target.community;
+        while (fields >> oidString) {
+            SnmpOid oid;
+            if (!ParseOIDString(oidString, oid)) {
+                target.oids.clear();
+                break;
+            }
+            target.oids.push_back(oid);
+        }
+
+        if (target.community.empty() || target.oids.empty()) {
+            std::cerr << "Line " << lineNumber << ": expected 'host community OID [OID ...]'" << std::endl;
+            continue;
+        }
 
-    std::cout << "\n=== SNMP GET SUBTREE Results for OID: ";
-    for (size_t i = 0; i < baseOidArray.size(); i++) {
-        std::cout << baseOidArray[i];
-        if (i < baseOidArray.size() - 1) std::cout << ".";
+        targets.push_back(std::move(target));
+        lineNumbers.push_back(lineNumber);
     }
-    std::cout << " ===" << std::endl;
 
-    int itemCount = 0;
-    bool moreItems = true;
-    AsnObjectIdentifier lastOid = baseOid;
-
-    while (moreItems) {
-        // Выполнение GETNEXT запроса
-        if (SnmpMgrRequest(hSnmp, SNMP_PDU_GETNEXT, &varBindList, &errorStatus, &errorIndex)) {
-            if (errorStatus == SNMP_ERRORSTATUS_NOERROR) {
-                // Проверяем, находится ли полученный OID в нужном поддереве
-                bool isInSubtree = true;
-                UINT minLength = min(lastOid.idLength, varBindList.list[0].name.idLength);
-
-                for (UINT i = 0; i < minLength; i++) {
-                    if (varBindList.list[0].name.ids[i] != lastOid.ids[i]) {
-                        if (i < baseOid.idLength) {
-                            isInSubtree = false;
-                        }
-                        break;
-                    }
-                }
+    // Имена разрешаются параллельно и запоминаются: повторный опрос того же списка не ждёт DNS
+    std::vector<std::string> hostnames;
+    hostnames.reserve(targets.size());
+    for (const SnmpPollTarget& target : targets) {
+        hostnames.push_back(target.hostname);
+    }
+    std::vector<SnmpResolveEntry> resolved;
+    SnmpResolveAll(SnmpResolveGlobalCache(), hostnames, resolved);
 
-                if (!isInSubtree || CompareOID(varBindList.list[0].name, lastOid)) {
-                    moreItems = false;
-                    break;
-                }
+    size_t count = 0;
+    for (size_t i = 0; i < targets.size(); i++) {
+        if (resolved[i].error != 0) {
+            std::cerr << "Line " << lineNumbers[i] << ": cannot resolve " << targets[i].hostname
+                << ". Error code: " << resolved[i].error << std::endl;
+            continue;
+        }
+        targets[i].address = resolved[i].address;
+        targets[i].addressLength = resolved[i].addressLength;
+        if (count != i) targets[count] = std::move(targets[i]);
+        count++;
+    }
+    targets.resize(count);
 
-                // Выводим результат
-                itemCount++;
-                std::cout << itemCount << ". OID: ";
-                for (UINT i = 0; i < varBindList.list[0].name.idLength; i++) {
-                    std::cout << varBindList.list[0].name.ids[i];
-                    if (i < varBindList.list[0].name.idLength - 1) std::cout << ".";
-                }
-                LPSTR str_oid;
-                SnmpMgrOidToStr(&varBindList.list[0].name, &str_oid);
-                std::cout << "\t" << str_oid << "\t";
-                std::cout << " = ";
-                PrintSnmpValue(varBindList.list[0].value);
-                std::cout << std::endl;
+    return true;
+}
 
-                // Сохраняем последний OID для следующей итерации
-                /*if (lastOid.ids) {
-                    SnmpUtilMemFree(lastOid.ids);
-                }*/
-                lastOid = varBindList.list[0].name;
-                lastOid.ids = (UINT*)SnmpUtilMemAlloc(lastOid.idLength * sizeof(UINT));
-                for (UINT i = 0; i < lastOid.idLength; i++) {
-                    lastOid.ids[i] = varBindList.list[0].name.ids[i];
-                }
+// Функция для асинхронного опроса списка агентов. Результаты идут в output,
+// сообщения о ходе опроса и итоги - в log.
+bool SnmpPollTargets(const std::string& path, const SnmpPollerOptions& options, std::ostream& log) {
+    std::vector<SnmpPollTarget> targets;
+    if (!LoadPollTargets(path, targets)) {
+        return false;
+    }
+    if (targets.empty()) {
+        std::cerr << "No targets to poll" << std::endl;
+        return false;
+    }
+
+    log << "Polling " << targets.size() << " targets, ";
+    if (options.cycles > 0) log << options.cycles << " cycle(s)";
+    else log << "until stopped";
+    log << " every " << options.interval / 1000 << " s";
+    if (options.threads != 1) {
+        log << " on " << (options.threads > 0 ? std::to_string(options.threads) : std::string("all")) << " threads";
+    }
+    log << "..." << std::endl;
 
-                // Подготавливаем varBind для следующего запроса
-                varBindList.list[0].name = lastOid;
+    // Задержки для перцентилей копятся только в конечном опросе; у службы их считают метрики
+    std::vector<ULONGLONG> latencies;
+    bool keepLatencies = options.cycles > 0;
+    if (keepLatencies) latencies.reserve(targets.size() * options.cycles);
+
+    // Строки результата форматируются в буфере потока опроса, в общий вывод переносятся под блокировкой
+    std::mutex outputMutex;
+    auto onResult = [&latencies, keepLatencies, &outputMutex](const SnmpPollResult& result) {
+        thread_local std::string out;
+        out.clear();
+        auto commit = [&]() {
+            std::lock_guard<std::mutex> lock(outputMutex);
+            if (result.response && keepLatencies) latencies.push_back(result.latencyUs);
+            output.buffer.append(out);
+            SnmpOutputCommit(output);
+        };
+
+        const std::string& host = result.target->hostname;
+        if (result.response == NULL) {
+            if (result.error == SNMP_UDP_ERROR_DOWN) {
+                out.append(host).append("\tSkipped: agent is down, waiting for the next probe\n");
             }
             else {
-                LPSTR str_oid;
-                SnmpMgrOidToStr(&varBindList.list[0].name, &str_oid);
-                std::cout << "SNMP Error: " << SnmpErrorToString(errorStatus)
-                    << " (code: " << errorStatus << ") " << "for OID: " << str_oid << std::endl;
-                std::cout << "Possible, it is last element.\n";
-                moreItems = false;
+                out.append(host).append("\tTimeout: No Response from ").append(host).push_back('\n');
+            }
+            commit();
+            return;
+        }
+
+        const SnmpPdu& response = *result.response;
+        if (response.errorStatus != SNMP_ERRORSTATUS_NOERROR) {
+            out.append(host).append("\tSNMP Error: ").append(SnmpErrorToString(response.errorStatus));
+            out.append(" (code: ");
+            SnmpFormatSigned(out, response.errorStatus);
+            out.append(", index: ");
+            SnmpFormatSigned(out, response.errorIndex);
+            out.append(")\n");
+            commit();
+            return;
+        }
+
+        for (UINT i = 0; i < response.varBinds.len; i++) {
+            out.append(host).push_back('\t');
+            SnmpFormatVarBind(out, response.varBinds.list[i], mibIndex);
+        }
+        commit();
+    };
+
+    SnmpPollerStats stats;
+    ULONGLONG startTime = GetTickCount64();
+    bool success = SnmpPollerRun(targets, options, onResult, stats);
+    SnmpOutputFlush(output);
+    if (!success) {
+        std::cerr << "SnmpPollerRun failed. System error: " << GetLastError() << std::endl;
+        return false;
+    }
+    ULONGLONG elapsed = GetTickCount64() - startTime;
+
+    log << "\n=== Poll completed ===" << std::endl;
+    log << "Responses: " << stats.responses << ", timeouts: " << stats.timeouts
+        << ", retransmits: " << stats.retransmits << ", send errors: " << stats.sendErrors
+        << ", unmatched: " << stats.unmatched << ", skipped (agent down): " << stats.skipped << std::endl;
+    log << "Missed deadlines: " << stats.missedDeadlines << ", delayed by agent limits: " << stats.throttled << std::endl;
+    log << "Elapsed: " << elapsed << " ms";
+    if (elapsed > 0) {
+        log << ", " << stats.responses * 1000 / elapsed << " responses/s";
+    }
+    log << std::endl;
+
+    if (!latencies.empty()) {
+        std::sort(latencies.begin(), latencies.end());
+        log << "Latency p50: " << latencies[latencies.size() / 2] << " us, p99: "
+            << latencies[latencies.size() * 99 / 100] << " us" << std::endl;
+    }
+
+    return true;
+}
+
+// Функция для обхода поддеревьев многих агентов на нескольких потоках. Список - в формате
+// poll: каждый OID строки - корень обхода этого агента. Строки одного агента идут по порядку.
+bool SnmpWalkTargets(const std::string& path, int threads, UINT maxRepetitions) {
+    std::vector<SnmpPollTarget> targets;
+    if (!LoadPollTargets(path, targets)) {
+        return false;
+    }
+
+    std::vector<SnmpWalkJob> jobs;
+    for (const SnmpPollTarget& target : targets) {
+        for (const SnmpOid& oid : target.oids) {
+            jobs.push_back(SnmpWalkJob{ target.hostname, target.community, oid });
+        }
+    }
+    if (jobs.empty()) {
+        std::cerr << "No targets to walk" << std::endl;
+        return false;
+    }
+
+    SnmpSchedulerOptions options;
+    options.threads = threads;
+    options.maxRepetitions = maxRepetitions;
+    size_t workerCount = threads > 0 ? (size_t)threads : std::thread::hardware_concurrency();
+    if (workerCount == 0) workerCount = 1;
+
+    std::cout << "Walking " << jobs.size() << " subtree(s) of " << targets.size() << " agent(s) on "
+        << workerCount << " thread(s)..." << std::endl;
+
+    // У каждого потока свой буфер строк; в std::cout блоки пишутся под блокировкой
+    std::vector<SnmpOutput> buffers(workerCount);
+    std::mutex outputMutex;
+    auto flushWorker = [&](int worker) {
+        std::lock_guard<std::mutex> lock(outputMutex);
+        SnmpOutputFlush(buffers[worker]);
+    };
+
+    auto onVarBind = [&](int worker, size_t job, RFC1157VarBind& varBind) {
+        std::string& out = buffers[worker].buffer;
+        out.append(jobs[job].hostname).push_back('\t');
+        SnmpFormatVarBind(out, varBind, mibIndex);
+        if (out.size() >= SNMP_OUTPUT_FLUSH_SIZE) flushWorker(worker);
+    };
+    auto onDone = [&](const SnmpWalkJobResult& result) {
+        // Ошибку выводим после уже полученных строк этого обхода
+        flushWorker(result.worker);
+        if (!result.success) {
+            std::lock_guard<std::mutex> lock(outputMutex);
+            std::cerr << jobs[result.job].hostname << "\tWalk failed after " << result.count
+                << " item(s). Error code: " << result.error << std::endl;
+        }
+    };
+
+    SnmpSchedulerStats stats;
+    ULONGLONG startTime = GetTickCount64();
+    SnmpSchedulerRun(jobs, options, onVarBind, onDone, stats);
+    ULONGLONG elapsed = GetTickCount64() - startTime;
+
+    std::cout << "\n=== Walk completed ===" << std::endl;
+    std::cout << "Subtrees: " << stats.jobs << ", failed: " << stats.failures << ", items: " << stats.varBinds
+        << ", stolen: " << stats.steals << std::endl;
+    std::cout << "Elapsed: " << elapsed << " ms";
+    if (elapsed > 0) {
+        std::cout << ", " << stats.varBinds * 1000 / elapsed << " items/s";
+    }
+    std::cout << std::endl;
+    return stats.failures == 0;
+}
+
+// Скорость поднятого интерфейса агента
+struct SnmpInterfaceSpeed {
+    UINT index;
+    AsnGauge32 speed;             // ifHighSpeed, Мбит/с
+};
+
+// Итог процесса одного агента в if_speeds
+struct SnmpInterfaceReport {
+    DWORD error = 0;
+    std::vector<SnmpInterfaceSpeed> speeds;
+};
+
+// Процесс одного агента: обход ifOperStatus, затем GET ifHighSpeed каждого поднятого интерфейса.
+// Процессы всех агентов идут в одном потоке, их запросы - в полёте одновременно.
+static SnmpTask<> SnmpInterfaceSpeedsTask(SnmpLoop& loop, size_t agent, UINT maxRepetitions,
+    SnmpInterfaceReport& report) {
+    static const SnmpOid ifOperStatus = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 8 };
+    static const SnmpOid ifHighSpeed = { 1, 3, 6, 1, 2, 1, 31, 1, 1, 1, 15 };
+
+    std::vector<UINT> up;
+    report.error = co_await SnmpAsyncWalk(loop, agent, ifOperStatus, maxRepetitions, [&up](RFC1157VarBind& varBind) {
+        // up(1)
+        if (varBind.name.idLength == ifOperStatus.Length() + 1 && varBind.value.asnType == ASN_INTEGER
+            && varBind.value.asnValue.number == 1) {
+            up.push_back(varBind.name.ids[ifOperStatus.Length()]);
+        }
+    });
+    if (report.error != 0) co_return;
+
+    SnmpOid name = ifHighSpeed;
+    for (UINT index : up) {
+        name.Truncate(ifHighSpeed.Length());
+        name.Append(index);
+        SnmpAsyncResult result = co_await SnmpAsyncGet(loop, agent, name);
+        if (result.response == NULL) {
+            report.error = result.error;
+            co_return;
+        }
+
+        // Нет ifXTable или строки в ней: интерфейс пропускается
+        const SnmpPdu& response = *result.response;
+        if (response.errorStatus != SNMP_ERRORSTATUS_NOERROR || response.varBinds.len != 1
+            || response.varBinds.list[0].value.asnType != ASN_GAUGE32) {
+            continue;
+        }
+        report.speeds.push_back(SnmpInterfaceSpeed{ index, response.varBinds.list[0].value.asnValue.gauge });
+    }
+}
+
+// Функция вывода скоростей поднятых интерфейсов многих агентов. Список - в формате poll
+// (OID строк не используются); процессы агентов - корутины одного цикла событий.
+bool SnmpInterfaceSpeeds(const std::string& path, UINT maxRepetitions) {
+    std::vector<SnmpPollTarget> targets;
+    if (!LoadPollTargets(path, targets)) {
+        return false;
+    }
+    if (targets.empty()) {
+        std::cerr << "No targets to query" << std::endl;
+        return false;
+    }
+
+    SnmpLoop loop;
+    if (!SnmpLoopInit(loop, 5000, 2)) {
+        std::cerr << "SnmpLoopInit failed. System error: " << GetLastError() << std::endl;
+        return false;
+    }
+
+    std::cout << "Reading interface speeds of " << targets.size() << " agent(s)..." << std::endl;
+
+    std::vector<SnmpInterfaceReport> reports(targets.size());
+    for (size_t i = 0; i < targets.size(); i++) {
+        const SnmpPollTarget& target = targets[i];
+        size_t agent = SnmpLoopAddAgent(loop, target.hostname, target.address, target.addressLength, target.community);
+        if (agent == SNMP_LOOP_NO_AGENT) {
+            reports[i].error = GetLastError();
+            continue;
+        }
+        SnmpLoopSpawn(loop, SnmpInterfaceSpeedsTask(loop, agent, maxRepetitions, reports[i]));
+    }
+
+    ULONGLONG startTime = GetTickCount64();
+    bool success = SnmpLoopRun(loop);
+    ULONGLONG elapsed = GetTickCount64() - startTime;
+    DWORD lastError = GetLastError();
+    SnmpLoopStats stats = loop.stats;
+    SnmpLoopClose(loop);
+    if (!success) {
+        std::cerr << "SnmpLoopRun failed. System error: " << lastError << std::endl;
+        return false;
+    }
+
+    size_t interfaces = 0;
+    size_t failures = 0;
+    for (size_t i = 0; i < targets.size(); i++) {
+        const SnmpInterfaceReport& report = reports[i];
+        for (const SnmpInterfaceSpeed& speed : report.speeds) {
+            output.buffer.append(targets[i].hostname).push_back('\t');
+            SnmpFormatUnsigned(output.buffer, speed.index);
+            output.buffer.push_back('\t');
+            SnmpFormatUnsigned(output.buffer, speed.speed);
+            output.buffer.append(" Mbit/s\n");
+            SnmpOutputCommit(output);
+        }
+        interfaces += report.speeds.size();
+        if (report.error != 0) {
+            SnmpOutputFlush(output);
+            std::cerr << targets[i].hostname << "\tFailed after " << report.speeds.size()
+                << " interface(s). Error code: " << report.error << std::endl;
+            failures++;
+        }
+    }
+    SnmpOutputFlush(output);
+
+    std::cout << "\n=== Interface speeds completed ===" << std::endl;
+    std::cout << "Agents: " << targets.size() << ", failed: " << failures << ", interfaces up: " << interfaces
+        << std::endl;
+    std::cout << "Requests sent: " << stats.sent << ", retransmits: " << stats.retransmits
+        << ", timeouts: " << stats.timeouts << ", elapsed: " << elapsed << " ms" << std::endl;
+    return failures == 0;
+}
+
+// Функция для вывода таблицы по строкам: обход GETBULK собирается в колоночный снимок,
+// затем печатается заголовок из имён колонок и строки "индекс<TAB>значения" через табуляцию
+bool SnmpTableRequest(SnmpUdpSession& session, const SnmpOid& tableOid, UINT maxRepetitions) {
+    SnmpTable table;
+    SnmpTableInit(table, tableOid);
+    size_t skipped = 0;
+    bool success = SnmpBulkWalk(session, tableOid, maxRepetitions, [&table, &skipped](RFC1157VarBind& varBind) {
+        if (!SnmpTableAdd(table, varBind)) skipped++;
+    });
+    if (!success) {
+        PrintRequestError("SnmpBulkWalk", GetLastError());
+        if (SnmpTableRows(table) == 0) return false;
+    }
+
+    // Синтаксис колонки одинаков для всех её ячеек: разборщик выбирается один раз
+    std::string& out = output.buffer;
+    out.append("index");
+    std::vector<const SnmpSyntaxBinding*> bindings;
+    SnmpOid columnOid = table.entry;
+    for (const SnmpTableColumn& column : table.columns) {
+        columnOid.Append(column.arc);
+        out.push_back('\t');
+        SnmpMibResolve(mibIndex, columnOid.Data(), columnOid.Length(), out);
+        bindings.push_back(SnmpSyntaxFind(columnOid.Data(), columnOid.Length()));
+        columnOid.Truncate(table.entry.Length());
+    }
+    out.push_back('\n');
+
+    for (size_t row = 0; row < SnmpTableRows(table); row++) {
+        size_t length;
+        const UINT* index = SnmpTableRowIndex(table, row, length);
+        SnmpFormatOid(out, index, length);
+        for (size_t i = 0; i < table.columns.size(); i++) {
+            out.push_back('\t');
+            AsnAny value;
+            if (!SnmpTableGet(table.columns[i], row, value)) continue;
+            const SnmpSyntaxBinding* binding = bindings[i];
+            if (binding == NULL || !SnmpSyntaxGetDecoder(binding->syntax)(out, value, *binding)) {
+                SnmpFormatValueText(out, value);
             }
         }
+        out.push_back('\n');
+        SnmpOutputCommit(output);
+    }
+    SnmpOutputFlush(output);
+
+    std::cout << "=== " << SnmpTableRows(table) << " rows, " << table.columns.size() << " columns, "
+        << SnmpTableMemory(table) << " bytes";
+    if (skipped > 0) std::cout << ", " << skipped << " item(s) outside the table skipped";
+    std::cout << " ===" << std::endl;
+    return true;
+}
+
+// Функция для сохранения обхода поддерева через GETBULK в архив (snmp_archive).
+// Обход прерванный таймаутом тоже сохраняется: полученная часть остаётся пригодной для чтения.
+bool SnmpArchiveSaveRequest(SnmpUdpSession& session, const SnmpOid& baseOid, UINT maxRepetitions, const std::string& path) {
+    SnmpArchiveWriter writer;
+    if (!SnmpArchiveCreate(writer, path)) return false;
+
+    auto start = std::chrono::steady_clock::now();
+    size_t skipped = 0;
+    bool success = SnmpBulkWalk(session, baseOid, maxRepetitions, [&writer, &skipped](RFC1157VarBind& varBind) {
+        if (!SnmpArchiveAppend(writer, varBind)) skipped++;
+    });
+    if (!success) {
+        PrintRequestError("SnmpBulkWalk", GetLastError());
+    }
+    if (!SnmpArchiveFinish(writer)) return false;
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "=== Saved " << writer.records << " items in " << writer.blocks.size() << " blocks to " << path
+        << " (" << writer.offset << " bytes of records) in " << elapsed << " ms";
+    if (skipped > 0) std::cout << ", " << skipped << " item(s) out of order skipped";
+    std::cout << " ===" << std::endl;
+    return success;
+}
+
+// Функция для печати значения изменившегося OID: новое значение и прежнее после него
+static void FormatArchiveChange(std::string& out, const SnmpArchiveChange& change) {
+    static const char* const kinds[] = { "added   ", "changed ", "removed " };
+    out.append(kinds[change.kind]);
+    SnmpFormatVarBind(out, change.after ? *change.after : *change.before, mibIndex);
+    if (change.kind != SNMP_DELTA_CHANGED) return;
+
+    while (!out.empty() && out.back() == '\n') out.pop_back();
+    out.append("\t(was ");
+    SnmpFormatTypedValue(out, change.before->name.ids, change.before->name.idLength, change.before->value, mibIndex);
+    while (!out.empty() && out.back() == '\n') out.pop_back();
+    out.append(")\n");
+}
+
+// Функция для работы с архивом обхода без агента:
+// info <file> | get <file> <OID> | scan <file> [OID] | diff <old-file> <new-file> [OID]
+bool SnmpArchiveCommand(const std::vector<std::string>& args) {
+    static const char* const usage = "Use: archive info <file> | archive get <file> <OID> | "
+        "archive scan <file> [OID] | archive diff <old-file> <new-file> [OID]";
+    std::string command = args.empty() ? "" : args[0];
+    size_t files = command == "diff" ? 2 : 1;
+    if ((command != "info" && command != "get" && command != "scan" && command != "diff")
+        || args.size() < 1 + files || args.size() > 2 + files
+        || (command == "info" && args.size() != 2) || (command == "get" && args.size() != 3)) {
+        std::cerr << usage << std::endl;
+        return false;
+    }
+
+    SnmpOid oid;
+    if (args.size() == 2 + files && !ParseOIDString(args[1 + files], oid)) {
+        std::cerr << "Invalid OID format. " << usage << std::endl;
+        return false;
+    }
+
+    SnmpArchive archives[2];
+    for (size_t i = 0; i < files; i++) {
+        if (!SnmpArchiveOpen(archives[i], args[1 + i])) {
+            DWORD error = GetLastError();
+            std::cerr << "Cannot open archive " << args[1 + i] << ": "
+                << (error == SNMP_ARCHIVE_ERROR_FORMAT ? "not an archive or damaged" : "error code " + std::to_string(error))
+                << std::endl;
+            return false;
+        }
+    }
+
+    bool success = true;
+    std::string& out = output.buffer;
+    if (command == "info") {
+        time_t created = (time_t)archives[0].header->created;
+        struct tm local;
+#ifdef _WIN32
+        localtime_s(&local, &created);
+#else
+        localtime_r(&created, &local);
+#endif
+        char text[64] = "";
+        strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", &local);
+        std::cout << "Archive " << args[1] << ": " << archives[0].records << " items, " << archives[0].blockCount
+            << " blocks, " << archives[0].viewSize << " bytes, saved " << text << std::endl;
+    }
+    else if (command == "get") {
+        SnmpArchiveCursor cursor;
+        if (SnmpArchiveGet(archives[0], cursor, oid.Data(), oid.Length())) {
+            SnmpFormatVarBind(out, cursor.varBind, mibIndex);
+            SnmpOutputFlush(output);
+        }
+        else {
+            std::cerr << (cursor.corrupt ? "Archive is damaged" : "No such OID in the archive") << std::endl;
+            success = false;
+        }
+    }
+    else if (command == "scan") {
+        size_t itemCount = 0;
+        success = SnmpArchiveScan(archives[0], oid.Data(), oid.Length(), [&out, &itemCount](const RFC1157VarBind& varBind) {
+            itemCount++;
+            SnmpFormatVarBind(out, varBind, mibIndex);
+            SnmpOutputCommit(output);
+            return true;
+        });
+        SnmpOutputFlush(output);
+        if (!success) std::cerr << "Archive is damaged, the scan stopped early" << std::endl;
+        std::cerr << "=== Found " << itemCount << " items ===" << std::endl;
+    }
+    else {
+        size_t counts[3] = {};
+        success = SnmpArchiveDiff(archives[0], archives[1], oid.Data(), oid.Length(),
+            [&out, &counts](const SnmpArchiveChange& change) {
+            counts[change.kind]++;
+            FormatArchiveChange(out, change);
+            SnmpOutputCommit(output);
+        });
+        SnmpOutputFlush(output);
+        if (!success) std::cerr << "Archive is damaged, the comparison stopped early" << std::endl;
+        std::cerr << "=== " << counts[SNMP_DELTA_ADDED] << " added, " << counts[SNMP_DELTA_CHANGED] << " changed, "
+            << counts[SNMP_DELTA_REMOVED] << " removed ===" << std::endl;
+    }
+
+    for (SnmpArchive& archive : archives) {
+        SnmpArchiveClose(archive);
+    }
+    return success;
+}
+
+// Функция для опроса изменений поддерева: каждый цикл обходит его через GETBULK
+// и выдаёт только новые, изменившиеся и пропавшие значения, для счётчиков - скорость.
+// Перезапуск агента определяется по sysUpTime.0, в таком цикле скорости не считаются.
+bool SnmpWatchRequest(SnmpUdpSession& session, const SnmpOid& baseOid, DWORD interval, int cycles, SnmpSink& sink) {
+    static const SnmpOid sysUpTime = { 1, 3, 6, 1, 2, 1, 1, 3, 0 };
+
+    SnmpSinkLog(sink) << "\n=== Watching changes of OID: " << baseOid.ToString() << " every "
+        << interval / 1000 << " s ===" << std::endl;
+
+    SnmpDeltaCache cache;
+    int itemCount = 0;
+    auto onChange = [&itemCount, &sink](const SnmpDeltaChange& change) {
+        static const char* const kinds[] = { "added", "changed", "removed" };
+        itemCount++;
+        SnmpSinkWriteChange(sink, itemCount, *change.varBind, kinds[change.kind], change.hasRate ? &change.rate : NULL);
+    };
+
+    ULONGLONG cycleStart = GetTickCount64();
+    for (int cycle = 1; cycles == 0 || cycle <= cycles; cycle++) {
+        // sysUpTime.0 - в начале каждого цикла, мимо кэша: по нему считается интервал
+        AsnAny upTime;
+        AsnInteger errorStatus;
+        bool hasUpTime = SnmpGetRequest(session, sysUpTime, upTime, errorStatus, false)
+            && upTime.asnType == ASN_TIMETICKS;
+        SnmpDeltaBegin(cache, hasUpTime, hasUpTime ? upTime.asnValue.ticks : 0, GetTickCount64());
+
+        bool ordered = true;
+        bool walked = SnmpBulkWalk(session, baseOid, 25, [&](RFC1157VarBind& varBind) {
+            if (ordered && !SnmpDeltaUpdate(cache, varBind, onChange)) ordered = false;
+        });
+
+        if (walked && ordered) {
+            SnmpDeltaEnd(cache, onChange);
+            SnmpOutputFlush(*sink.output);
+            SnmpSinkLog(sink) << "=== Cycle " << cycle << ": " << cache.emitted << " of " << cache.total
+                << " values changed" << (cache.discontinuity && cycle > 1 ? " (agent restarted, no rates)" : "")
+                << " ===" << std::endl;
+        }
         else {
             DWORD lastError = GetLastError();
-            std::cerr << "SnmpMgrRequest failed. System error: " << lastError << std::endl;
-            moreItems = false;
+            SnmpDeltaAbort(cache);
+            SnmpOutputFlush(*sink.output);
+            std::cerr << "Cycle " << cycle << " failed. System error: " << lastError << std::endl;
+        }
+
+        if (cycles != 0 && cycle >= cycles) break;
+
+        // Следующий цикл отсчитывается от планового начала, как в poll
+        cycleStart += interval;
+        ULONGLONG now = GetTickCount64();
+        if (cycleStart > now) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(cycleStart - now));
+        }
+        else {
+            cycleStart = now;
         }
     }
 
-    std::cout << "=== Found " << itemCount << " items ===" << std::endl;
+    return true;
+}
+
+// Функция для разбора аргументов обхода: <OID> [число] [-f text|ndjson|csv|binary|snmprec] [-o файл]
+bool ParseWalkArguments(const std::string& text, std::string& oidString, UINT& number,
+    SnmpSinkFormat& format, std::string& outputPath) {
+    std::istringstream args(text);
+    std::string token;
+    while (args >> token) {
+        if (token == "-f") {
+            if (!(args >> token) || !SnmpSinkParseFormat(token, format)) {
+                std::cerr << "Unknown output format: " << token << " (use text, ndjson, csv, binary or snmprec)" << std::endl;
+                return false;
+            }
+        }
+        else if (token == "-o") {
+            if (!(args >> outputPath)) {
+                std::cerr << "Missing file name after -o" << std::endl;
+                return false;
+            }
+        }
+        else if (oidString.empty()) {
+            oidString = token;
+        }
+        else {
+            UINT value = (UINT)strtoul(token.c_str(), NULL, 10);
+            if (value != 0) number = value;
+        }
+    }
 
-    // Очистка памяти
-    /*if (lastOid.ids) {
-        SnmpUtilMemFree(lastOid.ids);
-    }*/
-    if (varBindList.list) {
-        SnmpUtilMemFree(varBindList.list);
+    if (format == SNMP_SINK_BINARY && outputPath.empty()) {
+        std::cerr << "Binary output needs a file: -o <file>" << std::endl;
+        return false;
     }
-    //SnmpUtilMemFree(baseOid.ids);
+    return true;
+}
 
-    return itemCount > 0;
+// Функция для подготовки приёмника строк обхода: stdout или файл outputPath
+bool OpenWalkSink(SnmpSinkFormat format, const std::string& outputPath, std::ofstream& file,
+    SnmpOutput& fileOutput, SnmpSink& sink) {
+    sink.format = format;
+    sink.mib = &mibIndex;
+    sink.output = &output;
+
+    if (!outputPath.empty()) {
+        file.open(outputPath, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            std::cerr << "Cannot create output file: " << outputPath << std::endl;
+            return false;
+        }
+        fileOutput.stream = &file;
+        sink.output = &fileOutput;
+    }
+
+    SnmpSinkBegin(sink);
+    return true;
 }
 
-// Функция для выполнения SNMP GET запроса (оставлена для обратной совместимости)
-bool SnmpGetRequest(HANDLE hSnmp, const std::vector<UINT>& oidArray, AsnAny& result) {
-    AsnObjectIdentifier reqObject;
-    RFC1157VarBindList varBindList;
-    AsnInteger errorStatus;
-    AsnInteger errorIndex;
+// Функция для загрузки индекса MIB: готовый файл отображается в память,
+// без него индекс строится из встроенной части MIB-2
+void LoadMibIndex(std::ostream& log = std::cout) {
+    if (SnmpMibOpen(mibIndex, SNMP_MIB_DEFAULT_INDEX)) {
+        log << "MIB index loaded: " << SNMP_MIB_DEFAULT_INDEX
+            << " (" << mibIndex.nameCount << " names)" << std::endl;
+        return;
+    }
+    if (GetLastError() == SNMP_MIB_ERROR_FORMAT) {
+        std::cerr << "MIB index " << SNMP_MIB_DEFAULT_INDEX << " is damaged, using built-in MIB" << std::endl;
+    }
 
-    // Настройка OID
-    reqObject.idLength = (UINT)oidArray.size();
-    reqObject.ids = (UINT*)SnmpUtilMemAlloc(oidArray.size() * sizeof(UINT));
-    if (!reqObject.ids) return false;
+    std::vector<SnmpMibDefinition> definitions;
+    SnmpMibBuiltinDefinitions(definitions);
+    std::vector<UINT> image;
+    size_t unresolved = 0;
+    SnmpMibBuild(definitions, image, unresolved);
+    SnmpMibAttach(mibIndex, std::move(image));
+}
 
-    for (size_t i = 0; i < oidArray.size(); i++) {
-        reqObject.ids[i] = oidArray[i];
+// Функция для компиляции файлов MIB в индекс (встроенная часть MIB-2 добавляется всегда)
+bool SnmpCompileMib(const std::string& indexPath, const std::vector<std::string>& sources) {
+    std::vector<SnmpMibDefinition> definitions;
+    SnmpMibBuiltinDefinitions(definitions);
+    size_t builtinCount = definitions.size();
+    for (const std::string& source : sources) {
+        if (!SnmpMibParseFile(source, definitions)) {
+            return false;
+        }
     }
 
-    varBindList.list = (RFC1157VarBind*)SnmpUtilMemAlloc(sizeof(RFC1157VarBind));
-    if (!varBindList.list) {
-        SnmpUtilMemFree(reqObject.ids);
+    std::vector<UINT> image;
+    size_t unresolved = 0;
+    if (!SnmpMibBuild(definitions, image, unresolved) || !SnmpMibWriteFile(indexPath, image)) {
         return false;
     }
 
-    varBindList.len = 1;
-    varBindList.list[0].name = reqObject;
-    varBindList.list[0].value.asnType = ASN_NULL;
+    std::cout << "Parsed " << definitions.size() - builtinCount << " definitions from MIB files" << std::endl;
+    if (unresolved > 0) {
+        std::cout << "Skipped " << unresolved << " definitions with unknown parent (load the imported MIBs too)" << std::endl;
+    }
+    std::cout << "MIB index written: " << indexPath << " (" << image.size() * sizeof(UINT) << " bytes)" << std::endl;
 
-    bool success = false;
+    // Дальше в этом запуске используется новый индекс
+    if (!SnmpMibOpen(mibIndex, indexPath)) {
+        SnmpMibAttach(mibIndex, std::move(image));
+    }
+    return true;
+}
 
-    LPSTR str_oid;
-    SnmpMgrOidToStr(&reqObject, &str_oid);
-    std::cout << "Name of element (from OID): " << str_oid << "\n";
+// Функция для команды metrics: без ключей печатает метрики в формате Prometheus,
+// -l запускает HTTP-эндпоинт /metrics, -o - периодическую запись в файл, stop - останавливает экспорт
+bool SnmpMetricsCommand(const std::string& text, SnmpMetricsExporter& exporter) {
+    std::istringstream args(text);
+    std::string listenAddress, dumpPath, arg;
+    DWORD interval = 10;
 
-    SetLastError(0);
+    while (args >> arg) {
+        if (arg == "stop") {
+            SnmpMetricsExporterStop(exporter);
+            std::cout << "Metrics export stopped" << std::endl;
+            return true;
+        }
+        if (arg == "-l" && args >> listenAddress) continue;
+        if (arg == "-o" && args >> dumpPath) continue;
+        if (arg == "-i" && args >> interval && interval > 0) continue;
+
+        std::cerr << "Usage: metrics [-l 127.0.0.1:9116] [-o metrics.prom [-i 10]] | metrics stop" << std::endl;
+        return false;
+    }
+
+    if (listenAddress.empty() && dumpPath.empty()) {
+        std::string metrics;
+        SnmpMetricsFormatPrometheus(metrics);
+        std::cout << metrics;
+        return true;
+    }
+
+    // Новые настройки заменяют работающий экспорт
+    SnmpMetricsExporterStop(exporter);
+    exporter.listenAddress = listenAddress;
+    exporter.dumpPath = dumpPath;
+    exporter.dumpInterval = interval * 1000;
+    if (!SnmpMetricsExporterStart(exporter)) {
+        std::cerr << "Cannot listen on " << listenAddress << ". Error code: " << GetLastError() << std::endl;
+        return false;
+    }
+
+    if (!listenAddress.empty()) {
+        std::cout << "Serving metrics on http://" << listenAddress << "/metrics" << std::endl;
+    }
+    if (!dumpPath.empty()) {
+        std::cout << "Writing metrics to " << dumpPath << " every " << interval << " s" << std::endl;
+    }
+    return true;
+}
+
+// Функция для команды cache: on [TTL, с] | off | ttl <OID> <с> | clear | без аргументов - состояние.
+// Кэш обслуживает GET, get_bulk и get_all без потоков.
+bool SnmpCacheCommand(const std::string& text) {
+    std::istringstream args(text);
+    std::string command;
+    args >> command;
+
+    if (command == "on") {
+        DWORD ttl = 0;
+        if (args >> ttl) responseCache.ttl = ttl * 1000;
+        responseCacheEnabled = true;
+        std::cout << "Response cache enabled, TTL " << responseCache.ttl / 1000.0 << " s" << std::endl;
+        return true;
+    }
+    if (command == "off") {
+        responseCacheEnabled = false;
+        SnmpCacheClear(responseCache);
+        std::cout << "Response cache disabled" << std::endl;
+        return true;
+    }
+    if (command == "clear") {
+        SnmpCacheClear(responseCache);
+        std::cout << "Response cache cleared" << std::endl;
+        return true;
+    }
+    if (command == "ttl") {
+        std::string oidString;
+        double seconds = -1;
+        SnmpOid subtree;
+        if (!(args >> oidString >> seconds) || seconds < 0 || !ParseOIDString(oidString, subtree)) {
+            std::cerr << "Usage: cache ttl <OID> <seconds>" << std::endl;
+            return false;
+        }
+        SnmpCacheSetTtl(responseCache, subtree, (DWORD)(seconds * 1000));
+        std::cout << "TTL of " << subtree.ToString() << " set to " << seconds << " s" << std::endl;
+        return true;
+    }
+    if (!command.empty()) {
+        std::cerr << "Usage: cache [on [ttl-s] | off | ttl <OID> <seconds> | clear]" << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(responseCache.mutex);
+    std::cout << "Response cache " << (responseCacheEnabled ? "enabled" : "disabled") << ", TTL "
+        << responseCache.ttl / 1000.0 << " s" << std::endl;
+    for (const SnmpCacheRule& rule : responseCache.rules) {
+        std::cout << "  " << rule.subtree.ToString() << "\t" << rule.ttl / 1000.0 << " s" << std::endl;
+    }
+    std::cout << "Hits: " << responseCache.hits << ", merged: " << responseCache.merged
+        << ", misses: " << responseCache.misses << std::endl;
+    return true;
+}
+
+// Флаг остановки службы по SIGINT/SIGTERM
+static std::atomic<bool> stopRequested(false);
+
+static void OnStopSignal(int) {
+    stopRequested = true;
+}
+
+static void PrintDaemonUsage() {
+    std::cerr << "Usage: manageSNMP --daemon <targets-file> [options]\n"
+        << "  -i seconds       poll interval (default 60)\n"
+        << "  -t threads       poller threads, 0 - one per core (default 1)\n"
+        << "  -c count         requests in flight per agent, 0 - unlimited (default 1)\n"
+        << "  -r packets       datagrams per second per agent, 0 - unlimited (default 10)\n"
+        << "  -l host:port     serve Prometheus metrics on http://host:port/metrics\n"
+        << "  -o file          write metrics to a file every 10 s\n"
+        << "Without arguments manageSNMP runs interactively.\n";
+}
 
-    if (SnmpMgrRequest(hSnmp, SNMP_PDU_GET, &varBindList, &errorStatus, &errorIndex)) {
-        if (errorStatus == SNMP_ERRORSTATUS_NOERROR) {
-            result = varBindList.list[0].value;
-            success = true;
+// Функция режима службы: опрос списка агентов без диалога до SIGINT/SIGTERM.
+// Цели разносятся по периоду, нагрузка на каждого агента ограничена.
+// Результаты идут в stdout, сообщения и итоги - в stderr.
+static int RunDaemon(int argc, char* argv[]) {
+    if (argc < 3) {
+        PrintDaemonUsage();
+        return 1;
+    }
+    std::string path = argv[2];
+
+    SnmpPollerOptions options;
+    options.interval = 60000;
+    options.cycles = 0;
+    options.spread = true;
+    options.maxAgentInFlight = 1;
+    options.maxAgentRate = 10;
+    options.stop = &stopRequested;
+    SnmpMetricsExporter exporter;
+
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.size() != 2 || arg[0] != '-' || i + 1 >= argc) {
+            std::cerr << "Invalid argument: " << arg << std::endl;
+            PrintDaemonUsage();
+            return 1;
         }
-        else {
-            std::cout << "SNMP Error: " << SnmpErrorToString(errorStatus)
-                << " (code: " << errorStatus << ")" << std::endl;
+
+        std::string value = argv[++i];
+        switch (arg[1]) {
+        case 'i': options.interval = (DWORD)std::atoi(value.c_str()) * 1000; break;
+        case 't': options.threads = std::atoi(value.c_str()); break;
+        case 'c': options.maxAgentInFlight = std::atoi(value.c_str()); break;
+        case 'r': options.maxAgentRate = std::atof(value.c_str()); break;
+        case 'l': exporter.listenAddress = value; break;
+        case 'o': exporter.dumpPath = value; break;
+        default:
+            std::cerr << "Invalid argument: " << arg << std::endl;
+            PrintDaemonUsage();
+            return 1;
+        }
+    }
+    if (options.interval == 0) {
+        std::cerr << "Poll interval must be at least 1 s" << std::endl;
+        return 1;
+    }
+    options.jitter = options.interval / SNMP_POLL_JITTER_DIVISOR;
+
+    std::signal(SIGINT, OnStopSignal);
+    std::signal(SIGTERM, OnStopSignal);
+
+    LoadMibIndex(std::cerr);
+    if (!exporter.listenAddress.empty() || !exporter.dumpPath.empty()) {
+        if (!SnmpMetricsExporterStart(exporter)) {
+            std::cerr << "Cannot listen on " << exporter.listenAddress << ". Error code: " << GetLastError() << std::endl;
+            return 1;
+        }
+    }
+
+    bool success = SnmpPollTargets(path, options, std::cerr);
+    SnmpMetricsExporterStop(exporter);
+    return success ? 0 : 1;
+}
+
+// Пакетный режим: строк файла команд в одной порции. Результаты порции копятся в памяти
+// и выводятся по порядку строк, так что порция ограничивает расход памяти.
+#define SNMP_BATCH_CHUNK_LINES 4096
+
+// OID в одном запросе GET пакетного режима: длинные строки get делятся на несколько запросов,
+// чтобы ответ не упирался в размер сообщения агента (tooBig)
+#define SNMP_BATCH_GET_OIDS 32
+
+struct SnmpBatchOptions {
+    std::string community = "public";
+    int threads = 0;              // потоков обхода, 0 - по числу ядер
+    DWORD timeout = 5000;
+    int retries = 2;
+    int agentInFlight = 8;        // GET в полёте к одному агенту
+    SnmpSinkFormat format = SNMP_SINK_TEXT;
+};
+
+// Команда пакетного режима - одна строка файла. Её запросы - единицы firstUnit..firstUnit+unitCount-1.
+struct SnmpBatchCommand {
+    int line = 0;
+    std::string host;
+    size_t firstUnit = 0;
+    size_t unitCount = 0;
+};
+
+// Единица работы: один GET (часть OID строки get) или один обход.
+// Строки результата копятся в out, сообщения об ошибках - в errors.
+struct SnmpBatchUnit {
+    size_t command = 0;
+    SnmpOutput out;
+    SnmpSink sink;
+    std::string errors;
+};
+
+// Порция команд: GET идут через асинхронный поллер, обходы - через планировщик
+struct SnmpBatchChunk {
+    std::vector<SnmpBatchCommand> commands;
+    std::vector<SnmpBatchUnit> units;
+    std::vector<SnmpPollTarget> targets;
+    std::vector<size_t> targetUnits;
+    std::vector<SnmpWalkJob> jobs;
+    std::vector<size_t> jobUnits;
+};
+
+// Функция разбора строки файла команд:
+//   get <host> <OID> [OID ...] | get_all <host> <OID> | bulk <host> <OID> [max-repetitions]
+// Агент задаётся как host[:port] или community@host[:port].
+// Возвращает false и пишет причину в stderr для неверной строки; пустые строки и '#' пропускаются.
+static bool ParseBatchLine(const std::string& text, int lineNumber, const SnmpBatchOptions& options,
+    SnmpBatchChunk& chunk) {
+    std::istringstream fields(text);
+    std::string command, agent;
+    if (!(fields >> command) || command[0] == '#') return true;
+
+    bool isGet = command == "get";
+    if (!isGet && command != "get_all" && command != "bulk") {
+        std::cerr << "Line " << lineNumber << ": unknown command '" << command << "'" << std::endl;
+        return false;
+    }
+
+    std::string community = options.community;
+    fields >> agent;
+    size_t at = agent.rfind('@');
+    if (at != std::string::npos) {
+        community = agent.substr(0, at);
+        agent = agent.substr(at + 1);
+    }
+
+    std::vector<SnmpOid> oids;
+    UINT maxRepetitions = 0;
+    std::string token;
+    while (fields >> token) {
+        // Числовой аргумент после OID у bulk - max-repetitions
+        if (command == "bulk" && oids.size() == 1 && isdigit((unsigned char)token[0]) &&
+            token.find('.') == std::string::npos) {
+            maxRepetitions = (UINT)strtoul(token.c_str(), NULL, 10);
+            continue;
+        }
+        SnmpOid oid;
+        if (!ParseOIDString(token, oid)) {
+            std::cerr << "Line " << lineNumber << ": invalid OID " << token << std::endl;
+            return false;
+        }
+        oids.push_back(oid);
+    }
+
+    if (agent.empty() || community.empty() || oids.empty() || (!isGet && oids.size() > 1)) {
+        std::cerr << "Line " << lineNumber << ": expected '" << command
+            << (isGet ? " <host> <OID> [OID ...]'" : " <host> <OID>'") << std::endl;
+        return false;
+    }
+
+    SnmpBatchCommand batchCommand;
+    batchCommand.line = lineNumber;
+    batchCommand.host = agent;
+    batchCommand.firstUnit = chunk.units.size();
+    size_t commandIndex = chunk.commands.size();
+
+    if (isGet) {
+        for (size_t first = 0; first < oids.size(); first += SNMP_BATCH_GET_OIDS) {
+            size_t last = std::min(oids.size(), first + SNMP_BATCH_GET_OIDS);
+            SnmpPollTarget target;
+            target.hostname = agent;
+            target.community = community;
+            target.oids.assign(oids.begin() + first, oids.begin() + last);
+            chunk.targets.push_back(std::move(target));
+            chunk.targetUnits.push_back(chunk.units.size());
+            chunk.units.emplace_back();
+            chunk.units.back().command = commandIndex;
         }
     }
     else {
-        DWORD lastError = GetLastError();
-        std::cerr << "SnmpMgrRequest failed. System error: " << lastError << std::endl;
+        // get_all обходит поддерево с max-repetitions по умолчанию
+        SnmpWalkJob job{ agent, community, oids[0] };
+        job.maxRepetitions = maxRepetitions;
+        chunk.jobs.push_back(std::move(job));
+        chunk.jobUnits.push_back(chunk.units.size());
+        chunk.units.emplace_back();
+        chunk.units.back().command = commandIndex;
+    }
+
+    batchCommand.unitCount = chunk.units.size() - batchCommand.firstUnit;
+    chunk.commands.push_back(std::move(batchCommand));
+    return true;
+}
+
+// Функция добавления сообщения об ошибке к результату команды: "Line N: host\t..."
+static std::string& SnmpBatchError(SnmpBatchChunk& chunk, SnmpBatchUnit& unit) {
+    const SnmpBatchCommand& command = chunk.commands[unit.command];
+    unit.errors.append("Line ").append(std::to_string(command.line)).append(": ");
+    unit.errors.append(command.host).push_back('\t');
+    return unit.errors;
+}
+
+// Функция выполнения порции: GET всех строк одновременно в полёте через поллер,
+// обходы - параллельно на потоках планировщика. Затем результаты выводятся по порядку строк.
+static void RunBatchChunk(SnmpBatchChunk& chunk, const SnmpBatchOptions& options,
+    size_t& failedCommands, SnmpPollerStats& pollStats, SnmpSchedulerStats& walkStats) {
+    // Указатели приёмников ставятся, когда массивы единиц и команд уже не растут
+    for (SnmpBatchUnit& unit : chunk.units) {
+        unit.sink.format = options.format;
+        unit.sink.mib = &mibIndex;
+        unit.sink.output = &unit.out;
+        unit.sink.host = chunk.commands[unit.command].host.c_str();
+        unit.sink.hold = true;
     }
 
-    // Очистка памяти
-    if (varBindList.list) {
-        if (varBindList.list[0].name.ids) {
-            SnmpUtilMemFree(varBindList.list[0].name.ids);
+    // Адреса GET разрешаются заранее (повторы имён - из кэша); неразрешённые цели выбывают
+    std::vector<std::string> hostnames;
+    hostnames.reserve(chunk.targets.size());
+    for (const SnmpPollTarget& target : chunk.targets) {
+        hostnames.push_back(target.hostname);
+    }
+    std::vector<SnmpResolveEntry> resolved;
+    SnmpResolveAll(SnmpResolveGlobalCache(), hostnames, resolved);
+
+    size_t count = 0;
+    for (size_t i = 0; i < chunk.targets.size(); i++) {
+        if (resolved[i].error != 0) {
+            SnmpBatchError(chunk, chunk.units[chunk.targetUnits[i]]).append("Cannot resolve host. Error code: ")
+                .append(std::to_string(resolved[i].error)).push_back('\n');
+            continue;
+        }
+        chunk.targets[i].address = resolved[i].address;
+        chunk.targets[i].addressLength = resolved[i].addressLength;
+        if (count != i) {
+            chunk.targets[count] = std::move(chunk.targets[i]);
+            chunk.targetUnits[count] = chunk.targetUnits[i];
         }
-        SnmpUtilMemFree(varBindList.list);
+        count++;
     }
+    chunk.targets.resize(count);
+    chunk.targetUnits.resize(count);
 
-    return success;
+    // Обработчики пишут только в свою единицу, поэтому блокировки не нужны
+    auto onResult = [&chunk](const SnmpPollResult& result) {
+        SnmpBatchUnit& unit = chunk.units[chunk.targetUnits[result.targetIndex]];
+        if (result.response == NULL) {
+            if (result.error == SNMP_UDP_ERROR_DOWN) {
+                SnmpBatchError(chunk, unit).append("Skipped: agent is down, waiting for the next probe\n");
+            }
+            else {
+                SnmpBatchError(chunk, unit).append("Timeout: No Response\n");
+            }
+            return;
+        }
+
+        const SnmpPdu& response = *result.response;
+        if (response.errorStatus != SNMP_ERRORSTATUS_NOERROR) {
+            std::string& out = SnmpBatchError(chunk, unit);
+            out.append("SNMP Error: ").append(SnmpErrorToString(response.errorStatus)).append(" (code: ");
+            SnmpFormatSigned(out, response.errorStatus);
+            out.append(", index: ");
+            SnmpFormatSigned(out, response.errorIndex);
+            out.append(")\n");
+            return;
+        }
+
+        for (UINT i = 0; i < response.varBinds.len; i++) {
+            SnmpSinkWrite(unit.sink, (int)i + 1, response.varBinds.list[i]);
+        }
+    };
+
+    SnmpPollerOptions pollOptions;
+    pollOptions.timeout = options.timeout;
+    pollOptions.retries = options.retries;
+    pollOptions.cycles = 1;
+    pollOptions.maxAgentInFlight = options.agentInFlight;
+
+    bool pollSuccess = true;
+    DWORD pollError = 0;
+    std::thread poller;
+    if (!chunk.targets.empty()) {
+        poller = std::thread([&]() {
+            pollSuccess = SnmpPollerRun(chunk.targets, pollOptions, onResult, pollStats);
+            if (!pollSuccess) pollError = GetLastError();
+        });
+    }
+
+    std::vector<size_t> walkCounts(chunk.jobs.size(), 0);
+    auto onVarBind = [&chunk, &walkCounts](int, size_t job, RFC1157VarBind& varBind) {
+        SnmpSinkWrite(chunk.units[chunk.jobUnits[job]].sink, (int)++walkCounts[job], varBind);
+    };
+    auto onDone = [&chunk](const SnmpWalkJobResult& result) {
+        if (result.success) return;
+        SnmpBatchError(chunk, chunk.units[chunk.jobUnits[result.job]]).append("Walk failed after ")
+            .append(std::to_string(result.count)).append(" item(s). Error code: ")
+            .append(std::to_string(result.error)).push_back('\n');
+    };
+
+    SnmpSchedulerOptions walkOptions;
+    walkOptions.threads = options.threads;
+    walkOptions.timeout = options.timeout;
+    walkOptions.retries = options.retries;
+    SnmpSchedulerRun(chunk.jobs, walkOptions, onVarBind, onDone, walkStats);
+
+    if (poller.joinable()) poller.join();
+    if (!pollSuccess) {
+        // Поллер не запустился (нет сокета): GET порции остались без ответа
+        for (size_t unit : chunk.targetUnits) {
+            if (chunk.units[unit].out.buffer.empty() && chunk.units[unit].errors.empty()) {
+                SnmpBatchError(chunk, chunk.units[unit]).append("SnmpPollerRun failed. System error: ")
+                    .append(std::to_string(pollError)).push_back('\n');
+            }
+        }
+    }
+
+    // Вывод по порядку строк: результаты - в stdout, ошибки - в stderr после результатов своей строки
+    for (const SnmpBatchCommand& command : chunk.commands) {
+        bool failed = false;
+        for (size_t i = command.firstUnit; i < command.firstUnit + command.unitCount; i++) {
+            SnmpBatchUnit& unit = chunk.units[i];
+            output.buffer.append(unit.out.buffer);
+            SnmpOutputCommit(output);
+            if (!unit.errors.empty()) {
+                SnmpOutputFlush(output);
+                std::cerr << unit.errors;
+                failed = true;
+            }
+        }
+        if (failed) failedCommands++;
+    }
+    SnmpOutputFlush(output);
+}
+
+static void PrintBatchUsage() {
+    std::cerr << "Usage: manageSNMP --batch <command-file | -> [options]\n"
+        << "  Each line: get <host> <OID> [OID ...] | get_all <host> <OID> | bulk <host> <OID> [max-repetitions]\n"
+        << "  host is host[:port] or community@host[:port]; '-' reads commands from stdin\n"
+        << "  -c community     default community (default public)\n"
+        << "  -j threads       walk threads, 0 - one per core (default 0)\n"
+        << "  -p count         GET requests in flight per agent, 0 - unlimited (default 8)\n"
+        << "  -t ms            timeout of one attempt (default 5000)\n"
+        << "  -r retries       retries after a timeout (default 2)\n"
+        << "  -f format        text, ndjson or csv (default text)\n"
+        << "Results go to stdout in the order of the command lines, errors and totals - to stderr.\n";
+}
+
+// Функция пакетного режима: команды из файла или stdin выполняются без диалога порциями
+// по SNMP_BATCH_CHUNK_LINES строк. Запросы порции идут одновременно (GET - конвейером
+// через общий сокет поллера, обходы - на нескольких потоках), вывод - в порядке строк.
+static int RunBatch(int argc, char* argv[]) {
+    if (argc < 3) {
+        PrintBatchUsage();
+        return 1;
+    }
+    std::string path = argv[2];
+
+    SnmpBatchOptions options;
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.size() != 2 || arg[0] != '-' || i + 1 >= argc) {
+            std::cerr << "Invalid argument: " << arg << std::endl;
+            PrintBatchUsage();
+            return 1;
+        }
+
+        std::string value = argv[++i];
+        switch (arg[1]) {
+        case 'c': options.community = value; break;
+        case 'j': options.threads = std::atoi(value.c_str()); break;
+        case 'p': options.agentInFlight = std::atoi(value.c_str()); break;
+        case 't': options.timeout = (DWORD)std::atoi(value.c_str()); break;
+        case 'r': options.retries = std::atoi(value.c_str()); break;
+        case 'f':
+            if (SnmpSinkParseFormat(value, options.format) &&
+                options.format != SNMP_SINK_BINARY && options.format != SNMP_SINK_SNMPREC) {
+                break;
+            }
+            std::cerr << "Batch mode writes text, ndjson or csv" << std::endl;
+            return 1;
+        default:
+            std::cerr << "Invalid argument: " << arg << std::endl;
+            PrintBatchUsage();
+            return 1;
+        }
+    }
+    if (options.timeout == 0 || options.retries < 0) {
+        std::cerr << "Timeout must be positive and retries must not be negative" << std::endl;
+        return 1;
+    }
+
+    std::ifstream file;
+    if (path != "-") {
+        file.open(path);
+        if (!file) {
+            std::cerr << "Cannot open command file: " << path << std::endl;
+            return 1;
+        }
+    }
+    std::istream& input = path == "-" ? std::cin : file;
+
+    LoadMibIndex(std::cerr);
+
+    if (options.format == SNMP_SINK_CSV) {
+        SnmpSink header;
+        header.format = SNMP_SINK_CSV;
+        header.output = &output;
+        header.host = "";
+        SnmpSinkBegin(header);
+    }
+
+    SnmpBatchChunk chunk;
+    SnmpPollerStats pollStats;
+    SnmpSchedulerStats walkStats;
+    size_t commandCount = 0, failedCommands = 0, invalidLines = 0;
+    ULONGLONG startTime = GetTickCount64();
+
+    std::string line;
+    int lineNumber = 0;
+    bool more = true;
+    while (more) {
+        chunk = SnmpBatchChunk();
+        int chunkLines = 0;
+        while (chunkLines < SNMP_BATCH_CHUNK_LINES && (more = (bool)std::getline(input, line))) {
+            lineNumber++;
+            chunkLines++;
+            if (!ParseBatchLine(line, lineNumber, options, chunk)) invalidLines++;
+        }
+        if (chunk.commands.empty()) continue;
+
+        commandCount += chunk.commands.size();
+        RunBatchChunk(chunk, options, failedCommands, pollStats, walkStats);
+    }
+    ULONGLONG elapsed = GetTickCount64() - startTime;
+
+    std::cerr << "=== Batch completed ===" << std::endl;
+    std::cerr << "Commands: " << commandCount << ", failed: " << failedCommands << ", invalid lines: " << invalidLines
+        << ", GET responses: " << pollStats.responses << ", walked items: " << walkStats.varBinds << std::endl;
+    std::cerr << "Elapsed: " << elapsed << " ms" << std::endl;
+
+    return failedCommands == 0 && invalidLines == 0 ? 0 : 2;
+}
+
+static void PrintArchiveUsage() {
+    std::cerr << "Usage: manageSNMP --archive <command>\n"
+        << "  info <file>                    items, blocks and time of an archive\n"
+        << "  get <file> <OID>               value of one OID\n"
+        << "  scan <file> [OID]              all items of the subtree\n"
+        << "  diff <old-file> <new-file> [OID]  added, changed and removed items of the subtree\n"
+        << "Archives are saved by the interactive command archive_save; no agent is contacted.\n";
+}
+
+// Функция режима чтения архивов обхода: без диалога и без сети
+static int RunArchive(int argc, char* argv[]) {
+    if (argc < 3) {
+        PrintArchiveUsage();
+        return 1;
+    }
+
+    LoadMibIndex(std::cerr);
+    std::vector<std::string> args(argv + 2, argv + argc);
+    return SnmpArchiveCommand(args) ? 0 : 1;
+}
+
+// Поток для приглашений и заставки диалога: если stdout перенаправлен в файл или канал,
+// они уходят в stderr и не попадают в результаты
+static std::ostream& ConsoleStream() {
+#ifdef _WIN32
+    static bool terminal = _isatty(_fileno(stdout)) != 0;
+#else
+    static bool terminal = isatty(fileno(stdout)) != 0;
+#endif
+    return terminal ? std::cout : std::cerr;
+}
+
+// Список команд диалога: печатается при подключении и по команде help
+static void PrintCommandUsage(std::ostream& console) {
+    console << "\nCommands:\n"
+        << "  <OID>                                  GET of one value\n"
+        << "  get_all <OID> [streams]                GET SUBTREE\n"
+        << "  get_bulk <OID> [max-repetitions]       GET SUBTREE via GETBULK\n"
+        << "    (get_all and get_bulk accept '-f text|ndjson|csv|binary|snmprec' and '-o <file>')\n"
+        << "  get_multi <OID> <OID> ...              one batched GET\n"
+        << "  get_table <table-OID> [max-repetitions]  show a table by rows\n"
+        << "  archive_save <OID> <file> [max-repetitions]  save a walk to an archive\n"
+        << "  archive info|get|scan|diff ...         read saved archives\n"
+        << "  poll <targets-file> [interval-s] [cycles] [threads]  poll many agents\n"
+        << "  walk_targets <targets-file> [threads] [max-repetitions]  walk the listed OIDs of many agents\n"
+        << "  if_speeds <targets-file> [max-repetitions]  speeds of interfaces that are up on many agents\n"
+        << "  watch <OID> [interval-s] [-n cycles] [-f text|ndjson|csv] [-o <file>]  poll only changes\n"
+        << "  mib_compile <index-file> <MIB file or directory> ...  build a MIB index\n"
+        << "  metrics [-l host:port] [-o <file> [-i seconds]] | metrics stop  show or export request metrics\n"
+        << "  cache [on [ttl-s] | off | ttl <OID> <seconds> | clear]  serve repeated requests from a response cache\n"
+        << "  help                                   this list\n"
+        << "  quit                                   exit" << std::endl;
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+#ifdef _WIN32
     // Инициализация Winsock
     WSADATA wsaData;
     if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
         std::cerr << "WSAStartup failed" << std::endl;
         return 1;
     }
+#endif
+
+    // С аргументами - режим без диалога
+    if (argc > 1) {
+        int exitCode = 1;
+        if (std::string(argv[1]) == "--daemon") {
+            exitCode = RunDaemon(argc, argv);
+        }
+        else if (std::string(argv[1]) == "--batch") {
+            exitCode = RunBatch(argc, argv);
+        }
+        else if (std::string(argv[1]) == "--archive") {
+            exitCode = RunArchive(argc, argv);
+        }
+        else {
+            std::cerr << "Unknown mode: " << argv[1] << std::endl;
+            PrintDaemonUsage();
+            PrintBatchUsage();
+            PrintArchiveUsage();
+        }
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        return exitCode;
+    }
 
     // Параметры подключения
     std::string hostname, community;
+    std::ostream& console = ConsoleStream();
 
-    std::cout << "=== SNMP GET/GET SUBTREE Client ===" << std::endl;
+    console << "=== SNMP GET/GET SUBTREE Client ===" << std::endl;
+
+    LoadMibIndex(console);
 
     // Ввод параметров
-    std::cout << "Enter SNMP host [demo.pysnmp.com]: ";
+    console << "Enter SNMP host [demo.pysnmp.com]: ";
     std::getline(std::cin, hostname);
     if (hostname.empty()) hostname = "demo.pysnmp.com";
 
-    std::cout << "Enter community string [public]: ";
+    console << "Enter community string [public]: ";
     std::getline(std::cin, community);
     if (community.empty()) community = "public";
 
     // Открываем SNMP сессию
-    std::cout << "Connecting to " << hostname << " with community '" << community << "'..." << std::endl;
-
-    HANDLE hSnmp = SnmpMgrOpen(
-        const_cast<LPSTR>(hostname.c_str()),
-        const_cast<LPSTR>(community.c_str()),
-        5000,
-        2
-    );
+    console << "Connecting to " << hostname << " with community '" << community << "'..." << std::endl;
 
-    if (hSnmp == NULL) {
+    // GET/GETNEXT идут как SNMPv1 (как раньше через mgmtapi), GETBULK - как SNMPv2c
+    SnmpUdpSession session;
+    if (!SnmpUdpOpen(session, hostname, community, 5000, 2, SNMP_VERSION_V1)) {
         DWORD error = GetLastError();
-        std::cerr << "SnmpMgrOpen failed. Error code: " << error << std::endl;
-
-        if (error == 1231) {
-            std::cerr << "Network error: Cannot reach the SNMP agent." << std::endl;
-        }
+        std::cerr << "SnmpUdpOpen failed. Error code: " << error << std::endl;
+        std::cerr << "Network error: Cannot resolve the SNMP agent address." << std::endl;
 
+#ifdef _WIN32
         WSACleanup();
+#endif
         return 1;
     }
 
-    std::cout << "SNMP session opened successfully!" << std::endl;
+    console << "SNMP session opened successfully!" << std::endl;
 
-    std::cout << "\nAvailable OID examples for GET SUBTREE:" << std::endl;
-    std::cout << "1.3.6.1.2.1.1     - System group (complete system info)" << std::endl;
-    std::cout << "1.3.6.1.2.1.2     - Interfaces group (network interfaces)" << std::endl;
-    std::cout << "1.3.6.1.2.1.4     - IP group" << std::endl;
-    std::cout << "1.3.6.1.2.1.5     - ICMP group" << std::endl;
-    std::cout << "\nFor single value GET requests, use specific OIDs:" << std::endl;
-    std::cout << "1.3.6.1.2.1.1.1.0 - System description" << std::endl;
-    std::cout << "1.3.6.1.2.1.1.3.0 - System uptime" << std::endl;
+    console << "\nAvailable OID examples for GET SUBTREE:" << std::endl;
+    console << "1.3.6.1.2.1.1     - System group (complete system info)" << std::endl;
+    console << "1.3.6.1.2.1.2     - Interfaces group (network interfaces)" << std::endl;
+    console << "1.3.6.1.2.1.4     - IP group" << std::endl;
+    console << "1.3.6.1.2.1.5     - ICMP group" << std::endl;
+    console << "\nFor single value GET requests, use specific OIDs:" << std::endl;
+    console << "1.3.6.1.2.1.1.1.0 - System description" << std::endl;
+    console << "1.3.6.1.2.1.1.3.0 - System uptime" << std::endl;
+    PrintCommandUsage(console);
+
+    // Экспорт метрик запускается командой metrics и работает до выхода
+    SnmpMetricsExporter exporter;
 
     // Основной цикл запросов
     while (true) {
         std::string input;
-        std::cout << "\nEnter OID for GET, 'get_all <OID>' for GET SUBTREE, or 'quit' to exit: ";
-        std::getline(std::cin, input);
+        console << "\nEnter OID or command ('help' for the list, 'quit' to exit): ";
+        // Конец ввода (EOF или закрытый stdin) завершает работу, иначе цикл крутился бы вечно
+        if (!std::getline(std::cin, input)) {
+            break;
+        }
 
         if (input == "quit" || input == "exit") {
             break;
@@ -593,49 +1865,296 @@ int main() {
             continue;
         }
 
+        if (input == "help") {
+            PrintCommandUsage(console);
+            continue;
+        }
+
         // Обработка WALK команды
         if (input.find("get_all ") == 0) {
-            std::string oidString = input.substr(8);
+            std::string oidString, outputPath;
+            UINT streams = 1;
+            SnmpSinkFormat format = SNMP_SINK_TEXT;
+            if (!ParseWalkArguments(input.substr(8), oidString, streams, format, outputPath)) {
+                continue;
+            }
 
-            std::vector<UINT> oidArray;
-            if (!ParseOIDString(oidString, oidArray)) {
+            SnmpOid oid;
+            if (!ParseOIDString(oidString, oid)) {
                 std::cerr << "Invalid OID format. Use format: 1.3.6.1.2.1.1" << std::endl;
                 continue;
             }
 
-            SnmpWalkRequest(hSnmp, oidArray);
+            std::ofstream file;
+            SnmpOutput fileOutput;
+            SnmpSink sink;
+            if (!OpenWalkSink(format, outputPath, file, fileOutput, sink)) {
+                continue;
+            }
+
+            if (streams > 1) {
+                SnmpParallelWalkRequest(session, oid, streams, sink);
+            }
+            else {
+                SnmpWalkRequest(session, oid, sink);
+            }
+            SnmpSinkEnd(sink);
+        }
+        // Обработка WALK через GETBULK
+        else if (input.find("get_bulk ") == 0) {
+            std::string oidString, outputPath;
+            UINT maxRepetitions = 25;
+            SnmpSinkFormat format = SNMP_SINK_TEXT;
+            if (!ParseWalkArguments(input.substr(9), oidString, maxRepetitions, format, outputPath)) {
+                continue;
+            }
+
+            SnmpOid oid;
+            if (!ParseOIDString(oidString, oid)) {
+                std::cerr << "Invalid OID format. Use format: 1.3.6.1.2.1.2.2 25" << std::endl;
+                continue;
+            }
+
+            std::ofstream file;
+            SnmpOutput fileOutput;
+            SnmpSink sink;
+            if (!OpenWalkSink(format, outputPath, file, fileOutput, sink)) {
+                continue;
+            }
+
+            SnmpBulkWalkRequest(session, oid, maxRepetitions, sink);
+            SnmpSinkEnd(sink);
+        }
+        // Таблица по строкам из колоночного снимка
+        else if (input.find("get_table ") == 0) {
+            std::istringstream args(input.substr(10));
+            std::string oidString;
+            UINT maxRepetitions = 25;
+            args >> oidString;
+            if (!(args >> maxRepetitions) || maxRepetitions == 0) {
+                maxRepetitions = 25;
+            }
+
+            SnmpOid oid;
+            if (!ParseOIDString(oidString, oid)) {
+                std::cerr << "Invalid OID format. Use format: get_table 1.3.6.1.2.1.2.2 25" << std::endl;
+                continue;
+            }
+
+            SnmpTableRequest(session, oid, maxRepetitions);
+        }
+        // Обход в архив для последующего поиска и сравнения
+        else if (input.find("archive_save ") == 0) {
+            std::istringstream args(input.substr(13));
+            std::string oidString, path;
+            UINT maxRepetitions = 25;
+            args >> oidString >> path;
+            if (!(args >> maxRepetitions) || maxRepetitions == 0) {
+                maxRepetitions = 25;
+            }
+
+            SnmpOid oid;
+            if (!ParseOIDString(oidString, oid) || path.empty()) {
+                std::cerr << "Invalid arguments. Use format: archive_save 1.3.6.1.2.1 walk.swar 25" << std::endl;
+                continue;
+            }
+
+            SnmpArchiveSaveRequest(session, oid, maxRepetitions, path);
+        }
+        // Чтение сохранённых архивов
+        else if (input.find("archive ") == 0) {
+            std::istringstream args(input.substr(8));
+            std::vector<std::string> words;
+            std::string word;
+            while (args >> word) {
+                words.push_back(word);
+            }
+            SnmpArchiveCommand(words);
+        }
+        // Пакетный GET нескольких OID
+        else if (input.find("get_multi ") == 0) {
+            std::istringstream args(input.substr(10));
+            std::string oidString;
+            std::vector<SnmpOid> oids;
+            bool valid = true;
+            while (args >> oidString) {
+                SnmpOid oid;
+                if (!ParseOIDString(oidString, oid)) {
+                    valid = false;
+                    break;
+                }
+                oids.push_back(oid);
+            }
+
+            if (!valid || oids.empty()) {
+                std::cerr << "Invalid OID format. Use format: 1.3.6.1.2.1.1.1.0 1.3.6.1.2.1.1.3.0" << std::endl;
+                continue;
+            }
+
+            SnmpGetMultiRequest(session, oids);
+        }
+        // Асинхронный опрос списка агентов
+        else if (input.find("poll ") == 0) {
+            std::istringstream args(input.substr(5));
+            std::string path;
+            DWORD interval = 60;
+            int cycles = 1;
+            int threads = 1;
+            args >> path;
+            if (!(args >> interval) || interval == 0) {
+                interval = 60;
+            }
+            if (!(args >> cycles) || cycles <= 0) {
+                cycles = 1;
+            }
+            if (!(args >> threads) || threads < 0) {
+                threads = 1;
+            }
+
+            // Многократный опрос разносится по периоду, чтобы запросы не уходили залпом
+            SnmpPollerOptions options;
+            options.interval = interval * 1000;
+            options.cycles = cycles;
+            options.threads = threads;
+            options.spread = cycles > 1;
+            options.jitter = options.interval / SNMP_POLL_JITTER_DIVISOR;
+            SnmpPollTargets(path, options, std::cout);
+        }
+        // Обход поддеревьев многих агентов на нескольких потоках
+        else if (input.find("walk_targets ") == 0) {
+            std::istringstream args(input.substr(13));
+            std::string path;
+            int threads = 0;
+            UINT maxRepetitions = 25;
+            args >> path;
+            if (!(args >> threads) || threads < 0) {
+                threads = 0;
+            }
+            if (!(args >> maxRepetitions) || maxRepetitions == 0) {
+                maxRepetitions = 25;
+            }
+
+            SnmpWalkTargets(path, threads, maxRepetitions);
+        }
+        // Скорости поднятых интерфейсов многих агентов
+        else if (input.find("if_speeds ") == 0) {
+            std::istringstream args(input.substr(10));
+            std::string path;
+            UINT maxRepetitions = 25;
+            args >> path;
+            if (!(args >> maxRepetitions) || maxRepetitions == 0) {
+                maxRepetitions = 25;
+            }
+
+            SnmpInterfaceSpeeds(path, maxRepetitions);
+        }
+        // Опрос изменений поддерева
+        else if (input.find("watch ") == 0) {
+            // -n отделяем до разбора общих аргументов обхода
+            std::string text = input.substr(6);
+            int cycles = 0;
+            size_t cyclesPosition = text.find(" -n ");
+            if (cyclesPosition != std::string::npos) {
+                std::istringstream cyclesArgs(text.substr(cyclesPosition + 4));
+                std::string rest;
+                cyclesArgs >> cycles;
+                std::getline(cyclesArgs, rest);
+                text = text.substr(0, cyclesPosition) + rest;
+            }
+
+            std::string oidString, outputPath;
+            UINT interval = 60;
+            SnmpSinkFormat format = SNMP_SINK_TEXT;
+            if (!ParseWalkArguments(text, oidString, interval, format, outputPath)) {
+                continue;
+            }
+            if (format == SNMP_SINK_BINARY || format == SNMP_SINK_SNMPREC) {
+                std::cerr << "watch writes text, ndjson or csv" << std::endl;
+                continue;
+            }
+
+            SnmpOid oid;
+            if (!ParseOIDString(oidString, oid)) {
+                std::cerr << "Invalid OID format. Use format: watch 1.3.6.1.2.1.2.2 60 -n 10" << std::endl;
+                continue;
+            }
+
+            std::ofstream file;
+            SnmpOutput fileOutput;
+            SnmpSink sink;
+            sink.changes = true;
+            if (!OpenWalkSink(format, outputPath, file, fileOutput, sink)) {
+                continue;
+            }
+
+            SnmpWatchRequest(session, oid, interval * 1000, cycles < 0 ? 0 : cycles, sink);
+            SnmpSinkEnd(sink);
+        }
+        // Компиляция файлов MIB в индекс для символьных имён
+        else if (input.find("mib_compile ") == 0) {
+            std::istringstream args(input.substr(12));
+            std::string indexPath, source;
+            std::vector<std::string> sources;
+            args >> indexPath;
+            while (args >> source) {
+                sources.push_back(source);
+            }
+
+            if (indexPath.empty() || sources.empty()) {
+                std::cerr << "Usage: mib_compile " << SNMP_MIB_DEFAULT_INDEX << " /usr/share/snmp/mibs" << std::endl;
+                continue;
+            }
+
+            SnmpCompileMib(indexPath, sources);
+        }
+        // Метрики запросов: вывод или экспорт по HTTP / в файл
+        else if (input == "metrics" || input.find("metrics ") == 0) {
+            SnmpMetricsCommand(input.substr(7), exporter);
+        }
+        // Кэш ответов: включение, TTL поддеревьев, счётчики
+        else if (input == "cache" || input.find("cache ") == 0) {
+            SnmpCacheCommand(input.substr(5));
         }
         else {
             // Обычный GET запрос
-            std::vector<UINT> oidArray;
-            if (!ParseOIDString(input, oidArray)) {
+            SnmpOid oid;
+            if (!ParseOIDString(input, oid)) {
                 std::cerr << "Invalid OID format. Use format: 1.3.6.1.2.1.1.1.0" << std::endl;
                 continue;
             }
 
-            std::cout << "Sending GET request for OID: ";
-            for (size_t i = 0; i < oidArray.size(); i++) {
-                std::cout << oidArray[i];
-                if (i < oidArray.size() - 1) std::cout << ".";
-            }
-            std::cout << std::endl;
+            std::cout << "Sending GET request for OID: " << oid.ToString() << std::endl;
+            std::cout << "Name of element (from OID): " << SnmpOidToName(oid.AsAsn()) << "\n";
 
             AsnAny result;
-            if (SnmpGetRequest(hSnmp, oidArray, result)) {
+            AsnInteger errorStatus;
+            if (SnmpGetRequest(session, oid, result, errorStatus)) {
                 std::cout << "Response: ";
-                PrintSnmpValue(result);
+                PrintSnmpValue(oid, result);
                 std::cout << std::endl;
             }
             else {
+                DWORD lastError = GetLastError();
+                if (lastError == SNMP_UDP_ERROR_AGENT) {
+                    std::cout << "SNMP Error: " << SnmpErrorToString(errorStatus)
+                        << " (code: " << errorStatus << ")" << std::endl;
+                }
+                else {
+                    PrintRequestError("SnmpUdpRequest", lastError);
+                }
                 std::cout << "Failed to get response for OID" << std::endl;
             }
         }
     }
 
+    SnmpMetricsExporterStop(exporter);
+
     // Закрытие сессии
-    SnmpMgrClose(hSnmp);
+    SnmpUdpClose(session);
+#ifdef _WIN32
     WSACleanup();
+#endif
 
-    std::cout << "Program completed" << std::endl;
+    console << "Program completed" << std::endl;
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,543 @@
+﻿#include "snmp_archive.h"
+
+#include <cstring>
+#include <ctime>
+#include <iostream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// Индекс блоков начинается с границы 8 байт: поля ULONGLONG читаются из отображения напрямую
+#define SNMP_ARCHIVE_INDEX_ALIGN 8
+
+static void SnmpArchivePutVarint(std::vector<BYTE>& out, ULONGLONG value) {
+    while (value >= 0x80) {
+        out.push_back((BYTE)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((BYTE)value);
+}
+
+// Чтение varint с проверкой границ: повреждённый файл не выводит разбор за конец блока
+static inline bool SnmpArchiveGetVarint(const BYTE*& data, const BYTE* end, ULONGLONG& value) {
+    // Дуги, длины и большинство чисел обхода укладываются в один байт
+    if (data != end && *data < 0x80) {
+        value = *data++;
+        return true;
+    }
+
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (data == end) return false;
+        BYTE byte = *data++;
+        value |= (ULONGLONG)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+static bool SnmpArchiveGetArc(const BYTE*& data, const BYTE* end, UINT& arc) {
+    ULONGLONG value;
+    if (!SnmpArchiveGetVarint(data, end, value) || value > 0xFFFFFFFFULL) return false;
+    arc = (UINT)value;
+    return true;
+}
+
+// Функция кодирования значения varbind (без типа и длины)
+static void SnmpArchiveEncodeValue(std::vector<BYTE>& out, const AsnAny& value) {
+    switch (value.asnType) {
+    case ASN_INTEGER: {
+        // zigzag: малые отрицательные числа тоже занимают один-два байта
+        long long number = value.asnValue.number;
+        SnmpArchivePutVarint(out, ((ULONGLONG)number << 1) ^ (ULONGLONG)(number >> 63));
+        break;
+    }
+    case ASN_COUNTER32:
+    case ASN_GAUGE32:
+    case ASN_TIMETICKS:
+    case ASN_UNSIGNED32:
+        SnmpArchivePutVarint(out, value.asnValue.unsigned32);
+        break;
+    case ASN_COUNTER64:
+        SnmpArchivePutVarint(out, value.asnValue.counter64.QuadPart);
+        break;
+    case ASN_OCTETSTRING:
+    case ASN_OPAQUE:
+    case ASN_BITS:
+    case ASN_IPADDRESS:
+        out.insert(out.end(), value.asnValue.string.stream, value.asnValue.string.stream + value.asnValue.string.length);
+        break;
+    case ASN_OBJECTIDENTIFIER:
+        for (UINT i = 0; i < value.asnValue.object.idLength; i++) {
+            SnmpArchivePutVarint(out, value.asnValue.object.ids[i]);
+        }
+        break;
+    default:
+        // NULL и исключения (noSuchObject и т.п.) - только тип
+        break;
+    }
+}
+
+// Функция разбора значения; строки указывают в data, дуги OID - в arcs
+static bool SnmpArchiveDecodeValue(BYTE type, const BYTE* data, UINT length, std::vector<UINT>& arcs, AsnAny& value) {
+    const BYTE* end = data + length;
+    memset(&value, 0, sizeof(value));
+    value.asnType = type;
+
+    ULONGLONG number;
+    switch (type) {
+    case ASN_INTEGER:
+        if (!SnmpArchiveGetVarint(data, end, number)) return false;
+        value.asnValue.number = (AsnInteger32)(long long)((number >> 1) ^ (0 - (number & 1)));
+        break;
+    case ASN_COUNTER32:
+    case ASN_GAUGE32:
+    case ASN_TIMETICKS:
+    case ASN_UNSIGNED32:
+        if (!SnmpArchiveGetVarint(data, end, number)) return false;
+        value.asnValue.unsigned32 = (AsnUnsigned32)number;
+        break;
+    case ASN_COUNTER64:
+        if (!SnmpArchiveGetVarint(data, end, number)) return false;
+        value.asnValue.counter64.QuadPart = number;
+        break;
+    case ASN_OCTETSTRING:
+    case ASN_OPAQUE:
+    case ASN_BITS:
+    case ASN_IPADDRESS:
+        value.asnValue.string.stream = (BYTE*)data;
+        value.asnValue.string.length = length;
+        value.asnValue.string.dynamic = FALSE;
+        break;
+    case ASN_OBJECTIDENTIFIER:
+        arcs.clear();
+        while (data < end) {
+            UINT arc;
+            if (!SnmpArchiveGetArc(data, end, arc)) return false;
+            arcs.push_back(arc);
+        }
+        value.asnValue.object.ids = arcs.data();
+        value.asnValue.object.idLength = (UINT)arcs.size();
+        break;
+    default:
+        break;
+    }
+    return true;
+}
+
+bool SnmpArchiveCreate(SnmpArchiveWriter& writer, const std::string& path) {
+    writer.file.close();
+    writer.file.clear();
+    writer.file.open(path, std::ios::binary | std::ios::trunc);
+    writer.path = path;
+    writer.block.clear();
+    writer.blockRecords = 0;
+    writer.last.clear();
+    writer.blocks.clear();
+    writer.firstArcs.clear();
+    writer.records = 0;
+    if (!writer.file) {
+        std::cerr << "Cannot create archive: " << path << std::endl;
+        return false;
+    }
+
+    SnmpArchiveHeader header;
+    header.magic = SNMP_ARCHIVE_MAGIC;
+    header.version = SNMP_ARCHIVE_FORMAT_VERSION;
+    header.created = (ULONGLONG)time(NULL);
+    writer.file.write((const char*)&header, sizeof(header));
+    writer.offset = sizeof(header);
+    return true;
+}
+
+// Функция записи собранного блока в файл
+static bool SnmpArchiveFlushBlock(SnmpArchiveWriter& writer) {
+    if (writer.block.empty()) return true;
+    if (!writer.file) return false;   // об ошибке записи уже сообщено
+
+    SnmpArchiveBlock& block = writer.blocks.back();
+    block.length = (UINT)writer.block.size();
+    block.records = writer.blockRecords;
+    writer.file.write((const char*)writer.block.data(), writer.block.size());
+    writer.offset += writer.block.size();
+    writer.block.clear();
+    writer.blockRecords = 0;
+    if (!writer.file) {
+        std::cerr << "Cannot write archive: " << writer.path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Функция кодирования записи: shared дуг имени берутся из прошлой записи блока
+static void SnmpArchiveEncodeRecord(SnmpArchiveWriter& writer, const RFC1157VarBind& varBind, size_t shared) {
+    std::vector<BYTE>& record = writer.record;
+    record.clear();
+    SnmpArchivePutVarint(record, shared);
+    SnmpArchivePutVarint(record, varBind.name.idLength - shared);
+    for (size_t i = shared; i < varBind.name.idLength; i++) {
+        SnmpArchivePutVarint(record, varBind.name.ids[i]);
+    }
+    record.push_back(varBind.value.asnType);
+
+    writer.value.clear();
+    SnmpArchiveEncodeValue(writer.value, varBind.value);
+    SnmpArchivePutVarint(record, writer.value.size());
+    record.insert(record.end(), writer.value.begin(), writer.value.end());
+}
+
+bool SnmpArchiveAppend(SnmpArchiveWriter& writer, const RFC1157VarBind& varBind) {
+    const UINT* ids = varBind.name.ids;
+    size_t length = varBind.name.idLength;
+    if (writer.records > 0 && SnmpOidCompare(writer.last.data(), writer.last.size(), ids, length) >= 0) {
+        SetLastError(ERROR_INVALID_PARAMETER);
+        return false;
+    }
+
+    size_t shared = 0;
+    if (!writer.block.empty()) {
+        while (shared < length && shared < writer.last.size() && writer.last[shared] == ids[shared]) shared++;
+    }
+    SnmpArchiveEncodeRecord(writer, varBind, shared);
+
+    // Не помещается - новый блок; его первая запись хранит имя целиком.
+    // Запись больше блока занимает отдельный блок.
+    if (!writer.block.empty() && writer.block.size() + writer.record.size() > SNMP_ARCHIVE_BLOCK_SIZE) {
+        if (!SnmpArchiveFlushBlock(writer)) return false;
+        SnmpArchiveEncodeRecord(writer, varBind, 0);
+    }
+
+    if (writer.block.empty()) {
+        SnmpArchiveBlock block;
+        block.offset = writer.offset;
+        block.length = 0;
+        block.records = 0;
+        block.firstOffset = (UINT)writer.firstArcs.size();
+        block.firstLength = (UINT)length;
+        writer.blocks.push_back(block);
+        writer.firstArcs.insert(writer.firstArcs.end(), ids, ids + length);
+    }
+
+    writer.block.insert(writer.block.end(), writer.record.begin(), writer.record.end());
+    writer.blockRecords++;
+    writer.records++;
+    writer.last.assign(ids, ids + length);
+    return true;
+}
+
+bool SnmpArchiveFinish(SnmpArchiveWriter& writer) {
+    if (!SnmpArchiveFlushBlock(writer)) {
+        writer.file.close();
+        return false;
+    }
+
+    static const char padding[SNMP_ARCHIVE_INDEX_ALIGN] = {};
+    size_t paddingLength = (size_t)((SNMP_ARCHIVE_INDEX_ALIGN - writer.offset % SNMP_ARCHIVE_INDEX_ALIGN) % SNMP_ARCHIVE_INDEX_ALIGN);
+    writer.file.write(padding, paddingLength);
+
+    SnmpArchiveTrailer trailer;
+    trailer.indexOffset = writer.offset + paddingLength;
+    trailer.records = writer.records;
+    trailer.blockCount = (UINT)writer.blocks.size();
+    trailer.arcCount = (UINT)writer.firstArcs.size();
+    trailer.magic = SNMP_ARCHIVE_MAGIC;
+    trailer.version = SNMP_ARCHIVE_FORMAT_VERSION;
+    writer.file.write((const char*)writer.blocks.data(), writer.blocks.size() * sizeof(SnmpArchiveBlock));
+    writer.file.write((const char*)writer.firstArcs.data(), writer.firstArcs.size() * sizeof(UINT));
+    writer.file.write((const char*)&trailer, sizeof(trailer));
+    writer.file.close();
+    if (!writer.file) {
+        std::cerr << "Cannot write archive: " << writer.path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool SnmpArchiveDetect(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    UINT magic = 0;
+    return file.read((char*)&magic, sizeof(magic)) && magic == SNMP_ARCHIVE_MAGIC;
+}
+
+// Проверка заголовка, хвоста и индекса: после неё чтение блоков не выходит за пределы файла
+static bool SnmpArchiveSetView(SnmpArchive& archive, const BYTE* base, size_t size) {
+    if (size < sizeof(SnmpArchiveHeader) + sizeof(SnmpArchiveTrailer)) return false;
+    const SnmpArchiveHeader* header = (const SnmpArchiveHeader*)base;
+    if (header->magic != SNMP_ARCHIVE_MAGIC || header->version != SNMP_ARCHIVE_FORMAT_VERSION) return false;
+
+    // Длина массива первых OID произвольна, поэтому хвост может быть не выровнен
+    SnmpArchiveTrailer trailer;
+    memcpy(&trailer, base + size - sizeof(trailer), sizeof(trailer));
+    if (trailer.magic != SNMP_ARCHIVE_MAGIC || trailer.version != SNMP_ARCHIVE_FORMAT_VERSION
+        || trailer.indexOffset < sizeof(SnmpArchiveHeader) || trailer.indexOffset % SNMP_ARCHIVE_INDEX_ALIGN != 0
+        || trailer.indexOffset > size - sizeof(trailer)) {
+        return false;
+    }
+
+    // Значения хвоста не складываются, а сравниваются с остатком файла: сумма могла бы переполниться
+    ULONGLONG indexSize = size - sizeof(trailer) - trailer.indexOffset;
+    if (trailer.blockCount > indexSize / sizeof(SnmpArchiveBlock)) return false;
+    indexSize -= (ULONGLONG)trailer.blockCount * sizeof(SnmpArchiveBlock);
+    if (trailer.arcCount > indexSize / sizeof(UINT) || trailer.arcCount * (ULONGLONG)sizeof(UINT) != indexSize) {
+        return false;
+    }
+
+    const SnmpArchiveBlock* blocks = (const SnmpArchiveBlock*)(base + trailer.indexOffset);
+    for (UINT i = 0; i < trailer.blockCount; i++) {
+        const SnmpArchiveBlock& block = blocks[i];
+        if (block.offset < sizeof(SnmpArchiveHeader) || block.length == 0
+            || block.offset > trailer.indexOffset || block.length > trailer.indexOffset - block.offset
+            || (ULONGLONG)block.firstOffset + block.firstLength > trailer.arcCount) {
+            return false;
+        }
+    }
+
+    archive.base = base;
+    archive.header = header;
+    archive.blocks = blocks;
+    archive.firstArcs = (const UINT*)(blocks + trailer.blockCount);
+    archive.blockCount = trailer.blockCount;
+    archive.records = trailer.records;
+    return true;
+}
+
+bool SnmpArchiveOpen(SnmpArchive& archive, const std::string& path) {
+    SnmpArchiveClose(archive);
+
+    void* view = NULL;
+    size_t size = 0;
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)
+        || fileSize.QuadPart < (LONGLONG)(sizeof(SnmpArchiveHeader) + sizeof(SnmpArchiveTrailer))) {
+        CloseHandle(file);
+        SetLastError(SNMP_ARCHIVE_ERROR_FORMAT);
+        return false;
+    }
+    size = (size_t)fileSize.QuadPart;
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (mapping == NULL) return false;
+    view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (view == NULL) return false;
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        SetLastError(errno);
+        return false;
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0
+        || fileStat.st_size < (off_t)(sizeof(SnmpArchiveHeader) + sizeof(SnmpArchiveTrailer))) {
+        close(fd);
+        SetLastError(SNMP_ARCHIVE_ERROR_FORMAT);
+        return false;
+    }
+    size = (size_t)fileStat.st_size;
+
+    view = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED) {
+        SetLastError(errno);
+        return false;
+    }
+#endif
+
+    archive.view = view;
+    archive.viewSize = size;
+    if (!SnmpArchiveSetView(archive, (const BYTE*)view, size)) {
+        SnmpArchiveClose(archive);
+        SetLastError(SNMP_ARCHIVE_ERROR_FORMAT);
+        return false;
+    }
+    return true;
+}
+
+void SnmpArchiveClose(SnmpArchive& archive) {
+    if (archive.view) {
+#ifdef _WIN32
+        UnmapViewOfFile(archive.view);
+#else
+        munmap(archive.view, archive.viewSize);
+#endif
+    }
+    archive = SnmpArchive();
+}
+
+// Функция перехода курсора на начало блока
+static void SnmpArchiveEnterBlock(SnmpArchiveCursor& cursor, UINT block) {
+    const SnmpArchiveBlock& info = cursor.archive->blocks[block];
+    cursor.block = block;
+    cursor.next = cursor.archive->base + info.offset;
+    cursor.end = cursor.next + info.length;
+}
+
+// Функция разбора значения текущей записи из её кодировки (raw)
+static bool SnmpArchiveLoadValue(SnmpArchiveCursor& cursor) {
+    const BYTE* data = cursor.raw + 1;
+    const BYTE* end = cursor.raw + cursor.rawLength;
+    ULONGLONG length;
+    SnmpArchiveGetVarint(data, end, length);
+    if (!SnmpArchiveDecodeValue(cursor.raw[0], data, (UINT)length, cursor.valueArcs, cursor.varBind.value)) {
+        cursor.valid = false;
+        cursor.corrupt = true;
+        return false;
+    }
+    return true;
+}
+
+// Функция разбора следующей записи, при конце блока - с переходом в следующий.
+// При поиске значение не разбирается (withValue = false), только пропускается.
+static bool SnmpArchiveStep(SnmpArchiveCursor& cursor, bool withValue) {
+    cursor.valid = false;
+    if (cursor.corrupt) return false;
+    if (cursor.next == cursor.end) {
+        if (cursor.block + 1 >= cursor.archive->blockCount) return false;
+        SnmpArchiveEnterBlock(cursor, cursor.block + 1);
+    }
+
+    const BYTE* data = cursor.next;
+    const BYTE* end = cursor.end;
+    bool first = data == cursor.archive->base + cursor.archive->blocks[cursor.block].offset;
+    ULONGLONG shared, count, length;
+    cursor.corrupt = true;
+    if (!SnmpArchiveGetVarint(data, end, shared) || !SnmpArchiveGetVarint(data, end, count)
+        || shared > cursor.name.size() || (first && shared != 0) || count > (ULONGLONG)(end - data)) {
+        return false;
+    }
+
+    cursor.name.resize((size_t)shared);
+    for (ULONGLONG i = 0; i < count; i++) {
+        UINT arc;
+        if (!SnmpArchiveGetArc(data, end, arc)) return false;
+        cursor.name.push_back(arc);
+    }
+
+    if (data == end) return false;
+    cursor.raw = data++;
+    if (!SnmpArchiveGetVarint(data, end, length) || length > (ULONGLONG)(end - data)) return false;
+    cursor.rawLength = (UINT)(data + length - cursor.raw);
+
+    cursor.varBind.name.ids = cursor.name.data();
+    cursor.varBind.name.idLength = (UINT)cursor.name.size();
+    cursor.next = data + length;
+    cursor.corrupt = false;
+    cursor.valid = true;
+    return !withValue || SnmpArchiveLoadValue(cursor);
+}
+
+bool SnmpArchiveSeek(const SnmpArchive& archive, SnmpArchiveCursor& cursor, const UINT* ids, size_t length) {
+    cursor.archive = &archive;
+    cursor.valid = false;
+    cursor.corrupt = false;
+    cursor.name.clear();
+    if (archive.blockCount == 0) return false;
+
+    // Первый блок, который начинается после искомого OID; нужный - перед ним
+    UINT low = 0;
+    UINT high = archive.blockCount;
+    while (low < high) {
+        UINT middle = low + (high - low) / 2;
+        const SnmpArchiveBlock& block = archive.blocks[middle];
+        if (SnmpOidCompare(archive.firstArcs + block.firstOffset, block.firstLength, ids, length) <= 0) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+
+    SnmpArchiveEnterBlock(cursor, low > 0 ? low - 1 : 0);
+    while (SnmpArchiveStep(cursor, false)) {
+        if (SnmpOidCompare(cursor.name.data(), cursor.name.size(), ids, length) >= 0) return SnmpArchiveLoadValue(cursor);
+    }
+    return false;
+}
+
+bool SnmpArchiveNext(SnmpArchiveCursor& cursor) {
+    return cursor.valid && SnmpArchiveStep(cursor, true);
+}
+
+bool SnmpArchiveGet(const SnmpArchive& archive, SnmpArchiveCursor& cursor, const UINT* ids, size_t length) {
+    return SnmpArchiveSeek(archive, cursor, ids, length)
+        && SnmpOidCompare(cursor.name.data(), cursor.name.size(), ids, length) == 0;
+}
+
+// Функция проверки, что курсор стоит на записи поддерева
+static bool SnmpArchiveInside(const SnmpArchiveCursor& cursor, const UINT* prefix, size_t length) {
+    return cursor.valid && SnmpOidStartsWith(cursor.name.data(), cursor.name.size(), prefix, length);
+}
+
+bool SnmpArchiveScan(const SnmpArchive& archive, const UINT* prefix, size_t length, const SnmpArchiveCallback& onVarBind) {
+    SnmpArchiveCursor cursor;
+    SnmpArchiveSeek(archive, cursor, prefix, length);
+    while (SnmpArchiveInside(cursor, prefix, length)) {
+        if (!onVarBind(cursor.varBind)) return true;
+        SnmpArchiveNext(cursor);
+    }
+
+    if (cursor.corrupt) {
+        SetLastError(SNMP_ARCHIVE_ERROR_FORMAT);
+        return false;
+    }
+    return true;
+}
+
+bool SnmpArchiveDiff(const SnmpArchive& before, const SnmpArchive& after, const UINT* prefix, size_t length,
+    const SnmpArchiveDiffCallback& onChange) {
+    SnmpArchiveCursor old, current;
+    SnmpArchiveSeek(before, old, prefix, length);
+    SnmpArchiveSeek(after, current, prefix, length);
+
+    // На повреждённой записи слияние останавливается: иначе остаток второго архива выглядел бы изменением
+    SnmpArchiveChange change;
+    while (!old.corrupt && !current.corrupt) {
+        bool hasOld = SnmpArchiveInside(old, prefix, length);
+        bool hasCurrent = SnmpArchiveInside(current, prefix, length);
+        if (!hasOld && !hasCurrent) break;
+
+        int order = !hasOld ? 1 : !hasCurrent ? -1
+            : SnmpOidCompare(old.name.data(), old.name.size(), current.name.data(), current.name.size());
+        if (order < 0) {
+            change.kind = SNMP_DELTA_REMOVED;
+            change.before = &old.varBind;
+            change.after = NULL;
+            onChange(change);
+            SnmpArchiveNext(old);
+        }
+        else if (order > 0) {
+            change.kind = SNMP_DELTA_ADDED;
+            change.before = NULL;
+            change.after = &current.varBind;
+            onChange(change);
+            SnmpArchiveNext(current);
+        }
+        else {
+            // Тип и значение в кодировке архива: совпадение байтов - совпадение значений
+            if (old.rawLength != current.rawLength || memcmp(old.raw, current.raw, old.rawLength) != 0) {
+                change.kind = SNMP_DELTA_CHANGED;
+                change.before = &old.varBind;
+                change.after = &current.varBind;
+                onChange(change);
+            }
+            SnmpArchiveNext(old);
+            SnmpArchiveNext(current);
+        }
+    }
+
+    if (old.corrupt || current.corrupt) {
+        SetLastError(SNMP_ARCHIVE_ERROR_FORMAT);
+        return false;
+    }
+    return true;
+}
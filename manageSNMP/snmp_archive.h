@@ -0,0 +1,138 @@
+﻿#pragma once
+
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+#include "snmp_delta.h"
+#include "snmp_oid.h"
+
+// Файл архива повреждён, усечён или записан на платформе с другим порядком байт
+#define SNMP_ARCHIVE_ERROR_FORMAT 60
+
+#define SNMP_ARCHIVE_MAGIC 0x52415753   // "SWAR"
+#define SNMP_ARCHIVE_FORMAT_VERSION 1
+
+// Размер блока записей: поиск - двоичный по блокам, внутри блока - последовательный разбор,
+// поэтому блок меньше страницы (около сотни записей обхода) и индекс - несколько процентов файла
+#define SNMP_ARCHIVE_BLOCK_SIZE 1024
+
+// Архив обхода - записи в порядке возрастания OID, разбитые на блоки:
+//   заголовок | блоки записей | выравнивание до 8 | индекс блоков | первые OID блоков | хвост
+// Запись: общих дуг с прошлой записью блока, число остальных дуг, остальные дуги, тип,
+// длина значения, значение. Все числа - varint (7 бит на байт, младшие вперёд);
+// INTEGER - zigzag, строки - как есть, OID-значение - дуги varint.
+// Первая запись блока хранит имя целиком, поэтому блок разбирается независимо от соседей.
+// Файл пишется только дописыванием: индекс и хвост - после последнего блока.
+struct SnmpArchiveHeader {
+    UINT magic;
+    UINT version;
+    ULONGLONG created;            // время записи, секунды с 1970 года
+};
+
+struct SnmpArchiveBlock {
+    ULONGLONG offset;             // начало блока от начала файла
+    UINT length;                  // байт
+    UINT records;
+    UINT firstOffset;             // OID первой записи - дуги firstArcs[firstOffset, firstOffset + firstLength)
+    UINT firstLength;
+};
+
+struct SnmpArchiveTrailer {
+    ULONGLONG indexOffset;
+    ULONGLONG records;
+    UINT blockCount;
+    UINT arcCount;                // дуг первых OID
+    UINT magic;
+    UINT version;
+};
+
+// Запись архива. Блок собирается в памяти и пишется целиком, когда следующая
+// запись в него не помещается.
+struct SnmpArchiveWriter {
+    std::ofstream file;
+    std::string path;
+    ULONGLONG offset = 0;         // записано байт
+    std::vector<BYTE> block;
+    UINT blockRecords = 0;
+    std::vector<UINT> last;       // OID прошлой записи
+    std::vector<BYTE> record;     // кодирование одной записи
+    std::vector<BYTE> value;      // и её значения
+    std::vector<SnmpArchiveBlock> blocks;
+    std::vector<UINT> firstArcs;
+    ULONGLONG records = 0;
+};
+
+// Отображённый в память архив. Открытие проверяет только заголовок, индекс и границы блоков;
+// записи разбираются при чтении.
+struct SnmpArchive {
+    const BYTE* base = NULL;
+    const SnmpArchiveHeader* header = NULL;
+    const SnmpArchiveBlock* blocks = NULL;
+    const UINT* firstArcs = NULL;
+    UINT blockCount = 0;
+    ULONGLONG records = 0;
+    void* view = NULL;
+    size_t viewSize = 0;
+};
+
+// Положение чтения. varBind - текущая запись: имя и дуги OID-значения лежат в массивах курсора,
+// байты строк указывают прямо в отображение и действительны, пока архив открыт.
+struct SnmpArchiveCursor {
+    const SnmpArchive* archive = NULL;
+    UINT block = 0;
+    const BYTE* next = NULL;      // следующая запись блока
+    const BYTE* end = NULL;       // конец блока
+    std::vector<UINT> name;
+    std::vector<UINT> valueArcs;
+    RFC1157VarBind varBind;
+    const BYTE* raw = NULL;       // тип и значение в кодировке архива: равные значения - равные байты
+    UINT rawLength = 0;
+    bool valid = false;           // есть текущая запись
+    bool corrupt = false;         // разбор остановлен на повреждённой записи
+};
+
+// Изменение между двумя архивами; before/after - NULL для добавленного/пропавшего OID.
+// Varbind действительны только внутри обработчика.
+struct SnmpArchiveChange {
+    SnmpDeltaKind kind;
+    const RFC1157VarBind* before;
+    const RFC1157VarBind* after;
+};
+
+typedef std::function<bool(const RFC1157VarBind& varBind)> SnmpArchiveCallback;
+typedef std::function<void(const SnmpArchiveChange& change)> SnmpArchiveDiffCallback;
+
+bool SnmpArchiveCreate(SnmpArchiveWriter& writer, const std::string& path);
+
+// Очередной varbind обхода. OID должны возрастать, иначе false (ERROR_INVALID_PARAMETER).
+bool SnmpArchiveAppend(SnmpArchiveWriter& writer, const RFC1157VarBind& varBind);
+
+// Дописывает последний блок, индекс и хвост и закрывает файл
+bool SnmpArchiveFinish(SnmpArchiveWriter& writer);
+
+// true, если файл начинается с сигнатуры архива (для выбора формата по содержимому)
+bool SnmpArchiveDetect(const std::string& path);
+
+bool SnmpArchiveOpen(SnmpArchive& archive, const std::string& path);
+
+void SnmpArchiveClose(SnmpArchive& archive);
+
+// Ставит курсор на первую запись с OID не меньше ids (length = 0 - на начало архива).
+// Двоичный поиск по первым OID блоков, затем разбор одного блока. false, если таких записей нет.
+bool SnmpArchiveSeek(const SnmpArchive& archive, SnmpArchiveCursor& cursor, const UINT* ids, size_t length);
+
+// Переход к следующей записи; false в конце архива или на повреждённой записи (corrupt)
+bool SnmpArchiveNext(SnmpArchiveCursor& cursor);
+
+// Точное значение OID; false, если его нет в архиве
+bool SnmpArchiveGet(const SnmpArchive& archive, SnmpArchiveCursor& cursor, const UINT* ids, size_t length);
+
+// Записи поддерева prefix по порядку, пока обработчик возвращает true. Читаются только
+// блоки поддерева. false (SNMP_ARCHIVE_ERROR_FORMAT), если встретилась повреждённая запись.
+bool SnmpArchiveScan(const SnmpArchive& archive, const UINT* prefix, size_t length, const SnmpArchiveCallback& onVarBind);
+
+// Потоковое сравнение поддерева prefix двух архивов слиянием курсоров, без загрузки
+// снимков в память. Значения сравниваются по байтам кодировки (тип и значение).
+bool SnmpArchiveDiff(const SnmpArchive& before, const SnmpArchive& after, const UINT* prefix, size_t length,
+    const SnmpArchiveDiffCallback& onChange);
@@ -0,0 +1,41 @@
+﻿#include "snmp_arena.h"
+
+#include <new>
+
+void* SnmpArenaAlloc(SnmpArena& arena, size_t size) {
+    size = (size + 7) & ~(size_t)7;
+
+    // Ищем блок, в который помещается запрос, начиная с текущего
+    while (arena.blockIndex < arena.blocks.size()) {
+        if (arena.blockSizes[arena.blockIndex] - arena.offset >= size) {
+            void* ptr = arena.blocks[arena.blockIndex].get() + arena.offset;
+            arena.offset += size;
+            return ptr;
+        }
+        arena.blockIndex++;
+        arena.offset = 0;
+    }
+
+    // Новый блок; слишком большие запросы получают блок своего размера
+    size_t newSize = size > arena.blockSize ? size : arena.blockSize;
+    unsigned char* block = new (std::nothrow) unsigned char[newSize];
+    if (!block) return NULL;
+
+    arena.blocks.emplace_back(block);
+    arena.blockSizes.push_back(newSize);
+    arena.blockIndex = arena.blocks.size() - 1;
+    arena.offset = size;
+    return block;
+}
+
+void SnmpArenaReset(SnmpArena& arena) {
+    arena.blockIndex = 0;
+    arena.offset = 0;
+}
+
+void SnmpArenaRelease(SnmpArena& arena) {
+    arena.blocks.clear();
+    arena.blockSizes.clear();
+    arena.blockIndex = 0;
+    arena.offset = 0;
+}
@@ -0,0 +1,30 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Арена для данных одного запроса: память выдаётся последовательно из блоков
+// и освобождается целиком одним вызовом SnmpArenaReset. Блоки после сброса
+// переиспользуются, поэтому в установившемся режиме аллокаций нет.
+struct SnmpArena {
+    std::vector<std::unique_ptr<unsigned char[]>> blocks;
+    std::vector<size_t> blockSizes;
+    size_t blockSize = 16 * 1024;
+    size_t blockIndex = 0;        // текущий блок
+    size_t offset = 0;            // занято в текущем блоке
+};
+
+// Выделяет size байт с выравниванием 8. Возвращает NULL только при нехватке памяти.
+void* SnmpArenaAlloc(SnmpArena& arena, size_t size);
+
+// Освобождает всё выделенное разом, сохраняя блоки для следующего запроса
+void SnmpArenaReset(SnmpArena& arena);
+
+// Возвращает блоки системе
+void SnmpArenaRelease(SnmpArena& arena);
+
+template <typename T>
+T* SnmpArenaAllocArray(SnmpArena& arena, size_t count) {
+    return static_cast<T*>(SnmpArenaAlloc(arena, count * sizeof(T)));
+}
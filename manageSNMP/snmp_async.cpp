@@ -0,0 +1,446 @@
+﻿#include "snmp_async.h"
+
+#include <cstring>
+#include <random>
+#include "snmp_udp.h"
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#elif !defined(_WIN32)
+#include <sys/select.h>
+#endif
+
+// Шаг и размер колеса таймеров (как у поллера)
+#define SNMP_LOOP_TICK_MS     10
+#define SNMP_LOOP_WHEEL_SLOTS 4096
+
+// Размер буферов сокета: ответы тысяч одновременных запросов приходят всплеском
+#define SNMP_LOOP_SOCKET_BUFFER (4 * 1024 * 1024)
+
+static thread_local size_t taskFrameBytes = 0;
+
+void* SnmpTaskAlloc(size_t size) {
+    taskFrameBytes += size;
+    return ::operator new(size);
+}
+
+void SnmpTaskFree(void* frame, size_t size) {
+    taskFrameBytes -= size;
+    ::operator delete(frame);
+}
+
+size_t SnmpTaskFrameBytes() {
+    return taskFrameBytes;
+}
+
+bool SnmpLoopInit(SnmpLoop& loop, DWORD timeout, int retries, size_t maxInFlight) {
+    loop.timeout = timeout;
+    loop.retries = retries;
+    loop.maxInFlight = maxInFlight > 0 ? maxInFlight : 1;
+
+    // Номер слота занимает младшие биты request-id, остальные (до 31) - порядковый номер запроса
+    loop.slotBits = 1;
+    while (((size_t)1 << loop.slotBits) < loop.maxInFlight) loop.slotBits++;
+    if (loop.slotBits > 24) {
+        SetLastError(ERROR_INVALID_PARAMETER);
+        return false;
+    }
+    loop.sequenceLimit = (AsnInteger)(1u << (31 - loop.slotBits));
+
+    // Случайный начальный номер, чтобы не принять ответ предыдущего запуска
+    std::random_device random;
+    loop.sequence = (AsnInteger)(random() % (unsigned)loop.sequenceLimit);
+
+    loop.slots.assign(loop.maxInFlight, NULL);
+    loop.freeSlots.clear();
+    for (size_t i = loop.maxInFlight; i-- > 0; ) {
+        loop.freeSlots.push_back((UINT)i);
+    }
+    loop.inFlight = 0;
+    loop.active = 0;
+    loop.waitingHead = loop.waitingTail = NULL;
+    loop.stats = SnmpLoopStats();
+    loop.sendBuffer.resize(SNMP_UDP_MAX_DATAGRAM);
+    loop.receiveBuffer.resize(SNMP_UDP_MAX_DATAGRAM);
+    SnmpTimerWheelInit(loop.wheel, SNMP_LOOP_TICK_MS, SNMP_LOOP_WHEEL_SLOTS, GetTickCount64());
+
+#ifdef __linux__
+    loop.epollFd = epoll_create1(0);
+    if (loop.epollFd < 0) {
+        SetLastError(errno);
+        return false;
+    }
+#endif
+    return true;
+}
+
+// Функция создания сокета семейства адресов и регистрации его в цикле
+static SOCKET SnmpLoopOpenSocket(SnmpLoop& loop, int family) {
+    SOCKET sock = socket(family, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock == INVALID_SOCKET) {
+        SetLastError(WSAGetLastError());
+        return INVALID_SOCKET;
+    }
+
+    int bufferSize = SNMP_LOOP_SOCKET_BUFFER;
+    setsockopt(sock, SOL_SOCKET, SO_RCVBUF, (const char*)&bufferSize, sizeof(bufferSize));
+    setsockopt(sock, SOL_SOCKET, SO_SNDBUF, (const char*)&bufferSize, sizeof(bufferSize));
+
+    if (!SnmpUdpSetNonBlocking(sock)) {
+        SetLastError(WSAGetLastError());
+        closesocket(sock);
+        return INVALID_SOCKET;
+    }
+
+#ifdef __linux__
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = sock;
+    if (epoll_ctl(loop.epollFd, EPOLL_CTL_ADD, sock, &event) < 0) {
+        SetLastError(errno);
+        closesocket(sock);
+        return INVALID_SOCKET;
+    }
+#else
+    (void)loop;
+#endif
+    return sock;
+}
+
+size_t SnmpLoopAddAgent(SnmpLoop& loop, const std::string& target, const sockaddr_storage& address,
+    int addressLength, const std::string& community, AsnInteger version) {
+    SOCKET& sock = loop.sockets[address.ss_family == AF_INET6 ? 1 : 0];
+    if (sock == INVALID_SOCKET) {
+        sock = SnmpLoopOpenSocket(loop, address.ss_family);
+        if (sock == INVALID_SOCKET) return SNMP_LOOP_NO_AGENT;
+    }
+
+    BYTE header[SNMP_UDP_DEFAULT_MESSAGE_SIZE];
+    size_t length = BerEncodeMessageHeader(version, community.data(), community.size(), header, sizeof(header));
+    if (length == 0) {
+        SetLastError(ERROR_INVALID_PARAMETER);
+        return SNMP_LOOP_NO_AGENT;
+    }
+
+    SnmpLoopAgent agent;
+    agent.target = target;
+    agent.community = community;
+    agent.address = address;
+    agent.addressLength = addressLength;
+    agent.version = version;
+    agent.header.assign(header, header + length);
+    agent.sock = sock;
+    SnmpRttInit(agent.rtt, loop.timeout);
+    loop.agents.push_back(std::move(agent));
+    return loop.agents.size() - 1;
+}
+
+// Функция отправки (или повторной отправки) запроса и планирования таймаута попытки
+static void SnmpLoopSend(SnmpLoop& loop, SnmpAsyncOp& op) {
+    SnmpLoopAgent& agent = loop.agents[op.agent];
+
+    // GETBULK определён только начиная с SNMPv2c
+    size_t length;
+    if (op.request.type != SNMP_PDU_GETBULK || agent.version != SNMP_VERSION_V1) {
+        length = BerEncodeMessagePrefixed(agent.header.data(), agent.header.size(), op.request,
+            loop.sendBuffer.data(), loop.sendBuffer.size());
+    }
+    else {
+        length = BerEncodeMessage(SNMP_VERSION_V2C, agent.community.data(), agent.community.size(), op.request,
+            loop.sendBuffer.data(), loop.sendBuffer.size());
+    }
+
+    // Переполненный буфер сокета равносилен потере датаграммы: сработает повтор
+    loop.stats.sent++;
+    if (sendto(agent.sock, (const char*)loop.sendBuffer.data(), (int)length, 0,
+        (const sockaddr*)&agent.address, agent.addressLength) != SOCKET_ERROR) {
+        SnmpMetricsOnSend(op.metrics, length, op.attempt > 1);
+    }
+
+    DWORD timeout = loop.adaptiveTimeout ? SnmpRttTimeout(agent.rtt, op.attempt) : loop.timeout;
+    SnmpTimerSchedule(loop.wheel, op.timer, GetTickCount64() + timeout);
+}
+
+// Функция отправки первой попытки: запрос получает слот и request-id
+static void SnmpLoopLaunch(SnmpLoop& loop, SnmpAsyncOp& op) {
+    UINT slot = loop.freeSlots.back();
+    loop.freeSlots.pop_back();
+    loop.slots[slot] = &op;
+    loop.inFlight++;
+
+    loop.sequence = loop.sequence + 1 < loop.sequenceLimit ? loop.sequence + 1 : 1;
+    op.request.requestId = (AsnInteger)(((unsigned)loop.sequence << loop.slotBits) | slot);
+    op.attempt = 1;
+    op.firstSent = SnmpMetricsNowUs();
+    SnmpLoopSend(loop, op);
+}
+
+// Функция завершения запроса в полёте: слот освобождается, место отдаётся ждущим запросам,
+// затем продолжается ожидавшая корутина. После этого op может быть уже разрушен.
+static void SnmpLoopComplete(SnmpLoop& loop, SnmpAsyncOp& op, const SnmpPdu* response, DWORD error) {
+    SnmpTimerCancel(loop.wheel, op.timer);
+    loop.slots[(unsigned)op.request.requestId & ((1u << loop.slotBits) - 1)] = NULL;
+    loop.freeSlots.push_back((unsigned)op.request.requestId & ((1u << loop.slotBits) - 1));
+    loop.inFlight--;
+    op.result.response = response;
+    op.result.error = error;
+
+    while (loop.waitingHead != NULL && !loop.freeSlots.empty()) {
+        SnmpAsyncOp& next = *loop.waitingHead;
+        loop.waitingHead = next.nextWaiting;
+        if (loop.waitingHead == NULL) loop.waitingTail = NULL;
+        SnmpLoopLaunch(loop, next);
+    }
+
+    op.waiter.resume();
+}
+
+bool SnmpLoopSubmit(SnmpAsyncOp& op) {
+    SnmpLoop& loop = *op.loop;
+    SnmpLoopAgent& agent = loop.agents[op.agent];
+    op.request.varBinds.list = &op.varBind;
+    op.result = SnmpAsyncResult();
+    op.metrics = SnmpMetricsSeriesFor(agent.target, op.request.type);
+
+    // Недоступному агенту - только проба в одну попытку, и не чаще интервала проб
+    op.maxAttempts = loop.retries + 1;
+    if (loop.adaptiveTimeout) {
+        SnmpRttDecision decision = SnmpRttAdmit(agent.rtt, GetTickCount64());
+        if (decision == SNMP_RTT_SKIP) {
+            op.result.error = SNMP_UDP_ERROR_DOWN;
+            return false;
+        }
+        if (decision == SNMP_RTT_PROBE) op.maxAttempts = 1;
+    }
+
+    op.timer.owner = &op;
+    if (loop.freeSlots.empty()) {
+        loop.stats.queued++;
+        op.nextWaiting = NULL;
+        if (loop.waitingTail) loop.waitingTail->nextWaiting = &op;
+        else loop.waitingHead = &op;
+        loop.waitingTail = &op;
+        return true;
+    }
+
+    SnmpLoopLaunch(loop, op);
+    return true;
+}
+
+// Функция сборки запроса с одним varbind
+static SnmpAsyncRequest SnmpAsyncMake(SnmpLoop& loop, size_t agent, BYTE type, const SnmpOid& oid,
+    AsnInteger errorStatus, AsnInteger errorIndex) {
+    SnmpAsyncRequest awaiter;
+    SnmpAsyncOp& op = awaiter.op;
+    op.loop = &loop;
+    op.agent = agent;
+    op.varBind.name = oid.AsAsn();
+    op.varBind.value.asnType = ASN_NULL;
+    op.request.type = type;
+    op.request.errorStatus = errorStatus;
+    op.request.errorIndex = errorIndex;
+    op.request.varBinds.len = 1;
+    return awaiter;
+}
+
+// Список varbind указывает внутрь запроса, поэтому ставится уже на месте, в SnmpLoopSubmit
+SnmpAsyncRequest SnmpAsyncGet(SnmpLoop& loop, size_t agent, const SnmpOid& oid) {
+    return SnmpAsyncMake(loop, agent, SNMP_PDU_GET, oid, 0, 0);
+}
+
+SnmpAsyncRequest SnmpAsyncGetNext(SnmpLoop& loop, size_t agent, const SnmpOid& oid) {
+    return SnmpAsyncMake(loop, agent, SNMP_PDU_GETNEXT, oid, 0, 0);
+}
+
+SnmpAsyncRequest SnmpAsyncGetBulk(SnmpLoop& loop, size_t agent, const SnmpOid& oid, UINT maxRepetitions) {
+    // non-repeaters = 0, max-repetitions
+    return SnmpAsyncMake(loop, agent, SNMP_PDU_GETBULK, oid, 0, (AsnInteger)(maxRepetitions ? maxRepetitions : 1));
+}
+
+void SnmpLoopTaskDone(SnmpLoop& loop) {
+    loop.active--;
+}
+
+void SnmpLoopSpawn(SnmpLoop& loop, SnmpTask<void> task) {
+    std::coroutine_handle<SnmpTask<void>::promise_type> handle = task.Release();
+    handle.promise().detached = &loop;
+    loop.active++;
+    handle.resume();
+}
+
+// Функция обработки сработавшего таймаута попытки: повтор или завершение без ответа
+static void SnmpLoopOnTimer(SnmpLoop& loop, SnmpTimer& timer) {
+    SnmpAsyncOp& op = *static_cast<SnmpAsyncOp*>(timer.owner);
+    if (op.attempt < op.maxAttempts) {
+        op.attempt++;
+        loop.stats.retransmits++;
+        SnmpLoopSend(loop, op);
+        return;
+    }
+
+    loop.stats.timeouts++;
+    SnmpLoopAgent& agent = loop.agents[op.agent];
+    if (loop.adaptiveTimeout) SnmpRttFailure(agent.rtt, GetTickCount64());
+    SnmpMetricsOnTimeout(op.metrics);
+    SnmpLoopComplete(loop, op, NULL, SNMP_UDP_ERROR_TIMEOUT);
+}
+
+// Функция чтения всех накопившихся в сокете ответов
+static void SnmpLoopReceive(SnmpLoop& loop, SOCKET sock) {
+    BYTE* buffer = loop.receiveBuffer.data();
+
+    while (true) {
+        sockaddr_storage from;
+        socklen_t fromLength = sizeof(from);
+        int received = recvfrom(sock, (char*)buffer, (int)loop.receiveBuffer.size(), 0,
+            (sockaddr*)&from, &fromLength);
+        if (received == SOCKET_ERROR) {
+            if (WSAGetLastError() == WSAECONNRESET) continue;
+            return;
+        }
+
+        SnmpArenaReset(loop.arena);
+
+        SnmpMessage message;
+        if (!BerDecodeMessage(buffer, received, loop.arena, message) || message.pdu.type != SNMP_PDU_RESPONSE) {
+            loop.stats.unmatched++;
+            continue;
+        }
+
+        size_t slot = (size_t)((unsigned)message.pdu.requestId & ((1u << loop.slotBits) - 1));
+        SnmpAsyncOp* op = slot < loop.slots.size() ? loop.slots[slot] : NULL;
+        if (op == NULL || op->request.requestId != message.pdu.requestId
+            || !SnmpUdpSameAddress(from, loop.agents[op->agent].address)) {
+            loop.stats.unmatched++;
+            continue;
+        }
+
+        loop.stats.responses++;
+        SnmpLoopAgent& agent = loop.agents[op->agent];
+        ULONGLONG latencyUs = SnmpMetricsNowUs() - op->firstSent;
+        if (loop.adaptiveTimeout) {
+            // Ответ после повтора не отнести к конкретной отправке - такой замер пропускаем
+            if (op->attempt == 1) SnmpRttSample(agent.rtt, latencyUs / 1000.0);
+            SnmpRttSuccess(agent.rtt);
+        }
+        SnmpMetricsOnResponse(op->metrics, latencyUs, message.pdu.errorStatus, (size_t)received,
+            message.pdu.varBinds.len);
+
+        // Корутина продолжается здесь же: ответ в буфере приёма действителен до её следующего co_await
+        SnmpLoopComplete(loop, *op, &message.pdu, 0);
+    }
+}
+
+// Функция ожидания входящих датаграмм не дольше timeoutMs (-1 - без ограничения)
+static bool SnmpLoopWait(SnmpLoop& loop, int timeoutMs) {
+#ifdef __linux__
+    epoll_event events[4];
+    int ready = epoll_wait(loop.epollFd, events, 4, timeoutMs);
+    if (ready < 0) {
+        if (errno == EINTR) return true;
+        SetLastError(errno);
+        return false;
+    }
+    for (int i = 0; i < ready; i++) {
+        SnmpLoopReceive(loop, (SOCKET)events[i].data.fd);
+    }
+    return true;
+#else
+    fd_set readSet;
+    FD_ZERO(&readSet);
+    SOCKET maxSocket = 0;
+    for (SOCKET sock : loop.sockets) {
+        if (sock == INVALID_SOCKET) continue;
+        FD_SET(sock, &readSet);
+        if (sock > maxSocket) maxSocket = sock;
+    }
+
+    timeval tv;
+    tv.tv_sec = timeoutMs < 0 ? 1 : timeoutMs / 1000;
+    tv.tv_usec = timeoutMs < 0 ? 0 : (timeoutMs % 1000) * 1000;
+
+    int ready = select((int)maxSocket + 1, &readSet, NULL, NULL, &tv);
+    if (ready == SOCKET_ERROR) {
+        SetLastError(WSAGetLastError());
+        return false;
+    }
+    for (SOCKET sock : loop.sockets) {
+        if (sock != INVALID_SOCKET && FD_ISSET(sock, &readSet)) {
+            SnmpLoopReceive(loop, sock);
+        }
+    }
+    return true;
+#endif
+}
+
+bool SnmpLoopRun(SnmpLoop& loop) {
+    while (loop.active > 0) {
+        // Задачи ждут не запросов цикла - разбудить их нечему
+        if (loop.inFlight == 0) {
+            SetLastError(ERROR_INVALID_PARAMETER);
+            return false;
+        }
+
+        int timeout = SnmpTimerWheelTimeout(loop.wheel, GetTickCount64());
+        if (!SnmpLoopWait(loop, timeout)) return false;
+
+        SnmpTimerWheelAdvance(loop.wheel, GetTickCount64(), [&loop](SnmpTimer& timer) {
+            SnmpLoopOnTimer(loop, timer);
+        });
+    }
+    return true;
+}
+
+void SnmpLoopClose(SnmpLoop& loop) {
+    for (SOCKET& sock : loop.sockets) {
+        if (sock != INVALID_SOCKET) {
+            closesocket(sock);
+            sock = INVALID_SOCKET;
+        }
+    }
+#ifdef __linux__
+    if (loop.epollFd >= 0) {
+        close(loop.epollFd);
+        loop.epollFd = -1;
+    }
+#endif
+    loop.agents.clear();
+}
+
+SnmpTask<DWORD> SnmpAsyncWalk(SnmpLoop& loop, size_t agent, SnmpOid baseOid, UINT maxRepetitions,
+    SnmpWalkCallback onVarBind) {
+    bool bulk = loop.agents[agent].version != SNMP_VERSION_V1;
+    if (maxRepetitions == 0) maxRepetitions = 1;
+    SnmpOid lastOid = baseOid;
+
+    while (true) {
+        SnmpAsyncResult result = bulk ? co_await SnmpAsyncGetBulk(loop, agent, lastOid, maxRepetitions)
+            : co_await SnmpAsyncGetNext(loop, agent, lastOid);
+        if (result.response == NULL) co_return result.error;
+
+        const SnmpPdu& response = *result.response;
+        if (bulk && response.errorStatus == SNMP_ERRORSTATUS_TOOBIG && maxRepetitions > 1) {
+            maxRepetitions /= 2;
+            continue;
+        }
+        // SNMPv1-агент отвечает на GETNEXT за концом MIB ошибкой noSuchName
+        if (!bulk && response.errorStatus == SNMP_ERRORSTATUS_NOSUCHNAME) co_return 0;
+        if (response.errorStatus != SNMP_ERRORSTATUS_NOERROR) co_return SNMP_UDP_ERROR_AGENT;
+        if (response.varBinds.len == 0) co_return 0;
+
+        AsnObjectIdentifier previousOid = lastOid.AsAsn();
+        for (UINT i = 0; i < response.varBinds.len; i++) {
+            RFC1157VarBind& varBind = response.varBinds.list[i];
+
+            // Хвост пачки за пределами поддерева и конец MIB - конец обхода
+            if (varBind.value.asnType == SNMP_EXCEPTION_ENDOFMIBVIEW || !SnmpOidStartsWith(varBind.name, baseOid)
+                || SnmpOidCompare(varBind.name, previousOid) <= 0) {
+                co_return 0;
+            }
+
+            onVarBind(varBind);
+            previousOid = varBind.name;
+        }
+        lastOid.Assign(previousOid.ids, previousOid.idLength);
+    }
+}
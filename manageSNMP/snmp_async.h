@@ -0,0 +1,237 @@
+﻿#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "snmp_ber.h"
+#include "snmp_metrics.h"
+#include "snmp_oid.h"
+#include "snmp_pwalk.h"
+#include "snmp_rtt.h"
+#include "snmp_timer.h"
+
+// Ограничение одновременно ожидающих ответа запросов цикла: остальные ждут очереди
+#define SNMP_LOOP_MAX_IN_FLIGHT 4096
+
+// Результат SnmpLoopAddAgent, если агента добавить не удалось
+#define SNMP_LOOP_NO_AGENT ((size_t)-1)
+
+struct SnmpLoop;
+
+// Результат одного запроса. response == NULL, если ответа нет (error - код, как у SnmpUdpRequest).
+// Ответ ссылается на буфер приёма цикла и действителен до следующего co_await.
+struct SnmpAsyncResult {
+    DWORD error = 0;
+    const SnmpPdu* response = NULL;
+};
+
+// Запрос в цикле событий. Живёт в кадре ожидающей корутины (как временный объект
+// выражения co_await), поэтому запрос не выделяет память.
+struct SnmpAsyncOp {
+    SnmpLoop* loop = NULL;
+    size_t agent = 0;
+    SnmpPdu request = {};
+    RFC1157VarBind varBind = {};
+    int attempt = 0;
+    int maxAttempts = 0;          // 1 - проба недоступного агента
+    ULONGLONG firstSent = 0;      // мкс
+    SnmpMetricsSeries* metrics = NULL;
+    SnmpTimer timer;              // таймаут попытки
+    SnmpAsyncOp* nextWaiting = NULL;
+    std::coroutine_handle<> waiter;
+    SnmpAsyncResult result;
+};
+
+// Ставит запрос в цикл. false - запрос завершился сразу (агент недоступен, запрос не кодируется),
+// результат уже в op.result и корутину не нужно приостанавливать.
+bool SnmpLoopSubmit(SnmpAsyncOp& op);
+
+// Ожидание ответа на один PDU: SnmpAsyncResult result = co_await SnmpAsyncGet(loop, agent, oid)
+struct SnmpAsyncRequest {
+    SnmpAsyncOp op;
+
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> waiter) {
+        op.waiter = waiter;
+        return SnmpLoopSubmit(op);
+    }
+    SnmpAsyncResult await_resume() const noexcept { return op.result; }
+};
+
+// OID запроса должен жить до завершения co_await (временный объект в том же выражении годится)
+SnmpAsyncRequest SnmpAsyncGet(SnmpLoop& loop, size_t agent, const SnmpOid& oid);
+SnmpAsyncRequest SnmpAsyncGetNext(SnmpLoop& loop, size_t agent, const SnmpOid& oid);
+SnmpAsyncRequest SnmpAsyncGetBulk(SnmpLoop& loop, size_t agent, const SnmpOid& oid, UINT maxRepetitions);
+
+// Завершение задачи, запущенной SnmpLoopSpawn
+void SnmpLoopTaskDone(SnmpLoop& loop);
+
+// Кадры корутин выделяются через этот учёт: память на задачу видна в замерах
+void* SnmpTaskAlloc(size_t size);
+void SnmpTaskFree(void* frame, size_t size);
+
+// Байт в кадрах корутин, занятых сейчас в этом потоке
+size_t SnmpTaskFrameBytes();
+
+// Общая часть обещания задачи: ожидающая корутина и цикл отсоединённой задачи
+struct SnmpTaskPromiseBase {
+    std::coroutine_handle<> continuation;
+    SnmpLoop* detached = NULL;    // задача запущена SnmpLoopSpawn: кадр освобождается по завершении
+
+    // По завершении управление сразу передаётся ожидающей корутине, без рекурсии в стеке
+    struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            SnmpTaskPromiseBase& promise = handle.promise();
+            if (promise.continuation) return promise.continuation;
+            if (promise.detached) {
+                SnmpLoop* loop = promise.detached;
+                handle.destroy();
+                SnmpLoopTaskDone(*loop);
+            }
+            return std::noop_coroutine();
+        }
+        void await_resume() const noexcept {}
+    };
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+    // Исключения в проекте не используются
+    void unhandled_exception() const noexcept { std::terminate(); }
+
+    static void* operator new(size_t size) { return SnmpTaskAlloc(size); }
+    static void operator delete(void* frame, size_t size) { SnmpTaskFree(frame, size); }
+};
+
+template <typename T>
+struct SnmpTaskPromiseResult : SnmpTaskPromiseBase {
+    T value = T();
+    void return_value(T result) { value = std::move(result); }
+};
+
+template <>
+struct SnmpTaskPromiseResult<void> : SnmpTaskPromiseBase {
+    void return_void() const noexcept {}
+};
+
+// Задача-корутина с результатом T. Запускается, когда её ожидают (co_await) или
+// передают циклу (SnmpLoopSpawn); кадр принадлежит объекту задачи.
+template <typename T = void>
+class SnmpTask {
+public:
+    struct promise_type : SnmpTaskPromiseResult<T> {
+        SnmpTask get_return_object() {
+            return SnmpTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+    };
+
+    SnmpTask() = default;
+    SnmpTask(SnmpTask&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    SnmpTask& operator=(SnmpTask&& other) noexcept {
+        if (this != &other) {
+            if (handle) handle.destroy();
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+    SnmpTask(const SnmpTask&) = delete;
+    SnmpTask& operator=(const SnmpTask&) = delete;
+    ~SnmpTask() {
+        if (handle) handle.destroy();
+    }
+
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> waiter) noexcept {
+        handle.promise().continuation = waiter;
+        return handle;
+    }
+    T await_resume() {
+        if constexpr (!std::is_void_v<T>) return std::move(handle.promise().value);
+    }
+
+    // Передаёт кадр вызывающему (для SnmpLoopSpawn)
+    std::coroutine_handle<promise_type> Release() { return std::exchange(handle, nullptr); }
+
+private:
+    explicit SnmpTask(std::coroutine_handle<promise_type> coroutine) : handle(coroutine) {}
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+// Агент цикла: адрес, начало сообщения и оценка времени ответа
+struct SnmpLoopAgent {
+    std::string target;           // метка метрик
+    std::string community;
+    sockaddr_storage address;
+    int addressLength = 0;
+    AsnInteger version = SNMP_VERSION_V2C;
+    std::vector<BYTE> header;     // version и community в BER
+    SOCKET sock = INVALID_SOCKET;
+    SnmpRtt rtt;
+};
+
+struct SnmpLoopStats {
+    unsigned long long sent = 0;          // датаграмм с повторами
+    unsigned long long retransmits = 0;
+    unsigned long long responses = 0;
+    unsigned long long timeouts = 0;
+    unsigned long long unmatched = 0;     // ответы без ожидающего запроса
+    unsigned long long queued = 0;        // запросы, ждавшие места в maxInFlight
+};
+
+// Цикл событий для запросов корутин в одном потоке. Запросы всех задач находятся
+// в полёте одновременно на общих неблокирующих сокетах (по одному на семейство адресов)
+// и сопоставляются с ответами по request-id; таймауты и повторы ведёт колесо таймеров.
+// Корутина, ожидавшая ответа, продолжается прямо из обработчика датаграммы.
+struct SnmpLoop {
+    DWORD timeout = 5000;         // таймаут попытки (при adaptiveTimeout - его предел)
+    int retries = 2;
+    bool adaptiveTimeout = true;
+    size_t maxInFlight = SNMP_LOOP_MAX_IN_FLIGHT;
+
+    std::vector<SnmpLoopAgent> agents;
+    SOCKET sockets[2] = { INVALID_SOCKET, INVALID_SOCKET };   // IPv4 и IPv6
+    std::vector<SnmpAsyncOp*> slots;      // запросы в полёте по номеру в младших битах request-id
+    std::vector<UINT> freeSlots;
+    int slotBits = 0;
+    AsnInteger sequence = 0;
+    AsnInteger sequenceLimit = 0;
+    size_t inFlight = 0;
+    SnmpAsyncOp* waitingHead = NULL;      // ждут места в maxInFlight, по порядку
+    SnmpAsyncOp* waitingTail = NULL;
+    size_t active = 0;                    // незавершённые задачи SnmpLoopSpawn
+    SnmpLoopStats stats;
+
+    SnmpTimerWheel wheel;
+    std::vector<BYTE> sendBuffer;
+    std::vector<BYTE> receiveBuffer;
+    SnmpArena arena;
+#ifdef __linux__
+    int epollFd = -1;
+#endif
+};
+
+bool SnmpLoopInit(SnmpLoop& loop, DWORD timeout, int retries, size_t maxInFlight = SNMP_LOOP_MAX_IN_FLIGHT);
+
+// Добавляет агента с уже разрешённым адресом (см. SnmpResolveAll); сокет его семейства
+// открывается при первом таком агенте. Возвращает индекс или SNMP_LOOP_NO_AGENT (GetLastError).
+size_t SnmpLoopAddAgent(SnmpLoop& loop, const std::string& target, const sockaddr_storage& address,
+    int addressLength, const std::string& community, AsnInteger version = SNMP_VERSION_V2C);
+
+// Запускает задачу до первого ожидания; дальше её ведёт SnmpLoopRun. Кадр освобождается по завершении.
+void SnmpLoopSpawn(SnmpLoop& loop, SnmpTask<void> task);
+
+// Ведёт цикл событий, пока не завершатся все запущенные задачи
+bool SnmpLoopRun(SnmpLoop& loop);
+
+void SnmpLoopClose(SnmpLoop& loop);
+
+// Обход поддерева: GETBULK по maxRepetitions OID (для SNMPv1-агента - GETNEXT), при tooBig
+// пачка уменьшается вдвое. Возвращает 0 или код ошибки (SNMP_UDP_ERROR_AGENT - ошибка агента).
+// Varbind действителен только внутри onVarBind.
+SnmpTask<DWORD> SnmpAsyncWalk(SnmpLoop& loop, size_t agent, SnmpOid baseOid, UINT maxRepetitions,
+    SnmpWalkCallback onVarBind);
@@ -0,0 +1,118 @@
+﻿#include "snmp_batch.h"
+
+#include <deque>
+
+// Запас на рост полей длины у SEQUENCE сообщения, PDU и списка varbind
+#define SNMP_BATCH_LENGTH_SLACK 8
+
+bool SnmpGetBatch(SnmpUdpSession& session, const std::vector<SnmpOid>& oids,
+    SnmpArena& resultArena, std::vector<SnmpBatchResult>& results) {
+    results.resize(oids.size());
+    for (SnmpBatchResult& result : results) {
+        result.errorStatus = SNMP_ERRORSTATUS_NOERROR;
+        result.value.asnType = ASN_NULL;
+    }
+    if (oids.empty()) return true;
+
+    std::vector<RFC1157VarBind> varBinds(oids.size());
+    for (size_t i = 0; i < oids.size(); i++) {
+        varBinds[i].name = oids[i].AsAsn();
+        varBinds[i].value.asnType = ASN_NULL;
+    }
+
+    SnmpPdu request;
+    request.type = SNMP_PDU_GET;
+    request.requestId = 0x7FFFFFFF;
+    request.errorStatus = 0;
+    request.errorIndex = 0;
+    request.varBinds.list = NULL;
+    request.varBinds.len = 0;
+
+    // Размер сообщения без varbind - общая часть каждого запроса
+    size_t headerSize = BerEncodeMessage(session.version, session.community.data(), session.community.size(),
+        request, session.sendBuffer.data(), session.sendBuffer.size()) + SNMP_BATCH_LENGTH_SLACK;
+
+    // Разбиваем OID на пакеты по размеру запроса и известному пределу varbind
+    std::deque<std::vector<size_t>> batches;
+    std::vector<size_t> batch;
+    size_t batchSize = headerSize;
+    for (size_t i = 0; i < oids.size(); i++) {
+        size_t varBindSize = BerVarBindSize(varBinds[i].name);
+        bool full = batchSize + varBindSize > session.maxMessageSize
+            || (session.maxVarBinds != 0 && batch.size() >= session.maxVarBinds);
+        if (!batch.empty() && full) {
+            batches.push_back(std::move(batch));
+            batch.clear();
+            batchSize = headerSize;
+        }
+        batch.push_back(i);
+        batchSize += varBindSize;
+    }
+    batches.push_back(std::move(batch));
+
+    std::vector<RFC1157VarBind> requestList;
+    while (!batches.empty()) {
+        batch = std::move(batches.front());
+        batches.pop_front();
+
+        requestList.clear();
+        for (size_t index : batch) {
+            requestList.push_back(varBinds[index]);
+        }
+        request.varBinds.list = requestList.data();
+        request.varBinds.len = (UINT)requestList.size();
+
+        SnmpPdu response;
+        if (!SnmpUdpRequest(session, request, response)) {
+            return false;
+        }
+
+        if (response.errorStatus == SNMP_ERRORSTATUS_NOERROR) {
+            for (size_t i = 0; i < batch.size(); i++) {
+                SnmpBatchResult& result = results[batch[i]];
+
+                // Ответ сопоставляется по позиции, но имя всё равно сверяем
+                if (i >= response.varBinds.len
+                    || SnmpOidCompare(response.varBinds.list[i].name, varBinds[batch[i]].name) != 0) {
+                    result.errorStatus = SNMP_ERRORSTATUS_GENERR;
+                    continue;
+                }
+
+                if (!SnmpCopyValue(resultArena, response.varBinds.list[i].value, result.value)) {
+                    SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+                    return false;
+                }
+            }
+        }
+        else if (response.errorStatus == SNMP_ERRORSTATUS_TOOBIG) {
+            if (batch.size() == 1) {
+                results[batch[0]].errorStatus = SNMP_ERRORSTATUS_TOOBIG;
+                continue;
+            }
+
+            // Ответ агента не поместился - делим пакет и запоминаем предел для следующих
+            size_t half = batch.size() / 2;
+            if (session.maxVarBinds == 0 || session.maxVarBinds > half) {
+                session.maxVarBinds = (UINT)half;
+            }
+            batches.push_front(std::vector<size_t>(batch.begin() + half, batch.end()));
+            batches.push_front(std::vector<size_t>(batch.begin(), batch.begin() + half));
+        }
+        else if (response.errorIndex >= 1 && (size_t)response.errorIndex <= batch.size()) {
+            // Ошибка относится к одному varbind: отдаём её ему, остальные запрашиваем снова
+            size_t bad = (size_t)response.errorIndex - 1;
+            results[batch[bad]].errorStatus = response.errorStatus;
+            batch.erase(batch.begin() + bad);
+            if (!batch.empty()) {
+                batches.push_front(std::move(batch));
+            }
+        }
+        else {
+            for (size_t index : batch) {
+                results[index].errorStatus = response.errorStatus;
+            }
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,19 @@
+﻿#pragma once
+
+#include <vector>
+#include "snmp_oid.h"
+#include "snmp_udp.h"
+
+// Результат пакетного GET для одного OID
+struct SnmpBatchResult {
+    AsnInteger errorStatus;       // SNMP_ERRORSTATUS_NOERROR или ошибка, отнесённая к этому OID
+    AsnAny value;                 // копия в арене вызывающего (ASN_NULL при ошибке)
+};
+
+// Читает значения всех OID минимальным числом запросов GET: OID упаковываются
+// в PDU, пока запрос помещается в session.maxMessageSize. При tooBig пакет делится
+// пополам (и предел сохраняется в session.maxVarBinds), при ошибке с errorIndex
+// (noSuchName в SNMPv1) виновный OID получает эту ошибку, а остальные запрашиваются повторно.
+// results[i] соответствует oids[i]. false - только при ошибке транспорта или памяти.
+bool SnmpGetBatch(SnmpUdpSession& session, const std::vector<SnmpOid>& oids,
+    SnmpArena& resultArena, std::vector<SnmpBatchResult>& results);
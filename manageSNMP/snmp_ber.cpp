@@ -0,0 +1,493 @@
+﻿#include "snmp_ber.h"
+
+#include <cstring>
+
+// Кодирование идёт с конца буфера к началу: длина каждого TLV становится
+// известна сразу после записи содержимого, поэтому промежуточные буферы не нужны.
+struct BerWriter {
+    BYTE* begin;
+    BYTE* pos;
+    bool overflow;
+};
+
+static void BerPutByte(BerWriter& writer, BYTE value) {
+    if (writer.pos == writer.begin) {
+        writer.overflow = true;
+        return;
+    }
+    *--writer.pos = value;
+}
+
+static void BerPutBytes(BerWriter& writer, const BYTE* data, size_t length) {
+    if ((size_t)(writer.pos - writer.begin) < length) {
+        writer.overflow = true;
+        return;
+    }
+    writer.pos -= length;
+    if (length > 0) {
+        memcpy(writer.pos, data, length);
+    }
+}
+
+// Функция для записи тега и длины BER (короткая или длинная форма) перед содержимым
+static void BerPutHeader(BerWriter& writer, BYTE tag, size_t length) {
+    if (length < 0x80) {
+        BerPutByte(writer, (BYTE)length);
+    }
+    else {
+        int count = 0;
+        while (length > 0) {
+            BerPutByte(writer, (BYTE)(length & 0xFF));
+            length >>= 8;
+            count++;
+        }
+        BerPutByte(writer, (BYTE)(0x80 | count));
+    }
+    BerPutByte(writer, tag);
+}
+
+// Функция для записи INTEGER в минимальном дополнительном коде
+static void BerPutInteger(BerWriter& writer, BYTE tag, long long value) {
+    size_t count = 0;
+
+    do {
+        BYTE byte = (BYTE)(value & 0xFF);
+        BerPutByte(writer, byte);
+        value >>= 8;
+        count++;
+        if ((value == 0 && !(byte & 0x80)) || (value == -1 && (byte & 0x80))) break;
+    } while (count < 8);
+
+    BerPutHeader(writer, tag, count);
+}
+
+// Функция для записи беззнакового значения (Counter32, Gauge32, TimeTicks, Counter64)
+static void BerPutUnsigned(BerWriter& writer, BYTE tag, unsigned long long value) {
+    size_t count = 0;
+    BYTE byte;
+
+    do {
+        byte = (BYTE)(value & 0xFF);
+        BerPutByte(writer, byte);
+        value >>= 8;
+        count++;
+    } while (value != 0);
+
+    // Старший бит означал бы отрицательное число - дописываем нулевой байт
+    if (byte & 0x80) {
+        BerPutByte(writer, 0);
+        count++;
+    }
+
+    BerPutHeader(writer, tag, count);
+}
+
+// Функция для записи OBJECT IDENTIFIER
+static bool BerPutOid(BerWriter& writer, const AsnObjectIdentifier& oid) {
+    if (oid.idLength < 2 || oid.ids[0] > 2 || (oid.ids[0] < 2 && oid.ids[1] >= 40)) {
+        return false;
+    }
+
+    BYTE* end = writer.pos;
+    for (UINT i = oid.idLength - 1; i >= 1; i--) {
+        unsigned long long arc = oid.ids[i];
+        if (i == 1) {
+            arc += 40ULL * oid.ids[0];
+        }
+
+        // Младшая группа 7 бит идёт последней и без бита продолжения
+        BerPutByte(writer, (BYTE)(arc & 0x7F));
+        arc >>= 7;
+        while (arc != 0) {
+            BerPutByte(writer, (BYTE)((arc & 0x7F) | 0x80));
+            arc >>= 7;
+        }
+    }
+
+    BerPutHeader(writer, ASN_OBJECTIDENTIFIER, end - writer.pos);
+    return true;
+}
+
+// Функция для записи значения varbind
+static bool BerPutValue(BerWriter& writer, const AsnAny& value) {
+    switch (value.asnType) {
+    case ASN_NULL:
+    case SNMP_EXCEPTION_NOSUCHOBJECT:
+    case SNMP_EXCEPTION_NOSUCHINSTANCE:
+    case SNMP_EXCEPTION_ENDOFMIBVIEW:
+        BerPutHeader(writer, value.asnType, 0);
+        return true;
+    case ASN_INTEGER:
+        BerPutInteger(writer, ASN_INTEGER, value.asnValue.number);
+        return true;
+    case ASN_COUNTER32:
+    case ASN_GAUGE32:
+    case ASN_TIMETICKS:
+    case ASN_UNSIGNED32:
+        BerPutUnsigned(writer, value.asnType, value.asnValue.unsigned32);
+        return true;
+    case ASN_COUNTER64:
+        BerPutUnsigned(writer, ASN_COUNTER64, value.asnValue.counter64.QuadPart);
+        return true;
+    case ASN_OCTETSTRING:
+    case ASN_IPADDRESS:
+    case ASN_OPAQUE:
+    case ASN_BITS:
+        BerPutBytes(writer, value.asnValue.string.stream, value.asnValue.string.length);
+        BerPutHeader(writer, value.asnType, value.asnValue.string.length);
+        return true;
+    case ASN_OBJECTIDENTIFIER:
+        return BerPutOid(writer, value.asnValue.object);
+    default:
+        return false;
+    }
+}
+
+// Функция для записи PDU со списком varbind
+static bool BerPutPdu(BerWriter& writer, const SnmpPdu& pdu) {
+    // В запросах на чтение значения не передаются - всегда кодируем NULL
+    bool withValues = pdu.type == SNMP_PDU_SET || pdu.type == SNMP_PDU_RESPONSE;
+    AsnAny nullValue;
+    nullValue.asnType = ASN_NULL;
+
+    BYTE* pduEnd = writer.pos;
+    for (UINT i = pdu.varBinds.len; i > 0; i--) {
+        const RFC1157VarBind& varBind = pdu.varBinds.list[i - 1];
+
+        BYTE* varBindEnd = writer.pos;
+        if (!BerPutValue(writer, withValues ? varBind.value : nullValue)) return false;
+        if (!BerPutOid(writer, varBind.name)) return false;
+        BerPutHeader(writer, ASN_SEQUENCE, varBindEnd - writer.pos);
+
+        if (writer.overflow) return false;
+    }
+    BerPutHeader(writer, ASN_SEQUENCE, pduEnd - writer.pos);
+
+    BerPutInteger(writer, ASN_INTEGER, pdu.errorIndex);
+    BerPutInteger(writer, ASN_INTEGER, pdu.errorStatus);
+    BerPutInteger(writer, ASN_INTEGER, pdu.requestId);
+    BerPutHeader(writer, pdu.type, pduEnd - writer.pos);
+    return !writer.overflow;
+}
+
+// Функция для записи version и community
+static void BerPutMessageHeader(BerWriter& writer, AsnInteger version, const char* community, size_t communityLength) {
+    BerPutBytes(writer, (const BYTE*)community, communityLength);
+    BerPutHeader(writer, ASN_OCTETSTRING, communityLength);
+    BerPutInteger(writer, ASN_INTEGER, version);
+}
+
+// Функция для переноса готового сообщения из конца буфера в начало
+static size_t BerFinish(BerWriter& writer, BYTE* buffer, BYTE* messageEnd) {
+    if (writer.overflow) return 0;
+
+    size_t length = messageEnd - writer.pos;
+    memmove(buffer, writer.pos, length);
+    return length;
+}
+
+size_t BerEncodeMessage(AsnInteger version, const char* community, size_t communityLength,
+    const SnmpPdu& pdu, BYTE* buffer, size_t capacity) {
+    BerWriter writer = { buffer, buffer + capacity, false };
+
+    BYTE* messageEnd = writer.pos;
+    if (!BerPutPdu(writer, pdu)) return 0;
+    BerPutMessageHeader(writer, version, community, communityLength);
+    BerPutHeader(writer, ASN_SEQUENCE, messageEnd - writer.pos);
+
+    return BerFinish(writer, buffer, messageEnd);
+}
+
+size_t BerEncodeMessageHeader(AsnInteger version, const char* community, size_t communityLength,
+    BYTE* buffer, size_t capacity) {
+    BerWriter writer = { buffer, buffer + capacity, false };
+
+    BYTE* headerEnd = writer.pos;
+    BerPutMessageHeader(writer, version, community, communityLength);
+
+    return BerFinish(writer, buffer, headerEnd);
+}
+
+size_t BerEncodeMessagePrefixed(const BYTE* header, size_t headerLength, const SnmpPdu& pdu,
+    BYTE* buffer, size_t capacity) {
+    BerWriter writer = { buffer, buffer + capacity, false };
+
+    BYTE* messageEnd = writer.pos;
+    if (!BerPutPdu(writer, pdu)) return 0;
+    BerPutBytes(writer, header, headerLength);
+    BerPutHeader(writer, ASN_SEQUENCE, messageEnd - writer.pos);
+
+    return BerFinish(writer, buffer, messageEnd);
+}
+
+// Функция для вычисления размера заголовка TLV с содержимым длины length
+static size_t BerHeaderSize(size_t length) {
+    size_t size = 2;
+    while (length > 0x7F) {
+        size++;
+        length >>= 8;
+    }
+    return size;
+}
+
+size_t BerVarBindSize(const AsnObjectIdentifier& name) {
+    size_t oidLength = 0;
+    for (UINT i = 1; i < name.idLength; i++) {
+        unsigned long long arc = name.ids[i];
+        if (i == 1) {
+            arc += 40ULL * name.ids[0];
+        }
+        do {
+            oidLength++;
+            arc >>= 7;
+        } while (arc != 0);
+    }
+
+    size_t content = BerHeaderSize(oidLength) + oidLength + 2;
+    return BerHeaderSize(content) + content;
+}
+
+// Курсор для чтения BER с проверкой границ
+struct BerReader {
+    const BYTE* pos;
+    const BYTE* end;
+};
+
+// Функция для чтения заголовка TLV. Возвращает тег и границы содержимого.
+static bool BerReadTlv(BerReader& reader, BYTE& tag, const BYTE*& content, size_t& length) {
+    if (reader.end - reader.pos < 2) return false;
+
+    tag = *reader.pos++;
+    BYTE first = *reader.pos++;
+
+    if (first < 0x80) {
+        length = first;
+    }
+    else {
+        int count = first & 0x7F;
+        if (count == 0 || count > 4 || reader.end - reader.pos < count) return false;
+
+        length = 0;
+        for (int i = 0; i < count; i++) {
+            length = (length << 8) | *reader.pos++;
+        }
+    }
+
+    if ((size_t)(reader.end - reader.pos) < length) return false;
+
+    content = reader.pos;
+    reader.pos += length;
+    return true;
+}
+
+static bool BerReadExpected(BerReader& reader, BYTE expectedTag, BerReader& inner) {
+    BYTE tag;
+    const BYTE* content;
+    size_t length;
+    if (!BerReadTlv(reader, tag, content, length) || tag != expectedTag) return false;
+
+    inner.pos = content;
+    inner.end = content + length;
+    return true;
+}
+
+// Функция для разбора знакового INTEGER
+static bool BerParseInteger(const BYTE* content, size_t length, long long& value) {
+    if (length == 0 || length > 8) return false;
+
+    value = (content[0] & 0x80) ? -1 : 0;
+    for (size_t i = 0; i < length; i++) {
+        value = (long long)(((unsigned long long)value << 8) | content[i]);
+    }
+    return true;
+}
+
+// Функция для разбора беззнакового значения (допускается ведущий нулевой байт)
+static bool BerParseUnsigned(const BYTE* content, size_t length, unsigned long long& value) {
+    if (length == 0 || length > 9 || (length == 9 && content[0] != 0)) return false;
+
+    value = 0;
+    for (size_t i = 0; i < length; i++) {
+        value = (value << 8) | content[i];
+    }
+    return true;
+}
+
+static bool BerReadInteger(BerReader& reader, AsnInteger& value) {
+    BYTE tag;
+    const BYTE* content;
+    size_t length;
+    long long parsed;
+    if (!BerReadTlv(reader, tag, content, length) || tag != ASN_INTEGER) return false;
+    if (!BerParseInteger(content, length, parsed)) return false;
+
+    value = (AsnInteger)parsed;
+    return true;
+}
+
+// Функция для разбора OBJECT IDENTIFIER в массив из арены
+static bool BerParseOid(const BYTE* content, size_t length, SnmpArena& arena, AsnObjectIdentifier& oid) {
+    oid.idLength = 0;
+    oid.ids = NULL;
+    if (length == 0 || (content[length - 1] & 0x80)) return false;
+
+    // Количество дуг не больше количества байт плюс одна (первый байт даёт две дуги)
+    UINT* ids = SnmpArenaAllocArray<UINT>(arena, length + 1);
+    if (!ids) return false;
+
+    UINT count = 0;
+    unsigned long long arc = 0;
+    for (size_t i = 0; i < length; i++) {
+        arc = (arc << 7) | (content[i] & 0x7F);
+        // Первый подидентификатор - это 40 * X + Y: для X = 2 дуга Y на 80 меньше его;
+        // остальные дуги обязаны помещаться в UINT, иначе усечение дало бы другой OID
+        if (arc > (count == 0 ? 0xFFFFFFFFULL + 80 : 0xFFFFFFFFULL)) return false;
+
+        if (!(content[i] & 0x80)) {
+            if (count == 0) {
+                UINT first = arc < 40 ? 0 : (arc < 80 ? 1 : 2);
+                ids[count++] = first;
+                ids[count++] = (UINT)(arc - 40ULL * first);
+            }
+            else {
+                ids[count++] = (UINT)arc;
+            }
+            arc = 0;
+        }
+    }
+
+    oid.idLength = count;
+    oid.ids = ids;
+    return true;
+}
+
+// Функция для разбора значения varbind в AsnAny. Строки не копируются.
+static bool BerParseValue(BYTE tag, const BYTE* content, size_t length, SnmpArena& arena, AsnAny& value) {
+    long long number;
+    unsigned long long unsignedValue;
+
+    value.asnType = tag;
+    switch (tag) {
+    case ASN_NULL:
+    case SNMP_EXCEPTION_NOSUCHOBJECT:
+    case SNMP_EXCEPTION_NOSUCHINSTANCE:
+    case SNMP_EXCEPTION_ENDOFMIBVIEW:
+        return true;
+    case ASN_INTEGER:
+        if (!BerParseInteger(content, length, number)) return false;
+        value.asnValue.number = (AsnInteger)number;
+        return true;
+    case ASN_COUNTER32:
+    case ASN_GAUGE32:
+    case ASN_TIMETICKS:
+    case ASN_UNSIGNED32:
+        if (!BerParseUnsigned(content, length, unsignedValue)) return false;
+        value.asnValue.unsigned32 = (AsnUnsigned32)unsignedValue;
+        return true;
+    case ASN_COUNTER64:
+        if (!BerParseUnsigned(content, length, unsignedValue)) return false;
+        value.asnValue.counter64.QuadPart = unsignedValue;
+        return true;
+    case ASN_OBJECTIDENTIFIER:
+        return BerParseOid(content, length, arena, value.asnValue.object);
+    case ASN_OCTETSTRING:
+    case ASN_IPADDRESS:
+    case ASN_OPAQUE:
+    case ASN_BITS:
+        value.asnValue.string.stream = const_cast<BYTE*>(content);
+        value.asnValue.string.length = (UINT)length;
+        value.asnValue.string.dynamic = FALSE;
+        return true;
+    default:
+        // Неизвестный тип сохраняем только как тег, содержимое пропускаем
+        value.asnValue.string.stream = NULL;
+        value.asnValue.string.length = 0;
+        value.asnValue.string.dynamic = FALSE;
+        return true;
+    }
+}
+
+bool BerDecodeMessage(const BYTE* data, size_t length, SnmpArena& arena, SnmpMessage& message) {
+    SnmpPdu& pdu = message.pdu;
+    pdu.varBinds.list = NULL;
+    pdu.varBinds.len = 0;
+
+    BerReader reader = { data, data + length };
+    BerReader body;
+    if (!BerReadExpected(reader, ASN_SEQUENCE, body)) return false;
+    if (!BerReadInteger(body, message.version)) return false;
+
+    BerReader communityReader;
+    if (!BerReadExpected(body, ASN_OCTETSTRING, communityReader)) return false;
+    message.community = communityReader.pos;
+    message.communityLength = (UINT)(communityReader.end - communityReader.pos);
+
+    BYTE tag;
+    const BYTE* content;
+    size_t contentLength;
+    if (!BerReadTlv(body, tag, content, contentLength)) return false;
+
+    pdu.type = tag;
+    BerReader pduReader = { content, content + contentLength };
+    if (!BerReadInteger(pduReader, pdu.requestId)) return false;
+    if (!BerReadInteger(pduReader, pdu.errorStatus)) return false;
+    if (!BerReadInteger(pduReader, pdu.errorIndex)) return false;
+
+    BerReader varBindsReader;
+    if (!BerReadExpected(pduReader, ASN_SEQUENCE, varBindsReader)) return false;
+
+    // Сначала считаем количество varbind, чтобы выделить список одним блоком
+    UINT count = 0;
+    BerReader counter = varBindsReader;
+    while (counter.pos < counter.end) {
+        if (!BerReadTlv(counter, tag, content, contentLength)) return false;
+        count++;
+    }
+
+    if (count == 0) return true;
+
+    RFC1157VarBind* list = SnmpArenaAllocArray<RFC1157VarBind>(arena, count);
+    if (!list) return false;
+
+    for (UINT i = 0; i < count; i++) {
+        BerReader varBind;
+        if (!BerReadExpected(varBindsReader, ASN_SEQUENCE, varBind)) return false;
+        if (!BerReadTlv(varBind, tag, content, contentLength) || tag != ASN_OBJECTIDENTIFIER) return false;
+        if (!BerParseOid(content, contentLength, arena, list[i].name)) return false;
+        if (!BerReadTlv(varBind, tag, content, contentLength)) return false;
+        if (!BerParseValue(tag, content, contentLength, arena, list[i].value)) return false;
+    }
+
+    pdu.varBinds.list = list;
+    pdu.varBinds.len = count;
+    return true;
+}
+
+bool SnmpCopyValue(SnmpArena& arena, const AsnAny& source, AsnAny& destination) {
+    destination = source;
+
+    switch (source.asnType) {
+    case ASN_OBJECTIDENTIFIER: {
+        const AsnObjectIdentifier& oid = source.asnValue.object;
+        UINT* ids = SnmpArenaAllocArray<UINT>(arena, oid.idLength ? oid.idLength : 1);
+        if (!ids) return false;
+        memcpy(ids, oid.ids, oid.idLength * sizeof(UINT));
+        destination.asnValue.object.ids = ids;
+        return true;
+    }
+    case ASN_OCTETSTRING:
+    case ASN_IPADDRESS:
+    case ASN_OPAQUE:
+    case ASN_BITS: {
+        const AsnOctetString& string = source.asnValue.string;
+        BYTE* stream = SnmpArenaAllocArray<BYTE>(arena, string.length ? string.length : 1);
+        if (!stream) return false;
+        if (string.length) memcpy(stream, string.stream, string.length);
+        destination.asnValue.string.stream = stream;
+        destination.asnValue.string.dynamic = FALSE;
+        return true;
+    }
+    default:
+        return true;
+    }
+}
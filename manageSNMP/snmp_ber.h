@@ -0,0 +1,53 @@
+﻿#pragma once
+
+#include <cstddef>
+#include "snmp_compat.h"
+#include "snmp_arena.h"
+
+// Версии протокола в поле version сообщения SNMP
+#define SNMP_VERSION_V1  0
+#define SNMP_VERSION_V2C 1
+
+// PDU в том виде, в котором он передаётся по сети.
+// Для GETBULK поля errorStatus/errorIndex содержат non-repeaters/max-repetitions.
+struct SnmpPdu {
+    BYTE type;
+    AsnInteger requestId;
+    AsnInteger errorStatus;
+    AsnInteger errorIndex;
+    RFC1157VarBindList varBinds;
+};
+
+// Разобранное сообщение. Все указатели ссылаются либо на буфер, из которого
+// сообщение было разобрано, либо на арену - отдельно ничего освобождать не нужно.
+struct SnmpMessage {
+    AsnInteger version;
+    const BYTE* community;
+    UINT communityLength;
+    SnmpPdu pdu;
+};
+
+// Кодирует сообщение SNMP (version, community, PDU) в BER в буфер вызывающего.
+// Возвращает длину сообщения или 0, если оно не поместилось в capacity байт.
+size_t BerEncodeMessage(AsnInteger version, const char* community, size_t communityLength,
+    const SnmpPdu& pdu, BYTE* buffer, size_t capacity);
+
+// Кодирует начало сообщения - version и community - для повторного использования:
+// у запросов одной сессии оно одинаково. Возвращает длину или 0 при нехватке места.
+size_t BerEncodeMessageHeader(AsnInteger version, const char* community, size_t communityLength,
+    BYTE* buffer, size_t capacity);
+
+// То же, что BerEncodeMessage, но version и community берутся готовыми из BerEncodeMessageHeader
+size_t BerEncodeMessagePrefixed(const BYTE* header, size_t headerLength, const SnmpPdu& pdu,
+    BYTE* buffer, size_t capacity);
+
+// Разбирает сообщение SNMP из BER без копирования: строковые значения указывают
+// в data, массивы OID и список varbind выделяются из арены.
+bool BerDecodeMessage(const BYTE* data, size_t length, SnmpArena& arena, SnmpMessage& message);
+
+// Размер varbind с NULL-значением в запросе на чтение (для упаковки нескольких OID в один PDU)
+size_t BerVarBindSize(const AsnObjectIdentifier& name);
+
+// Копирует значение (вместе со строкой или OID, на которые оно ссылается) в арену,
+// чтобы оно пережило буфер приёма. Возвращает false при нехватке памяти.
+bool SnmpCopyValue(SnmpArena& arena, const AsnAny& source, AsnAny& destination);
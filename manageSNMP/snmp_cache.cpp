@@ -0,0 +1,208 @@
+﻿#include "snmp_cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include "snmp_metrics.h"
+
+void SnmpCacheSetTtl(SnmpCache& cache, const SnmpOid& subtree, DWORD ttl) {
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    auto it = std::lower_bound(cache.rules.begin(), cache.rules.end(), subtree,
+        [](const SnmpCacheRule& rule, const SnmpOid& oid) { return rule.subtree < oid; });
+    if (it != cache.rules.end() && it->subtree == subtree) {
+        it->ttl = ttl;
+        return;
+    }
+    cache.rules.insert(it, SnmpCacheRule{ subtree, ttl });
+}
+
+DWORD SnmpCacheTtl(const SnmpCache& cache, const SnmpOid& oid) {
+    // Поддеревья, содержащие OID, идут в сортированном списке не позже него;
+    // из них самое длинное встречается последним
+    auto it = std::upper_bound(cache.rules.begin(), cache.rules.end(), oid,
+        [](const SnmpOid& value, const SnmpCacheRule& rule) { return value < rule.subtree; });
+    while (it != cache.rules.begin()) {
+        --it;
+        if (oid.StartsWith(it->subtree)) return it->ttl;
+    }
+    return cache.ttl;
+}
+
+// Функция для копирования varbind в арену результата
+static bool SnmpCacheCopyVarBind(SnmpCacheResult& result, const RFC1157VarBind& source) {
+    RFC1157VarBind copy;
+    UINT* ids = SnmpArenaAllocArray<UINT>(result.arena, source.name.idLength ? source.name.idLength : 1);
+    if (!ids || !SnmpCopyValue(result.arena, source.value, copy.value)) return false;
+    memcpy(ids, source.name.ids, source.name.idLength * sizeof(UINT));
+    copy.name.ids = ids;
+    copy.name.idLength = source.name.idLength;
+    result.varBinds.push_back(copy);
+    return true;
+}
+
+// Функция обмена с агентом мимо кэша: результат - в result, без блокировки кэша
+static void SnmpCacheExchange(SnmpUdpSession& session, const SnmpOid& oid, bool walk, UINT maxRepetitions,
+    SnmpCacheResult& result) {
+    if (walk) {
+        bool copied = true;
+        auto onVarBind = [&result, &copied](RFC1157VarBind& varBind) {
+            if (copied && !SnmpCacheCopyVarBind(result, varBind)) copied = false;
+        };
+        bool success = maxRepetitions > 0 ? SnmpBulkWalk(session, oid, maxRepetitions, onVarBind)
+            : SnmpWalk(session, oid, onVarBind);
+        if (!success) result.error = GetLastError();
+        else if (!copied) result.error = ERROR_NOT_ENOUGH_MEMORY;
+        return;
+    }
+
+    RFC1157VarBind requestVarBind;
+    requestVarBind.name = oid.AsAsn();
+    requestVarBind.value.asnType = ASN_NULL;
+    SnmpPdu request;
+    request.type = SNMP_PDU_GET;
+    request.errorStatus = 0;
+    request.errorIndex = 0;
+    request.varBinds.list = &requestVarBind;
+    request.varBinds.len = 1;
+
+    SnmpPdu response;
+    if (!SnmpUdpRequest(session, request, response)) {
+        result.error = GetLastError();
+        return;
+    }
+    // Ошибка агента - тоже ответ: noSuchName на повторный GET агент дал бы снова
+    result.errorStatus = response.errorStatus;
+    if (response.errorStatus == SNMP_ERRORSTATUS_NOERROR && response.varBinds.len == 0) {
+        result.errorStatus = SNMP_ERRORSTATUS_GENERR;
+    }
+    if (result.errorStatus == SNMP_ERRORSTATUS_NOERROR && !SnmpCacheCopyVarBind(result, response.varBinds.list[0])) {
+        result.error = ERROR_NOT_ENOUGH_MEMORY;
+    }
+}
+
+// Функция удаления истёкших записей, к которым никто не присоединился
+static void SnmpCacheSweep(std::unordered_map<SnmpOid, SnmpCacheEntry>& entries, ULONGLONG now) {
+    for (auto it = entries.begin(); it != entries.end();) {
+        if (!it->second.pending && it->second.expiresAt <= now) it = entries.erase(it);
+        else ++it;
+    }
+}
+
+// Функция получения ответа: из кэша, от запроса в полёте или новым обменом с агентом.
+static std::shared_ptr<SnmpCacheResult> SnmpCacheFetch(SnmpCache& cache, SnmpUdpSession& session,
+    const SnmpOid& oid, bool walk, UINT maxRepetitions) {
+    SnmpMetricsSeries* metrics = SnmpMetricsSeriesFor(session.target,
+        walk ? (maxRepetitions > 0 ? SNMP_PDU_GETBULK : SNMP_PDU_GETNEXT) : SNMP_PDU_GET);
+    std::string key = session.target;
+    key.push_back('\0');
+    key.append(session.community);
+
+    std::unique_lock<std::mutex> lock(cache.mutex);
+    SnmpCacheAgent& agent = cache.agents[key];
+    std::unordered_map<SnmpOid, SnmpCacheEntry>& entries =
+        !walk ? agent.gets : (maxRepetitions > 0 ? agent.bulkWalks : agent.walks);
+    ULONGLONG now = GetTickCount64();
+    SnmpCacheEntry& entry = entries[oid];
+
+    if (entry.result && entry.expiresAt > now) {
+        cache.hits++;
+        SnmpMetricsOnCache(metrics, SNMP_METRICS_CACHE_HIT);
+        return entry.result;
+    }
+    if (entry.pending) {
+        cache.merged++;
+        SnmpMetricsOnCache(metrics, SNMP_METRICS_CACHE_MERGED);
+        std::shared_ptr<SnmpCacheResult> pending = entry.pending;
+        cache.completed.wait(lock, [&pending]() { return pending->done; });
+        return pending;
+    }
+
+    cache.misses++;
+    SnmpMetricsOnCache(metrics, SNMP_METRICS_CACHE_MISS);
+    std::shared_ptr<SnmpCacheResult> result = std::make_shared<SnmpCacheResult>();
+    entry.pending = result;
+    lock.unlock();
+
+    // Запрос идёт без блокировки: обмен с агентом может длиться секунды
+    SnmpCacheExchange(session, oid, walk, maxRepetitions, *result);
+
+    // Ссылки на агента и запись действительны: вставка в unordered_map их не меняет,
+    // а запись с запросом в полёте не удаляется
+    lock.lock();
+    now = GetTickCount64();
+    entry.pending.reset();
+    DWORD ttl = SnmpCacheTtl(cache, oid);
+    if (result->error == 0 && ttl > 0) {
+        entry.result = result;
+        entry.expiresAt = now + ttl;
+    }
+
+    size_t entryCount = agent.gets.size() + agent.walks.size() + agent.bulkWalks.size();
+    if (entryCount >= agent.sweepAt) {
+        SnmpCacheSweep(agent.gets, now);
+        SnmpCacheSweep(agent.walks, now);
+        SnmpCacheSweep(agent.bulkWalks, now);
+        entryCount = agent.gets.size() + agent.walks.size() + agent.bulkWalks.size();
+        agent.sweepAt = std::max((size_t)SNMP_CACHE_SWEEP_ENTRIES, entryCount * 2);
+    }
+
+    result->done = true;
+    cache.completed.notify_all();
+    return result;
+}
+
+bool SnmpCacheGet(SnmpCache& cache, SnmpUdpSession& session, const SnmpOid& oid, AsnAny& result,
+    AsnInteger& errorStatus) {
+    std::shared_ptr<SnmpCacheResult> fetched = SnmpCacheFetch(cache, session, oid, false, 0);
+
+    errorStatus = SNMP_ERRORSTATUS_NOERROR;
+    if (fetched->error != 0) {
+        SetLastError(fetched->error);
+        return false;
+    }
+    if (fetched->errorStatus != SNMP_ERRORSTATUS_NOERROR) {
+        errorStatus = fetched->errorStatus;
+        SetLastError(SNMP_UDP_ERROR_AGENT);
+        return false;
+    }
+
+    // Значение переносится в арену сессии: результат кэша может быть вытеснен новым
+    SnmpArenaReset(session.arena);
+    if (!SnmpCopyValue(session.arena, fetched->varBinds[0].value, result)) {
+        SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+        return false;
+    }
+    return true;
+}
+
+bool SnmpCacheWalk(SnmpCache& cache, SnmpUdpSession& session, const SnmpOid& baseOid, UINT maxRepetitions,
+    const SnmpWalkCallback& onVarBind) {
+    std::shared_ptr<SnmpCacheResult> fetched = SnmpCacheFetch(cache, session, baseOid, true, maxRepetitions);
+
+    // Обработчик получает копию: varbind результата общие для всех потоков
+    for (const RFC1157VarBind& varBind : fetched->varBinds) {
+        RFC1157VarBind copy = varBind;
+        onVarBind(copy);
+    }
+    if (fetched->error != 0) {
+        SetLastError(fetched->error);
+        return false;
+    }
+    return true;
+}
+
+void SnmpCacheClear(SnmpCache& cache) {
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    for (auto& agent : cache.agents) {
+        for (auto* entries : { &agent.second.gets, &agent.second.walks, &agent.second.bulkWalks }) {
+            for (auto it = entries->begin(); it != entries->end();) {
+                if (it->second.pending) {
+                    it->second.result.reset();
+                    ++it;
+                }
+                else {
+                    it = entries->erase(it);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,86 @@
+﻿#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "snmp_arena.h"
+#include "snmp_oid.h"
+#include "snmp_pwalk.h"
+#include "snmp_udp.h"
+
+// Время жизни ответа по умолчанию, мс: повторы сборщиков в пределах нескольких секунд
+// обслуживаются из кэша, а счётчики не успевают заметно устареть
+#define SNMP_CACHE_DEFAULT_TTL 5000
+
+// Записей агента, после которых при очередном промахе удаляются истёкшие
+#define SNMP_CACHE_SWEEP_ENTRIES 1024
+
+// Ответы для OID поддерева subtree живут ttl мс (0 - не кэшировать); действует самое длинное
+// совпавшее поддерево. Одинаковые запросы в полёте объединяются при любом ttl.
+struct SnmpCacheRule {
+    SnmpOid subtree;
+    DWORD ttl;
+};
+
+// Итог одного обмена с агентом: GET - один varbind, обход - все varbind поддерева.
+// После завершения не меняется, поэтому читается без блокировки.
+struct SnmpCacheResult {
+    bool done = false;
+    DWORD error = 0;              // 0 - агент ответил, иначе код ошибки запроса
+    AsnInteger errorStatus = 0;   // ошибка агента в ответе на GET
+    std::vector<RFC1157VarBind> varBinds;
+    SnmpArena arena;              // имена и значения varBinds
+};
+
+struct SnmpCacheEntry {
+    std::shared_ptr<SnmpCacheResult> result;      // последний удачный ответ
+    ULONGLONG expiresAt = 0;
+    std::shared_ptr<SnmpCacheResult> pending;     // запрос в полёте, к которому присоединяются
+};
+
+// Ответы одного агента (target и community сессии). Обходы GETNEXT и GETBULK хранятся
+// отдельно: агент SNMPv1 отвергает GETBULK, и ожидающий обхода GETNEXT не должен
+// получить эту ошибку, присоединившись к обходу GETBULK в полёте.
+struct SnmpCacheAgent {
+    std::unordered_map<SnmpOid, SnmpCacheEntry> gets;
+    std::unordered_map<SnmpOid, SnmpCacheEntry> walks;
+    std::unordered_map<SnmpOid, SnmpCacheEntry> bulkWalks;
+    size_t sweepAt = SNMP_CACHE_SWEEP_ENTRIES;
+};
+
+// Общий слой запросов для сборщиков, опрашивающих одних и тех же агентов: одинаковые
+// запросы в полёте объединяются в один обмен, повторы в пределах TTL отдаются из кэша.
+// Потокобезопасен; у каждого потока - своя сессия.
+struct SnmpCache {
+    std::mutex mutex;
+    std::condition_variable completed;
+    std::unordered_map<std::string, SnmpCacheAgent> agents;
+    std::vector<SnmpCacheRule> rules;             // по возрастанию OID
+    DWORD ttl = SNMP_CACHE_DEFAULT_TTL;           // для OID вне правил
+    unsigned long long hits = 0;
+    unsigned long long merged = 0;
+    unsigned long long misses = 0;
+};
+
+// Задаёт время жизни ответов поддерева (заменяет прежнее правило того же поддерева)
+void SnmpCacheSetTtl(SnmpCache& cache, const SnmpOid& subtree, DWORD ttl);
+
+// Время жизни ответа для OID: правило самого длинного совпавшего поддерева или cache.ttl
+DWORD SnmpCacheTtl(const SnmpCache& cache, const SnmpOid& oid);
+
+// GET одного OID через кэш; контракт - как у SnmpGetRequest: при ошибке агента false
+// с SNMP_UDP_ERROR_AGENT и errorStatus. Значение лежит в арене сессии до её следующего запроса.
+bool SnmpCacheGet(SnmpCache& cache, SnmpUdpSession& session, const SnmpOid& oid, AsnAny& result,
+    AsnInteger& errorStatus);
+
+// Обход поддерева через кэш: maxRepetitions > 0 - SnmpBulkWalk, 0 - SnmpWalk (GETNEXT).
+// Varbind выдаются после завершения обхода (при ошибке - полученные до неё) и действительны
+// только внутри onVarBind.
+bool SnmpCacheWalk(SnmpCache& cache, SnmpUdpSession& session, const SnmpOid& baseOid, UINT maxRepetitions,
+    const SnmpWalkCallback& onVarBind);
+
+// Удаляет сохранённые ответы (запросы в полёте завершатся как обычно)
+void SnmpCacheClear(SnmpCache& cache);
@@ -0,0 +1,34 @@
+﻿#include "snmp_compat.h"
+
+#ifndef _WIN32
+
+#include <chrono>
+
+static thread_local DWORD lastError = 0;
+
+DWORD GetLastError() {
+    return lastError;
+}
+
+void SetLastError(DWORD error) {
+    lastError = error;
+}
+
+ULONGLONG GetTickCount64() {
+    return (ULONGLONG)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int SnmpUtilOidCmp(AsnObjectIdentifier* oid1, AsnObjectIdentifier* oid2) {
+    UINT length = oid1->idLength < oid2->idLength ? oid1->idLength : oid2->idLength;
+    for (UINT i = 0; i < length; i++) {
+        if (oid1->ids[i] != oid2->ids[i]) {
+            return oid1->ids[i] < oid2->ids[i] ? -1 : 1;
+        }
+    }
+
+    if (oid1->idLength == oid2->idLength) return 0;
+    return oid1->idLength < oid2->idLength ? -1 : 1;
+}
+
+#endif
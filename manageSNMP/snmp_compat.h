@@ -0,0 +1,179 @@
+﻿#pragma once
+
+// Платформенный слой: на Windows используются заголовки SDK (snmp.h, Winsock),
+// на остальных системах здесь объявлено то подмножество типов и функций snmpapi,
+// которое нужно нативному движку SNMP.
+
+#ifdef _WIN32
+
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#include <snmp.h>
+
+#else
+
+#include <cerrno>
+#include <cstdint>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <unistd.h>
+
+// Базовые типы Windows
+typedef unsigned int UINT;
+typedef uint32_t DWORD;
+typedef unsigned char BYTE;
+typedef unsigned short WORD;
+typedef int BOOL;
+typedef char* LPSTR;
+typedef unsigned long long ULONGLONG;
+
+typedef union {
+    struct {
+        DWORD LowPart;
+        DWORD HighPart;
+    };
+    ULONGLONG QuadPart;
+} ULARGE_INTEGER;
+
+#ifndef TRUE
+#define TRUE 1
+#endif
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+#define ERROR_NOT_ENOUGH_MEMORY 8
+#define ERROR_INVALID_PARAMETER 87
+
+DWORD GetLastError();
+void SetLastError(DWORD error);
+ULONGLONG GetTickCount64();
+
+// Сокеты BSD под именами Winsock
+typedef int SOCKET;
+#define INVALID_SOCKET (-1)
+#define SOCKET_ERROR (-1)
+#define WSAEWOULDBLOCK EWOULDBLOCK
+#define WSAECONNRESET ECONNREFUSED
+
+inline int closesocket(SOCKET sock) { return close(sock); }
+inline int WSAGetLastError() { return errno; }
+
+// Типы SMI (как в snmp.h)
+typedef int32_t AsnInteger;
+typedef int32_t AsnInteger32;
+typedef uint32_t AsnUnsigned32;
+typedef ULARGE_INTEGER AsnCounter64;
+typedef AsnUnsigned32 AsnCounter32;
+typedef AsnUnsigned32 AsnGauge32;
+typedef AsnUnsigned32 AsnTimeticks;
+
+typedef struct {
+    BYTE* stream;
+    UINT length;
+    BOOL dynamic;
+} AsnOctetString;
+
+typedef AsnOctetString AsnBits;
+typedef AsnOctetString AsnSequence;
+typedef AsnOctetString AsnIPAddress;
+typedef AsnOctetString AsnOpaque;
+
+typedef struct {
+    UINT idLength;
+    UINT* ids;
+} AsnObjectIdentifier;
+
+typedef AsnObjectIdentifier AsnObjectName;
+
+typedef struct {
+    BYTE asnType;
+    union {
+        AsnInteger32 number;
+        AsnUnsigned32 unsigned32;
+        AsnCounter64 counter64;
+        AsnOctetString string;
+        AsnBits bits;
+        AsnObjectIdentifier object;
+        AsnSequence sequence;
+        AsnIPAddress address;
+        AsnCounter32 counter;
+        AsnGauge32 gauge;
+        AsnTimeticks ticks;
+        AsnOpaque arbitrary;
+    } asnValue;
+} AsnAny;
+
+typedef AsnAny AsnObjectSyntax;
+
+typedef struct {
+    AsnObjectName name;
+    AsnObjectSyntax value;
+} SnmpVarBind;
+
+typedef struct {
+    SnmpVarBind* list;
+    UINT len;
+} SnmpVarBindList;
+
+typedef SnmpVarBind RFC1157VarBind;
+typedef SnmpVarBindList RFC1157VarBindList;
+
+// Теги ASN.1
+#define ASN_INTEGER                 0x02
+#define ASN_BITS                    0x03
+#define ASN_OCTETSTRING             0x04
+#define ASN_NULL                    0x05
+#define ASN_OBJECTIDENTIFIER        0x06
+#define ASN_SEQUENCE                0x30
+#define ASN_IPADDRESS               0x40
+#define ASN_COUNTER32               0x41
+#define ASN_GAUGE32                 0x42
+#define ASN_TIMETICKS               0x43
+#define ASN_OPAQUE                  0x44
+#define ASN_COUNTER64               0x46
+#define ASN_UNSIGNED32              0x47
+#define ASN_RFC1155_IPADDRESS       ASN_IPADDRESS
+
+#define SNMP_EXCEPTION_NOSUCHOBJECT     0x80
+#define SNMP_EXCEPTION_NOSUCHINSTANCE   0x81
+#define SNMP_EXCEPTION_ENDOFMIBVIEW     0x82
+
+// Типы PDU
+#define SNMP_PDU_GET                0xA0
+#define SNMP_PDU_GETNEXT            0xA1
+#define SNMP_PDU_RESPONSE           0xA2
+#define SNMP_PDU_SET                0xA3
+#define SNMP_PDU_GETBULK            0xA5
+#define SNMP_PDU_INFORM             0xA6
+#define SNMP_PDU_TRAP               0xA7
+#define SNMP_PDU_REPORT             0xA8
+
+// Коды error-status
+#define SNMP_ERRORSTATUS_NOERROR                0
+#define SNMP_ERRORSTATUS_TOOBIG                 1
+#define SNMP_ERRORSTATUS_NOSUCHNAME             2
+#define SNMP_ERRORSTATUS_BADVALUE               3
+#define SNMP_ERRORSTATUS_READONLY               4
+#define SNMP_ERRORSTATUS_GENERR                 5
+#define SNMP_ERRORSTATUS_NOACCESS               6
+#define SNMP_ERRORSTATUS_WRONGTYPE              7
+#define SNMP_ERRORSTATUS_WRONGLENGTH            8
+#define SNMP_ERRORSTATUS_WRONGENCODING          9
+#define SNMP_ERRORSTATUS_WRONGVALUE             10
+#define SNMP_ERRORSTATUS_NOCREATION             11
+#define SNMP_ERRORSTATUS_INCONSISTENTVALUE      12
+#define SNMP_ERRORSTATUS_RESOURCEUNAVAILABLE    13
+#define SNMP_ERRORSTATUS_COMMITFAILED           14
+#define SNMP_ERRORSTATUS_UNDOFAILED             15
+#define SNMP_ERRORSTATUS_AUTHORIZATIONERROR     16
+#define SNMP_ERRORSTATUS_NOTWRITABLE            17
+#define SNMP_ERRORSTATUS_INCONSISTENTNAME       18
+
+// Функции snmpapi, используемые движком
+int SnmpUtilOidCmp(AsnObjectIdentifier* oid1, AsnObjectIdentifier* oid2);
+
+#endif
@@ -0,0 +1,242 @@
+﻿#include "snmp_delta.h"
+
+#include <cstring>
+#include "snmp_oid.h"
+
+// Функция для очистки снимка с сохранением ёмкости массивов
+static void SnmpDeltaClear(SnmpDeltaSnapshot& snapshot) {
+    snapshot.ids.clear();
+    snapshot.entries.clear();
+    snapshot.data.clear();
+}
+
+void SnmpDeltaBegin(SnmpDeltaCache& cache, bool hasUpTime, AsnTimeticks upTime, ULONGLONG nowMs) {
+    SnmpDeltaClear(cache.current);
+    cache.cursor = 0;
+    cache.total = 0;
+    cache.emitted = 0;
+    cache.cycleHasUpTime = hasUpTime;
+    cache.cycleUpTime = upTime;
+    cache.cycleTimeMs = nowMs;
+
+    cache.discontinuity = !cache.valid;
+    cache.interval = 0;
+    if (!cache.valid) return;
+
+    ULONGLONG wallMs = nowMs > cache.timeMs ? nowMs - cache.timeMs : 0;
+    cache.interval = wallMs / 1000.0;
+
+    if (hasUpTime && cache.hasUpTime) {
+        // sysUpTime в сотых долях секунды. Уменьшение - перезапуск агента
+        // (или переполнение через 497 дней: скорости тоже нельзя считать).
+        if (upTime < cache.upTime) {
+            cache.discontinuity = true;
+            return;
+        }
+        ULONGLONG upTimeMs = (ULONGLONG)(upTime - cache.upTime) * 10;
+        ULONGLONG tolerance = wallMs / 10 > SNMP_DELTA_UPTIME_TOLERANCE ? wallMs / 10 : SNMP_DELTA_UPTIME_TOLERANCE;
+        if (upTimeMs + tolerance < wallMs) {
+            cache.discontinuity = true;
+            return;
+        }
+
+        // Интервал по часам агента точнее: задержка ответа не попадает в скорость
+        cache.interval = upTimeMs / 1000.0;
+    }
+}
+
+// Функция для сохранения значения в снимок (имя - дуги UINT, значение - число или байты)
+static void SnmpDeltaStore(SnmpDeltaSnapshot& snapshot, const RFC1157VarBind& varBind) {
+    SnmpDeltaEntry entry;
+    entry.idOffset = (UINT)snapshot.ids.size();
+    entry.idLength = varBind.name.idLength;
+    entry.type = varBind.value.asnType;
+    entry.number = 0;
+    entry.dataOffset = 0;
+    entry.dataLength = 0;
+    snapshot.ids.insert(snapshot.ids.end(), varBind.name.ids, varBind.name.ids + varBind.name.idLength);
+
+    const AsnAny& value = varBind.value;
+    const BYTE* bytes = NULL;
+    switch (value.asnType) {
+    case ASN_INTEGER:
+        entry.number = (ULONGLONG)(long long)value.asnValue.number;
+        break;
+    case ASN_COUNTER32:
+    case ASN_GAUGE32:
+    case ASN_TIMETICKS:
+    case ASN_UNSIGNED32:
+        entry.number = value.asnValue.unsigned32;
+        break;
+    case ASN_COUNTER64:
+        entry.number = value.asnValue.counter64.QuadPart;
+        break;
+    case ASN_OCTETSTRING:
+    case ASN_OPAQUE:
+    case ASN_BITS:
+    case ASN_IPADDRESS:
+        bytes = value.asnValue.string.stream;
+        entry.dataLength = value.asnValue.string.length;
+        break;
+    case ASN_OBJECTIDENTIFIER:
+        // Дуги OID-значения читаются обратно как UINT, поэтому выравниваем их начало
+        snapshot.data.resize((snapshot.data.size() + sizeof(UINT) - 1) & ~(sizeof(UINT) - 1));
+        bytes = (const BYTE*)value.asnValue.object.ids;
+        entry.dataLength = value.asnValue.object.idLength * sizeof(UINT);
+        break;
+    default:
+        break;
+    }
+
+    if (entry.dataLength > 0) {
+        entry.dataOffset = (UINT)snapshot.data.size();
+        snapshot.data.insert(snapshot.data.end(), bytes, bytes + entry.dataLength);
+    }
+    snapshot.entries.push_back(entry);
+}
+
+// Функция для сборки varbind из записи снимка; указатели смотрят в массивы снимка
+static void SnmpDeltaLoad(SnmpDeltaSnapshot& snapshot, const SnmpDeltaEntry& entry, RFC1157VarBind& varBind) {
+    varBind.name.ids = snapshot.ids.data() + entry.idOffset;
+    varBind.name.idLength = entry.idLength;
+
+    AsnAny& value = varBind.value;
+    memset(&value, 0, sizeof(value));
+    value.asnType = entry.type;
+    BYTE* bytes = snapshot.data.data() + entry.dataOffset;
+    switch (entry.type) {
+    case ASN_INTEGER:
+        value.asnValue.number = (AsnInteger32)(long long)entry.number;
+        break;
+    case ASN_COUNTER32:
+    case ASN_GAUGE32:
+    case ASN_TIMETICKS:
+    case ASN_UNSIGNED32:
+        value.asnValue.unsigned32 = (AsnUnsigned32)entry.number;
+        break;
+    case ASN_COUNTER64:
+        value.asnValue.counter64.QuadPart = entry.number;
+        break;
+    case ASN_OCTETSTRING:
+    case ASN_OPAQUE:
+    case ASN_BITS:
+    case ASN_IPADDRESS:
+        value.asnValue.string.stream = bytes;
+        value.asnValue.string.length = entry.dataLength;
+        value.asnValue.string.dynamic = FALSE;
+        break;
+    case ASN_OBJECTIDENTIFIER:
+        value.asnValue.object.ids = (UINT*)bytes;
+        value.asnValue.object.idLength = entry.dataLength / sizeof(UINT);
+        break;
+    default:
+        break;
+    }
+}
+
+// Функция сравнения значений двух записей (имена уже совпали)
+static bool SnmpDeltaSameValue(const SnmpDeltaSnapshot& snapshot1, const SnmpDeltaEntry& entry1,
+    const SnmpDeltaSnapshot& snapshot2, const SnmpDeltaEntry& entry2) {
+    return entry1.type == entry2.type && entry1.number == entry2.number && entry1.dataLength == entry2.dataLength
+        && (entry1.dataLength == 0 || memcmp(snapshot1.data.data() + entry1.dataOffset,
+            snapshot2.data.data() + entry2.dataOffset, entry1.dataLength) == 0);
+}
+
+// Функция вычисления скорости счётчика. Counter32 при уменьшении считается
+// переполнившимся (перезапуск агента отсекает проверка sysUpTime), Counter64 - сброшенным.
+static bool SnmpDeltaRate(const SnmpDeltaCache& cache, const SnmpDeltaEntry& before, const SnmpDeltaEntry& after,
+    double& rate) {
+    if (cache.discontinuity || cache.interval <= 0 || before.type != after.type) return false;
+
+    ULONGLONG delta;
+    if (after.type == ASN_COUNTER32) {
+        delta = after.number >= before.number ? after.number - before.number : after.number + 0x100000000ULL - before.number;
+    }
+    else if (after.type == ASN_COUNTER64) {
+        if (after.number < before.number) return false;
+        delta = after.number - before.number;
+    }
+    else {
+        return false;
+    }
+
+    rate = delta / cache.interval;
+    return true;
+}
+
+// Функция выдачи изменения
+static void SnmpDeltaEmit(SnmpDeltaCache& cache, SnmpDeltaKind kind, const RFC1157VarBind& varBind,
+    bool hasRate, double rate, const SnmpDeltaCallback& onChange) {
+    SnmpDeltaChange change;
+    change.kind = kind;
+    change.varBind = &varBind;
+    change.hasRate = hasRate;
+    change.rate = rate;
+    cache.emitted++;
+    onChange(change);
+}
+
+// Функция выдачи пропавшего OID прошлого снимка
+static void SnmpDeltaEmitRemoved(SnmpDeltaCache& cache, const SnmpDeltaCallback& onChange) {
+    RFC1157VarBind removed;
+    SnmpDeltaLoad(cache.previous, cache.previous.entries[cache.cursor], removed);
+    SnmpDeltaEmit(cache, SNMP_DELTA_REMOVED, removed, false, 0, onChange);
+    cache.cursor++;
+}
+
+bool SnmpDeltaUpdate(SnmpDeltaCache& cache, const RFC1157VarBind& varBind, const SnmpDeltaCallback& onChange) {
+    // Слияние требует возрастания OID внутри цикла
+    if (!cache.current.entries.empty()) {
+        const SnmpDeltaEntry& last = cache.current.entries.back();
+        if (SnmpOidCompare(cache.current.ids.data() + last.idOffset, last.idLength,
+            varBind.name.ids, varBind.name.idLength) >= 0) {
+            SetLastError(ERROR_INVALID_PARAMETER);
+            return false;
+        }
+    }
+
+    SnmpDeltaStore(cache.current, varBind);
+    cache.total++;
+    const SnmpDeltaEntry& entry = cache.current.entries.back();
+
+    SnmpDeltaSnapshot& previous = cache.previous;
+    while (cache.cursor < previous.entries.size()) {
+        const SnmpDeltaEntry& old = previous.entries[cache.cursor];
+        int order = SnmpOidCompare(previous.ids.data() + old.idOffset, old.idLength,
+            varBind.name.ids, varBind.name.idLength);
+        if (order > 0) break;
+        if (order < 0) {
+            SnmpDeltaEmitRemoved(cache, onChange);
+            continue;
+        }
+
+        cache.cursor++;
+        if (SnmpDeltaSameValue(previous, old, cache.current, entry)) return true;
+
+        double rate = 0;
+        bool hasRate = SnmpDeltaRate(cache, old, entry, rate);
+        SnmpDeltaEmit(cache, SNMP_DELTA_CHANGED, varBind, hasRate, rate, onChange);
+        return true;
+    }
+
+    SnmpDeltaEmit(cache, SNMP_DELTA_ADDED, varBind, false, 0, onChange);
+    return true;
+}
+
+void SnmpDeltaEnd(SnmpDeltaCache& cache, const SnmpDeltaCallback& onChange) {
+    while (cache.cursor < cache.previous.entries.size()) {
+        SnmpDeltaEmitRemoved(cache, onChange);
+    }
+
+    std::swap(cache.previous, cache.current);
+    SnmpDeltaClear(cache.current);
+    cache.valid = true;
+    cache.hasUpTime = cache.cycleHasUpTime;
+    cache.upTime = cache.cycleUpTime;
+    cache.timeMs = cache.cycleTimeMs;
+}
+
+void SnmpDeltaAbort(SnmpDeltaCache& cache) {
+    SnmpDeltaClear(cache.current);
+    cache.cursor = 0;
+}
@@ -0,0 +1,81 @@
+﻿#pragma once
+
+#include <functional>
+#include <vector>
+#include "snmp_compat.h"
+
+// Допустимое расхождение прироста sysUpTime с часами, мс (и не меньше 10% интервала):
+// если sysUpTime вырос заметно меньше, агент перезапускался и счётчики начались заново
+#define SNMP_DELTA_UPTIME_TOLERANCE 2000
+
+enum SnmpDeltaKind {
+    SNMP_DELTA_ADDED,             // OID появился (в первом цикле - все OID)
+    SNMP_DELTA_CHANGED,
+    SNMP_DELTA_REMOVED            // OID пропал; varBind содержит последнее значение
+};
+
+// Изменение одного OID между циклами опроса. Varbind действителен только внутри обработчика.
+struct SnmpDeltaChange {
+    SnmpDeltaKind kind;
+    const RFC1157VarBind* varBind;
+    bool hasRate;                 // для Counter32/Counter64, если скорость можно посчитать
+    double rate;                  // прирост счётчика в секунду
+};
+
+typedef std::function<void(const SnmpDeltaChange& change)> SnmpDeltaCallback;
+
+// Значение в снимке. Числа хранятся в number, байты строк и дуги OID-значений - в общем массиве data.
+struct SnmpDeltaEntry {
+    UINT idOffset;                // имя - дуги ids[idOffset, idOffset + idLength)
+    UINT idLength;
+    BYTE type;
+    ULONGLONG number;
+    UINT dataOffset;
+    UINT dataLength;              // в байтах
+};
+
+// Снимок поддерева в трёх плоских массивах, записи - в порядке OID.
+// Ни одной отдельной аллокации на значение: сравнение с прошлым циклом идёт
+// последовательным проходом по памяти.
+struct SnmpDeltaSnapshot {
+    std::vector<UINT> ids;
+    std::vector<SnmpDeltaEntry> entries;
+    std::vector<BYTE> data;
+};
+
+// Кэш значений одной цели между циклами опроса. Снимок прошлого цикла и строящийся
+// меняются местами, поэтому после первых циклов память не выделяется.
+struct SnmpDeltaCache {
+    SnmpDeltaSnapshot previous;
+    SnmpDeltaSnapshot current;
+    size_t cursor = 0;            // позиция слияния в previous
+    bool valid = false;           // есть снимок прошлого цикла
+    bool discontinuity = false;   // в этом цикле скорости не считаются (первый цикл, перезапуск агента)
+    double interval = 0;          // секунд с прошлого цикла (по sysUpTime, если он известен)
+
+    bool hasUpTime = false;
+    AsnTimeticks upTime = 0;
+    ULONGLONG timeMs = 0;
+    bool cycleHasUpTime = false;
+    AsnTimeticks cycleUpTime = 0;
+    ULONGLONG cycleTimeMs = 0;
+
+    // Итоги последнего цикла
+    size_t total = 0;
+    size_t emitted = 0;
+};
+
+// Начало цикла. upTime - sysUpTime.0 агента в этом цикле (hasUpTime = false, если его не удалось получить),
+// nowMs - время опроса (GetTickCount64). Определяет разрыв счётчиков: sysUpTime уменьшился
+// или вырос меньше, чем прошло времени.
+void SnmpDeltaBegin(SnmpDeltaCache& cache, bool hasUpTime, AsnTimeticks upTime, ULONGLONG nowMs);
+
+// Очередной varbind обхода. Varbind должны идти в порядке возрастания OID, как их выдаёт обход.
+// Обработчик вызывается для нового или изменившегося значения; перед ним - для пропавших OID.
+bool SnmpDeltaUpdate(SnmpDeltaCache& cache, const RFC1157VarBind& varBind, const SnmpDeltaCallback& onChange);
+
+// Конец успешного цикла: оставшиеся OID прошлого снимка пропали, новый снимок становится прошлым
+void SnmpDeltaEnd(SnmpDeltaCache& cache, const SnmpDeltaCallback& onChange);
+
+// Цикл не удался (обход прерван): прошлый снимок остаётся, частичный отбрасывается
+void SnmpDeltaAbort(SnmpDeltaCache& cache);
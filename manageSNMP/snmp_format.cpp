@@ -0,0 +1,233 @@
+﻿#include "snmp_format.h"
+
+#include <charconv>
+#include "snmp_simd.h"
+#include "snmp_syntax.h"
+
+void SnmpOutputFlush(SnmpOutput& output) {
+    if (!output.buffer.empty()) {
+        output.stream->write(output.buffer.data(), (std::streamsize)output.buffer.size());
+        output.buffer.clear();
+    }
+    output.stream->flush();
+}
+
+void SnmpFormatUnsigned(std::string& out, unsigned long long value) {
+    char digits[20];
+    std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), value);
+    out.append(digits, result.ptr);
+}
+
+void SnmpFormatSigned(std::string& out, long long value) {
+    char digits[20];
+    std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), value);
+    out.append(digits, result.ptr);
+}
+
+void SnmpFormatOid(std::string& out, const UINT* ids, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        if (i > 0) out.push_back('.');
+        SnmpFormatUnsigned(out, ids[i]);
+    }
+}
+
+void SnmpFormatHex(std::string& out, const BYTE* data, size_t length) {
+    size_t start = out.size();
+    out.resize(start + 2 * length);
+    SnmpSimdHex(&out[start], data, length);
+}
+
+void SnmpFormatHexSeparated(std::string& out, const BYTE* data, size_t length, char separator) {
+    if (length == 0) return;
+    size_t start = out.size();
+    out.resize(start + 3 * length - 1);
+    SnmpSimdHexSeparated(&out[start], data, length, separator);
+}
+
+bool SnmpFormatIsPrintable(const BYTE* data, size_t length) {
+    return SnmpSimdIsPrintable(data, length);
+}
+
+bool SnmpFormatValueText(std::string& out, const AsnAny& value) {
+    switch (value.asnType) {
+    case ASN_INTEGER:
+        SnmpFormatSigned(out, value.asnValue.number);
+        return false;
+    case ASN_COUNTER32:
+    case ASN_GAUGE32:
+    case ASN_TIMETICKS:
+    case ASN_UNSIGNED32:
+        SnmpFormatUnsigned(out, value.asnValue.unsigned32);
+        return false;
+    case ASN_COUNTER64:
+        SnmpFormatUnsigned(out, value.asnValue.counter64.QuadPart);
+        return false;
+    case ASN_OCTETSTRING:
+        if (SnmpFormatIsPrintable(value.asnValue.string.stream, value.asnValue.string.length)) {
+            out.append((const char*)value.asnValue.string.stream, value.asnValue.string.length);
+        }
+        else {
+            SnmpFormatHex(out, value.asnValue.string.stream, value.asnValue.string.length);
+        }
+        return true;
+    case ASN_OPAQUE:
+    case ASN_BITS:
+        SnmpFormatHex(out, value.asnValue.string.stream, value.asnValue.string.length);
+        return true;
+    case ASN_IPADDRESS:
+        for (UINT i = 0; i < value.asnValue.address.length; i++) {
+            if (i > 0) out.push_back('.');
+            SnmpFormatUnsigned(out, value.asnValue.address.stream[i]);
+        }
+        return true;
+    case ASN_OBJECTIDENTIFIER:
+        SnmpFormatOid(out, value.asnValue.object.ids, value.asnValue.object.idLength);
+        return true;
+    default:
+        return false;
+    }
+}
+
+static void SnmpFormatOctetString(std::string& out, const AsnOctetString& string) {
+    out.append("OCTET STRING: ");
+
+    // Сначала печатаемость: текст из 4 или 6 символов ("eth0") - это не адрес
+    if (string.length > 0 && SnmpFormatIsPrintable(string.stream, string.length)) {
+        out.append((const char*)string.stream, string.length);
+    }
+    // Непечатаемые 6 байт - MAC-адрес
+    else if (string.length == 6) {
+        SnmpFormatHexSeparated(out, string.stream, string.length, '-');
+    }
+    // Непечатаемые 4 байта - IP-адрес
+    else if (string.length == 4) {
+        for (UINT i = 0; i < string.length; i++) {
+            SnmpFormatUnsigned(out, string.stream[i]);
+            if (i < string.length - 1) {
+                out.push_back('.');
+            }
+        }
+    }
+    else {
+        SnmpFormatHexSeparated(out, string.stream, string.length, ' ');
+    }
+}
+
+void SnmpFormatValue(std::string& out, const AsnAny& value, const SnmpMibIndex& mib) {
+    switch (value.asnType) {
+    case ASN_INTEGER:
+        out.append("INTEGER: ");
+        SnmpFormatSigned(out, value.asnValue.number);
+        out.push_back('\n');
+        break;
+    case ASN_COUNTER32:
+        out.append("COUNTER32: ");
+        SnmpFormatUnsigned(out, value.asnValue.unsigned32);
+        out.push_back('\n');
+        break;
+    case ASN_GAUGE32:
+        out.append("GAUGE: ");
+        SnmpFormatUnsigned(out, value.asnValue.unsigned32);
+        out.push_back('\n');
+        break;
+    case ASN_OCTETSTRING:
+        SnmpFormatOctetString(out, value.asnValue.string);
+        break;
+    case ASN_OBJECTIDENTIFIER:
+        out.append("OID: ");
+        SnmpFormatOid(out, value.asnValue.object.ids, value.asnValue.object.idLength);
+        out.push_back('\t');
+        SnmpMibResolve(mib, value.asnValue.object.ids, value.asnValue.object.idLength, out);
+        out.append("\t\n");
+        break;
+    case ASN_NULL:
+        out.append("NULL\n");
+        break;
+    case ASN_RFC1155_IPADDRESS:
+        out.append("IPADDRESS: ");
+        // Строка указывает в буфер приёма или архив: длину, отличную от 4, выводим байтами
+        if (value.asnValue.address.length != 4) {
+            SnmpFormatHex(out, value.asnValue.address.stream, value.asnValue.address.length);
+        }
+        else {
+            for (UINT i = 0; i < 4; i++) {
+                if (i > 0) out.push_back('.');
+                SnmpFormatUnsigned(out, value.asnValue.address.stream[i]);
+            }
+        }
+        out.push_back('\n');
+        break;
+    case ASN_TIMETICKS:
+        out.append("TIMETICKS: ");
+        SnmpFormatUnsigned(out, value.asnValue.ticks);
+        out.push_back('\n');
+        break;
+    case ASN_COUNTER64:
+        out.append("COUNTER64: ");
+        SnmpFormatUnsigned(out, value.asnValue.counter64.QuadPart);
+        out.push_back('\n');
+        break;
+    case SNMP_EXCEPTION_NOSUCHOBJECT:
+        out.append("No Such Object available on this agent at this OID\n");
+        break;
+    case SNMP_EXCEPTION_NOSUCHINSTANCE:
+        out.append("No Such Instance currently exists at this OID\n");
+        break;
+    case SNMP_EXCEPTION_ENDOFMIBVIEW:
+        out.append("No more variables left in this MIB View\n");
+        break;
+    default:
+        out.append("UNKNOWN TYPE: ");
+        SnmpFormatUnsigned(out, value.asnType);
+        out.push_back('\n');
+        break;
+    }
+}
+
+// Подпись типа в формате SnmpFormatValue
+static const char* SnmpFormatTypeLabel(BYTE asnType) {
+    switch (asnType) {
+    case ASN_INTEGER: return "INTEGER: ";
+    case ASN_COUNTER32: return "COUNTER32: ";
+    case ASN_GAUGE32: return "GAUGE: ";
+    case ASN_TIMETICKS: return "TIMETICKS: ";
+    case ASN_COUNTER64: return "COUNTER64: ";
+    case ASN_OCTETSTRING: return "OCTET STRING: ";
+    case ASN_IPADDRESS: return "IPADDRESS: ";
+    default: return NULL;
+    }
+}
+
+void SnmpFormatTypedValue(std::string& out, const UINT* ids, size_t length, const AsnAny& value,
+    const SnmpMibIndex& mib) {
+    // OID-значения общий разбор печатает с именем из MIB - лучше разборщика синтаксиса
+    const SnmpSyntaxBinding* binding = SnmpSyntaxFind(ids, length);
+    const char* label = SnmpFormatTypeLabel(value.asnType);
+    if (binding != NULL && binding->syntax != SNMP_SYNTAX_OBJECT_ID && label != NULL) {
+        size_t start = out.size();
+        out.append(label);
+        if (SnmpSyntaxGetDecoder(binding->syntax)(out, value, *binding)) {
+            // Как в SnmpFormatValue: после OCTET STRING перевода строки нет
+            if (value.asnType != ASN_OCTETSTRING) out.push_back('\n');
+            return;
+        }
+        out.resize(start);
+    }
+    SnmpFormatValue(out, value, mib);
+}
+
+void SnmpFormatVarBind(std::string& out, const RFC1157VarBind& varBind, const SnmpMibIndex& mib) {
+    out.append("OID: ");
+    SnmpFormatOid(out, varBind.name.ids, varBind.name.idLength);
+    out.push_back('\t');
+    SnmpMibResolve(mib, varBind.name.ids, varBind.name.idLength, out);
+    out.append("\t = ");
+    SnmpFormatTypedValue(out, varBind.name.ids, varBind.name.idLength, varBind.value, mib);
+    out.push_back('\n');
+}
+
+void SnmpFormatWalkItem(std::string& out, int itemNumber, const RFC1157VarBind& varBind, const SnmpMibIndex& mib) {
+    SnmpFormatSigned(out, itemNumber);
+    out.append(". ");
+    SnmpFormatVarBind(out, varBind, mib);
+}
@@ -0,0 +1,60 @@
+﻿#pragma once
+
+#include <iostream>
+#include <string>
+#include "snmp_mib.h"
+
+// Размер буфера, после которого накопленные строки сбрасываются в поток
+#define SNMP_OUTPUT_FLUSH_SIZE (64 * 1024)
+
+// Буфер вывода: строки результатов форматируются в buffer и пишутся
+// в поток крупными блоками, а не по полю через operator<<.
+struct SnmpOutput {
+    std::ostream* stream = &std::cout;
+    std::string buffer;
+};
+
+// Пишет накопленное в поток и очищает буфер (ёмкость сохраняется)
+void SnmpOutputFlush(SnmpOutput& output);
+
+// Вызывается после каждой строки: сбрасывает буфер, только когда он заполнен
+inline void SnmpOutputCommit(SnmpOutput& output) {
+    if (output.buffer.size() >= SNMP_OUTPUT_FLUSH_SIZE) {
+        SnmpOutputFlush(output);
+    }
+}
+
+// Форматирование дописывает текст в out без промежуточных строк и потоков
+void SnmpFormatUnsigned(std::string& out, unsigned long long value);
+void SnmpFormatSigned(std::string& out, long long value);
+void SnmpFormatOid(std::string& out, const UINT* ids, size_t length);
+
+// Байты в hex с ведущими нулями и без разделителей: "001B210AFF01"
+void SnmpFormatHex(std::string& out, const BYTE* data, size_t length);
+
+// Байты в hex с разделителем: MAC "00-1B-21-0A-FF-01", дамп "00 1B 21"
+void SnmpFormatHexSeparated(std::string& out, const BYTE* data, size_t length, char separator);
+
+// true, если все байты - печатаемые символы ASCII (пустая строка тоже печатаемая)
+bool SnmpFormatIsPrintable(const BYTE* data, size_t length);
+
+// Значение как текст без типа и кавычек (ячейка таблицы, поле JSON/CSV). Возвращает true,
+// если это строка (в JSON - в кавычках). Печатаемая OCTET STRING выводится как есть,
+// остальные байтовые типы - в hex; NULL и исключения не выводятся.
+bool SnmpFormatValueText(std::string& out, const AsnAny& value);
+
+// Значение в формате PrintSnmpValue: "INTEGER: 5\n", "OCTET STRING: text" и т.д.
+// OCTET STRING: печатаемая - как текст, иначе 6 байт - MAC, 4 байта - IP, остальное - hex через пробел
+void SnmpFormatValue(std::string& out, const AsnAny& value, const SnmpMibIndex& mib);
+
+// То же для значения объекта с OID ids: если синтаксис объекта известен (snmp_syntax.h),
+// значение разбирается по нему ("INTEGER: up(1)", MAC в ifPhysAddress при любых байтах),
+// иначе и при несовпадении типа - как SnmpFormatValue
+void SnmpFormatTypedValue(std::string& out, const UINT* ids, size_t length, const AsnAny& value,
+    const SnmpMibIndex& mib);
+
+// "OID: 1.3.6.1.2.1.1.5.0\tSNMPv2-MIB::sysName.0\t = <значение>\n"
+void SnmpFormatVarBind(std::string& out, const RFC1157VarBind& varBind, const SnmpMibIndex& mib);
+
+// Строка обхода: "<номер>. OID: ..."
+void SnmpFormatWalkItem(std::string& out, int itemNumber, const RFC1157VarBind& varBind, const SnmpMibIndex& mib);
@@ -0,0 +1,454 @@
+﻿#include "snmp_metrics.h"
+
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+#include "snmp_udp.h"
+
+#ifndef _WIN32
+#include <sys/select.h>
+#endif
+
+// Шард метрик одного потока. Ряды добавляет и обновляет только поток-владелец;
+// мьютекс защищает словарь от изменения во время экспорта.
+struct SnmpMetricsShard {
+    std::mutex mutex;
+    std::unordered_map<std::string, std::array<std::unique_ptr<SnmpMetricsSeries>, SNMP_METRICS_PDU_TYPES>> series;
+};
+
+static std::atomic<bool> metricsEnabled{true};
+
+// Все шарды процесса. Шард завершившегося потока не удаляется (его счётчики нужны экспорту),
+// а отдаётся следующему новому потоку: писатель у шарда по-прежнему один.
+static std::mutex registryMutex;
+static std::vector<SnmpMetricsShard*> registryShards;
+static std::vector<SnmpMetricsShard*> freeShards;
+
+// Владение шардом на время жизни потока
+struct SnmpMetricsShardHolder {
+    SnmpMetricsShard* shard = NULL;
+
+    ~SnmpMetricsShardHolder() {
+        if (!shard) return;
+        std::lock_guard<std::mutex> lock(registryMutex);
+        freeShards.push_back(shard);
+    }
+};
+
+static thread_local SnmpMetricsShardHolder threadShard;
+
+static SnmpMetricsShard* SnmpMetricsThreadShard() {
+    if (threadShard.shard) return threadShard.shard;
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    if (!freeShards.empty()) {
+        threadShard.shard = freeShards.back();
+        freeShards.pop_back();
+    }
+    else {
+        threadShard.shard = new SnmpMetricsShard();
+        registryShards.push_back(threadShard.shard);
+    }
+    return threadShard.shard;
+}
+
+void SnmpMetricsEnable(bool enabled) {
+    metricsEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool SnmpMetricsEnabled() {
+    return metricsEnabled.load(std::memory_order_relaxed);
+}
+
+// Функция для перевода типа PDU в номер ряда (-1 - тип не учитывается)
+static int SnmpMetricsPduIndex(BYTE pduType) {
+    switch (pduType) {
+    case SNMP_PDU_GET: return SNMP_METRICS_GET;
+    case SNMP_PDU_GETNEXT: return SNMP_METRICS_GETNEXT;
+    case SNMP_PDU_GETBULK: return SNMP_METRICS_GETBULK;
+    case SNMP_PDU_SET: return SNMP_METRICS_SET;
+    default: return -1;
+    }
+}
+
+static const char* const pduNames[SNMP_METRICS_PDU_TYPES] = { "get", "getnext", "getbulk", "set" };
+
+SnmpMetricsSeries* SnmpMetricsSeriesFor(const std::string& target, BYTE pduType) {
+    int pdu = SnmpMetricsPduIndex(pduType);
+    if (!SnmpMetricsEnabled() || pdu < 0) return NULL;
+
+    SnmpMetricsShard* shard = SnmpMetricsThreadShard();
+
+    // Поиск без блокировки: словарь меняет только этот поток
+    auto found = shard->series.find(target);
+    if (found != shard->series.end() && found->second[pdu]) {
+        return found->second[pdu].get();
+    }
+
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    std::unique_ptr<SnmpMetricsSeries>& series = shard->series[target][pdu];
+    series.reset(new SnmpMetricsSeries());
+    return series.get();
+}
+
+size_t SnmpMetricsBucket(ULONGLONG valueUs) {
+    if (valueUs < SNMP_METRICS_EXACT_BUCKETS) return (size_t)valueUs;
+
+    int exponent = 63;
+    while (!(valueUs >> exponent)) exponent--;
+    if (exponent > SNMP_METRICS_MAX_EXPONENT) return SNMP_METRICS_BUCKETS - 1;
+
+    size_t sub = (size_t)(valueUs >> (exponent - 3)) & (SNMP_METRICS_SUB_BUCKETS - 1);
+    return SNMP_METRICS_EXACT_BUCKETS + (exponent - 4) * SNMP_METRICS_SUB_BUCKETS + sub;
+}
+
+ULONGLONG SnmpMetricsBucketLimit(size_t bucket) {
+    if (bucket < SNMP_METRICS_EXACT_BUCKETS) return bucket + 1;
+
+    size_t exponent = (bucket - SNMP_METRICS_EXACT_BUCKETS) / SNMP_METRICS_SUB_BUCKETS + 4;
+    size_t sub = (bucket - SNMP_METRICS_EXACT_BUCKETS) % SNMP_METRICS_SUB_BUCKETS;
+    return (1ULL << exponent) + (sub + 1) * (1ULL << (exponent - 3));
+}
+
+// Сумма рядов одной цели и PDU по всем потокам
+struct SnmpMetricsTotals {
+    ULONGLONG requests = 0;
+    ULONGLONG retries = 0;
+    ULONGLONG responses = 0;
+    ULONGLONG timeouts = 0;
+    ULONGLONG missedDeadlines = 0;
+    ULONGLONG bytesOut = 0;
+    ULONGLONG bytesIn = 0;
+    ULONGLONG varBinds = 0;
+    ULONGLONG latencySumUs = 0;
+    ULONGLONG errors[SNMP_METRICS_ERROR_STATUSES] = {};
+    ULONGLONG latency[SNMP_METRICS_BUCKETS] = {};
+    ULONGLONG cache[SNMP_METRICS_CACHE_RESULTS] = {};
+};
+
+static void SnmpMetricsMerge(SnmpMetricsTotals& totals, const SnmpMetricsSeries& series) {
+    totals.requests += series.requests.load(std::memory_order_relaxed);
+    totals.retries += series.retries.load(std::memory_order_relaxed);
+    totals.responses += series.responses.load(std::memory_order_relaxed);
+    totals.timeouts += series.timeouts.load(std::memory_order_relaxed);
+    totals.missedDeadlines += series.missedDeadlines.load(std::memory_order_relaxed);
+    totals.bytesOut += series.bytesOut.load(std::memory_order_relaxed);
+    totals.bytesIn += series.bytesIn.load(std::memory_order_relaxed);
+    totals.varBinds += series.varBinds.load(std::memory_order_relaxed);
+    totals.latencySumUs += series.latencySumUs.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < SNMP_METRICS_ERROR_STATUSES; i++) {
+        totals.errors[i] += series.errors[i].load(std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < SNMP_METRICS_BUCKETS; i++) {
+        totals.latency[i] += series.latency[i].load(std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < SNMP_METRICS_CACHE_RESULTS; i++) {
+        totals.cache[i] += series.cache[i].load(std::memory_order_relaxed);
+    }
+}
+
+// Значение перцентиля по гистограмме - верхняя граница корзины, в мкс
+static ULONGLONG SnmpMetricsPercentile(const SnmpMetricsTotals& totals, double percent) {
+    ULONGLONG count = 0;
+    for (size_t i = 0; i < SNMP_METRICS_BUCKETS; i++) count += totals.latency[i];
+    if (count == 0) return 0;
+
+    ULONGLONG rank = (ULONGLONG)(percent / 100.0 * count + 0.5);
+    if (rank == 0) rank = 1;
+    ULONGLONG seen = 0;
+    for (size_t i = 0; i < SNMP_METRICS_BUCKETS; i++) {
+        seen += totals.latency[i];
+        if (seen >= rank) return SnmpMetricsBucketLimit(i);
+    }
+    return SnmpMetricsBucketLimit(SNMP_METRICS_BUCKETS - 1);
+}
+
+// Названия error-status по RFC 3416
+static const char* const errorNames[SNMP_METRICS_ERROR_STATUSES] = {
+    "noError", "tooBig", "noSuchName", "badValue", "readOnly", "genErr", "noAccess", "wrongType",
+    "wrongLength", "wrongEncoding", "wrongValue", "noCreation", "inconsistentValue", "resourceUnavailable",
+    "commitFailed", "undoFailed", "authorizationError", "notWritable", "inconsistentName", "other"
+};
+
+static const char* const cacheNames[SNMP_METRICS_CACHE_RESULTS] = { "hit", "merged", "miss" };
+
+// Границы корзин гистограммы Prometheus, мкс (внутренние корзины сводятся к ним с точностью 12.5%)
+static const ULONGLONG exportBoundsUs[] = {
+    100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000
+};
+
+// Время и число varbind на момент предыдущего экспорта - для скорости varbind/с
+static std::mutex exportMutex;
+static ULONGLONG lastExportUs = 0;
+static ULONGLONG lastExportVarBinds = 0;
+
+// Функция для экранирования значения метки
+static std::string SnmpMetricsLabel(const std::string& value) {
+    std::string escaped;
+    for (char c : value) {
+        if (c == '\\' || c == '"') escaped += '\\';
+        if (c == '\n') {
+            escaped += "\\n";
+            continue;
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+
+void SnmpMetricsFormatPrometheus(std::string& out) {
+    // Сводим ряды всех потоков по (цель, PDU); std::map - для стабильного порядка вывода
+    std::map<std::pair<std::string, int>, SnmpMetricsTotals> merged;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (SnmpMetricsShard* shard : registryShards) {
+            std::lock_guard<std::mutex> shardLock(shard->mutex);
+            for (const auto& entry : shard->series) {
+                for (int pdu = 0; pdu < SNMP_METRICS_PDU_TYPES; pdu++) {
+                    if (entry.second[pdu]) SnmpMetricsMerge(merged[{ entry.first, pdu }], *entry.second[pdu]);
+                }
+            }
+        }
+    }
+
+    std::ostringstream text;
+    ULONGLONG varBinds = 0;
+
+    struct { const char* name; const char* help; ULONGLONG SnmpMetricsTotals::* field; } counters[] = {
+        { "snmp_requests_total", "SNMP request datagrams sent, including retries.", &SnmpMetricsTotals::requests },
+        { "snmp_retries_total", "SNMP request retransmissions after a timeout.", &SnmpMetricsTotals::retries },
+        { "snmp_responses_total", "SNMP responses received.", &SnmpMetricsTotals::responses },
+        { "snmp_timeouts_total", "SNMP requests left without a response after all retries.", &SnmpMetricsTotals::timeouts },
+        { "snmp_poll_missed_deadlines_total", "Poll cycles that finished after the next cycle was due.", &SnmpMetricsTotals::missedDeadlines },
+        { "snmp_sent_bytes_total", "Bytes of SNMP requests sent.", &SnmpMetricsTotals::bytesOut },
+        { "snmp_received_bytes_total", "Bytes of SNMP responses received.", &SnmpMetricsTotals::bytesIn },
+        { "snmp_varbinds_received_total", "Variable bindings received in responses.", &SnmpMetricsTotals::varBinds },
+    };
+    for (const auto& counter : counters) {
+        text << "# HELP " << counter.name << " " << counter.help << "\n# TYPE " << counter.name << " counter\n";
+        for (const auto& entry : merged) {
+            text << counter.name << "{target=\"" << SnmpMetricsLabel(entry.first.first) << "\",pdu=\""
+                << pduNames[entry.first.second] << "\"} " << entry.second.*counter.field << "\n";
+        }
+    }
+
+    text << "# HELP snmp_errors_total SNMP responses with a non-zero error-status.\n# TYPE snmp_errors_total counter\n";
+    for (const auto& entry : merged) {
+        varBinds += entry.second.varBinds;
+        for (size_t status = 1; status < SNMP_METRICS_ERROR_STATUSES; status++) {
+            if (entry.second.errors[status] == 0) continue;
+            text << "snmp_errors_total{target=\"" << SnmpMetricsLabel(entry.first.first) << "\",pdu=\""
+                << pduNames[entry.first.second] << "\",status=\"" << errorNames[status] << "\"} "
+                << entry.second.errors[status] << "\n";
+        }
+    }
+
+    // Как и у ошибок, нулевые исходы не выводятся: без кэша рядов нет вовсе
+    text << "# HELP snmp_cache_lookups_total Requests served by the response cache: hit, merged into an identical "
+        << "request in flight, or miss sent to the agent.\n# TYPE snmp_cache_lookups_total counter\n";
+    for (const auto& entry : merged) {
+        for (size_t result = 0; result < SNMP_METRICS_CACHE_RESULTS; result++) {
+            if (entry.second.cache[result] == 0) continue;
+            text << "snmp_cache_lookups_total{target=\"" << SnmpMetricsLabel(entry.first.first) << "\",pdu=\""
+                << pduNames[entry.first.second] << "\",result=\"" << cacheNames[result] << "\"} "
+                << entry.second.cache[result] << "\n";
+        }
+    }
+
+    text << "# HELP snmp_request_duration_seconds Time from the first send of a request to its response.\n"
+        << "# TYPE snmp_request_duration_seconds histogram\n";
+    for (const auto& entry : merged) {
+        std::string labels = "target=\"" + SnmpMetricsLabel(entry.first.first) + "\",pdu=\"" + pduNames[entry.first.second] + "\"";
+        const SnmpMetricsTotals& totals = entry.second;
+
+        // Внутренняя корзина попадает в первую экспортную, которая покрывает её верхнюю границу
+        ULONGLONG cumulative = 0;
+        size_t bucket = 0;
+        for (ULONGLONG bound : exportBoundsUs) {
+            while (bucket < SNMP_METRICS_BUCKETS && SnmpMetricsBucketLimit(bucket) <= bound + 1) {
+                cumulative += totals.latency[bucket++];
+            }
+            text << "snmp_request_duration_seconds_bucket{" << labels << ",le=\"" << bound / 1e6 << "\"} " << cumulative << "\n";
+        }
+        while (bucket < SNMP_METRICS_BUCKETS) cumulative += totals.latency[bucket++];
+        text << "snmp_request_duration_seconds_bucket{" << labels << ",le=\"+Inf\"} " << cumulative << "\n"
+            << "snmp_request_duration_seconds_sum{" << labels << "} " << totals.latencySumUs / 1e6 << "\n"
+            << "snmp_request_duration_seconds_count{" << labels << "} " << cumulative << "\n";
+    }
+
+    text << "# HELP snmp_request_duration_quantile_seconds Response time percentiles (12.5% resolution).\n"
+        << "# TYPE snmp_request_duration_quantile_seconds gauge\n";
+    for (const auto& entry : merged) {
+        for (double quantile : { 0.5, 0.9, 0.99 }) {
+            text << "snmp_request_duration_quantile_seconds{target=\"" << SnmpMetricsLabel(entry.first.first)
+                << "\",pdu=\"" << pduNames[entry.first.second] << "\",quantile=\"" << quantile << "\"} "
+                << SnmpMetricsPercentile(entry.second, quantile * 100) / 1e6 << "\n";
+        }
+    }
+
+    // Скорость varbind/с - с момента предыдущего экспорта
+    double rate = 0;
+    {
+        std::lock_guard<std::mutex> lock(exportMutex);
+        ULONGLONG now = SnmpMetricsNowUs();
+        if (lastExportUs != 0 && now > lastExportUs && varBinds >= lastExportVarBinds) {
+            rate = (double)(varBinds - lastExportVarBinds) * 1e6 / (now - lastExportUs);
+        }
+        lastExportUs = now;
+        lastExportVarBinds = varBinds;
+    }
+    text << "# HELP snmp_varbinds_per_second Variable bindings received per second since the previous export.\n"
+        << "# TYPE snmp_varbinds_per_second gauge\n"
+        << "snmp_varbinds_per_second " << rate << "\n";
+
+    out += text.str();
+}
+
+bool SnmpMetricsWriteFile(const std::string& path) {
+    std::string text;
+    SnmpMetricsFormatPrometheus(text);
+
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file || !file.write(text.data(), text.size())) {
+            std::cerr << "Cannot write metrics file: " << temporary << std::endl;
+            return false;
+        }
+    }
+
+#ifdef _WIN32
+    if (!MoveFileExA(temporary.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+#else
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+#endif
+        std::cerr << "Cannot replace metrics file: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Функция для ответа на один HTTP-запрос: GET /metrics - метрики, остальное - 404
+static void SnmpMetricsServe(SOCKET client) {
+    // Запрос короткий; ждём его не дольше секунды, чтобы медленный клиент не держал поток
+    char request[2048];
+    size_t length = 0;
+    while (length < sizeof(request) - 1) {
+        fd_set readSet;
+        FD_ZERO(&readSet);
+        FD_SET(client, &readSet);
+        timeval tv = { 1, 0 };
+        if (select((int)client + 1, &readSet, NULL, NULL, &tv) <= 0) break;
+
+        int received = recv(client, request + length, (int)(sizeof(request) - 1 - length), 0);
+        if (received <= 0) break;
+        length += received;
+        request[length] = '\0';
+        if (strstr(request, "\r\n\r\n") || strstr(request, "\n\n")) break;
+    }
+    request[length] = '\0';
+
+    std::string body;
+    std::string status = "200 OK";
+    if (strncmp(request, "GET /metrics", 12) == 0 && (request[12] == ' ' || request[12] == '?')) {
+        SnmpMetricsFormatPrometheus(body);
+    }
+    else {
+        status = "404 Not Found";
+        body = "Use GET /metrics\n";
+    }
+
+    std::string response = "HTTP/1.1 " + status + "\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+        + "Content-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+    size_t offset = 0;
+    while (offset < response.size()) {
+        int sent = send(client, response.data() + offset, (int)(response.size() - offset), 0);
+        if (sent <= 0) break;
+        offset += sent;
+    }
+}
+
+static void SnmpMetricsExporterRun(SnmpMetricsExporter* exporter) {
+    ULONGLONG nextDump = GetTickCount64() + exporter->dumpInterval;
+
+    while (!exporter->stop.load()) {
+        // Ожидание подключения не дольше 100 мс, чтобы вовремя заметить остановку и срок записи файла
+        if (exporter->listenSocket != INVALID_SOCKET) {
+            timeval tv = { 0, 100000 };
+            fd_set readSet;
+            FD_ZERO(&readSet);
+            FD_SET(exporter->listenSocket, &readSet);
+            if (select((int)exporter->listenSocket + 1, &readSet, NULL, NULL, &tv) > 0) {
+                SOCKET client = accept(exporter->listenSocket, NULL, NULL);
+                if (client != INVALID_SOCKET) {
+                    SnmpMetricsServe(client);
+                    closesocket(client);
+                }
+            }
+        }
+        else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+
+        if (!exporter->dumpPath.empty() && GetTickCount64() >= nextDump) {
+            SnmpMetricsWriteFile(exporter->dumpPath);
+            nextDump = GetTickCount64() + exporter->dumpInterval;
+        }
+    }
+
+    // Последняя запись при остановке, чтобы в файле оказались итоговые значения
+    if (!exporter->dumpPath.empty()) {
+        SnmpMetricsWriteFile(exporter->dumpPath);
+    }
+}
+
+bool SnmpMetricsExporterStart(SnmpMetricsExporter& exporter) {
+    exporter.stop = false;
+    exporter.listenSocket = INVALID_SOCKET;
+
+    if (!exporter.listenAddress.empty()) {
+        sockaddr_storage address;
+        int addressLength = 0;
+        if (!SnmpUdpResolve(exporter.listenAddress, address, addressLength)) {
+            return false;
+        }
+
+        SOCKET sock = socket(address.ss_family, SOCK_STREAM, IPPROTO_TCP);
+        if (sock == INVALID_SOCKET) {
+            SetLastError(WSAGetLastError());
+            return false;
+        }
+
+        int enable = 1;
+        setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, (const char*)&enable, sizeof(enable));
+        if (bind(sock, (const sockaddr*)&address, addressLength) == SOCKET_ERROR || listen(sock, 16) == SOCKET_ERROR) {
+            SetLastError(WSAGetLastError());
+            closesocket(sock);
+            return false;
+        }
+        exporter.listenSocket = sock;
+    }
+
+    exporter.thread = std::thread(SnmpMetricsExporterRun, &exporter);
+    return true;
+}
+
+void SnmpMetricsExporterStop(SnmpMetricsExporter& exporter) {
+    exporter.stop = true;
+    if (exporter.thread.joinable()) {
+        exporter.thread.join();
+    }
+    if (exporter.listenSocket != INVALID_SOCKET) {
+        closesocket(exporter.listenSocket);
+        exporter.listenSocket = INVALID_SOCKET;
+    }
+}
@@ -0,0 +1,131 @@
+﻿#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include "snmp_compat.h"
+
+// Гистограмма задержек в мкс, как в HdrHistogram: значения до 16 - точно,
+// дальше каждый интервал [2^e, 2^(e+1)) делится на 8 равных корзин (точность 12.5%)
+#define SNMP_METRICS_EXACT_BUCKETS 16
+#define SNMP_METRICS_SUB_BUCKETS 8
+#define SNMP_METRICS_MAX_EXPONENT 35      // 2^36 мкс - около 19 часов
+#define SNMP_METRICS_BUCKETS \
+    (SNMP_METRICS_EXACT_BUCKETS + (SNMP_METRICS_MAX_EXPONENT - 3) * SNMP_METRICS_SUB_BUCKETS)
+
+// Счётчики ошибок по error-status 0..18, всё остальное - в последнем
+#define SNMP_METRICS_ERROR_STATUSES 20
+
+// Типы PDU, для которых ведутся отдельные ряды
+enum SnmpMetricsPdu {
+    SNMP_METRICS_GET,
+    SNMP_METRICS_GETNEXT,
+    SNMP_METRICS_GETBULK,
+    SNMP_METRICS_SET,
+    SNMP_METRICS_PDU_TYPES
+};
+
+// Исходы обращения к кэшу ответов (см. SnmpCache)
+enum SnmpMetricsCache {
+    SNMP_METRICS_CACHE_HIT,       // ответ из кэша
+    SNMP_METRICS_CACHE_MERGED,    // присоединился к такому же запросу в полёте
+    SNMP_METRICS_CACHE_MISS,      // запрос ушёл агенту
+    SNMP_METRICS_CACHE_RESULTS
+};
+
+// Ряд метрик одной цели и одного типа PDU в шарде одного потока.
+// Пишет только поток-владелец (load + store без блокирующих инструкций),
+// экспорт читает те же атомарные поля из другого потока.
+struct SnmpMetricsSeries {
+    std::atomic<ULONGLONG> requests{0};           // отправленные датаграммы, с повторами
+    std::atomic<ULONGLONG> retries{0};
+    std::atomic<ULONGLONG> responses{0};
+    std::atomic<ULONGLONG> timeouts{0};           // запросы без ответа после всех повторов
+    std::atomic<ULONGLONG> missedDeadlines{0};    // циклы опроса, не уложившиеся в период
+    std::atomic<ULONGLONG> bytesOut{0};
+    std::atomic<ULONGLONG> bytesIn{0};
+    std::atomic<ULONGLONG> varBinds{0};           // varbind в ответах
+    std::atomic<ULONGLONG> latencySumUs{0};
+    std::atomic<ULONGLONG> errors[SNMP_METRICS_ERROR_STATUSES] = {};
+    std::atomic<ULONGLONG> latency[SNMP_METRICS_BUCKETS] = {};
+    std::atomic<ULONGLONG> cache[SNMP_METRICS_CACHE_RESULTS] = {};
+};
+
+// Включение записи метрик (по умолчанию включена); выключенная запись - одна проверка флага
+void SnmpMetricsEnable(bool enabled);
+bool SnmpMetricsEnabled();
+
+// Ряд для цели и PDU в шарде текущего потока (создаётся при первом обращении).
+// Указатель действителен до конца процесса, но писать в ряд можно только из этого потока.
+// NULL, если метрики выключены или тип PDU не учитывается.
+SnmpMetricsSeries* SnmpMetricsSeriesFor(const std::string& target, BYTE pduType);
+
+// Номер корзины гистограммы и верхняя граница корзины (не включительно), мкс
+size_t SnmpMetricsBucket(ULONGLONG valueUs);
+ULONGLONG SnmpMetricsBucketLimit(size_t bucket);
+
+inline ULONGLONG SnmpMetricsNowUs() {
+    return (ULONGLONG)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Прибавление к счётчику, у которого один писатель
+inline void SnmpMetricsAdd(std::atomic<ULONGLONG>& counter, ULONGLONG value) {
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+inline void SnmpMetricsOnSend(SnmpMetricsSeries* series, size_t bytes, bool retry) {
+    if (!series) return;
+    SnmpMetricsAdd(series->requests, 1);
+    SnmpMetricsAdd(series->bytesOut, bytes);
+    if (retry) SnmpMetricsAdd(series->retries, 1);
+}
+
+inline void SnmpMetricsOnResponse(SnmpMetricsSeries* series, ULONGLONG latencyUs, AsnInteger errorStatus,
+    size_t bytes, UINT varBinds) {
+    if (!series) return;
+    SnmpMetricsAdd(series->responses, 1);
+    SnmpMetricsAdd(series->bytesIn, bytes);
+    SnmpMetricsAdd(series->varBinds, varBinds);
+    SnmpMetricsAdd(series->latencySumUs, latencyUs);
+    SnmpMetricsAdd(series->latency[SnmpMetricsBucket(latencyUs)], 1);
+    size_t status = errorStatus >= 0 && errorStatus < SNMP_METRICS_ERROR_STATUSES - 1
+        ? (size_t)errorStatus : SNMP_METRICS_ERROR_STATUSES - 1;
+    SnmpMetricsAdd(series->errors[status], 1);
+}
+
+inline void SnmpMetricsOnTimeout(SnmpMetricsSeries* series) {
+    if (!series) return;
+    SnmpMetricsAdd(series->timeouts, 1);
+}
+
+inline void SnmpMetricsOnMissedDeadline(SnmpMetricsSeries* series) {
+    if (!series) return;
+    SnmpMetricsAdd(series->missedDeadlines, 1);
+}
+
+inline void SnmpMetricsOnCache(SnmpMetricsSeries* series, SnmpMetricsCache result) {
+    if (!series) return;
+    SnmpMetricsAdd(series->cache[result], 1);
+}
+
+// Все ряды всех потоков в текстовом формате Prometheus (дописывается в out)
+void SnmpMetricsFormatPrometheus(std::string& out);
+
+// Записывает метрики в файл через временный файл и переименование,
+// чтобы читатель не увидел наполовину записанный файл
+bool SnmpMetricsWriteFile(const std::string& path);
+
+// Экспорт метрик: HTTP-эндпоинт (GET /metrics) и/или периодическая запись в файл
+struct SnmpMetricsExporter {
+    std::string listenAddress;    // "127.0.0.1:9116"; пустая строка - без HTTP
+    std::string dumpPath;         // пустая строка - без файла
+    DWORD dumpInterval = 10000;   // период записи файла, мс
+    SOCKET listenSocket = INVALID_SOCKET;
+    std::thread thread;
+    std::atomic<bool> stop{false};
+};
+
+bool SnmpMetricsExporterStart(SnmpMetricsExporter& exporter);
+void SnmpMetricsExporterStop(SnmpMetricsExporter& exporter);
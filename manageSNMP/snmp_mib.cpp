@@ -0,0 +1,890 @@
+﻿#include "snmp_mib.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#define SNMP_MIB_HEADER_WORDS (sizeof(SnmpMibHeader) / sizeof(UINT))
+#define SNMP_MIB_NODE_WORDS (sizeof(SnmpMibNode) / sizeof(UINT))
+
+struct SnmpMibBuiltin {
+    const char* module;
+    const char* name;
+    const char* parent;
+    UINT arc;
+};
+
+// Встроенная часть дерева: то, что нужно для обычных запросов без файлов MIB
+static const SnmpMibBuiltin builtinMib[] = {
+    { "SNMPv2-SMI", "org", "iso", 3 },
+    { "SNMPv2-SMI", "dod", "org", 6 },
+    { "SNMPv2-SMI", "internet", "dod", 1 },
+    { "SNMPv2-SMI", "directory", "internet", 1 },
+    { "SNMPv2-SMI", "mgmt", "internet", 2 },
+    { "SNMPv2-SMI", "mib-2", "mgmt", 1 },
+    { "SNMPv2-SMI", "transmission", "mib-2", 10 },
+    { "SNMPv2-SMI", "experimental", "internet", 3 },
+    { "SNMPv2-SMI", "private", "internet", 4 },
+    { "SNMPv2-SMI", "enterprises", "private", 1 },
+    { "SNMPv2-SMI", "security", "internet", 5 },
+    { "SNMPv2-SMI", "snmpV2", "internet", 6 },
+    { "SNMPv2-SMI", "snmpDomains", "snmpV2", 1 },
+    { "SNMPv2-SMI", "snmpProxys", "snmpV2", 2 },
+    { "SNMPv2-SMI", "snmpModules", "snmpV2", 3 },
+
+    { "SNMPv2-MIB", "system", "mib-2", 1 },
+    { "SNMPv2-MIB", "sysDescr", "system", 1 },
+    { "SNMPv2-MIB", "sysObjectID", "system", 2 },
+    { "SNMPv2-MIB", "sysUpTime", "system", 3 },
+    { "SNMPv2-MIB", "sysContact", "system", 4 },
+    { "SNMPv2-MIB", "sysName", "system", 5 },
+    { "SNMPv2-MIB", "sysLocation", "system", 6 },
+    { "SNMPv2-MIB", "sysServices", "system", 7 },
+    { "SNMPv2-MIB", "sysORLastChange", "system", 8 },
+    { "SNMPv2-MIB", "sysORTable", "system", 9 },
+    { "SNMPv2-MIB", "sysOREntry", "sysORTable", 1 },
+    { "SNMPv2-MIB", "sysORIndex", "sysOREntry", 1 },
+    { "SNMPv2-MIB", "sysORID", "sysOREntry", 2 },
+    { "SNMPv2-MIB", "sysORDescr", "sysOREntry", 3 },
+    { "SNMPv2-MIB", "sysORUpTime", "sysOREntry", 4 },
+    { "SNMPv2-MIB", "snmp", "mib-2", 11 },
+    { "SNMPv2-MIB", "snmpInPkts", "snmp", 1 },
+    { "SNMPv2-MIB", "snmpOutPkts", "snmp", 2 },
+    { "SNMPv2-MIB", "snmpInBadVersions", "snmp", 3 },
+    { "SNMPv2-MIB", "snmpInBadCommunityNames", "snmp", 4 },
+    { "SNMPv2-MIB", "snmpInBadCommunityUses", "snmp", 5 },
+    { "SNMPv2-MIB", "snmpInASNParseErrs", "snmp", 6 },
+    { "SNMPv2-MIB", "snmpInTooBigs", "snmp", 8 },
+    { "SNMPv2-MIB", "snmpInNoSuchNames", "snmp", 9 },
+    { "SNMPv2-MIB", "snmpInBadValues", "snmp", 10 },
+    { "SNMPv2-MIB", "snmpInReadOnlys", "snmp", 11 },
+    { "SNMPv2-MIB", "snmpInGenErrs", "snmp", 12 },
+    { "SNMPv2-MIB", "snmpInTotalReqVars", "snmp", 13 },
+    { "SNMPv2-MIB", "snmpInTotalSetVars", "snmp", 14 },
+    { "SNMPv2-MIB", "snmpInGetRequests", "snmp", 15 },
+    { "SNMPv2-MIB", "snmpInGetNexts", "snmp", 16 },
+    { "SNMPv2-MIB", "snmpInSetRequests", "snmp", 17 },
+    { "SNMPv2-MIB", "snmpInGetResponses", "snmp", 18 },
+    { "SNMPv2-MIB", "snmpInTraps", "snmp", 19 },
+    { "SNMPv2-MIB", "snmpOutTooBigs", "snmp", 20 },
+    { "SNMPv2-MIB", "snmpOutNoSuchNames", "snmp", 21 },
+    { "SNMPv2-MIB", "snmpOutBadValues", "snmp", 22 },
+    { "SNMPv2-MIB", "snmpOutGenErrs", "snmp", 24 },
+    { "SNMPv2-MIB", "snmpOutGetRequests", "snmp", 25 },
+    { "SNMPv2-MIB", "snmpOutGetNexts", "snmp", 26 },
+    { "SNMPv2-MIB", "snmpOutSetRequests", "snmp", 27 },
+    { "SNMPv2-MIB", "snmpOutGetResponses", "snmp", 28 },
+    { "SNMPv2-MIB", "snmpOutTraps", "snmp", 29 },
+    { "SNMPv2-MIB", "snmpEnableAuthenTraps", "snmp", 30 },
+    { "SNMPv2-MIB", "snmpSilentDrops", "snmp", 31 },
+    { "SNMPv2-MIB", "snmpProxyDrops", "snmp", 32 },
+    { "SNMPv2-MIB", "snmpMIB", "snmpModules", 1 },
+    { "SNMPv2-MIB", "snmpMIBObjects", "snmpMIB", 1 },
+    { "SNMPv2-MIB", "snmpTrap", "snmpMIBObjects", 4 },
+    { "SNMPv2-MIB", "snmpTrapOID", "snmpTrap", 1 },
+    { "SNMPv2-MIB", "snmpTrapEnterprise", "snmpTrap", 3 },
+    { "SNMPv2-MIB", "snmpTraps", "snmpMIBObjects", 5 },
+    { "SNMPv2-MIB", "coldStart", "snmpTraps", 1 },
+    { "SNMPv2-MIB", "warmStart", "snmpTraps", 2 },
+    { "SNMPv2-MIB", "authenticationFailure", "snmpTraps", 5 },
+
+    { "IF-MIB", "interfaces", "mib-2", 2 },
+    { "IF-MIB", "ifNumber", "interfaces", 1 },
+    { "IF-MIB", "ifTable", "interfaces", 2 },
+    { "IF-MIB", "ifEntry", "ifTable", 1 },
+    { "IF-MIB", "ifIndex", "ifEntry", 1 },
+    { "IF-MIB", "ifDescr", "ifEntry", 2 },
+    { "IF-MIB", "ifType", "ifEntry", 3 },
+    { "IF-MIB", "ifMtu", "ifEntry", 4 },
+    { "IF-MIB", "ifSpeed", "ifEntry", 5 },
+    { "IF-MIB", "ifPhysAddress", "ifEntry", 6 },
+    { "IF-MIB", "ifAdminStatus", "ifEntry", 7 },
+    { "IF-MIB", "ifOperStatus", "ifEntry", 8 },
+    { "IF-MIB", "ifLastChange", "ifEntry", 9 },
+    { "IF-MIB", "ifInOctets", "ifEntry", 10 },
+    { "IF-MIB", "ifInUcastPkts", "ifEntry", 11 },
+    { "IF-MIB", "ifInNUcastPkts", "ifEntry", 12 },
+    { "IF-MIB", "ifInDiscards", "ifEntry", 13 },
+    { "IF-MIB", "ifInErrors", "ifEntry", 14 },
+    { "IF-MIB", "ifInUnknownProtos", "ifEntry", 15 },
+    { "IF-MIB", "ifOutOctets", "ifEntry", 16 },
+    { "IF-MIB", "ifOutUcastPkts", "ifEntry", 17 },
+    { "IF-MIB", "ifOutNUcastPkts", "ifEntry", 18 },
+    { "IF-MIB", "ifOutDiscards", "ifEntry", 19 },
+    { "IF-MIB", "ifOutErrors", "ifEntry", 20 },
+    { "IF-MIB", "ifOutQLen", "ifEntry", 21 },
+    { "IF-MIB", "ifSpecific", "ifEntry", 22 },
+    { "IF-MIB", "ifMIB", "mib-2", 31 },
+    { "IF-MIB", "ifMIBObjects", "ifMIB", 1 },
+    { "IF-MIB", "ifXTable", "ifMIBObjects", 1 },
+    { "IF-MIB", "ifXEntry", "ifXTable", 1 },
+    { "IF-MIB", "ifName", "ifXEntry", 1 },
+    { "IF-MIB", "ifInMulticastPkts", "ifXEntry", 2 },
+    { "IF-MIB", "ifInBroadcastPkts", "ifXEntry", 3 },
+    { "IF-MIB", "ifOutMulticastPkts", "ifXEntry", 4 },
+    { "IF-MIB", "ifOutBroadcastPkts", "ifXEntry", 5 },
+    { "IF-MIB", "ifHCInOctets", "ifXEntry", 6 },
+    { "IF-MIB", "ifHCInUcastPkts", "ifXEntry", 7 },
+    { "IF-MIB", "ifHCInMulticastPkts", "ifXEntry", 8 },
+    { "IF-MIB", "ifHCInBroadcastPkts", "ifXEntry", 9 },
+    { "IF-MIB", "ifHCOutOctets", "ifXEntry", 10 },
+    { "IF-MIB", "ifHCOutUcastPkts", "ifXEntry", 11 },
+    { "IF-MIB", "ifHCOutMulticastPkts", "ifXEntry", 12 },
+    { "IF-MIB", "ifHCOutBroadcastPkts", "ifXEntry", 13 },
+    { "IF-MIB", "ifLinkUpDownTrapEnable", "ifXEntry", 14 },
+    { "IF-MIB", "ifHighSpeed", "ifXEntry", 15 },
+    { "IF-MIB", "ifPromiscuousMode", "ifXEntry", 16 },
+    { "IF-MIB", "ifConnectorPresent", "ifXEntry", 17 },
+    { "IF-MIB", "ifAlias", "ifXEntry", 18 },
+    { "IF-MIB", "ifCounterDiscontinuityTime", "ifXEntry", 19 },
+    { "IF-MIB", "ifStackTable", "ifMIBObjects", 2 },
+    { "IF-MIB", "ifTableLastChange", "ifMIBObjects", 5 },
+    { "IF-MIB", "ifStackLastChange", "ifMIBObjects", 6 },
+    { "IF-MIB", "linkDown", "snmpTraps", 3 },
+    { "IF-MIB", "linkUp", "snmpTraps", 4 },
+
+    { "RFC1213-MIB", "at", "mib-2", 3 },
+    { "RFC1213-MIB", "atTable", "at", 1 },
+    { "RFC1213-MIB", "atEntry", "atTable", 1 },
+    { "RFC1213-MIB", "atIfIndex", "atEntry", 1 },
+    { "RFC1213-MIB", "atPhysAddress", "atEntry", 2 },
+    { "RFC1213-MIB", "atNetAddress", "atEntry", 3 },
+
+    { "IP-MIB", "ip", "mib-2", 4 },
+    { "IP-MIB", "ipForwarding", "ip", 1 },
+    { "IP-MIB", "ipDefaultTTL", "ip", 2 },
+    { "IP-MIB", "ipInReceives", "ip", 3 },
+    { "IP-MIB", "ipInHdrErrors", "ip", 4 },
+    { "IP-MIB", "ipInAddrErrors", "ip", 5 },
+    { "IP-MIB", "ipForwDatagrams", "ip", 6 },
+    { "IP-MIB", "ipInUnknownProtos", "ip", 7 },
+    { "IP-MIB", "ipInDiscards", "ip", 8 },
+    { "IP-MIB", "ipInDelivers", "ip", 9 },
+    { "IP-MIB", "ipOutRequests", "ip", 10 },
+    { "IP-MIB", "ipOutDiscards", "ip", 11 },
+    { "IP-MIB", "ipOutNoRoutes", "ip", 12 },
+    { "IP-MIB", "ipReasmTimeout", "ip", 13 },
+    { "IP-MIB", "ipReasmReqds", "ip", 14 },
+    { "IP-MIB", "ipReasmOKs", "ip", 15 },
+    { "IP-MIB", "ipReasmFails", "ip", 16 },
+    { "IP-MIB", "ipFragOKs", "ip", 17 },
+    { "IP-MIB", "ipFragFails", "ip", 18 },
+    { "IP-MIB", "ipFragCreates", "ip", 19 },
+    { "IP-MIB", "ipAddrTable", "ip", 20 },
+    { "IP-MIB", "ipAddrEntry", "ipAddrTable", 1 },
+    { "IP-MIB", "ipAdEntAddr", "ipAddrEntry", 1 },
+    { "IP-MIB", "ipAdEntIfIndex", "ipAddrEntry", 2 },
+    { "IP-MIB", "ipAdEntNetMask", "ipAddrEntry", 3 },
+    { "IP-MIB", "ipAdEntBcastAddr", "ipAddrEntry", 4 },
+    { "IP-MIB", "ipAdEntReasmMaxSize", "ipAddrEntry", 5 },
+    { "RFC1213-MIB", "ipRouteTable", "ip", 21 },
+    { "RFC1213-MIB", "ipRouteEntry", "ipRouteTable", 1 },
+    { "RFC1213-MIB", "ipRouteDest", "ipRouteEntry", 1 },
+    { "RFC1213-MIB", "ipRouteIfIndex", "ipRouteEntry", 2 },
+    { "RFC1213-MIB", "ipRouteMetric1", "ipRouteEntry", 3 },
+    { "RFC1213-MIB", "ipRouteNextHop", "ipRouteEntry", 7 },
+    { "RFC1213-MIB", "ipRouteType", "ipRouteEntry", 8 },
+    { "RFC1213-MIB", "ipRouteProto", "ipRouteEntry", 9 },
+    { "RFC1213-MIB", "ipRouteMask", "ipRouteEntry", 11 },
+    { "IP-MIB", "ipNetToMediaTable", "ip", 22 },
+    { "IP-MIB", "ipNetToMediaEntry", "ipNetToMediaTable", 1 },
+    { "IP-MIB", "ipNetToMediaIfIndex", "ipNetToMediaEntry", 1 },
+    { "IP-MIB", "ipNetToMediaPhysAddress", "ipNetToMediaEntry", 2 },
+    { "IP-MIB", "ipNetToMediaNetAddress", "ipNetToMediaEntry", 3 },
+    { "IP-MIB", "ipNetToMediaType", "ipNetToMediaEntry", 4 },
+    { "IP-MIB", "ipRoutingDiscards", "ip", 23 },
+    { "IP-MIB", "icmp", "mib-2", 5 },
+    { "IP-MIB", "icmpInMsgs", "icmp", 1 },
+    { "IP-MIB", "icmpInErrors", "icmp", 2 },
+    { "IP-MIB", "icmpInDestUnreachs", "icmp", 3 },
+    { "IP-MIB", "icmpInTimeExcds", "icmp", 4 },
+    { "IP-MIB", "icmpInParmProbs", "icmp", 5 },
+    { "IP-MIB", "icmpInSrcQuenchs", "icmp", 6 },
+    { "IP-MIB", "icmpInRedirects", "icmp", 7 },
+    { "IP-MIB", "icmpInEchos", "icmp", 8 },
+    { "IP-MIB", "icmpInEchoReps", "icmp", 9 },
+    { "IP-MIB", "icmpInTimestamps", "icmp", 10 },
+    { "IP-MIB", "icmpInTimestampReps", "icmp", 11 },
+    { "IP-MIB", "icmpInAddrMasks", "icmp", 12 },
+    { "IP-MIB", "icmpInAddrMaskReps", "icmp", 13 },
+    { "IP-MIB", "icmpOutMsgs", "icmp", 14 },
+    { "IP-MIB", "icmpOutErrors", "icmp", 15 },
+    { "IP-MIB", "icmpOutDestUnreachs", "icmp", 16 },
+    { "IP-MIB", "icmpOutTimeExcds", "icmp", 17 },
+    { "IP-MIB", "icmpOutParmProbs", "icmp", 18 },
+    { "IP-MIB", "icmpOutSrcQuenchs", "icmp", 19 },
+    { "IP-MIB", "icmpOutRedirects", "icmp", 20 },
+    { "IP-MIB", "icmpOutEchos", "icmp", 21 },
+    { "IP-MIB", "icmpOutEchoReps", "icmp", 22 },
+    { "IP-MIB", "icmpOutTimestamps", "icmp", 23 },
+    { "IP-MIB", "icmpOutTimestampReps", "icmp", 24 },
+    { "IP-MIB", "icmpOutAddrMasks", "icmp", 25 },
+    { "IP-MIB", "icmpOutAddrMaskReps", "icmp", 26 },
+
+    { "TCP-MIB", "tcp", "mib-2", 6 },
+    { "TCP-MIB", "tcpRtoAlgorithm", "tcp", 1 },
+    { "TCP-MIB", "tcpRtoMin", "tcp", 2 },
+    { "TCP-MIB", "tcpRtoMax", "tcp", 3 },
+    { "TCP-MIB", "tcpMaxConn", "tcp", 4 },
+    { "TCP-MIB", "tcpActiveOpens", "tcp", 5 },
+    { "TCP-MIB", "tcpPassiveOpens", "tcp", 6 },
+    { "TCP-MIB", "tcpAttemptFails", "tcp", 7 },
+    { "TCP-MIB", "tcpEstabResets", "tcp", 8 },
+    { "TCP-MIB", "tcpCurrEstab", "tcp", 9 },
+    { "TCP-MIB", "tcpInSegs", "tcp", 10 },
+    { "TCP-MIB", "tcpOutSegs", "tcp", 11 },
+    { "TCP-MIB", "tcpRetransSegs", "tcp", 12 },
+    { "TCP-MIB", "tcpConnTable", "tcp", 13 },
+    { "TCP-MIB", "tcpConnEntry", "tcpConnTable", 1 },
+    { "TCP-MIB", "tcpConnState", "tcpConnEntry", 1 },
+    { "TCP-MIB", "tcpConnLocalAddress", "tcpConnEntry", 2 },
+    { "TCP-MIB", "tcpConnLocalPort", "tcpConnEntry", 3 },
+    { "TCP-MIB", "tcpConnRemAddress", "tcpConnEntry", 4 },
+    { "TCP-MIB", "tcpConnRemPort", "tcpConnEntry", 5 },
+    { "TCP-MIB", "tcpInErrs", "tcp", 14 },
+    { "TCP-MIB", "tcpOutRsts", "tcp", 15 },
+
+    { "UDP-MIB", "udp", "mib-2", 7 },
+    { "UDP-MIB", "udpInDatagrams", "udp", 1 },
+    { "UDP-MIB", "udpNoPorts", "udp", 2 },
+    { "UDP-MIB", "udpInErrors", "udp", 3 },
+    { "UDP-MIB", "udpOutDatagrams", "udp", 4 },
+    { "UDP-MIB", "udpTable", "udp", 5 },
+    { "UDP-MIB", "udpEntry", "udpTable", 1 },
+    { "UDP-MIB", "udpLocalAddress", "udpEntry", 1 },
+    { "UDP-MIB", "udpLocalPort", "udpEntry", 2 },
+
+    { "HOST-RESOURCES-MIB", "host", "mib-2", 25 },
+    { "HOST-RESOURCES-MIB", "hrSystem", "host", 1 },
+    { "HOST-RESOURCES-MIB", "hrSystemUptime", "hrSystem", 1 },
+    { "HOST-RESOURCES-MIB", "hrSystemDate", "hrSystem", 2 },
+    { "HOST-RESOURCES-MIB", "hrSystemInitialLoadDevice", "hrSystem", 3 },
+    { "HOST-RESOURCES-MIB", "hrSystemInitialLoadParameters", "hrSystem", 4 },
+    { "HOST-RESOURCES-MIB", "hrSystemNumUsers", "hrSystem", 5 },
+    { "HOST-RESOURCES-MIB", "hrSystemProcesses", "hrSystem", 6 },
+    { "HOST-RESOURCES-MIB", "hrSystemMaxProcesses", "hrSystem", 7 },
+    { "HOST-RESOURCES-MIB", "hrStorage", "host", 2 },
+    { "HOST-RESOURCES-MIB", "hrStorageTypes", "hrStorage", 1 },
+    { "HOST-RESOURCES-MIB", "hrMemorySize", "hrStorage", 2 },
+    { "HOST-RESOURCES-MIB", "hrStorageTable", "hrStorage", 3 },
+    { "HOST-RESOURCES-MIB", "hrStorageEntry", "hrStorageTable", 1 },
+    { "HOST-RESOURCES-MIB", "hrStorageIndex", "hrStorageEntry", 1 },
+    { "HOST-RESOURCES-MIB", "hrStorageType", "hrStorageEntry", 2 },
+    { "HOST-RESOURCES-MIB", "hrStorageDescr", "hrStorageEntry", 3 },
+    { "HOST-RESOURCES-MIB", "hrStorageAllocationUnits", "hrStorageEntry", 4 },
+    { "HOST-RESOURCES-MIB", "hrStorageSize", "hrStorageEntry", 5 },
+    { "HOST-RESOURCES-MIB", "hrStorageUsed", "hrStorageEntry", 6 },
+    { "HOST-RESOURCES-MIB", "hrStorageAllocationFailures", "hrStorageEntry", 7 },
+    { "HOST-RESOURCES-MIB", "hrDevice", "host", 3 },
+    { "HOST-RESOURCES-MIB", "hrDeviceTable", "hrDevice", 2 },
+    { "HOST-RESOURCES-MIB", "hrDeviceEntry", "hrDeviceTable", 1 },
+    { "HOST-RESOURCES-MIB", "hrDeviceIndex", "hrDeviceEntry", 1 },
+    { "HOST-RESOURCES-MIB", "hrDeviceType", "hrDeviceEntry", 2 },
+    { "HOST-RESOURCES-MIB", "hrDeviceDescr", "hrDeviceEntry", 3 },
+    { "HOST-RESOURCES-MIB", "hrDeviceID", "hrDeviceEntry", 4 },
+    { "HOST-RESOURCES-MIB", "hrDeviceStatus", "hrDeviceEntry", 5 },
+    { "HOST-RESOURCES-MIB", "hrDeviceErrors", "hrDeviceEntry", 6 },
+    { "HOST-RESOURCES-MIB", "hrProcessorTable", "hrDevice", 3 },
+    { "HOST-RESOURCES-MIB", "hrProcessorEntry", "hrProcessorTable", 1 },
+    { "HOST-RESOURCES-MIB", "hrProcessorFrwID", "hrProcessorEntry", 1 },
+    { "HOST-RESOURCES-MIB", "hrProcessorLoad", "hrProcessorEntry", 2 },
+    { "HOST-RESOURCES-MIB", "hrSWRun", "host", 4 },
+    { "HOST-RESOURCES-MIB", "hrSWRunTable", "hrSWRun", 2 },
+    { "HOST-RESOURCES-MIB", "hrSWRunEntry", "hrSWRunTable", 1 },
+    { "HOST-RESOURCES-MIB", "hrSWRunIndex", "hrSWRunEntry", 1 },
+    { "HOST-RESOURCES-MIB", "hrSWRunName", "hrSWRunEntry", 2 },
+    { "HOST-RESOURCES-MIB", "hrSWRunID", "hrSWRunEntry", 3 },
+    { "HOST-RESOURCES-MIB", "hrSWRunPath", "hrSWRunEntry", 4 },
+    { "HOST-RESOURCES-MIB", "hrSWRunParameters", "hrSWRunEntry", 5 },
+    { "HOST-RESOURCES-MIB", "hrSWRunType", "hrSWRunEntry", 6 },
+    { "HOST-RESOURCES-MIB", "hrSWRunStatus", "hrSWRunEntry", 7 },
+};
+
+void SnmpMibBuiltinDefinitions(std::vector<SnmpMibDefinition>& definitions) {
+    for (const SnmpMibBuiltin& builtin : builtinMib) {
+        SnmpMibDefinition definition;
+        definition.module = builtin.module;
+        definition.name = builtin.name;
+        definition.parent = builtin.parent;
+        definition.arcs.push_back(builtin.arc);
+        definitions.push_back(std::move(definition));
+    }
+}
+
+// Разбиение текста MIB на лексемы: идентификаторы и числа, "::=" и одиночные знаки.
+// Комментарии "--" и строки в кавычках (DESCRIPTION и т.п.) отбрасываются.
+static void SnmpMibTokenize(const std::string& text, std::vector<std::string>& tokens) {
+    size_t i = 0;
+    while (i < text.size()) {
+        char c = text[i];
+        if (isspace((unsigned char)c)) {
+            i++;
+        }
+        else if (c == '-' && i + 1 < text.size() && text[i + 1] == '-') {
+            // Комментарий идёт до конца строки или до следующего "--"
+            i += 2;
+            while (i < text.size() && text[i] != '\n' && text[i] != '\r') {
+                if (text[i] == '-' && i + 1 < text.size() && text[i + 1] == '-') {
+                    i += 2;
+                    break;
+                }
+                i++;
+            }
+        }
+        else if (c == '"') {
+            size_t end = text.find('"', i + 1);
+            i = end == std::string::npos ? text.size() : end + 1;
+        }
+        else if (text.compare(i, 3, "::=") == 0) {
+            tokens.push_back("::=");
+            i += 3;
+        }
+        else if (isalnum((unsigned char)c)) {
+            size_t start = i;
+            while (i < text.size() && (isalnum((unsigned char)text[i])
+                || (text[i] == '-' && !(i + 1 < text.size() && text[i + 1] == '-')))) {
+                i++;
+            }
+            tokens.push_back(text.substr(start, i - start));
+        }
+        else {
+            tokens.push_back(std::string(1, c));
+            i++;
+        }
+    }
+}
+
+static bool SnmpMibIsValueName(const std::string& token) {
+    return !token.empty() && islower((unsigned char)token[0]);
+}
+
+static bool SnmpMibIsNumber(const std::string& token) {
+    return !token.empty() && token.find_first_not_of("0123456789") == std::string::npos;
+}
+
+static bool SnmpMibParseArc(const std::string& token, UINT& arc) {
+    if (!SnmpMibIsNumber(token) || token.size() > 10) return false;
+    unsigned long long value = std::stoull(token);
+    if (value > 0xFFFFFFFFULL) return false;
+    arc = (UINT)value;
+    return true;
+}
+
+// Макросы SMI, значение которых - OID узла дерева
+static bool SnmpMibIsOidMacro(const std::string& token) {
+    static const char* macros[] = {
+        "OBJECT-TYPE", "MODULE-IDENTITY", "OBJECT-IDENTITY", "NOTIFICATION-TYPE",
+        "OBJECT-GROUP", "NOTIFICATION-GROUP", "MODULE-COMPLIANCE", "AGENT-CAPABILITIES",
+    };
+    for (const char* macro : macros) {
+        if (token == macro) return true;
+    }
+    return false;
+}
+
+// Разбор значения { parent name(n) ... n }: промежуточные name(n) тоже становятся определениями
+static bool SnmpMibParseValue(const std::vector<std::string>& tokens, size_t& i, const std::string& module,
+    const std::string& name, std::vector<SnmpMibDefinition>& definitions) {
+    if (i >= tokens.size() || tokens[i] != "{") return false;
+    i++;
+    if (i >= tokens.size() || !SnmpMibIsValueName(tokens[i])) return false;
+
+    std::string parent = tokens[i++];
+    if (i + 2 < tokens.size() && tokens[i] == "(" && tokens[i + 2] == ")") {
+        i += 3;
+    }
+
+    std::vector<UINT> arcs;
+    while (i < tokens.size() && tokens[i] != "}") {
+        UINT arc;
+        if (SnmpMibParseArc(tokens[i], arc)) {
+            arcs.push_back(arc);
+            i++;
+        }
+        else if (SnmpMibIsValueName(tokens[i]) && i + 3 < tokens.size() && tokens[i + 1] == "("
+            && SnmpMibParseArc(tokens[i + 2], arc) && tokens[i + 3] == ")") {
+            arcs.push_back(arc);
+            SnmpMibDefinition definition;
+            definition.module = module;
+            definition.name = tokens[i];
+            definition.parent = parent;
+            definition.arcs = arcs;
+            definitions.push_back(std::move(definition));
+            parent = tokens[i];
+            arcs.clear();
+            i += 4;
+        }
+        else {
+            return false;
+        }
+    }
+    if (i >= tokens.size() || arcs.empty()) return false;
+    i++;
+
+    SnmpMibDefinition definition;
+    definition.module = module;
+    definition.name = name;
+    definition.parent = parent;
+    definition.arcs = std::move(arcs);
+    definitions.push_back(std::move(definition));
+    return true;
+}
+
+static bool SnmpMibParseText(const std::string& text, std::vector<SnmpMibDefinition>& definitions) {
+    std::vector<std::string> tokens;
+    SnmpMibTokenize(text, tokens);
+
+    std::string module;
+    for (size_t i = 0; i < tokens.size(); i++) {
+        if (tokens[i] == "DEFINITIONS" && i > 0) {
+            module = tokens[i - 1];
+            continue;
+        }
+
+        // name OBJECT IDENTIFIER ::= { ... } или name MACRO ... ::= { ... }
+        bool objectIdentifier = tokens[i] == "OBJECT" && i + 2 < tokens.size()
+            && tokens[i + 1] == "IDENTIFIER" && tokens[i + 2] == "::=";
+        if ((!objectIdentifier && !SnmpMibIsOidMacro(tokens[i])) || i == 0 || !SnmpMibIsValueName(tokens[i - 1])) {
+            continue;
+        }
+
+        const std::string& name = tokens[i - 1];
+        size_t j = i + 1;
+        while (j < tokens.size() && tokens[j] != "::=") {
+            j++;
+        }
+        if (j >= tokens.size()) break;
+        j++;
+
+        if (SnmpMibParseValue(tokens, j, module, name, definitions)) {
+            i = j - 1;
+        }
+    }
+    return true;
+}
+
+bool SnmpMibParseFile(const std::string& path, std::vector<SnmpMibDefinition>& definitions) {
+    std::error_code error;
+    if (std::filesystem::is_directory(path, error)) {
+        // Каталог: все файлы в нём, в порядке имён для воспроизводимого индекса
+        std::vector<std::string> files;
+        for (const auto& entry : std::filesystem::directory_iterator(path, error)) {
+            if (entry.is_regular_file(error)) {
+                files.push_back(entry.path().string());
+            }
+        }
+        std::sort(files.begin(), files.end());
+        for (const std::string& file : files) {
+            if (!SnmpMibParseFile(file, definitions)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Cannot open MIB file: " << path << std::endl;
+        return false;
+    }
+    std::ostringstream text;
+    text << file.rdbuf();
+    return SnmpMibParseText(text.str(), definitions);
+}
+
+struct SnmpMibBuildNode {
+    UINT arc;
+    std::string name;
+    std::string module;
+    std::vector<UINT> children;
+};
+
+static UINT SnmpMibBuildChild(std::vector<SnmpMibBuildNode>& nodes, UINT parent, UINT arc) {
+    for (UINT child : nodes[parent].children) {
+        if (nodes[child].arc == arc) return child;
+    }
+    SnmpMibBuildNode node;
+    node.arc = arc;
+    nodes.push_back(std::move(node));
+    UINT child = (UINT)nodes.size() - 1;
+    nodes[parent].children.push_back(child);
+    return child;
+}
+
+bool SnmpMibBuild(const std::vector<SnmpMibDefinition>& definitions, std::vector<UINT>& image, size_t& unresolved) {
+    // Дерево строится в обычных узлах с векторами детей, затем укладывается в образ
+    std::vector<SnmpMibBuildNode> nodes(1);
+    std::unordered_map<std::string, UINT> byName;
+
+    static const char* roots[] = { "ccitt", "iso", "joint-iso-ccitt" };
+    for (UINT arc = 0; arc < 3; arc++) {
+        UINT node = SnmpMibBuildChild(nodes, 0, arc);
+        nodes[node].name = roots[arc];
+        nodes[node].module = "SNMPv2-SMI";
+        byName[roots[arc]] = node;
+    }
+
+    // Родитель может быть определён позже или в другом файле: повторяем проходы, пока есть успехи
+    std::vector<const SnmpMibDefinition*> pending;
+    for (const SnmpMibDefinition& definition : definitions) {
+        pending.push_back(&definition);
+    }
+    bool progress = true;
+    while (progress && !pending.empty()) {
+        progress = false;
+        std::vector<const SnmpMibDefinition*> next;
+        for (const SnmpMibDefinition* definition : pending) {
+            auto parent = byName.find(definition->parent);
+            if (parent == byName.end()) {
+                next.push_back(definition);
+                continue;
+            }
+
+            UINT node = parent->second;
+            for (UINT arc : definition->arcs) {
+                node = SnmpMibBuildChild(nodes, node, arc);
+            }
+            if (nodes[node].name.empty()) {
+                nodes[node].name = definition->name;
+                nodes[node].module = definition->module;
+            }
+            byName.emplace(definition->name, node);
+            progress = true;
+        }
+        pending.swap(next);
+    }
+    unresolved = pending.size();
+
+    // Укладка в ширину: дети каждого узла получают соседние номера в порядке дуг
+    std::vector<UINT> order(1, 0);
+    std::vector<UINT> position(nodes.size(), 0);
+    for (size_t i = 0; i < order.size(); i++) {
+        std::vector<UINT>& children = nodes[order[i]].children;
+        std::sort(children.begin(), children.end(), [&nodes](UINT a, UINT b) {
+            return nodes[a].arc < nodes[b].arc;
+        });
+        for (UINT child : children) {
+            position[child] = (UINT)order.size();
+            order.push_back(child);
+        }
+    }
+
+    std::string strings(1, '\0');
+    std::unordered_map<std::string, UINT> stringOffsets;
+    auto addString = [&strings, &stringOffsets](const std::string& text) -> UINT {
+        if (text.empty()) return 0;
+        auto found = stringOffsets.find(text);
+        if (found != stringOffsets.end()) return found->second;
+        UINT offset = (UINT)strings.size();
+        strings.append(text);
+        strings.push_back('\0');
+        stringOffsets.emplace(text, offset);
+        return offset;
+    };
+
+    std::vector<SnmpMibNode> packed(order.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        const SnmpMibBuildNode& node = nodes[order[i]];
+        SnmpMibNode& out = packed[i];
+        out.arc = node.arc;
+        out.parent = 0;             // заполняется ниже, когда все узлы уложены
+        out.firstChild = node.children.empty() ? 0 : position[node.children[0]];
+        out.childCount = (UINT)node.children.size();
+        out.name = addString(node.name);
+        out.module = addString(node.module);
+    }
+    for (size_t i = 0; i < order.size(); i++) {
+        for (UINT child : nodes[order[i]].children) {
+            packed[position[child]].parent = (UINT)i;
+        }
+    }
+
+    std::vector<UINT> names;
+    for (UINT i = 0; i < (UINT)packed.size(); i++) {
+        if (packed[i].name != 0) names.push_back(i);
+    }
+    std::sort(names.begin(), names.end(), [&packed, &strings](UINT a, UINT b) {
+        int result = strcmp(&strings[packed[a].name], &strings[packed[b].name]);
+        if (result != 0) return result < 0;
+        return strcmp(&strings[packed[a].module], &strings[packed[b].module]) < 0;
+    });
+
+    SnmpMibHeader header;
+    header.magic = SNMP_MIB_MAGIC;
+    header.version = SNMP_MIB_FORMAT_VERSION;
+    header.nodeCount = (UINT)packed.size();
+    header.nameCount = (UINT)names.size();
+    header.stringsSize = (UINT)strings.size();
+
+    size_t stringWords = (strings.size() + sizeof(UINT) - 1) / sizeof(UINT);
+    image.assign(SNMP_MIB_HEADER_WORDS + packed.size() * SNMP_MIB_NODE_WORDS + names.size() + stringWords, 0);
+    UINT* out = image.data();
+    memcpy(out, &header, sizeof(header));
+    out += SNMP_MIB_HEADER_WORDS;
+    memcpy(out, packed.data(), packed.size() * sizeof(SnmpMibNode));
+    out += packed.size() * SNMP_MIB_NODE_WORDS;
+    memcpy(out, names.data(), names.size() * sizeof(UINT));
+    out += names.size();
+    memcpy(out, strings.data(), strings.size());
+    return true;
+}
+
+bool SnmpMibWriteFile(const std::string& path, const std::vector<UINT>& image) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cerr << "Cannot create MIB index: " << path << std::endl;
+        return false;
+    }
+    file.write((const char*)image.data(), image.size() * sizeof(UINT));
+    if (!file) {
+        std::cerr << "Cannot write MIB index: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Проверка границ образа: после неё разрешение имён не выходит за пределы файла
+static bool SnmpMibSetImage(SnmpMibIndex& index, const UINT* words, size_t wordCount) {
+    if (wordCount < SNMP_MIB_HEADER_WORDS) return false;
+    const SnmpMibHeader* header = (const SnmpMibHeader*)words;
+    if (header->magic != SNMP_MIB_MAGIC || header->version != SNMP_MIB_FORMAT_VERSION
+        || header->nodeCount == 0 || header->stringsSize == 0) {
+        return false;
+    }
+
+    size_t stringWords = ((size_t)header->stringsSize + sizeof(UINT) - 1) / sizeof(UINT);
+    size_t required = SNMP_MIB_HEADER_WORDS + (size_t)header->nodeCount * SNMP_MIB_NODE_WORDS
+        + header->nameCount + stringWords;
+    if (required > wordCount) return false;
+
+    const SnmpMibNode* nodes = (const SnmpMibNode*)(words + SNMP_MIB_HEADER_WORDS);
+    const UINT* names = words + SNMP_MIB_HEADER_WORDS + (size_t)header->nodeCount * SNMP_MIB_NODE_WORDS;
+    const char* strings = (const char*)(names + header->nameCount);
+    if (strings[header->stringsSize - 1] != '\0') return false;
+
+    for (UINT i = 0; i < header->nodeCount; i++) {
+        const SnmpMibNode& node = nodes[i];
+        if (node.parent >= header->nodeCount || node.name >= header->stringsSize
+            || node.module >= header->stringsSize
+            || (size_t)node.firstChild + node.childCount > header->nodeCount) {
+            return false;
+        }
+    }
+    for (UINT i = 0; i < header->nameCount; i++) {
+        if (names[i] >= header->nodeCount) return false;
+    }
+
+    index.nodes = nodes;
+    index.names = names;
+    index.strings = strings;
+    index.nodeCount = header->nodeCount;
+    index.nameCount = header->nameCount;
+    return true;
+}
+
+bool SnmpMibOpen(SnmpMibIndex& index, const std::string& path) {
+    SnmpMibClose(index);
+
+    void* view = NULL;
+    size_t size = 0;
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < (LONGLONG)sizeof(SnmpMibHeader)) {
+        CloseHandle(file);
+        SetLastError(SNMP_MIB_ERROR_FORMAT);
+        return false;
+    }
+    size = (size_t)fileSize.QuadPart;
+
+    // Отображение держит файл открытым само, дескрипторы можно закрыть сразу
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (mapping == NULL) return false;
+    view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (view == NULL) return false;
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        SetLastError(errno);
+        return false;
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size < (off_t)sizeof(SnmpMibHeader)) {
+        close(fd);
+        SetLastError(SNMP_MIB_ERROR_FORMAT);
+        return false;
+    }
+    size = (size_t)fileStat.st_size;
+
+    view = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED) {
+        SetLastError(errno);
+        return false;
+    }
+#endif
+
+    index.view = view;
+    index.viewSize = size;
+    if (!SnmpMibSetImage(index, (const UINT*)view, size / sizeof(UINT))) {
+        SnmpMibClose(index);
+        SetLastError(SNMP_MIB_ERROR_FORMAT);
+        return false;
+    }
+    return true;
+}
+
+bool SnmpMibAttach(SnmpMibIndex& index, std::vector<UINT>&& image) {
+    SnmpMibClose(index);
+    index.storage = std::move(image);
+    if (!SnmpMibSetImage(index, index.storage.data(), index.storage.size())) {
+        SnmpMibClose(index);
+        SetLastError(SNMP_MIB_ERROR_FORMAT);
+        return false;
+    }
+    return true;
+}
+
+void SnmpMibClose(SnmpMibIndex& index) {
+    if (index.view) {
+#ifdef _WIN32
+        UnmapViewOfFile(index.view);
+#else
+        munmap(index.view, index.viewSize);
+#endif
+    }
+    index.view = NULL;
+    index.viewSize = 0;
+    index.storage.clear();
+    index.nodes = NULL;
+    index.names = NULL;
+    index.strings = NULL;
+    index.nodeCount = 0;
+    index.nameCount = 0;
+}
+
+static void SnmpMibAppendArc(std::string& out, UINT arc) {
+    char digits[10];
+    int count = 0;
+    do {
+        digits[count++] = (char)('0' + arc % 10);
+        arc /= 10;
+    } while (arc != 0);
+    while (count > 0) {
+        out.push_back(digits[--count]);
+    }
+}
+
+void SnmpMibResolve(const SnmpMibIndex& index, const UINT* ids, size_t length, std::string& out) {
+    // Спуск от корня; запоминаем последний узел с именем
+    UINT named = 0;
+    size_t namedDepth = 0;
+    UINT node = 0;
+    for (size_t depth = 0; index.nodeCount != 0 && depth < length; depth++) {
+        const SnmpMibNode* first = index.nodes + index.nodes[node].firstChild;
+        const SnmpMibNode* last = first + index.nodes[node].childCount;
+        const SnmpMibNode* child = std::lower_bound(first, last, ids[depth],
+            [](const SnmpMibNode& item, UINT arc) { return item.arc < arc; });
+        if (child == last || child->arc != ids[depth]) break;
+
+        node = (UINT)(child - index.nodes);
+        if (child->name != 0) {
+            named = node;
+            namedDepth = depth + 1;
+        }
+    }
+
+    size_t depth = 0;
+    if (namedDepth != 0) {
+        const SnmpMibNode& item = index.nodes[named];
+        if (item.module != 0) {
+            out.append(index.strings + item.module);
+            out.append("::");
+        }
+        out.append(index.strings + item.name);
+        depth = namedDepth;
+    }
+    for (; depth < length; depth++) {
+        if (depth > 0) out.push_back('.');
+        SnmpMibAppendArc(out, ids[depth]);
+    }
+}
+
+// Сравнение строки индекса с ключом, который не завершён нулём
+static int SnmpMibCompareKey(const char* text, const char* key, size_t keyLength) {
+    int result = strncmp(text, key, keyLength);
+    if (result != 0) return result;
+    return text[keyLength] == '\0' ? 0 : 1;
+}
+
+bool SnmpMibLookup(const SnmpMibIndex& index, const std::string& text, SnmpOid& oid) {
+    if (index.nodeCount == 0) return false;
+
+    // [MODULE::]name[.index]
+    size_t nameStart = 0;
+    size_t separator = text.find("::");
+    if (separator != std::string::npos) {
+        nameStart = separator + 2;
+    }
+    size_t nameEnd = text.find('.', nameStart);
+    if (nameEnd == std::string::npos) nameEnd = text.size();
+    if (nameEnd == nameStart) return false;
+
+    const char* name = text.data() + nameStart;
+    size_t nameLength = nameEnd - nameStart;
+    const UINT* first = std::lower_bound(index.names, index.names + index.nameCount, 0,
+        [&index, name, nameLength](UINT node, int) {
+            return SnmpMibCompareKey(index.strings + index.nodes[node].name, name, nameLength) < 0;
+        });
+
+    // Одно имя может встречаться в нескольких модулях; без модуля берётся первое
+    const UINT* found = NULL;
+    for (const UINT* it = first; it != index.names + index.nameCount; ++it) {
+        const SnmpMibNode& node = index.nodes[*it];
+        if (SnmpMibCompareKey(index.strings + node.name, name, nameLength) != 0) break;
+        if (separator == std::string::npos
+            || SnmpMibCompareKey(index.strings + node.module, text.data(), separator) == 0) {
+            found = it;
+            break;
+        }
+    }
+    if (found == NULL) return false;
+
+    UINT arcs[SNMP_OID_MAX_ARCS];
+    size_t count = 0;
+    for (UINT node = *found; node != 0; node = index.nodes[node].parent) {
+        if (count == SNMP_OID_MAX_ARCS) return false;
+        arcs[count++] = index.nodes[node].arc;
+    }
+    std::reverse(arcs, arcs + count);
+    oid.Assign(arcs, count);
+
+    if (nameEnd < text.size()) {
+        SnmpOid suffix;
+        if (!SnmpOidParse(text.data() + nameEnd, text.size() - nameEnd, suffix)
+            || oid.Length() + suffix.Length() > SNMP_OID_MAX_ARCS) {
+            return false;
+        }
+        for (size_t i = 0; i < suffix.Length(); i++) {
+            oid.Append(suffix[i]);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,82 @@
+﻿#pragma once
+
+#include <string>
+#include <vector>
+#include "snmp_oid.h"
+
+// Индекс по умолчанию: ищется в рабочем каталоге при запуске
+#define SNMP_MIB_DEFAULT_INDEX "manageSNMP.mibidx"
+
+// Файл индекса повреждён, усечён или записан на платформе с другим порядком байт
+#define SNMP_MIB_ERROR_FORMAT 50
+
+#define SNMP_MIB_MAGIC 0x42494D53     // "SMIB"
+#define SNMP_MIB_FORMAT_VERSION 1
+
+// Образ индекса - массив UINT, одинаковый в памяти и в файле:
+// заголовок, узлы дерева, номера именованных узлов по алфавиту, строки имён.
+// Узлы уложены в ширину, поэтому дети узла идут подряд и отсортированы по дуге.
+struct SnmpMibHeader {
+    UINT magic;
+    UINT version;
+    UINT nodeCount;
+    UINT nameCount;
+    UINT stringsSize;             // байт, с завершающими нулями
+};
+
+struct SnmpMibNode {
+    UINT arc;
+    UINT parent;
+    UINT firstChild;
+    UINT childCount;
+    UINT name;                    // смещение в строках, 0 - узел без имени
+    UINT module;
+};
+
+// Загруженный индекс: либо отображение файла в память, либо образ в storage
+struct SnmpMibIndex {
+    const SnmpMibNode* nodes = NULL;
+    const UINT* names = NULL;
+    const char* strings = NULL;
+    UINT nodeCount = 0;
+    UINT nameCount = 0;
+    std::vector<UINT> storage;
+    void* view = NULL;
+    size_t viewSize = 0;
+};
+
+// Определение из MIB: name ::= { parent arcs... }
+struct SnmpMibDefinition {
+    std::string module;
+    std::string name;
+    std::string parent;
+    std::vector<UINT> arcs;
+};
+
+// Определения встроенной части MIB-2 (SNMPv2-MIB, IF-MIB, IP-MIB, TCP/UDP-MIB, HOST-RESOURCES-MIB)
+void SnmpMibBuiltinDefinitions(std::vector<SnmpMibDefinition>& definitions);
+
+// Извлекает из текста MIB (SMIv1/SMIv2) определения OBJECT IDENTIFIER, OBJECT-TYPE,
+// MODULE-IDENTITY и других макросов с присваиванием ::= { ... }. Остальное пропускается.
+bool SnmpMibParseFile(const std::string& path, std::vector<SnmpMibDefinition>& definitions);
+
+// Строит образ индекса. Определения с неизвестным родителем (не загружен MIB,
+// из которого он импортируется) пропускаются, их число возвращается в unresolved.
+bool SnmpMibBuild(const std::vector<SnmpMibDefinition>& definitions, std::vector<UINT>& image, size_t& unresolved);
+
+bool SnmpMibWriteFile(const std::string& path, const std::vector<UINT>& image);
+
+// Отображает файл индекса в память без разбора; проверяются только границы
+bool SnmpMibOpen(SnmpMibIndex& index, const std::string& path);
+
+// Подключает образ, построенный в памяти
+bool SnmpMibAttach(SnmpMibIndex& index, std::vector<UINT>&& image);
+
+void SnmpMibClose(SnmpMibIndex& index);
+
+// Дописывает в out имя OID вида "IF-MIB::ifDescr.3": самый длинный именованный
+// префикс и оставшиеся дуги как индекс. Спуск - бинарный поиск по детям на каждом уровне.
+void SnmpMibResolve(const SnmpMibIndex& index, const UINT* ids, size_t length, std::string& out);
+
+// Обратное преобразование: "ifTable", "IF-MIB::ifTable" или "IF-MIB::ifDescr.3" в OID
+bool SnmpMibLookup(const SnmpMibIndex& index, const std::string& text, SnmpOid& oid);
@@ -0,0 +1,111 @@
+﻿#include "snmp_oid.h"
+
+#include <cstring>
+#include <utility>
+
+void SnmpOid::Reserve(size_t count) {
+    if (count <= capacity) return;
+
+    // Длинный OID сразу получает место под максимальную длину, чтобы Append не перевыделял память
+    size_t newCapacity = count > SNMP_OID_MAX_ARCS ? count : SNMP_OID_MAX_ARCS;
+
+    UINT* arcs = new UINT[newCapacity];
+    memcpy(arcs, Data(), length * sizeof(UINT));
+    if (IsHeap()) delete[] heapArcs;
+
+    heapArcs = arcs;
+    capacity = (UINT)newCapacity;
+}
+
+void SnmpOid::Assign(const UINT* arcs, size_t count) {
+    Reserve(count);
+
+    UINT* data = MutableData();
+    hash = SNMP_OID_HASH_BASIS;
+    for (size_t i = 0; i < count; i++) {
+        data[i] = arcs[i];
+        hash = SnmpOidHashStep(hash, arcs[i]);
+    }
+    length = (UINT)count;
+}
+
+void SnmpOid::Append(UINT arc) {
+    Reserve((size_t)length + 1);
+
+    MutableData()[length++] = arc;
+    hash = SnmpOidHashStep(hash, arc);
+}
+
+void SnmpOid::Truncate(size_t count) {
+    if (count >= length) return;
+
+    const UINT* data = Data();
+    hash = SNMP_OID_HASH_BASIS;
+    for (size_t i = 0; i < count; i++) {
+        hash = SnmpOidHashStep(hash, data[i]);
+    }
+    length = (UINT)count;
+}
+
+void SnmpOid::Swap(SnmpOid& other) noexcept {
+    std::swap(length, other.length);
+    std::swap(capacity, other.capacity);
+    std::swap(hash, other.hash);
+
+    // Хранилище меняем побайтно: в нём либо дуги, либо указатель на кучу
+    unsigned char storage[sizeof(inlineArcs)];
+    memcpy(storage, inlineArcs, sizeof(inlineArcs));
+    memcpy(inlineArcs, other.inlineArcs, sizeof(inlineArcs));
+    memcpy(other.inlineArcs, storage, sizeof(inlineArcs));
+}
+
+std::string SnmpOid::ToString() const {
+    std::string text;
+    text.reserve((size_t)length * 4);
+
+    char digits[10];
+    const UINT* data = Data();
+    for (UINT i = 0; i < length; i++) {
+        if (i > 0) text.push_back('.');
+
+        UINT arc = data[i];
+        int count = 0;
+        do {
+            digits[count++] = (char)('0' + arc % 10);
+            arc /= 10;
+        } while (arc != 0);
+        while (count > 0) {
+            text.push_back(digits[--count]);
+        }
+    }
+    return text;
+}
+
+bool SnmpOidParse(const char* text, size_t textLength, SnmpOid& oid) {
+    UINT arcs[SNMP_OID_MAX_ARCS];
+    size_t count = 0;
+
+    size_t i = 0;
+    while (i < textLength) {
+        if (text[i] == '.') {
+            i++;
+            continue;
+        }
+
+        // Дуга накапливается в 64 битах, переполнение UINT проверяется по ходу
+        unsigned long long arc = 0;
+        size_t start = i;
+        while (i < textLength && text[i] >= '0' && text[i] <= '9') {
+            arc = arc * 10 + (unsigned)(text[i] - '0');
+            if (arc > 0xFFFFFFFFULL) return false;
+            i++;
+        }
+
+        if (i == start || (i < textLength && text[i] != '.')) return false;
+        if (count == SNMP_OID_MAX_ARCS) return false;
+        arcs[count++] = (UINT)arc;
+    }
+
+    oid.Assign(arcs, count);
+    return true;
+}
@@ -0,0 +1,184 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include "snmp_compat.h"
+
+// Сколько дуг OID хранится без выделения памяти: хватает для скаляров и строк
+// большинства таблиц (ifTable, ipNetToMediaTable, bgpPeerTable)
+#define SNMP_OID_INLINE_ARCS 16
+
+// Максимальная длина OID по RFC 2578
+#define SNMP_OID_MAX_ARCS 128
+
+// Лексикографическое сравнение двух последовательностей дуг (-1, 0, 1)
+inline int SnmpOidCompare(const UINT* oid1, size_t length1, const UINT* oid2, size_t length2) {
+    size_t length = length1 < length2 ? length1 : length2;
+    for (size_t i = 0; i < length; i++) {
+        if (oid1[i] != oid2[i]) {
+            return oid1[i] < oid2[i] ? -1 : 1;
+        }
+    }
+    if (length1 == length2) return 0;
+    return length1 < length2 ? -1 : 1;
+}
+
+// Проверка, что OID лежит в поддереве prefix (или совпадает с ним)
+inline bool SnmpOidStartsWith(const UINT* oid, size_t length, const UINT* prefix, size_t prefixLength) {
+    if (length < prefixLength) return false;
+    for (size_t i = 0; i < prefixLength; i++) {
+        if (oid[i] != prefix[i]) return false;
+    }
+    return true;
+}
+
+// Хеш FNV-1a по дугам. Считается по одной дуге, поэтому его можно дополнять при добавлении дуг.
+#define SNMP_OID_HASH_BASIS 0xCBF29CE484222325ULL
+#define SNMP_OID_HASH_PRIME 0x100000001B3ULL
+
+constexpr ULONGLONG SnmpOidHashStep(ULONGLONG hash, UINT arc) {
+    return (hash ^ arc) * SNMP_OID_HASH_PRIME;
+}
+
+// OID, известный на этапе компиляции: constexpr SnmpOidLiteral sysDescr = { 1,3,6,1,2,1,1,1,0 };
+// Хеш вычисляется компилятором, в SnmpOid литерал копируется без разбора строки.
+struct SnmpOidLiteral {
+    UINT arcs[SNMP_OID_INLINE_ARCS] = {};
+    UINT length = 0;
+    ULONGLONG hash = SNMP_OID_HASH_BASIS;
+
+    constexpr SnmpOidLiteral(std::initializer_list<UINT> list) {
+        for (UINT arc : list) {
+            // Выход за SNMP_OID_INLINE_ARCS делает выражение не константным - ошибка компиляции
+            arcs[length++] = arc;
+            hash = SnmpOidHashStep(hash, arc);
+        }
+    }
+};
+
+// OID как значение: до SNMP_OID_INLINE_ARCS дуг хранятся внутри объекта,
+// длиннее - в куче. Хеш поддерживается при каждом изменении, поэтому OID
+// дёшево использовать как ключ unordered_map, а равенство сначала сверяет хеши.
+class SnmpOid {
+public:
+    SnmpOid() : length(0), capacity(SNMP_OID_INLINE_ARCS), hash(SNMP_OID_HASH_BASIS) {}
+
+    SnmpOid(const SnmpOidLiteral& literal)
+        : length(literal.length), capacity(SNMP_OID_INLINE_ARCS), hash(literal.hash) {
+        for (UINT i = 0; i < literal.length; i++) {
+            inlineArcs[i] = literal.arcs[i];
+        }
+    }
+
+    SnmpOid(std::initializer_list<UINT> list) : SnmpOid() {
+        Assign(list.begin(), list.size());
+    }
+
+    SnmpOid(const UINT* arcs, size_t count) : SnmpOid() {
+        Assign(arcs, count);
+    }
+
+    explicit SnmpOid(const AsnObjectIdentifier& oid) : SnmpOid() {
+        Assign(oid.ids, oid.idLength);
+    }
+
+    SnmpOid(const SnmpOid& other) : SnmpOid() {
+        Assign(other.Data(), other.length);
+    }
+
+    SnmpOid(SnmpOid&& other) noexcept : SnmpOid() {
+        Swap(other);
+    }
+
+    SnmpOid& operator=(const SnmpOid& other) {
+        if (this != &other) Assign(other.Data(), other.length);
+        return *this;
+    }
+
+    SnmpOid& operator=(SnmpOid&& other) noexcept {
+        Swap(other);
+        return *this;
+    }
+
+    ~SnmpOid() {
+        if (IsHeap()) delete[] heapArcs;
+    }
+
+    void Assign(const UINT* arcs, size_t count);
+    void Append(UINT arc);
+    void Truncate(size_t count);
+    void Swap(SnmpOid& other) noexcept;
+
+    size_t Length() const { return length; }
+    bool Empty() const { return length == 0; }
+    const UINT* Data() const { return IsHeap() ? heapArcs : inlineArcs; }
+    UINT operator[](size_t index) const { return Data()[index]; }
+    ULONGLONG Hash() const { return hash; }
+
+    // Представление для кодека и snmpapi; действительно, пока OID не изменён
+    AsnObjectIdentifier AsAsn() const {
+        AsnObjectIdentifier oid;
+        oid.idLength = length;
+        oid.ids = const_cast<UINT*>(Data());
+        return oid;
+    }
+
+    bool StartsWith(const SnmpOid& prefix) const {
+        return SnmpOidStartsWith(Data(), length, prefix.Data(), prefix.length);
+    }
+
+    int Compare(const SnmpOid& other) const {
+        return SnmpOidCompare(Data(), length, other.Data(), other.length);
+    }
+
+    std::string ToString() const;
+
+private:
+    bool IsHeap() const { return capacity > SNMP_OID_INLINE_ARCS; }
+    UINT* MutableData() { return IsHeap() ? heapArcs : inlineArcs; }
+    void Reserve(size_t count);
+
+    UINT length;
+    UINT capacity;
+    ULONGLONG hash;
+    union {
+        UINT inlineArcs[SNMP_OID_INLINE_ARCS];
+        UINT* heapArcs;
+    };
+};
+
+inline bool operator==(const SnmpOid& oid1, const SnmpOid& oid2) {
+    return oid1.Hash() == oid2.Hash() && oid1.Compare(oid2) == 0;
+}
+inline bool operator!=(const SnmpOid& oid1, const SnmpOid& oid2) { return !(oid1 == oid2); }
+inline bool operator<(const SnmpOid& oid1, const SnmpOid& oid2) { return oid1.Compare(oid2) < 0; }
+inline bool operator>(const SnmpOid& oid1, const SnmpOid& oid2) { return oid1.Compare(oid2) > 0; }
+inline bool operator<=(const SnmpOid& oid1, const SnmpOid& oid2) { return oid1.Compare(oid2) <= 0; }
+inline bool operator>=(const SnmpOid& oid1, const SnmpOid& oid2) { return oid1.Compare(oid2) >= 0; }
+
+// Сравнение и проверка поддерева для OID из разобранного PDU
+inline int SnmpOidCompare(const AsnObjectIdentifier& oid1, const AsnObjectIdentifier& oid2) {
+    return SnmpOidCompare(oid1.ids, oid1.idLength, oid2.ids, oid2.idLength);
+}
+
+inline bool SnmpOidStartsWith(const AsnObjectIdentifier& oid, const SnmpOid& prefix) {
+    return SnmpOidStartsWith(oid.ids, oid.idLength, prefix.Data(), prefix.Length());
+}
+
+// Разбор строки вида "1.3.6.1.2.1.1.1.0" без istringstream и исключений. Лишние точки
+// пропускаются, как и раньше. Возвращает false на символе, отличном от цифры и точки,
+// на дуге больше 4294967295 и на OID длиннее SNMP_OID_MAX_ARCS.
+bool SnmpOidParse(const char* text, size_t textLength, SnmpOid& oid);
+
+inline bool SnmpOidParse(const std::string& text, SnmpOid& oid) {
+    return SnmpOidParse(text.data(), text.size(), oid);
+}
+
+namespace std {
+template <>
+struct hash<SnmpOid> {
+    size_t operator()(const SnmpOid& oid) const { return (size_t)oid.Hash(); }
+};
+}
@@ -0,0 +1,700 @@
+﻿#include "snmp_poller.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include "snmp_metrics.h"
+#include "snmp_timer.h"
+#include "snmp_udp.h"
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#elif !defined(_WIN32)
+#include <sys/select.h>
+#endif
+
+// Шаг и размер колеса таймеров: оборот около 41 с, период опроса в 60 с - два оборота
+#define SNMP_POLLER_TICK_MS     10
+#define SNMP_POLLER_WHEEL_SLOTS 4096
+
+// Размер буферов сокета: чтобы не терять ответы при всплеске из тысяч запросов
+#define SNMP_POLLER_SOCKET_BUFFER (4 * 1024 * 1024)
+
+// Как часто проверяется флаг остановки, если таймеров долго нет
+#define SNMP_POLLER_STOP_CHECK_MS 200
+
+// Виды таймеров на колесе поллера
+enum SnmpPollTimerKind {
+    SNMP_POLL_TIMER_SLOT,         // таймаут попытки или начало цикла цели
+    SNMP_POLL_TIMER_AGENT         // пополнение корзины агента для ждущих целей
+};
+
+// Состояние опроса одной цели. Пока requestId != 0, запрос в полёте
+// и таймер отсчитывает таймаут попытки, иначе - время следующего цикла.
+struct SnmpPollSlot {
+    size_t index;
+    AsnInteger requestId;
+    AsnInteger sequence;
+    int attempt;
+    int maxAttempts;              // 1 - проба недоступной цели
+    int cyclesDone;
+    bool pending;                 // ждёт в очереди поллера или агента
+    ULONGLONG cycleStart;         // плановое время начала цикла, мс; по нему упорядочены очереди
+    size_t agent;                 // индекс в SnmpPoller::agents
+    std::chrono::steady_clock::time_point firstSent;
+    SOCKET sock;
+    size_t header;                // индекс в SnmpPoller::headers
+    std::vector<RFC1157VarBind> varBinds;
+    SnmpMetricsSeries* metrics;   // NULL - метрики выключены
+    SnmpRtt rtt;
+    SnmpTimer timer;
+};
+
+// Агент (адрес и порт), к которому могут относиться несколько целей.
+// Ограничивает число запросов в полёте и датаграмм в секунду (маркерная корзина).
+struct SnmpPollAgent {
+    int inFlight;
+    double tokens;
+    ULONGLONG refillTime;         // мс, время последнего пополнения корзины
+    std::vector<size_t> waiting;  // цели, ждущие агента: куча по cycleStart
+    SnmpTimer wake;
+};
+
+struct SnmpPoller {
+    SnmpPollTarget* targets;      // общий список целей
+    const size_t* indices;        // номера целей этого потока в общем списке (по слотам)
+    const SnmpPollerOptions* options;
+    const SnmpPollCallback* callback;
+    SnmpPollerStats* stats;
+
+    std::vector<SnmpPollSlot> slots;
+    std::vector<SOCKET> sockets;
+    int slotBits;
+    AsnInteger sequenceLimit;
+    size_t inFlight;
+    size_t active;                // цели, у которых остались циклы
+    std::vector<size_t> pendingHeap;          // ждут из-за maxInFlight: куча по cycleStart
+    std::vector<SnmpPollAgent> agents;
+    std::mt19937 random;
+    std::vector<std::vector<BYTE>> headers;   // version и community в BER, по одному на community
+
+    SnmpTimerWheel wheel;
+    std::vector<BYTE> sendBuffer;
+    std::vector<BYTE> receiveBuffer;
+    SnmpArena arena;
+#ifdef __linux__
+    int epollFd;
+#endif
+};
+
+// Порядок очередей: раньше запланированный (самый просроченный) цикл - первым
+struct SnmpPollLater {
+    const std::vector<SnmpPollSlot>* slots;
+    bool operator()(size_t a, size_t b) const {
+        return (*slots)[a].cycleStart > (*slots)[b].cycleStart;
+    }
+};
+
+static void SnmpPollPush(SnmpPoller& poller, std::vector<size_t>& heap, size_t index) {
+    poller.slots[index].pending = true;
+    heap.push_back(index);
+    std::push_heap(heap.begin(), heap.end(), SnmpPollLater{ &poller.slots });
+}
+
+static SnmpPollSlot& SnmpPollPop(SnmpPoller& poller, std::vector<size_t>& heap) {
+    std::pop_heap(heap.begin(), heap.end(), SnmpPollLater{ &poller.slots });
+    SnmpPollSlot& slot = poller.slots[heap.back()];
+    heap.pop_back();
+    slot.pending = false;
+    return slot;
+}
+
+// Функция пополнения корзины агента к моменту now
+static void SnmpPollRefill(SnmpPoller& poller, SnmpPollAgent& agent, ULONGLONG now) {
+    double rate = poller.options->maxAgentRate;
+    if (rate <= 0 || now <= agent.refillTime) return;
+
+    // Ёмкость - десятая доля секунды трафика: короткий всплеск допустим, залп на весь период - нет
+    double capacity = 1 + rate / 10;
+    agent.tokens += (now - agent.refillTime) * rate / 1000;
+    if (agent.tokens > capacity) agent.tokens = capacity;
+    agent.refillTime = now;
+}
+
+// Можно ли сейчас начать ещё один запрос к агенту
+static bool SnmpPollAgentReady(SnmpPoller& poller, SnmpPollAgent& agent, ULONGLONG now) {
+    const SnmpPollerOptions& options = *poller.options;
+    if (options.maxAgentInFlight > 0 && agent.inFlight >= options.maxAgentInFlight) return false;
+    if (options.maxAgentRate > 0) {
+        SnmpPollRefill(poller, agent, now);
+        if (agent.tokens < 1) return false;
+    }
+    return true;
+}
+
+// Функция планирования пробуждения агента, когда ждущим целям не хватает только маркеров
+static void SnmpPollAgentWake(SnmpPoller& poller, SnmpPollAgent& agent, ULONGLONG now) {
+    const SnmpPollerOptions& options = *poller.options;
+    if (agent.waiting.empty() || options.maxAgentRate <= 0 || agent.tokens >= 1) return;
+    if (options.maxAgentInFlight > 0 && agent.inFlight >= options.maxAgentInFlight) return;
+
+    ULONGLONG delay = (ULONGLONG)((1 - agent.tokens) * 1000 / options.maxAgentRate) + 1;
+    SnmpTimerSchedule(poller.wheel, agent.wake, now + delay);
+}
+
+// Функция отправки (или повторной отправки) запроса цели
+static void SnmpPollSend(SnmpPoller& poller, SnmpPollSlot& slot) {
+    SnmpPollTarget& target = poller.targets[poller.indices[slot.index]];
+
+    SnmpPdu request;
+    request.type = SNMP_PDU_GET;
+    request.requestId = slot.requestId;
+    request.errorStatus = 0;
+    request.errorIndex = 0;
+    request.varBinds.list = slot.varBinds.data();
+    request.varBinds.len = (UINT)slot.varBinds.size();
+
+    const std::vector<BYTE>& header = poller.headers[slot.header];
+    size_t length = BerEncodeMessagePrefixed(header.data(), header.size(), request,
+        poller.sendBuffer.data(), poller.sendBuffer.size());
+
+    // Повторы тоже расходуют маркеры агента (корзина может уйти в минус)
+    if (poller.options->maxAgentRate > 0) {
+        SnmpPollAgent& agent = poller.agents[slot.agent];
+        SnmpPollRefill(poller, agent, GetTickCount64());
+        agent.tokens -= 1;
+    }
+
+    poller.stats->sent++;
+    if (length == 0 || sendto(slot.sock, (const char*)poller.sendBuffer.data(), (int)length, 0,
+        (const sockaddr*)&target.address, target.addressLength) == SOCKET_ERROR) {
+        // Переполненный буфер сокета равносилен потере датаграммы: сработает повтор
+        poller.stats->sendErrors++;
+    }
+    else {
+        SnmpMetricsOnSend(slot.metrics, length, slot.attempt > 1);
+    }
+
+    DWORD timeout = poller.options->adaptiveTimeout ? SnmpRttTimeout(slot.rtt, slot.attempt) : poller.options->timeout;
+    SnmpTimerSchedule(poller.wheel, slot.timer, GetTickCount64() + timeout);
+}
+
+static void SnmpPollReport(SnmpPoller& poller, SnmpPollSlot& slot, const SnmpPdu* response, DWORD error,
+    size_t received);
+
+// Функция отправки первой попытки цикла
+static void SnmpPollLaunch(SnmpPoller& poller, SnmpPollSlot& slot) {
+    // request-id = порядковый номер цикла в старших битах и номер цели в младших,
+    // поэтому поиск ожидающего запроса по ответу не требует хеш-таблицы
+    slot.sequence = slot.sequence + 1 < poller.sequenceLimit ? slot.sequence + 1 : 1;
+    slot.requestId = (AsnInteger)(((unsigned)slot.sequence << poller.slotBits) | (unsigned)slot.index);
+    slot.attempt = 1;
+    slot.firstSent = std::chrono::steady_clock::now();
+    poller.inFlight++;
+    poller.agents[slot.agent].inFlight++;
+
+    SnmpPollSend(poller, slot);
+}
+
+// Функция запуска цели или постановки её в очередь агента либо поллера
+static void SnmpPollDispatch(SnmpPoller& poller, SnmpPollSlot& slot) {
+    SnmpPollAgent& agent = poller.agents[slot.agent];
+    ULONGLONG now = GetTickCount64();
+    if (!SnmpPollAgentReady(poller, agent, now)) {
+        poller.stats->throttled++;
+        SnmpPollPush(poller, agent.waiting, slot.index);
+        SnmpPollAgentWake(poller, agent, now);
+        return;
+    }
+    if (poller.inFlight >= poller.options->maxInFlight) {
+        SnmpPollPush(poller, poller.pendingHeap, slot.index);
+        return;
+    }
+    SnmpPollLaunch(poller, slot);
+}
+
+// Функция запуска ждущих целей агента, пока он это позволяет
+static void SnmpPollDrainAgent(SnmpPoller& poller, SnmpPollAgent& agent) {
+    ULONGLONG now = GetTickCount64();
+    while (!agent.waiting.empty() && SnmpPollAgentReady(poller, agent, now)) {
+        SnmpPollSlot& slot = SnmpPollPop(poller, agent.waiting);
+        if (poller.inFlight >= poller.options->maxInFlight) {
+            SnmpPollPush(poller, poller.pendingHeap, slot.index);
+            continue;
+        }
+        SnmpPollLaunch(poller, slot);
+    }
+    SnmpPollAgentWake(poller, agent, now);
+}
+
+// Функция запуска целей, ждущих места в maxInFlight
+static void SnmpPollDrainPending(SnmpPoller& poller) {
+    while (!poller.pendingHeap.empty() && poller.inFlight < poller.options->maxInFlight) {
+        SnmpPollDispatch(poller, SnmpPollPop(poller, poller.pendingHeap));
+    }
+}
+
+// Функция начала очередного цикла опроса цели
+static void SnmpPollStart(SnmpPoller& poller, SnmpPollSlot& slot) {
+    // Недоступная цель пропускает цикл без запроса, пока не придёт время пробы
+    slot.maxAttempts = poller.options->retries + 1;
+    if (poller.options->adaptiveTimeout) {
+        SnmpRttDecision decision = SnmpRttAdmit(slot.rtt, GetTickCount64());
+        if (decision == SNMP_RTT_SKIP) {
+            poller.stats->skipped++;
+            slot.attempt = 0;
+            slot.firstSent = std::chrono::steady_clock::now();
+            SnmpPollReport(poller, slot, NULL, SNMP_UDP_ERROR_DOWN, 0);
+            return;
+        }
+        if (decision == SNMP_RTT_PROBE) slot.maxAttempts = 1;
+    }
+
+    SnmpPollDispatch(poller, slot);
+}
+
+// Функция выдачи результата цикла и планирования следующего цикла.
+// received - размер датаграммы ответа (для метрик)
+static void SnmpPollReport(SnmpPoller& poller, SnmpPollSlot& slot, const SnmpPdu* response, DWORD error,
+    size_t received) {
+    SnmpPollResult result;
+    result.targetIndex = poller.indices[slot.index];
+    result.target = &poller.targets[result.targetIndex];
+    result.response = response;
+    result.error = error;
+    result.latencyUs = (ULONGLONG)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - slot.firstSent).count();
+    result.attempts = slot.attempt;
+
+    if (response) {
+        if (poller.options->adaptiveTimeout) {
+            // Ответ после повтора не отнести к конкретной отправке - такой замер пропускаем
+            if (slot.attempt == 1) SnmpRttSample(slot.rtt, result.latencyUs / 1000.0);
+            SnmpRttSuccess(slot.rtt);
+        }
+        SnmpMetricsOnResponse(slot.metrics, result.latencyUs, response->errorStatus, received, response->varBinds.len);
+    }
+    else if (error == SNMP_UDP_ERROR_TIMEOUT) {
+        if (poller.options->adaptiveTimeout) SnmpRttFailure(slot.rtt, GetTickCount64());
+        SnmpMetricsOnTimeout(slot.metrics);
+    }
+
+    // Цикл, завершившийся позже начала следующего, пропустил свой срок
+    ULONGLONG now = GetTickCount64();
+    if (error != SNMP_UDP_ERROR_DOWN && now > slot.cycleStart + poller.options->interval) {
+        poller.stats->missedDeadlines++;
+        SnmpMetricsOnMissedDeadline(slot.metrics);
+    }
+
+    slot.requestId = 0;
+    slot.cyclesDone++;
+
+    (*poller.callback)(result);
+
+    if (poller.options->cycles != 0 && slot.cyclesDone >= poller.options->cycles) {
+        poller.active--;
+    }
+    else {
+        // Следующий цикл отсчитывается от планового начала, чтобы период не "уползал"
+        slot.cycleStart += poller.options->interval;
+        now = GetTickCount64();
+        if (slot.cycleStart < now) slot.cycleStart = now;
+        ULONGLONG jitter = poller.options->jitter > 0 ? poller.random() % poller.options->jitter : 0;
+        SnmpTimerSchedule(poller.wheel, slot.timer, slot.cycleStart + jitter);
+    }
+}
+
+// Функция завершения запроса цели: результат, следующий цикл и запуск ожидающих целей
+static void SnmpPollComplete(SnmpPoller& poller, SnmpPollSlot& slot, const SnmpPdu* response, DWORD error,
+    size_t received) {
+    SnmpTimerCancel(poller.wheel, slot.timer);
+    SnmpPollAgent& agent = poller.agents[slot.agent];
+    poller.inFlight--;
+    agent.inFlight--;
+    SnmpPollReport(poller, slot, response, error, received);
+
+    // Освободилось место - запускаем ожидающие цели, самые просроченные первыми
+    SnmpPollDrainAgent(poller, agent);
+    SnmpPollDrainPending(poller);
+}
+
+// Функция обработки сработавшего таймера цели
+static void SnmpPollOnTimer(SnmpPoller& poller, SnmpTimer& timer) {
+    if (timer.kind == SNMP_POLL_TIMER_AGENT) {
+        SnmpPollDrainAgent(poller, *static_cast<SnmpPollAgent*>(timer.owner));
+        return;
+    }
+
+    SnmpPollSlot& slot = *static_cast<SnmpPollSlot*>(timer.owner);
+
+    if (slot.requestId == 0) {
+        SnmpPollStart(poller, slot);
+        return;
+    }
+
+    if (slot.attempt < slot.maxAttempts) {
+        slot.attempt++;
+        poller.stats->retransmits++;
+        SnmpPollSend(poller, slot);
+        return;
+    }
+
+    poller.stats->timeouts++;
+    SnmpPollComplete(poller, slot, NULL, SNMP_UDP_ERROR_TIMEOUT, 0);
+}
+
+// Функция чтения всех накопившихся в сокете ответов
+static void SnmpPollReceive(SnmpPoller& poller, SOCKET sock) {
+    BYTE* buffer = poller.receiveBuffer.data();
+
+    while (true) {
+        sockaddr_storage from;
+        socklen_t fromLength = sizeof(from);
+        int received = recvfrom(sock, (char*)buffer, (int)poller.receiveBuffer.size(), 0,
+            (sockaddr*)&from, &fromLength);
+        if (received == SOCKET_ERROR) {
+            int error = WSAGetLastError();
+            if (error == WSAECONNRESET) continue;
+            return;
+        }
+
+        SnmpArenaReset(poller.arena);
+
+        SnmpMessage message;
+        if (!BerDecodeMessage(buffer, received, poller.arena, message) || message.pdu.type != SNMP_PDU_RESPONSE) {
+            poller.stats->unmatched++;
+            continue;
+        }
+
+        size_t index = (size_t)((unsigned)message.pdu.requestId & ((1u << poller.slotBits) - 1));
+        if (index >= poller.slots.size()) {
+            poller.stats->unmatched++;
+            continue;
+        }
+
+        SnmpPollSlot& slot = poller.slots[index];
+        if (slot.requestId == 0 || slot.requestId != message.pdu.requestId
+            || !SnmpUdpSameAddress(from, poller.targets[poller.indices[index]].address)) {
+            poller.stats->unmatched++;
+            continue;
+        }
+
+        poller.stats->responses++;
+        SnmpPollComplete(poller, slot, &message.pdu, 0, (size_t)received);
+    }
+}
+
+// Ключ агента: семейство, порт и адрес
+static std::string SnmpPollAgentKey(const sockaddr_storage& address) {
+    if (address.ss_family == AF_INET6) {
+        const sockaddr_in6& a6 = (const sockaddr_in6&)address;
+        return std::string("6") + std::string((const char*)&a6.sin6_port, sizeof(a6.sin6_port))
+            + std::string((const char*)&a6.sin6_addr, sizeof(a6.sin6_addr));
+    }
+    const sockaddr_in& a4 = (const sockaddr_in&)address;
+    return std::string("4") + std::string((const char*)&a4.sin_port, sizeof(a4.sin_port))
+        + std::string((const char*)&a4.sin_addr, sizeof(a4.sin_addr));
+}
+
+// Фаза цели внутри периода: FNV-1a от имени и номера цели
+static ULONGLONG SnmpPollPhase(const std::string& hostname, size_t index) {
+    ULONGLONG hash = 14695981039346656037ULL;
+    for (char c : hostname) {
+        hash = (hash ^ (BYTE)c) * 1099511628211ULL;
+    }
+    for (size_t i = 0; i < sizeof(index); i++) {
+        hash = (hash ^ (BYTE)(index >> (i * 8))) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Функция создания сокета для заданного семейства адресов
+static SOCKET SnmpPollOpenSocket(int family) {
+    SOCKET sock = socket(family, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock == INVALID_SOCKET) {
+        SetLastError(WSAGetLastError());
+        return INVALID_SOCKET;
+    }
+
+    int bufferSize = SNMP_POLLER_SOCKET_BUFFER;
+    setsockopt(sock, SOL_SOCKET, SO_RCVBUF, (const char*)&bufferSize, sizeof(bufferSize));
+    setsockopt(sock, SOL_SOCKET, SO_SNDBUF, (const char*)&bufferSize, sizeof(bufferSize));
+
+    if (!SnmpUdpSetNonBlocking(sock)) {
+        SetLastError(WSAGetLastError());
+        closesocket(sock);
+        return INVALID_SOCKET;
+    }
+
+    return sock;
+}
+
+// Функция ожидания входящих датаграмм не дольше timeoutMs (-1 - без ограничения)
+static bool SnmpPollWait(SnmpPoller& poller, int timeoutMs) {
+#ifdef __linux__
+    epoll_event events[16];
+    int ready = epoll_wait(poller.epollFd, events, 16, timeoutMs);
+    if (ready < 0) {
+        if (errno == EINTR) return true;
+        SetLastError(errno);
+        return false;
+    }
+    for (int i = 0; i < ready; i++) {
+        SnmpPollReceive(poller, (SOCKET)events[i].data.fd);
+    }
+    return true;
+#else
+    // Сокетов всего несколько, поэтому для остальных систем достаточно select
+    fd_set readSet;
+    FD_ZERO(&readSet);
+    SOCKET maxSocket = 0;
+    for (SOCKET sock : poller.sockets) {
+        FD_SET(sock, &readSet);
+        if (sock > maxSocket) maxSocket = sock;
+    }
+
+    timeval tv;
+    tv.tv_sec = timeoutMs < 0 ? 1 : timeoutMs / 1000;
+    tv.tv_usec = timeoutMs < 0 ? 0 : (timeoutMs % 1000) * 1000;
+
+    int ready = select((int)maxSocket + 1, &readSet, NULL, NULL, &tv);
+    if (ready == SOCKET_ERROR) {
+        SetLastError(WSAGetLastError());
+        return false;
+    }
+    for (SOCKET sock : poller.sockets) {
+        if (FD_ISSET(sock, &readSet)) {
+            SnmpPollReceive(poller, sock);
+        }
+    }
+    return true;
+#endif
+}
+
+static void SnmpPollCloseSockets(SnmpPoller& poller) {
+    for (SOCKET sock : poller.sockets) {
+        closesocket(sock);
+    }
+    poller.sockets.clear();
+#ifdef __linux__
+    if (poller.epollFd >= 0) {
+        close(poller.epollFd);
+        poller.epollFd = -1;
+    }
+#endif
+}
+
+// Функция опроса части целей в своём цикле событий (со своими сокетами и колесом таймеров)
+static bool SnmpPollerRunShard(SnmpPollTarget* targets, const std::vector<size_t>& indices,
+    const SnmpPollerOptions& options, const SnmpPollCallback& callback, SnmpPollerStats& stats) {
+    size_t count = indices.size();
+    SnmpPoller poller;
+    poller.targets = targets;
+    poller.indices = indices.data();
+    poller.options = &options;
+    poller.callback = &callback;
+    poller.stats = &stats;
+    poller.inFlight = 0;
+    poller.active = count;
+    poller.sendBuffer.resize(SNMP_UDP_MAX_DATAGRAM);
+    poller.receiveBuffer.resize(SNMP_UDP_MAX_DATAGRAM);
+
+    // Номер цели занимает младшие биты request-id, остальные (до 31) - номер цикла
+    poller.slotBits = 1;
+    while (((size_t)1 << poller.slotBits) < count) poller.slotBits++;
+    if (poller.slotBits > 24) {
+        SetLastError(ERROR_INVALID_PARAMETER);
+        return false;
+    }
+    poller.sequenceLimit = (AsnInteger)(1u << (31 - poller.slotBits));
+
+#ifdef __linux__
+    poller.epollFd = epoll_create1(0);
+    if (poller.epollFd < 0) {
+        SetLastError(errno);
+        return false;
+    }
+#endif
+
+    // По socketCount сокетов на каждое встретившееся семейство адресов
+    int socketCount = options.socketCount > 0 ? options.socketCount : 1;
+    std::vector<SOCKET> sockets4, sockets6;
+    for (size_t i = 0; i < count; i++) {
+        const SnmpPollTarget& target = targets[indices[i]];
+        std::vector<SOCKET>& familySockets = target.address.ss_family == AF_INET6 ? sockets6 : sockets4;
+        if (!familySockets.empty()) continue;
+
+        for (int s = 0; s < socketCount; s++) {
+            SOCKET sock = SnmpPollOpenSocket(target.address.ss_family);
+            if (sock == INVALID_SOCKET) {
+                SnmpPollCloseSockets(poller);
+                return false;
+            }
+            poller.sockets.push_back(sock);
+            familySockets.push_back(sock);
+
+#ifdef __linux__
+            epoll_event event = {};
+            event.events = EPOLLIN;
+            event.data.fd = sock;
+            if (epoll_ctl(poller.epollFd, EPOLL_CTL_ADD, sock, &event) < 0) {
+                SetLastError(errno);
+                SnmpPollCloseSockets(poller);
+                return false;
+            }
+#endif
+        }
+    }
+
+    ULONGLONG now = GetTickCount64();
+    SnmpTimerWheelInit(poller.wheel, SNMP_POLLER_TICK_MS, SNMP_POLLER_WHEEL_SLOTS, now);
+
+    // Случайный начальный номер цикла, чтобы не принять ответ предыдущего запуска
+    std::random_device random;
+    std::mt19937 generator(random());
+    poller.random.seed(random());
+
+    // Цели с одним адресом и портом - один агент. Массив агентов больше не растёт:
+    // на их таймеры ссылается колесо.
+    std::unordered_map<std::string, size_t> agentIndex;
+    std::vector<size_t> slotAgents(count);
+    for (size_t i = 0; i < count; i++) {
+        auto inserted = agentIndex.emplace(SnmpPollAgentKey(targets[indices[i]].address), agentIndex.size());
+        slotAgents[i] = inserted.first->second;
+    }
+    poller.agents.resize(agentIndex.size());
+    for (SnmpPollAgent& agent : poller.agents) {
+        agent.inFlight = 0;
+        agent.tokens = 1;
+        agent.refillTime = now;
+        agent.wake.owner = &agent;
+        agent.wake.kind = SNMP_POLL_TIMER_AGENT;
+    }
+
+    // Начало сообщения кодируется один раз на community, а не при каждой отправке
+    std::unordered_map<std::string, size_t> headerIndex;
+    BYTE header[SNMP_UDP_DEFAULT_MESSAGE_SIZE];
+
+    poller.slots.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        SnmpPollSlot& slot = poller.slots[i];
+        SnmpPollTarget& target = targets[indices[i]];
+        slot.index = i;
+        slot.requestId = 0;
+        slot.sequence = (AsnInteger)(generator() % (unsigned)poller.sequenceLimit);
+        slot.attempt = 0;
+        slot.maxAttempts = options.retries + 1;
+        slot.cyclesDone = 0;
+        SnmpRttInit(slot.rtt, options.timeout);
+        slot.pending = false;
+        slot.cycleStart = now;
+        slot.timer.owner = &slot;
+        slot.timer.kind = SNMP_POLL_TIMER_SLOT;
+        slot.agent = slotAgents[i];
+        slot.metrics = SnmpMetricsSeriesFor(target.hostname, SNMP_PDU_GET);
+
+        std::vector<SOCKET>& familySockets = target.address.ss_family == AF_INET6 ? sockets6 : sockets4;
+        slot.sock = familySockets[i % familySockets.size()];
+
+        auto inserted = headerIndex.emplace(target.community, poller.headers.size());
+        if (inserted.second) {
+            size_t length = BerEncodeMessageHeader(options.version, target.community.data(), target.community.size(),
+                header, sizeof(header));
+            poller.headers.emplace_back(header, header + length);
+        }
+        slot.header = inserted.first->second;
+
+        slot.varBinds.resize(target.oids.size());
+        for (size_t j = 0; j < target.oids.size(); j++) {
+            RFC1157VarBind& varBind = slot.varBinds[j];
+            varBind.name = target.oids[j].AsAsn();
+            varBind.value.asnType = ASN_NULL;
+        }
+
+        // Без разнесения все цели стартуют сразу. С разнесением каждая получает постоянную
+        // фазу внутри периода (от имени цели, поэтому после перезапуска она та же).
+        if (options.spread && options.interval > 0) {
+            slot.cycleStart = now + SnmpPollPhase(target.hostname, indices[i]) % options.interval;
+            SnmpTimerSchedule(poller.wheel, slot.timer, slot.cycleStart);
+        }
+        else {
+            SnmpPollStart(poller, slot);
+        }
+    }
+
+    bool success = true;
+    while (poller.active > 0 && !(options.stop && options.stop->load())) {
+        now = GetTickCount64();
+        // С флагом остановки ждём не дольше SNMP_POLLER_STOP_CHECK_MS, чтобы заметить его вовремя
+        int timeout = SnmpTimerWheelTimeout(poller.wheel, now);
+        if (options.stop && (timeout < 0 || timeout > SNMP_POLLER_STOP_CHECK_MS)) timeout = SNMP_POLLER_STOP_CHECK_MS;
+        if (!SnmpPollWait(poller, timeout)) {
+            success = false;
+            break;
+        }
+
+        SnmpTimerWheelAdvance(poller.wheel, GetTickCount64(), [&poller](SnmpTimer& timer) {
+            SnmpPollOnTimer(poller, timer);
+        });
+    }
+
+    SnmpPollCloseSockets(poller);
+    return success;
+}
+
+bool SnmpPollerRun(std::vector<SnmpPollTarget>& targets, const SnmpPollerOptions& options,
+    const SnmpPollCallback& callback, SnmpPollerStats& stats) {
+    if (targets.empty()) return true;
+
+    size_t threads = options.threads > 0 ? (size_t)options.threads : std::thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+    if (threads > targets.size()) threads = targets.size();
+    if (threads == 1) {
+        std::vector<size_t> indices(targets.size());
+        for (size_t i = 0; i < indices.size(); i++) indices[i] = i;
+        return SnmpPollerRunShard(targets.data(), indices, options, callback, stats);
+    }
+
+    // Цели делятся по агентам (хеш адреса и порта): все цели агента в одном потоке, поэтому
+    // ограничения maxAgentInFlight и maxAgentRate действуют на агента целиком, а результаты
+    // каждой цели идут по порядку
+    std::vector<std::vector<size_t>> shards(threads);
+    std::hash<std::string> hasher;
+    for (size_t i = 0; i < targets.size(); i++) {
+        shards[hasher(SnmpPollAgentKey(targets[i].address)) % threads].push_back(i);
+    }
+
+    std::vector<SnmpPollerStats> shardStats(threads);
+    std::vector<char> shardSuccess(threads, 1);
+    std::vector<DWORD> shardError(threads, 0);
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < threads; i++) {
+        if (shards[i].empty()) continue;
+        workers.emplace_back([&, i]() {
+            shardSuccess[i] = SnmpPollerRunShard(targets.data(), shards[i], options, callback, shardStats[i]);
+            if (!shardSuccess[i]) shardError[i] = GetLastError();
+        });
+    }
+    for (std::thread& worker : workers) worker.join();
+
+    bool success = true;
+    for (size_t i = 0; i < threads; i++) {
+        stats.sent += shardStats[i].sent;
+        stats.retransmits += shardStats[i].retransmits;
+        stats.responses += shardStats[i].responses;
+        stats.timeouts += shardStats[i].timeouts;
+        stats.sendErrors += shardStats[i].sendErrors;
+        stats.skipped += shardStats[i].skipped;
+        stats.unmatched += shardStats[i].unmatched;
+        stats.missedDeadlines += shardStats[i].missedDeadlines;
+        stats.throttled += shardStats[i].throttled;
+        if (!shardSuccess[i] && success) {
+            success = false;
+            SetLastError(shardError[i]);
+        }
+    }
+    return success;
+}
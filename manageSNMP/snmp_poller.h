@@ -0,0 +1,72 @@
+﻿#pragma once
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
+#include "snmp_ber.h"
+#include "snmp_oid.h"
+#include "snmp_rtt.h"
+
+// Цель опроса: агент и набор OID, которые запрашиваются одним GET
+struct SnmpPollTarget {
+    std::string hostname;
+    std::string community;
+    std::vector<SnmpOid> oids;
+    sockaddr_storage address;
+    int addressLength;
+};
+
+struct SnmpPollerOptions {
+    DWORD timeout = 5000;         // таймаут одной попытки, мс (при adaptiveTimeout - его предел)
+    int retries = 2;
+    bool adaptiveTimeout = true;  // таймаут по времени ответа каждой цели, недоступные цели пропускаются
+    DWORD interval = 60000;       // период опроса каждой цели, мс
+    int cycles = 0;               // число циклов опроса, 0 - без ограничения
+    bool spread = false;          // разнести первые запросы целей по периоду, а не отправлять разом
+    DWORD jitter = 0;             // случайная добавка к началу каждого цикла, мс
+    int socketCount = 1;          // сокетов на семейство адресов (в каждом потоке)
+    int threads = 1;              // потоков опроса, 0 - по числу ядер
+    size_t maxInFlight = 4096;    // ограничение одновременно ожидающих ответа запросов
+    // Ограничения агента действуют при любом threads: все цели агента опрашивает один поток
+    int maxAgentInFlight = 0;     // запросов в полёте к одному агенту (адрес и порт), 0 - без ограничения
+    double maxAgentRate = 0;      // датаграмм в секунду к одному агенту, с повторами; 0 - без ограничения
+    const std::atomic<bool>* stop = NULL;     // установленный флаг прерывает опрос
+    AsnInteger version = SNMP_VERSION_V2C;
+};
+
+// Результат одного опроса. response == NULL, если ответа не было (error содержит код).
+// Ответ ссылается на буфер приёма поллера и действителен только внутри обработчика.
+struct SnmpPollResult {
+    const SnmpPollTarget* target;
+    size_t targetIndex;
+    const SnmpPdu* response;
+    DWORD error;
+    ULONGLONG latencyUs;          // от первой отправки до ответа
+    int attempts;
+};
+
+struct SnmpPollerStats {
+    unsigned long long sent = 0;          // отправлено датаграмм (с повторами)
+    unsigned long long retransmits = 0;
+    unsigned long long responses = 0;
+    unsigned long long timeouts = 0;
+    unsigned long long sendErrors = 0;
+    unsigned long long skipped = 0;       // циклы недоступных целей без запроса (SNMP_UDP_ERROR_DOWN)
+    unsigned long long unmatched = 0;     // ответы без ожидающего запроса (поздние, чужие, битые)
+    unsigned long long missedDeadlines = 0;   // циклы, завершившиеся позже начала следующего
+    unsigned long long throttled = 0;     // циклы, отложенные ограничениями агента
+};
+
+typedef std::function<void(const SnmpPollResult& result)> SnmpPollCallback;
+
+// Опрашивает все цели через несколько общих неблокирующих сокетов.
+// Запросы всех целей находятся в полёте одновременно и сопоставляются с ответами
+// по request-id; повторы, таймауты и следующий цикл опроса ведёт колесо таймеров.
+// При options.threads > 1 цели делятся между потоками по агентам (все цели одного адреса
+// и порта - в одном потоке), у каждого потока свои сокеты и цикл событий; обработчик тогда
+// вызывается из разных потоков одновременно, но для одной цели - всегда из одного и по порядку
+// циклов. Цели, ждущие ограничений maxInFlight и агента,
+// запускаются в порядке планового начала цикла: сначала самые просроченные. Возвращает управление после options.cycles циклов по каждой цели.
+bool SnmpPollerRun(std::vector<SnmpPollTarget>& targets, const SnmpPollerOptions& options,
+    const SnmpPollCallback& callback, SnmpPollerStats& stats);
@@ -0,0 +1,497 @@
+﻿#include "snmp_pwalk.h"
+#include "snmp_metrics.h"
+
+#include <cstring>
+#include <deque>
+#include <memory>
+
+#ifndef _WIN32
+#include <sys/select.h>
+#endif
+
+// Сколько пробных varbind отправляется в одном GETBULK при поиске ветвей
+#define SNMP_PWALK_PROBE_BATCH 16
+
+// Диапазонов больше, чем курсоров, чтобы неравные ветви не задерживали обход
+#define SNMP_PWALK_RANGES_PER_STREAM 4
+
+// Глубина спуска через единственную ветвь (таблица -> запись -> колонки)
+#define SNMP_PWALK_MAX_DESCENT 8
+
+// Первый OID найденной ветви поддерева
+struct SnmpWalkChild {
+    UINT arc;
+    RFC1157VarBind first;
+};
+
+// Диапазон одного курсора: ветви prefix от первой ветви диапазона до endArc
+// (не включая), последний диапазон открыт справа. Собранные varbind хранятся в арене диапазона
+// до тех пор, пока все предыдущие диапазоны не будут выданы.
+struct SnmpWalkRange {
+    UINT endArc;
+    bool lastRange;
+    SnmpOid lastOid;
+    std::vector<RFC1157VarBind> items;
+    SnmpArena arena;
+    UINT maxRepetitions;
+    AsnInteger requestId;         // 0 - запроса в полёте нет
+    int attempt;
+    bool probe;                   // запрос - проба недоступного агента: без повторов
+    ULONGLONG deadline;
+    ULONGLONG firstSent;          // время первой отправки текущего запроса, мкс
+    SnmpMetricsSeries* metrics;
+    bool done;
+};
+
+// Функция для копирования varbind (имя и значение) в арену
+static bool SnmpWalkCopyVarBind(SnmpArena& arena, const RFC1157VarBind& source, RFC1157VarBind& destination) {
+    UINT* ids = SnmpArenaAllocArray<UINT>(arena, source.name.idLength ? source.name.idLength : 1);
+    if (!ids) return false;
+    memcpy(ids, source.name.ids, source.name.idLength * sizeof(UINT));
+    destination.name.idLength = source.name.idLength;
+    destination.name.ids = ids;
+    return SnmpCopyValue(arena, source.value, destination.value);
+}
+
+// Функция поиска ветвей поддерева prefix. Каждый пробный varbind prefix.c.4294967295
+// в GETBULK с non-repeaters возвращает первый OID первой ветви после c, поэтому
+// за один запрос находится до SNMP_PWALK_PROBE_BATCH ветвей подряд.
+// complete = true, если найдены все ветви, а не первые maxChildren.
+static bool SnmpWalkProbe(SnmpUdpSession& session, const SnmpOid& prefix, size_t maxChildren,
+    SnmpArena& arena, std::vector<SnmpWalkChild>& children, bool& complete) {
+    children.clear();
+    complete = false;
+
+    std::vector<SnmpOid> probes;
+    std::vector<RFC1157VarBind> requestList;
+
+    while (children.size() < maxChildren) {
+        probes.clear();
+        if (children.empty()) {
+            probes.push_back(prefix);
+        }
+        else {
+            UINT lastArc = children.back().arc;
+            for (UINT i = 0; i < SNMP_PWALK_PROBE_BATCH && lastArc + i >= lastArc; i++) {
+                probes.push_back(prefix);
+                probes.back().Append(lastArc + i);
+                probes.back().Append(0xFFFFFFFF);
+            }
+        }
+
+        requestList.resize(probes.size());
+        for (size_t i = 0; i < probes.size(); i++) {
+            requestList[i].name = probes[i].AsAsn();
+            requestList[i].value.asnType = ASN_NULL;
+        }
+
+        SnmpPdu request;
+        request.type = SNMP_PDU_GETBULK;
+        request.errorStatus = (AsnInteger)probes.size();  // non-repeaters: все varbind как GETNEXT
+        request.errorIndex = 0;                           // max-repetitions
+        request.varBinds.list = requestList.data();
+        request.varBinds.len = (UINT)requestList.size();
+
+        SnmpPdu response;
+        if (!SnmpUdpRequest(session, request, response)) {
+            return false;
+        }
+        if (response.errorStatus != SNMP_ERRORSTATUS_NOERROR) {
+            SetLastError(SNMP_UDP_ERROR_AGENT);
+            return false;
+        }
+
+        // Если ответ на последнюю пробу уже вне поддерева - ветвей больше нет
+        complete = response.varBinds.len < probes.size();
+        for (UINT i = 0; i < response.varBinds.len; i++) {
+            RFC1157VarBind& varBind = response.varBinds.list[i];
+            if (varBind.value.asnType == SNMP_EXCEPTION_ENDOFMIBVIEW
+                || varBind.name.idLength <= prefix.Length() || !SnmpOidStartsWith(varBind.name, prefix)) {
+                complete = true;
+                continue;
+            }
+
+            UINT arc = varBind.name.ids[prefix.Length()];
+            if (children.empty() || arc > children.back().arc) {
+                SnmpWalkChild child;
+                child.arc = arc;
+                if (!SnmpWalkCopyVarBind(arena, varBind, child.first)) {
+                    SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+                    return false;
+                }
+                children.push_back(child);
+            }
+        }
+
+        if (complete || children.empty()) {
+            complete = true;
+            break;
+        }
+    }
+
+    return true;
+}
+
+// Функция отправки (или повтора) очередного GETBULK курсора
+static bool SnmpWalkSend(SnmpUdpSession& session, SnmpWalkRange& range) {
+    if (range.requestId == 0) {
+        range.requestId = session.nextRequestId;
+        session.nextRequestId = (session.nextRequestId + 1) & 0x7FFFFFFF;
+        if (session.nextRequestId == 0) session.nextRequestId = 1;
+        range.attempt = 1;
+        range.probe = false;
+        range.firstSent = SnmpMetricsNowUs();
+    }
+
+    // Недоступному агенту - только проба в одну попытку, как в SnmpUdpRequest
+    if (session.adaptiveTimeout) {
+        SnmpRttDecision decision = SnmpRttAdmit(session.rtt, GetTickCount64());
+        if (decision == SNMP_RTT_SKIP) {
+            SetLastError(SNMP_UDP_ERROR_DOWN);
+            return false;
+        }
+        if (decision == SNMP_RTT_PROBE) range.probe = true;
+    }
+
+    RFC1157VarBind requestVarBind;
+    requestVarBind.name = range.lastOid.AsAsn();
+    requestVarBind.value.asnType = ASN_NULL;
+
+    SnmpPdu request;
+    request.type = SNMP_PDU_GETBULK;
+    request.requestId = range.requestId;
+    request.errorStatus = 0;                                  // non-repeaters
+    request.errorIndex = (AsnInteger)range.maxRepetitions;    // max-repetitions
+    request.varBinds.list = &requestVarBind;
+    request.varBinds.len = 1;
+
+    size_t length = SnmpUdpEncode(session, SNMP_VERSION_V2C, request);
+    if (length == 0) {
+        SetLastError(ERROR_INVALID_PARAMETER);
+        return false;
+    }
+
+    session.requestCount++;
+    range.deadline = GetTickCount64()
+        + (session.adaptiveTimeout ? SnmpRttTimeout(session.rtt, range.attempt) : session.timeout);
+
+    int sent = sendto(session.sock, (const char*)session.sendBuffer.data(), (int)length, 0,
+        (const sockaddr*)&session.address, session.addressLength);
+    if (sent == SOCKET_ERROR) {
+        SetLastError(WSAGetLastError());
+        return false;
+    }
+    SnmpMetricsOnSend(range.metrics, length, range.attempt > 1);
+    return true;
+}
+
+// Функция обработки ответа курсору: сохраняет varbind своего диапазона
+// и отправляет следующий запрос, пока диапазон не закончится
+static bool SnmpWalkOnResponse(SnmpUdpSession& session, const SnmpOid& prefix,
+    SnmpWalkRange& range, SnmpPdu& response) {
+    range.requestId = 0;
+
+    if (response.errorStatus == SNMP_ERRORSTATUS_TOOBIG && range.maxRepetitions > 1) {
+        range.maxRepetitions /= 2;
+        return SnmpWalkSend(session, range);
+    }
+    if (response.errorStatus != SNMP_ERRORSTATUS_NOERROR) {
+        SetLastError(SNMP_UDP_ERROR_AGENT);
+        return false;
+    }
+
+    if (response.varBinds.len == 0) {
+        range.done = true;
+    }
+
+    AsnObjectIdentifier lastOid = range.lastOid.AsAsn();
+
+    for (UINT i = 0; i < response.varBinds.len; i++) {
+        RFC1157VarBind& varBind = response.varBinds.list[i];
+
+        // Граница диапазона - как граница поддерева в обычном обходе
+        if (varBind.value.asnType == SNMP_EXCEPTION_ENDOFMIBVIEW
+            || varBind.name.idLength <= prefix.Length() || !SnmpOidStartsWith(varBind.name, prefix)
+            || (!range.lastRange && varBind.name.ids[prefix.Length()] >= range.endArc)
+            || SnmpOidCompare(varBind.name, lastOid) <= 0) {
+            range.done = true;
+            break;
+        }
+
+        RFC1157VarBind item;
+        if (!SnmpWalkCopyVarBind(range.arena, varBind, item)) {
+            SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+            return false;
+        }
+        range.items.push_back(item);
+        lastOid = item.name;
+    }
+
+    if (range.done) return true;
+
+    range.lastOid.Assign(lastOid.ids, lastOid.idLength);
+    return SnmpWalkSend(session, range);
+}
+
+bool SnmpWalk(SnmpUdpSession& session, const SnmpOid& baseOid, const SnmpWalkCallback& onVarBind) {
+    // Последний OID хранится в SnmpOid: для обычных длин без выделения памяти
+    SnmpOid lastOid = baseOid;
+
+    RFC1157VarBind requestVarBind;
+    requestVarBind.value.asnType = ASN_NULL;
+
+    SnmpPdu request;
+    request.type = SNMP_PDU_GETNEXT;
+    request.errorStatus = 0;
+    request.errorIndex = 0;
+    request.varBinds.list = &requestVarBind;
+    request.varBinds.len = 1;
+
+    while (true) {
+        requestVarBind.name = lastOid.AsAsn();
+
+        SnmpPdu response;
+        if (!SnmpUdpRequest(session, request, response)) {
+            return false;
+        }
+        if (response.errorStatus == SNMP_ERRORSTATUS_NOSUCHNAME) {
+            return true;
+        }
+        if (response.errorStatus != SNMP_ERRORSTATUS_NOERROR) {
+            SetLastError(SNMP_UDP_ERROR_AGENT);
+            return false;
+        }
+        if (response.varBinds.len == 0) {
+            return true;
+        }
+
+        // OID должен остаться в поддереве, а обход - продвигаться вперёд
+        RFC1157VarBind& varBind = response.varBinds.list[0];
+        if (varBind.value.asnType == SNMP_EXCEPTION_ENDOFMIBVIEW || !SnmpOidStartsWith(varBind.name, baseOid)
+            || SnmpOidCompare(varBind.name, requestVarBind.name) <= 0) {
+            return true;
+        }
+
+        onVarBind(varBind);
+        lastOid.Assign(varBind.name.ids, varBind.name.idLength);
+    }
+}
+
+bool SnmpBulkWalk(SnmpUdpSession& session, const SnmpOid& baseOid, UINT maxRepetitions,
+    const SnmpWalkCallback& onVarBind) {
+    if (maxRepetitions == 0) maxRepetitions = 1;
+    SnmpOid lastOid = baseOid;
+
+    while (true) {
+        RFC1157VarBind requestVarBind;
+        requestVarBind.name = lastOid.AsAsn();
+        requestVarBind.value.asnType = ASN_NULL;
+
+        SnmpPdu request;
+        request.type = SNMP_PDU_GETBULK;
+        request.errorStatus = 0;                          // non-repeaters
+        request.errorIndex = (AsnInteger)maxRepetitions;  // max-repetitions
+        request.varBinds.list = &requestVarBind;
+        request.varBinds.len = 1;
+
+        SnmpPdu response;
+        if (!SnmpUdpRequest(session, request, response)) {
+            return false;
+        }
+
+        if (response.errorStatus == SNMP_ERRORSTATUS_TOOBIG && maxRepetitions > 1) {
+            maxRepetitions /= 2;
+            continue;
+        }
+        if (response.errorStatus != SNMP_ERRORSTATUS_NOERROR) {
+            SetLastError(SNMP_UDP_ERROR_AGENT);
+            return false;
+        }
+        if (response.varBinds.len == 0) {
+            return true;
+        }
+
+        AsnObjectIdentifier previousOid = requestVarBind.name;
+        for (UINT i = 0; i < response.varBinds.len; i++) {
+            RFC1157VarBind& varBind = response.varBinds.list[i];
+
+            // Хвост пачки за пределами поддерева и конец MIB - конец обхода
+            if (varBind.value.asnType == SNMP_EXCEPTION_ENDOFMIBVIEW || !SnmpOidStartsWith(varBind.name, baseOid)
+                || SnmpOidCompare(varBind.name, previousOid) <= 0) {
+                return true;
+            }
+
+            onVarBind(varBind);
+            previousOid = varBind.name;
+        }
+
+        lastOid.Assign(previousOid.ids, previousOid.idLength);
+    }
+}
+
+bool SnmpParallelWalk(SnmpUdpSession& session, const SnmpOid& baseOid,
+    UINT streams, UINT maxRepetitions, const SnmpWalkCallback& onVarBind) {
+    if (streams == 0) streams = 1;
+    if (maxRepetitions == 0) maxRepetitions = 1;
+
+    // Спускаемся через единственные ветви до уровня, где поддерево разветвляется
+    SnmpOid prefix = baseOid;
+    SnmpArena probeArena;
+    std::vector<SnmpWalkChild> children;
+    bool complete = false;
+
+    for (int depth = 0; depth < SNMP_PWALK_MAX_DESCENT; depth++) {
+        SnmpArenaReset(probeArena);
+        if (!SnmpWalkProbe(session, prefix, (size_t)streams * SNMP_PWALK_RANGES_PER_STREAM,
+            probeArena, children, complete)) {
+            return false;
+        }
+        if (children.empty()) {
+            return true;
+        }
+        if (!complete || children.size() > 1 || children[0].first.name.idLength <= prefix.Length() + 1) {
+            break;
+        }
+        prefix.Append(children[0].arc);
+    }
+
+    // Диапазон каждого курсора начинается с уже полученного пробой первого OID ветви
+    std::vector<std::unique_ptr<SnmpWalkRange>> ranges;
+    SnmpMetricsSeries* metrics = SnmpMetricsSeriesFor(session.target, SNMP_PDU_GETBULK);
+    for (size_t i = 0; i < children.size(); i++) {
+        std::unique_ptr<SnmpWalkRange> range(new SnmpWalkRange());
+        range->lastRange = i + 1 == children.size();
+        range->endArc = range->lastRange ? 0 : children[i + 1].arc;
+        range->maxRepetitions = maxRepetitions;
+        range->requestId = 0;
+        range->attempt = 0;
+        range->probe = false;
+        range->deadline = 0;
+        range->firstSent = 0;
+        range->metrics = metrics;
+        range->done = false;
+
+        RFC1157VarBind item;
+        if (!SnmpWalkCopyVarBind(range->arena, children[i].first, item)) {
+            SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+            return false;
+        }
+        range->items.push_back(item);
+        range->lastOid.Assign(item.name.ids, item.name.idLength);
+        ranges.push_back(std::move(range));
+    }
+
+    std::deque<SnmpWalkRange*> waiting;
+    for (std::unique_ptr<SnmpWalkRange>& range : ranges) {
+        waiting.push_back(range.get());
+    }
+
+    std::vector<SnmpWalkRange*> inFlight;
+    size_t flushed = 0;
+    BYTE* buffer = session.receiveBuffer.data();
+
+    while (true) {
+        // Завершённые диапазоны убираем из полёта и запускаем следующие
+        for (size_t i = 0; i < inFlight.size();) {
+            if (inFlight[i]->done) {
+                inFlight[i] = inFlight.back();
+                inFlight.pop_back();
+            }
+            else {
+                i++;
+            }
+        }
+        while (inFlight.size() < streams && !waiting.empty()) {
+            SnmpWalkRange* range = waiting.front();
+            waiting.pop_front();
+            if (!SnmpWalkSend(session, *range)) return false;
+            inFlight.push_back(range);
+        }
+
+        // Выдаём готовые диапазоны строго по порядку ветвей
+        while (flushed < ranges.size() && ranges[flushed]->done) {
+            for (RFC1157VarBind& item : ranges[flushed]->items) {
+                onVarBind(item);
+            }
+            ranges[flushed]->items = std::vector<RFC1157VarBind>();
+            SnmpArenaRelease(ranges[flushed]->arena);
+            flushed++;
+        }
+
+        if (inFlight.empty()) break;
+
+        ULONGLONG now = GetTickCount64();
+        ULONGLONG deadline = inFlight[0]->deadline;
+        for (SnmpWalkRange* range : inFlight) {
+            if (range->deadline < deadline) deadline = range->deadline;
+        }
+
+        ULONGLONG remaining = deadline > now ? deadline - now : 0;
+        timeval tv;
+        tv.tv_sec = (long)(remaining / 1000);
+        tv.tv_usec = (long)((remaining % 1000) * 1000);
+
+        fd_set readSet;
+        FD_ZERO(&readSet);
+        FD_SET(session.sock, &readSet);
+
+        int ready = select((int)session.sock + 1, &readSet, NULL, NULL, &tv);
+        if (ready == SOCKET_ERROR) {
+            SetLastError(WSAGetLastError());
+            return false;
+        }
+
+        while (ready > 0) {
+            sockaddr_storage from;
+            socklen_t fromLength = sizeof(from);
+            int received = recvfrom(session.sock, (char*)buffer, (int)session.receiveBuffer.size(), 0,
+                (sockaddr*)&from, &fromLength);
+            if (received == SOCKET_ERROR) {
+                if (WSAGetLastError() == WSAECONNRESET) continue;
+                break;
+            }
+            if (!SnmpUdpSameAddress(from, session.address)) {
+                continue;
+            }
+
+            SnmpArenaReset(session.arena);
+
+            SnmpMessage message;
+            if (!BerDecodeMessage(buffer, received, session.arena, message)
+                || message.pdu.type != SNMP_PDU_RESPONSE) {
+                continue;
+            }
+
+            for (SnmpWalkRange* range : inFlight) {
+                if (range->requestId != 0 && range->requestId == message.pdu.requestId) {
+                    ULONGLONG latencyUs = SnmpMetricsNowUs() - range->firstSent;
+                    if (session.adaptiveTimeout) {
+                        if (range->attempt == 1) SnmpRttSample(session.rtt, latencyUs / 1000.0);
+                        SnmpRttSuccess(session.rtt);
+                    }
+                    SnmpMetricsOnResponse(metrics, latencyUs, message.pdu.errorStatus, received,
+                        message.pdu.varBinds.len);
+                    if (!SnmpWalkOnResponse(session, prefix, *range, message.pdu)) return false;
+                    break;
+                }
+            }
+        }
+
+        // Повторы и таймауты
+        now = GetTickCount64();
+        for (SnmpWalkRange* range : inFlight) {
+            if (range->done || range->requestId == 0 || range->deadline > now) continue;
+
+            if (range->attempt > session.retries || range->probe) {
+                if (session.adaptiveTimeout) SnmpRttFailure(session.rtt, now);
+                SnmpMetricsOnTimeout(metrics);
+                SetLastError(SNMP_UDP_ERROR_TIMEOUT);
+                return false;
+            }
+            range->attempt++;
+            if (!SnmpWalkSend(session, *range)) return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,26 @@
+﻿#pragma once
+
+#include <functional>
+#include <vector>
+#include "snmp_oid.h"
+#include "snmp_udp.h"
+
+// Обработчик очередного varbind обхода. Varbind действителен только внутри вызова.
+typedef std::function<void(RFC1157VarBind& varBind)> SnmpWalkCallback;
+
+// Обход поддерева запросами GETNEXT (для агентов SNMPv1). Ошибка noSuchName - конец MIB
+// в SNMPv1, обход завершается успешно; другая ошибка агента - false и SNMP_UDP_ERROR_AGENT.
+bool SnmpWalk(SnmpUdpSession& session, const SnmpOid& baseOid, const SnmpWalkCallback& onVarBind);
+
+// Обход поддерева одним курсором GETBULK (только SNMPv2c): по maxRepetitions OID за запрос,
+// при tooBig пачка уменьшается вдвое. Ошибка агента - false и SNMP_UDP_ERROR_AGENT.
+bool SnmpBulkWalk(SnmpUdpSession& session, const SnmpOid& baseOid, UINT maxRepetitions,
+    const SnmpWalkCallback& onVarBind);
+
+// Обход поддерева несколькими одновременными курсорами GETBULK (только SNMPv2c).
+// Дочерние ветви поддерева (например, колонки таблицы) находятся пробными GETBULK,
+// затем каждый диапазон ветвей обходится своим курсором, до streams запросов в полёте.
+// Результаты выдаются в onVarBind в лексикографическом порядке, как при обычном обходе.
+// Недоступному агенту (session.rtt) запросы не отправляются: false и SNMP_UDP_ERROR_DOWN.
+bool SnmpParallelWalk(SnmpUdpSession& session, const SnmpOid& baseOid,
+    UINT streams, UINT maxRepetitions, const SnmpWalkCallback& onVarBind);
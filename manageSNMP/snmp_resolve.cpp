@@ -0,0 +1,130 @@
+﻿#include "snmp_resolve.h"
+
+#include <atomic>
+#include <thread>
+#include "snmp_udp.h"
+
+SnmpResolveCache& SnmpResolveGlobalCache() {
+    static SnmpResolveCache cache;
+    return cache;
+}
+
+// Функция разрешения имени мимо кэша с записью результата
+static void SnmpResolveFill(const std::string& target, SnmpResolveEntry& entry) {
+    if (SnmpUdpResolve(target, entry.address, entry.addressLength)) {
+        entry.error = 0;
+    }
+    else {
+        entry.error = GetLastError();
+        // getaddrinfo может вернуть 0 как код EAI_*, а 0 здесь означает успех
+        if (entry.error == 0) entry.error = ERROR_INVALID_PARAMETER;
+    }
+}
+
+// Функция для сохранения результата разрешения в кэш
+static void SnmpResolveStore(SnmpResolveCache& cache, const std::string& target, SnmpResolveEntry& entry,
+    ULONGLONG now) {
+    entry.expiresAt = now + (entry.error == 0 ? cache.ttl : cache.negativeTtl);
+    cache.entries[target] = entry;
+}
+
+bool SnmpResolveCached(SnmpResolveCache& cache, const std::string& target, sockaddr_storage& address,
+    int& addressLength) {
+    ULONGLONG now = GetTickCount64();
+    SnmpResolveEntry entry;
+    {
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        auto it = cache.entries.find(target);
+        if (it != cache.entries.end() && it->second.expiresAt > now) {
+            cache.hits++;
+            entry = it->second;
+        }
+        else {
+            cache.misses++;
+        }
+    }
+
+    // Разрешение идёт без блокировки: DNS-запрос может длиться секунды
+    if (entry.expiresAt == 0) {
+        SnmpResolveFill(target, entry);
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        SnmpResolveStore(cache, target, entry, now);
+    }
+
+    if (entry.error != 0) {
+        SetLastError(entry.error);
+        return false;
+    }
+    address = entry.address;
+    addressLength = entry.addressLength;
+    return true;
+}
+
+size_t SnmpResolveAll(SnmpResolveCache& cache, const std::vector<std::string>& targets,
+    std::vector<SnmpResolveEntry>& results, int threads) {
+    results.assign(targets.size(), SnmpResolveEntry());
+
+    // Имена, которых нет в кэше, без повторов; для каждой цели - номер её имени
+    std::vector<const std::string*> missing;
+    std::vector<size_t> missingIndex(targets.size(), (size_t)-1);
+    ULONGLONG now = GetTickCount64();
+    {
+        std::unordered_map<std::string, size_t> seen;
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        for (size_t i = 0; i < targets.size(); i++) {
+            auto it = cache.entries.find(targets[i]);
+            if (it != cache.entries.end() && it->second.expiresAt > now) {
+                cache.hits++;
+                results[i] = it->second;
+                continue;
+            }
+
+            auto inserted = seen.emplace(targets[i], missing.size());
+            if (inserted.second) {
+                cache.misses++;
+                missing.push_back(&targets[i]);
+            }
+            missingIndex[i] = inserted.first->second;
+        }
+    }
+
+    if (!missing.empty()) {
+        std::vector<SnmpResolveEntry> resolved(missing.size());
+        std::atomic<size_t> next(0);
+        auto worker = [&]() {
+            for (size_t i = next++; i < missing.size(); i = next++) {
+                SnmpResolveFill(*missing[i], resolved[i]);
+            }
+        };
+
+        size_t threadCount = threads > 1 ? (size_t)threads : 1;
+        if (threadCount > missing.size()) threadCount = missing.size();
+        std::vector<std::thread> pool;
+        for (size_t i = 1; i < threadCount; i++) {
+            pool.emplace_back(worker);
+        }
+        worker();
+        for (std::thread& thread : pool) {
+            thread.join();
+        }
+
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        for (size_t i = 0; i < missing.size(); i++) {
+            SnmpResolveStore(cache, *missing[i], resolved[i], now);
+        }
+        for (size_t i = 0; i < targets.size(); i++) {
+            if (missingIndex[i] != (size_t)-1) results[i] = resolved[missingIndex[i]];
+        }
+    }
+
+    size_t count = 0;
+    for (const SnmpResolveEntry& entry : results) {
+        if (entry.error == 0) count++;
+    }
+    return count;
+}
+
+void SnmpResolveClear(SnmpResolveCache& cache) {
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    cache.entries.clear();
+}
@@ -0,0 +1,47 @@
+﻿#pragma once
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "snmp_compat.h"
+
+// Время жизни разрешённого адреса и неудачного разрешения, мс
+#define SNMP_RESOLVE_TTL 300000
+#define SNMP_RESOLVE_NEGATIVE_TTL 30000
+
+// Потоков для параллельного разрешения: getaddrinfo блокируется на время DNS-запроса
+#define SNMP_RESOLVE_THREADS 16
+
+// Адрес агента (или код ошибки разрешения) со временем истечения
+struct SnmpResolveEntry {
+    sockaddr_storage address;
+    int addressLength = 0;
+    DWORD error = 0;              // 0 - адрес разрешён
+    ULONGLONG expiresAt = 0;
+};
+
+// Кэш разрешения имён агентов с TTL; потокобезопасен
+struct SnmpResolveCache {
+    std::mutex mutex;
+    std::unordered_map<std::string, SnmpResolveEntry> entries;
+    DWORD ttl = SNMP_RESOLVE_TTL;
+    DWORD negativeTtl = SNMP_RESOLVE_NEGATIVE_TTL;
+    unsigned long long hits = 0;
+    unsigned long long misses = 0;
+};
+
+// Общий кэш процесса
+SnmpResolveCache& SnmpResolveGlobalCache();
+
+// Разрешает адрес агента ("host", "host:port", "[ipv6]:port") через кэш
+bool SnmpResolveCached(SnmpResolveCache& cache, const std::string& target, sockaddr_storage& address,
+    int& addressLength);
+
+// Разрешает все адреса: повторяющиеся имена - один раз, отсутствующие в кэше - параллельно
+// на threads потоках. results[i] соответствует targets[i]. Возвращает число разрешённых.
+size_t SnmpResolveAll(SnmpResolveCache& cache, const std::vector<std::string>& targets,
+    std::vector<SnmpResolveEntry>& results, int threads = SNMP_RESOLVE_THREADS);
+
+// Удаляет все записи (например, после смены адресов в DNS)
+void SnmpResolveClear(SnmpResolveCache& cache);
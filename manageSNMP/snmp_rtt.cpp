@@ -0,0 +1,60 @@
+﻿#include "snmp_rtt.h"
+
+void SnmpRttInit(SnmpRtt& rtt, DWORD maxTimeout) {
+    rtt = SnmpRtt();
+    rtt.maxTimeout = maxTimeout > SNMP_RTT_MIN_TIMEOUT ? maxTimeout : SNMP_RTT_MIN_TIMEOUT;
+    if (rtt.timeout > rtt.maxTimeout) rtt.timeout = rtt.maxTimeout;
+}
+
+DWORD SnmpRttTimeout(const SnmpRtt& rtt, int attempt) {
+    ULONGLONG timeout = rtt.timeout;
+    for (int i = 1; i < attempt && timeout < rtt.maxTimeout; i++) {
+        timeout *= 2;
+    }
+    return timeout < rtt.maxTimeout ? (DWORD)timeout : rtt.maxTimeout;
+}
+
+void SnmpRttSample(SnmpRtt& rtt, double rttMs) {
+    // RFC 6298, п. 2.2-2.3: alpha = 1/8, beta = 1/4
+    if (!rtt.measured) {
+        rtt.srtt = rttMs;
+        rtt.rttvar = rttMs / 2;
+        rtt.measured = true;
+    }
+    else {
+        double error = rtt.srtt > rttMs ? rtt.srtt - rttMs : rttMs - rtt.srtt;
+        rtt.rttvar = 0.75 * rtt.rttvar + 0.25 * error;
+        rtt.srtt = 0.875 * rtt.srtt + 0.125 * rttMs;
+    }
+
+    double timeout = rtt.srtt + 4 * rtt.rttvar;
+    if (timeout < SNMP_RTT_MIN_TIMEOUT) timeout = SNMP_RTT_MIN_TIMEOUT;
+    if (timeout > rtt.maxTimeout) timeout = rtt.maxTimeout;
+    rtt.timeout = (DWORD)(timeout + 0.5);
+}
+
+SnmpRttDecision SnmpRttAdmit(const SnmpRtt& rtt, ULONGLONG nowMs) {
+    if (!rtt.down) return SNMP_RTT_SEND;
+    return nowMs >= rtt.probeAt ? SNMP_RTT_PROBE : SNMP_RTT_SKIP;
+}
+
+void SnmpRttSuccess(SnmpRtt& rtt) {
+    rtt.failures = 0;
+    rtt.down = false;
+    rtt.probeInterval = SNMP_RTT_PROBE_INTERVAL;
+}
+
+void SnmpRttFailure(SnmpRtt& rtt, ULONGLONG nowMs) {
+    if (rtt.down) {
+        // Неудачная проба: следующая - через вдвое больший интервал
+        rtt.probeInterval = rtt.probeInterval * 2 < SNMP_RTT_MAX_PROBE_INTERVAL
+            ? rtt.probeInterval * 2 : SNMP_RTT_MAX_PROBE_INTERVAL;
+        rtt.probeAt = nowMs + rtt.probeInterval;
+        return;
+    }
+
+    if (++rtt.failures >= SNMP_RTT_FAILURE_THRESHOLD) {
+        rtt.down = true;
+        rtt.probeAt = nowMs + rtt.probeInterval;
+    }
+}
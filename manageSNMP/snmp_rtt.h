@@ -0,0 +1,55 @@
+﻿#pragma once
+
+#include "snmp_compat.h"
+
+// Таймаут до первого замера (RFC 6298, п. 2.1)
+#define SNMP_RTT_INITIAL_TIMEOUT 1000
+
+// Нижняя граница таймаута, мс: ответы в локальной сети приходят за доли миллисекунды,
+// а минимум TCP в 1 с задерживал бы повтор после единственной потери
+#define SNMP_RTT_MIN_TIMEOUT 100
+
+// Сколько запросов подряд должны остаться без ответа (после всех повторов),
+// чтобы агент считался недоступным
+#define SNMP_RTT_FAILURE_THRESHOLD 2
+
+// Пауза перед первой пробой недоступного агента; после каждой неудачной пробы удваивается
+#define SNMP_RTT_PROBE_INTERVAL 5000
+#define SNMP_RTT_MAX_PROBE_INTERVAL 300000
+
+// Оценка времени ответа агента (SRTT/RTTVAR, как в TCP) и автомат отключения недоступного агента
+struct SnmpRtt {
+    bool measured = false;
+    double srtt = 0;              // сглаженное время ответа, мс
+    double rttvar = 0;            // его разброс, мс
+    DWORD timeout = SNMP_RTT_INITIAL_TIMEOUT;   // таймаут первой попытки
+    DWORD maxTimeout = 5000;      // предел таймаута с учётом удвоений
+
+    int failures = 0;             // запросов подряд без ответа
+    bool down = false;            // агент недоступен: запросы не отправляются до успешной пробы
+    ULONGLONG probeAt = 0;        // время следующей пробы
+    DWORD probeInterval = SNMP_RTT_PROBE_INTERVAL;
+};
+
+// Решение о запросе к агенту
+enum SnmpRttDecision {
+    SNMP_RTT_SEND,                // обычный запрос с повторами
+    SNMP_RTT_PROBE,               // агент недоступен, но пора проверить: одна попытка без повторов
+    SNMP_RTT_SKIP                 // агент недоступен: не отправлять
+};
+
+// Сброс оценки; maxTimeout - предел таймаута попытки (таймаут, заданный пользователем)
+void SnmpRttInit(SnmpRtt& rtt, DWORD maxTimeout);
+
+// Таймаут попытки attempt (с 1): RTO, удваивающийся с каждой попыткой, не больше maxTimeout
+DWORD SnmpRttTimeout(const SnmpRtt& rtt, int attempt);
+
+// Замер времени ответа. Только для ответов на первую попытку (алгоритм Карна):
+// ответ после повтора нельзя отнести ни к одной из отправок.
+void SnmpRttSample(SnmpRtt& rtt, double rttMs);
+
+SnmpRttDecision SnmpRttAdmit(const SnmpRtt& rtt, ULONGLONG nowMs);
+
+// Исход запроса: агент ответил (хоть с ошибкой) или не ответил ни на одну попытку
+void SnmpRttSuccess(SnmpRtt& rtt);
+void SnmpRttFailure(SnmpRtt& rtt, ULONGLONG nowMs);
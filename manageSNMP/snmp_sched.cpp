@@ -0,0 +1,126 @@
+﻿#include "snmp_sched.h"
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include "snmp_session.h"
+
+// Очередь групп потока: владелец берёт с конца, остальные забирают с начала
+struct SnmpWorkQueue {
+    std::mutex mutex;
+    std::deque<size_t> groups;
+};
+
+// Функция взятия группы из своей очереди
+static bool SnmpWorkPop(SnmpWorkQueue& queue, size_t& group) {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.groups.empty()) return false;
+    group = queue.groups.back();
+    queue.groups.pop_back();
+    return true;
+}
+
+// Функция для того, чтобы забрать группу из чужой очереди
+static bool SnmpWorkSteal(SnmpWorkQueue& queue, size_t& group) {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.groups.empty()) return false;
+    group = queue.groups.front();
+    queue.groups.pop_front();
+    return true;
+}
+
+bool SnmpSchedulerRun(const std::vector<SnmpWalkJob>& jobs, const SnmpSchedulerOptions& options,
+    const SnmpJobVarBindCallback& onVarBind, const SnmpJobDoneCallback& onDone, SnmpSchedulerStats& stats) {
+    if (jobs.empty()) return true;
+
+    // Группы заданий по агенту (адрес и community) в порядке первого появления
+    std::vector<std::vector<size_t>> groups;
+    std::unordered_map<std::string, size_t> groupIndex;
+    for (size_t i = 0; i < jobs.size(); i++) {
+        auto inserted = groupIndex.emplace(jobs[i].hostname + '\n' + jobs[i].community, groups.size());
+        if (inserted.second) groups.emplace_back();
+        groups[inserted.first->second].push_back(i);
+    }
+
+    size_t threads = options.threads > 0 ? (size_t)options.threads : std::thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+    if (threads > groups.size()) threads = groups.size();
+
+    // Адреса разрешаются заранее и параллельно; пулы потоков берут их из кэша
+    std::vector<std::string> hostnames;
+    for (const std::vector<size_t>& group : groups) {
+        hostnames.push_back(jobs[group.front()].hostname);
+    }
+    std::vector<SnmpResolveEntry> resolved;
+    SnmpResolveAll(SnmpResolveGlobalCache(), hostnames, resolved);
+
+    // Владелец берёт группы по порядку списка, забирают у него - с конца списка
+    std::vector<SnmpWorkQueue> queues(threads);
+    for (size_t i = 0; i < groups.size(); i++) {
+        queues[i % threads].groups.push_front(i);
+    }
+
+    std::atomic<unsigned long long> failures(0), varBinds(0), steals(0);
+    auto worker = [&](size_t self) {
+        SnmpSessionPool pool;
+        SnmpPoolInit(pool, options.timeout, options.retries, SNMP_VERSION_V2C);
+
+        size_t group = 0;
+        while (true) {
+            if (!SnmpWorkPop(queues[self], group)) {
+                // Своя очередь пуста - обходим чужие, начиная со следующего потока
+                size_t victim = 1;
+                for (; victim < threads; victim++) {
+                    if (SnmpWorkSteal(queues[(self + victim) % threads], group)) break;
+                }
+                // Новые группы не появляются: все очереди пусты - работа закончена
+                if (victim == threads) break;
+                steals++;
+            }
+
+            const SnmpWalkJob& first = jobs[groups[group].front()];
+            size_t agent = SnmpPoolAdd(pool, std::vector<std::string>(1, first.hostname), first.community);
+
+            for (size_t job : groups[group]) {
+                SnmpWalkJobResult result;
+                result.job = job;
+                result.worker = (int)self;
+                result.count = 0;
+                result.error = 0;
+
+                UINT maxRepetitions = jobs[job].maxRepetitions > 0 ? jobs[job].maxRepetitions : options.maxRepetitions;
+                SnmpUdpSession* session = SnmpPoolAcquire(pool, agent);
+                result.success = session != NULL && SnmpBulkWalk(*session, jobs[job].baseOid, maxRepetitions,
+                    [&](RFC1157VarBind& varBind) {
+                        result.count++;
+                        onVarBind((int)self, job, varBind);
+                    });
+                if (!result.success) {
+                    result.error = GetLastError();
+                    failures++;
+                }
+                varBinds += result.count;
+                onDone(result);
+            }
+        }
+
+        SnmpPoolClose(pool);
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < threads; i++) {
+        workers.emplace_back(worker, i);
+    }
+    worker(0);
+    for (std::thread& thread : workers) {
+        thread.join();
+    }
+
+    stats.jobs += jobs.size();
+    stats.failures += failures;
+    stats.varBinds += varBinds;
+    stats.steals += steals;
+    return true;
+}
@@ -0,0 +1,50 @@
+﻿#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+#include "snmp_oid.h"
+#include "snmp_pwalk.h"
+
+// Задание обхода: поддерево одного агента
+struct SnmpWalkJob {
+    std::string hostname;
+    std::string community;
+    SnmpOid baseOid;
+    UINT maxRepetitions = 0;      // 0 - из SnmpSchedulerOptions
+};
+
+struct SnmpSchedulerOptions {
+    int threads = 0;              // рабочих потоков, 0 - по числу ядер
+    DWORD timeout = 5000;         // таймаут попытки (предел адаптивного таймаута)
+    int retries = 2;
+    UINT maxRepetitions = 25;
+};
+
+// Итог задания. count - выданные varbind (при ошибке - сколько успело прийти).
+struct SnmpWalkJobResult {
+    size_t job;
+    int worker;
+    size_t count;
+    bool success;
+    DWORD error;
+};
+
+struct SnmpSchedulerStats {
+    unsigned long long jobs = 0;
+    unsigned long long failures = 0;
+    unsigned long long varBinds = 0;
+    unsigned long long steals = 0;        // групп заданий, выполненных не своим потоком
+};
+
+// Обработчики вызываются из рабочих потоков одновременно. worker - номер потока (с 0),
+// например для отдельного буфера вывода на поток. Varbind действителен только внутри вызова.
+typedef std::function<void(int worker, size_t job, RFC1157VarBind& varBind)> SnmpJobVarBindCallback;
+typedef std::function<void(const SnmpWalkJobResult& result)> SnmpJobDoneCallback;
+
+// Выполняет обходы GETBULK (SNMPv2c) на нескольких потоках, у каждого свой сокет (SnmpSessionPool).
+// Задания одного агента объединяются в группу и идут в одном потоке в порядке списка, поэтому
+// вывод по агенту детерминирован. Группы сначала делятся между потоками поровну; поток,
+// у которого группы кончились, забирает ещё не начатые группы из начала очереди другого потока.
+bool SnmpSchedulerRun(const std::vector<SnmpWalkJob>& jobs, const SnmpSchedulerOptions& options,
+    const SnmpJobVarBindCallback& onVarBind, const SnmpJobDoneCallback& onDone, SnmpSchedulerStats& stats);
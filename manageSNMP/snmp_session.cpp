@@ -0,0 +1,93 @@
+﻿#include "snmp_session.h"
+
+void SnmpPoolInit(SnmpSessionPool& pool, DWORD timeout, int retries, AsnInteger version,
+    SnmpResolveCache* resolver) {
+    pool.resolver = resolver ? resolver : &SnmpResolveGlobalCache();
+    pool.timeout = timeout;
+    pool.retries = retries;
+    pool.version = version;
+    pool.agents.clear();
+    for (SnmpUdpSession& session : pool.sessions) {
+        session.sock = INVALID_SOCKET;
+    }
+    pool.bound = 0;
+    pool.boundSession = NULL;
+}
+
+size_t SnmpPoolAdd(SnmpSessionPool& pool, const std::vector<std::string>& targets, const std::string& community) {
+    std::vector<SnmpResolveEntry> resolved;
+    SnmpResolveAll(*pool.resolver, targets, resolved);
+
+    // У всех агентов одно community - кодируем начало сообщения один раз
+    BYTE header[SNMP_UDP_DEFAULT_MESSAGE_SIZE];
+    size_t headerLength = BerEncodeMessageHeader(pool.version, community.data(), community.size(),
+        header, sizeof(header));
+
+    size_t first = pool.agents.size();
+    pool.agents.resize(first + targets.size());
+    for (size_t i = 0; i < targets.size(); i++) {
+        SnmpPoolAgent& agent = pool.agents[first + i];
+        agent.target = targets[i];
+        agent.community = community;
+        agent.header.assign(header, header + headerLength);
+        agent.address = resolved[i].address;
+        agent.addressLength = resolved[i].addressLength;
+        agent.error = resolved[i].error;
+        SnmpRttInit(agent.rtt, pool.timeout);
+    }
+    return first;
+}
+
+// Функция обмена состоянием агента и сессии. Строки и массивы меняются местами без копирования.
+static void SnmpPoolSwap(SnmpPoolAgent& agent, SnmpUdpSession& session) {
+    std::swap(agent.target, session.target);
+    std::swap(agent.community, session.community);
+    std::swap(agent.header, session.header);
+    std::swap(agent.rtt, session.rtt);
+    std::swap(agent.maxMessageSize, session.maxMessageSize);
+    std::swap(agent.maxVarBinds, session.maxVarBinds);
+}
+
+SnmpUdpSession* SnmpPoolAcquire(SnmpSessionPool& pool, size_t index) {
+    if (pool.boundSession && pool.bound == index) return pool.boundSession;
+    SnmpPoolRelease(pool);
+
+    if (index >= pool.agents.size()) {
+        SetLastError(ERROR_INVALID_PARAMETER);
+        return NULL;
+    }
+    SnmpPoolAgent& agent = pool.agents[index];
+    if (agent.error != 0) {
+        SetLastError(agent.error);
+        return NULL;
+    }
+
+    SnmpUdpSession& session = pool.sessions[agent.address.ss_family == AF_INET6 ? 1 : 0];
+    if (session.sock == INVALID_SOCKET) {
+        if (!SnmpUdpOpenAddress(session, agent.target, agent.address, agent.addressLength, agent.community,
+            pool.timeout, pool.retries, pool.version)) {
+            return NULL;
+        }
+    }
+
+    session.address = agent.address;
+    session.addressLength = agent.addressLength;
+    SnmpPoolSwap(agent, session);
+    pool.bound = index;
+    pool.boundSession = &session;
+    return &session;
+}
+
+void SnmpPoolRelease(SnmpSessionPool& pool) {
+    if (!pool.boundSession) return;
+
+    SnmpPoolSwap(pool.agents[pool.bound], *pool.boundSession);
+    pool.boundSession = NULL;
+}
+
+void SnmpPoolClose(SnmpSessionPool& pool) {
+    SnmpPoolRelease(pool);
+    for (SnmpUdpSession& session : pool.sessions) {
+        SnmpUdpClose(session);
+    }
+}
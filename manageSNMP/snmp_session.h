@@ -0,0 +1,51 @@
+﻿#pragma once
+
+#include <string>
+#include <vector>
+#include "snmp_resolve.h"
+#include "snmp_udp.h"
+
+// Агент пула: всё состояние сессии, кроме сокета, буферов и арены
+struct SnmpPoolAgent {
+    std::string target;
+    std::string community;
+    std::vector<BYTE> header;
+    sockaddr_storage address;
+    int addressLength = 0;
+    DWORD error = 0;              // ошибка разрешения адреса, 0 - агент доступен для запросов
+    SnmpRtt rtt;
+    size_t maxMessageSize = SNMP_UDP_DEFAULT_MESSAGE_SIZE;
+    UINT maxVarBinds = 0;
+};
+
+// Пул сессий для множества агентов: по одному UDP-сокету (с буферами и ареной) на семейство
+// адресов, которые по очереди обслуживают всех агентов. Адреса разрешаются параллельно
+// через кэш, начало сообщения (version и community) кодируется один раз на агента.
+// Пул рассчитан на один поток: в каждый момент с сокетом работает один агент.
+struct SnmpSessionPool {
+    SnmpResolveCache* resolver;
+    DWORD timeout;
+    int retries;
+    AsnInteger version;
+    std::vector<SnmpPoolAgent> agents;
+    SnmpUdpSession sessions[2];   // IPv4 и IPv6, сокет открывается при первом запросе
+    size_t bound;                 // агент, загруженный в сессию (agents.size() - ни один)
+    SnmpUdpSession* boundSession;
+};
+
+void SnmpPoolInit(SnmpSessionPool& pool, DWORD timeout, int retries, AsnInteger version = SNMP_VERSION_V2C,
+    SnmpResolveCache* resolver = NULL);
+
+// Добавляет агентов с общим community. Возвращает индекс первого из них;
+// агенты с неразрешённым адресом тоже добавляются (error != 0), запросы к ним не проходят.
+size_t SnmpPoolAdd(SnmpSessionPool& pool, const std::vector<std::string>& targets, const std::string& community);
+
+// Загружает состояние агента в сессию своего семейства адресов и возвращает её.
+// Сессией можно пользоваться как обычной до SnmpPoolRelease или следующего SnmpPoolAcquire.
+// NULL - адрес агента не разрешён или не удалось открыть сокет (GetLastError).
+SnmpUdpSession* SnmpPoolAcquire(SnmpSessionPool& pool, size_t agent);
+
+// Сохраняет состояние (оценку RTT, пределы размера запроса) текущего агента
+void SnmpPoolRelease(SnmpSessionPool& pool);
+
+void SnmpPoolClose(SnmpSessionPool& pool);
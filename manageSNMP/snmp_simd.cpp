@@ -0,0 +1,209 @@
+﻿#include "snmp_simd.h"
+
+#include <atomic>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define SNMP_SIMD_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// GCC и Clang компилируют функции AVX2 по атрибуту, без -mavx2 для всего файла;
+// MSVC принимает встроенные функции AVX2 без ключей
+#if defined(__GNUC__)
+#define SNMP_SIMD_AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define SNMP_SIMD_AVX2_TARGET
+#endif
+
+static const char hexDigits[] = "0123456789ABCDEF";
+
+// Функция определения поддержки AVX2: процессором (CPUID.7:EBX.5) и ОС (сохранение регистров YMM)
+static bool SnmpSimdHasAvx2() {
+#if defined(SNMP_SIMD_X86) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#elif defined(SNMP_SIMD_X86)
+    return __builtin_cpu_supports("avx2") != 0;
+#else
+    return false;
+#endif
+}
+
+SnmpSimdLevel SnmpSimdSupported() {
+#ifdef SNMP_SIMD_X86
+    static const SnmpSimdLevel supported = SnmpSimdHasAvx2() ? SNMP_SIMD_AVX2 : SNMP_SIMD_SSE2;
+    return supported;
+#else
+    return SNMP_SIMD_SCALAR;
+#endif
+}
+
+// Уровень читают потоки обхода, а SnmpSimdSelect может сменить его во время работы:
+// атомарная переменная без упорядочивания - любое из значений допустимо, нужна лишь целостность
+static std::atomic<SnmpSimdLevel> simdLevel{ SnmpSimdSupported() };
+
+SnmpSimdLevel SnmpSimdActive() {
+    return simdLevel.load(std::memory_order_relaxed);
+}
+
+bool SnmpSimdSelect(SnmpSimdLevel level) {
+    if (level > SnmpSimdSupported()) return false;
+    simdLevel.store(level, std::memory_order_relaxed);
+    return true;
+}
+
+const char* SnmpSimdName(SnmpSimdLevel level) {
+    switch (level) {
+    case SNMP_SIMD_SSE2: return "sse2";
+    case SNMP_SIMD_AVX2: return "avx2";
+    default: return "scalar";
+    }
+}
+
+// Скалярные пути: эталон для векторных и обработка хвостов короче вектора
+
+static bool SnmpSimdIsPrintableScalar(const BYTE* data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        if (data[i] < 0x20 || data[i] >= 0x7F) return false;
+    }
+    return true;
+}
+
+static void SnmpSimdHexScalar(char* out, const BYTE* data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        out[2 * i] = hexDigits[data[i] >> 4];
+        out[2 * i + 1] = hexDigits[data[i] & 0x0F];
+    }
+}
+
+#ifdef SNMP_SIMD_X86
+
+// Печатаемые байты 0x20..0x7E как знаковые - ровно диапазон (0x1F, 0x7F):
+// байты от 0x80 отрицательны и отсекаются тем же сравнением
+static bool SnmpSimdIsPrintableSse2(const BYTE* data, size_t length) {
+    if (length < 16) return SnmpSimdIsPrintableScalar(data, length);
+
+    const __m128i low = _mm_set1_epi8(0x1F);
+    const __m128i high = _mm_set1_epi8(0x7F);
+    size_t i = 0;
+    for (;; i += 16) {
+        // Последний неполный блок читается с перекрытием предыдущего
+        if (i + 16 > length) i = length - 16;
+        __m128i bytes = _mm_loadu_si128((const __m128i*)(data + i));
+        __m128i printable = _mm_and_si128(_mm_cmpgt_epi8(bytes, low), _mm_cmplt_epi8(bytes, high));
+        if (_mm_movemask_epi8(printable) != 0xFFFF) return false;
+        if (i + 16 == length) return true;
+    }
+}
+
+// Полубайты 0..15 в символы: '0' + n, для n > 9 ещё + 7 ('A' - '9' - 1)
+static inline __m128i SnmpSimdNibblesSse2(__m128i nibbles) {
+    __m128i letters = _mm_and_si128(_mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9)), _mm_set1_epi8(7));
+    return _mm_add_epi8(_mm_add_epi8(nibbles, _mm_set1_epi8('0')), letters);
+}
+
+static void SnmpSimdHexSse2(char* out, const BYTE* data, size_t length) {
+    const __m128i mask = _mm_set1_epi8(0x0F);
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i*)(data + i));
+        __m128i high = SnmpSimdNibblesSse2(_mm_and_si128(_mm_srli_epi16(bytes, 4), mask));
+        __m128i low = SnmpSimdNibblesSse2(_mm_and_si128(bytes, mask));
+        // Старший и младший полубайт каждого байта - соседние символы
+        _mm_storeu_si128((__m128i*)(out + 2 * i), _mm_unpacklo_epi8(high, low));
+        _mm_storeu_si128((__m128i*)(out + 2 * i + 16), _mm_unpackhi_epi8(high, low));
+    }
+    SnmpSimdHexScalar(out + 2 * i, data + i, length - i);
+}
+
+SNMP_SIMD_AVX2_TARGET
+static bool SnmpSimdIsPrintableAvx2(const BYTE* data, size_t length) {
+    if (length < 32) return SnmpSimdIsPrintableSse2(data, length);
+
+    const __m256i low = _mm256_set1_epi8(0x1F);
+    const __m256i high = _mm256_set1_epi8(0x7F);
+    size_t i = 0;
+    for (;; i += 32) {
+        if (i + 32 > length) i = length - 32;
+        __m256i bytes = _mm256_loadu_si256((const __m256i*)(data + i));
+        __m256i printable = _mm256_and_si256(_mm256_cmpgt_epi8(bytes, low), _mm256_cmpgt_epi8(high, bytes));
+        if (_mm256_movemask_epi8(printable) != -1) return false;
+        if (i + 32 == length) return true;
+    }
+}
+
+SNMP_SIMD_AVX2_TARGET
+static inline __m256i SnmpSimdNibblesAvx2(__m256i nibbles) {
+    __m256i letters = _mm256_and_si256(_mm256_cmpgt_epi8(nibbles, _mm256_set1_epi8(9)), _mm256_set1_epi8(7));
+    return _mm256_add_epi8(_mm256_add_epi8(nibbles, _mm256_set1_epi8('0')), letters);
+}
+
+SNMP_SIMD_AVX2_TARGET
+static void SnmpSimdHexAvx2(char* out, const BYTE* data, size_t length) {
+    const __m256i mask = _mm256_set1_epi8(0x0F);
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i bytes = _mm256_loadu_si256((const __m256i*)(data + i));
+        __m256i high = SnmpSimdNibblesAvx2(_mm256_and_si256(_mm256_srli_epi16(bytes, 4), mask));
+        __m256i low = SnmpSimdNibblesAvx2(_mm256_and_si256(bytes, mask));
+        // unpack работает внутри 128-битных половин: first = байты 0-7 | 16-23, second = 8-15 | 24-31
+        __m256i first = _mm256_unpacklo_epi8(high, low);
+        __m256i second = _mm256_unpackhi_epi8(high, low);
+        _mm256_storeu_si256((__m256i*)(out + 2 * i), _mm256_permute2x128_si256(first, second, 0x20));
+        _mm256_storeu_si256((__m256i*)(out + 2 * i + 32), _mm256_permute2x128_si256(first, second, 0x31));
+    }
+    SnmpSimdHexSse2(out + 2 * i, data + i, length - i);
+}
+
+#endif
+
+bool SnmpSimdIsPrintable(const BYTE* data, size_t length) {
+#ifdef SNMP_SIMD_X86
+    SnmpSimdLevel level = SnmpSimdActive();
+    if (level == SNMP_SIMD_AVX2) return SnmpSimdIsPrintableAvx2(data, length);
+    if (level == SNMP_SIMD_SSE2) return SnmpSimdIsPrintableSse2(data, length);
+#endif
+    return SnmpSimdIsPrintableScalar(data, length);
+}
+
+void SnmpSimdHex(char* out, const BYTE* data, size_t length) {
+#ifdef SNMP_SIMD_X86
+    SnmpSimdLevel level = SnmpSimdActive();
+    if (level == SNMP_SIMD_AVX2) {
+        SnmpSimdHexAvx2(out, data, length);
+        return;
+    }
+    if (level == SNMP_SIMD_SSE2) {
+        SnmpSimdHexSse2(out, data, length);
+        return;
+    }
+#endif
+    SnmpSimdHexScalar(out, data, length);
+}
+
+void SnmpSimdHexSeparated(char* out, const BYTE* data, size_t length, char separator) {
+    if (length == 0) return;
+
+    // Пары символов считаются блоками в буфере на стеке и расставляются через разделитель
+    char pairs[256];
+    for (size_t first = 0; first < length; first += sizeof(pairs) / 2) {
+        size_t count = length - first < sizeof(pairs) / 2 ? length - first : sizeof(pairs) / 2;
+        SnmpSimdHex(pairs, data + first, count);
+        for (size_t i = 0; i < count; i++) {
+            char* position = out + 3 * (first + i);
+            memcpy(position, pairs + 2 * i, 2);
+            if (first + i + 1 < length) position[2] = separator;
+        }
+    }
+}
@@ -0,0 +1,33 @@
+﻿#pragma once
+
+#include <cstddef>
+#include "snmp_compat.h"
+
+// Классификация и перевод в hex байтов OCTET STRING пачками по 16 (SSE2) или 32 (AVX2) байта.
+// Векторные пути есть только на x86-64; уровень выбирается по процессору при запуске.
+enum SnmpSimdLevel {
+    SNMP_SIMD_SCALAR,             // побайтно, на любой платформе
+    SNMP_SIMD_SSE2,               // есть на любом x86-64
+    SNMP_SIMD_AVX2                // если его поддерживают процессор и ОС
+};
+
+// Лучший уровень, доступный на этом процессоре
+SnmpSimdLevel SnmpSimdSupported();
+
+// Уровень, которым работают функции ниже; по умолчанию - SnmpSimdSupported()
+SnmpSimdLevel SnmpSimdActive();
+
+// Выбор уровня для сверки реализаций и замеров; false, если процессор его не поддерживает
+bool SnmpSimdSelect(SnmpSimdLevel level);
+
+// "scalar", "sse2" или "avx2"
+const char* SnmpSimdName(SnmpSimdLevel level);
+
+// true, если все байты - печатаемые ASCII 0x20..0x7E
+bool SnmpSimdIsPrintable(const BYTE* data, size_t length);
+
+// Пишет в out 2 * length символов: заглавный hex с ведущими нулями
+void SnmpSimdHex(char* out, const BYTE* data, size_t length);
+
+// Пишет в out 3 * length - 1 символов: hex с разделителем между байтами ("00-1B-21-0A-FF-01")
+void SnmpSimdHexSeparated(char* out, const BYTE* data, size_t length, char separator);
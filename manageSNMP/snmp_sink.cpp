@@ -0,0 +1,335 @@
+﻿#include "snmp_sink.h"
+
+#include <cstdio>
+#include <cstring>
+
+#define SNMP_SINK_ALIGN(size) (((size) + SNMP_SINK_ALIGNMENT - 1) & ~(size_t)(SNMP_SINK_ALIGNMENT - 1))
+
+bool SnmpSinkParseFormat(const std::string& name, SnmpSinkFormat& format) {
+    if (name == "text") format = SNMP_SINK_TEXT;
+    else if (name == "ndjson" || name == "json") format = SNMP_SINK_NDJSON;
+    else if (name == "csv") format = SNMP_SINK_CSV;
+    else if (name == "binary") format = SNMP_SINK_BINARY;
+    else if (name == "snmprec") format = SNMP_SINK_SNMPREC;
+    else return false;
+    return true;
+}
+
+std::ostream& SnmpSinkLog(const SnmpSink& sink) {
+    if (sink.format != SNMP_SINK_TEXT && sink.output->stream == &std::cout) {
+        return std::cerr;
+    }
+    return std::cout;
+}
+
+void SnmpSinkBegin(SnmpSink& sink) {
+    if (sink.format == SNMP_SINK_CSV) {
+        if (sink.host) sink.output->buffer.append("host,");
+        sink.output->buffer.append(sink.changes ? "oid,name,type,value,change,rate\n" : "oid,name,type,value\n");
+    }
+    else if (sink.format == SNMP_SINK_BINARY) {
+        SnmpSinkFileHeader header;
+        header.magic = SNMP_SINK_MAGIC;
+        header.version = SNMP_SINK_VERSION;
+        sink.output->buffer.append((const char*)&header, sizeof(header));
+    }
+}
+
+// Имя типа для машинных форматов (как у net-snmp); строка - STRING или Hex-STRING по содержимому
+static const char* SnmpSinkTypeName(const AsnAny& value) {
+    switch (value.asnType) {
+    case ASN_INTEGER: return "INTEGER";
+    case ASN_BITS: return "BITS";
+    case ASN_OCTETSTRING:
+        return SnmpFormatIsPrintable(value.asnValue.string.stream, value.asnValue.string.length)
+            ? "STRING" : "Hex-STRING";
+    case ASN_NULL: return "NULL";
+    case ASN_OBJECTIDENTIFIER: return "OID";
+    case ASN_IPADDRESS: return "IpAddress";
+    case ASN_COUNTER32: return "Counter32";
+    case ASN_GAUGE32: return "Gauge32";
+    case ASN_TIMETICKS: return "Timeticks";
+    case ASN_OPAQUE: return "Opaque";
+    case ASN_COUNTER64: return "Counter64";
+    case ASN_UNSIGNED32: return "Unsigned32";
+    case SNMP_EXCEPTION_NOSUCHOBJECT: return "noSuchObject";
+    case SNMP_EXCEPTION_NOSUCHINSTANCE: return "noSuchInstance";
+    case SNMP_EXCEPTION_ENDOFMIBVIEW: return "endOfMibView";
+    default: return "UNKNOWN";
+    }
+}
+
+// {"oid":"...","name":"...","type":"...","value":...}
+static void SnmpSinkWriteJson(SnmpSink& sink, const RFC1157VarBind& varBind) {
+    std::string& out = sink.output->buffer;
+    out.push_back('{');
+    if (sink.host) {
+        // Имя агента задаёт пользователь - кавычки и обратная косая экранируются
+        out.append("\"host\":\"");
+        for (const char* c = sink.host; *c; c++) {
+            if (*c == '"' || *c == '\\') out.push_back('\\');
+            out.push_back(*c);
+        }
+        out.append("\",");
+    }
+    out.append("\"oid\":\"");
+    SnmpFormatOid(out, varBind.name.ids, varBind.name.idLength);
+    out.append("\",\"name\":\"");
+    SnmpMibResolve(*sink.mib, varBind.name.ids, varBind.name.idLength, out);
+    out.append("\",\"type\":\"");
+    out.append(SnmpSinkTypeName(varBind.value));
+    out.append("\",\"value\":");
+
+    size_t start = out.size();
+    bool quoted = SnmpFormatValueText(out, varBind.value);
+    if (!quoted) {
+        if (out.size() == start) out.append("null");
+    }
+    else {
+        // В строке только печатаемые ASCII, экранировать нужно лишь кавычку и обратную косую.
+        // Вставки сдвигают только хвост буфера - само значение.
+        out.insert(start, 1, '"');
+        for (size_t i = start + 1; i < out.size(); i++) {
+            if (out[i] == '"' || out[i] == '\\') {
+                out.insert(i, 1, '\\');
+                i++;
+            }
+        }
+        out.push_back('"');
+    }
+    out.append("}\n");
+}
+
+// Берёт в кавычки поле out[start..], если в нём есть запятая, кавычка или перевод строки (RFC 4180)
+static void SnmpSinkQuoteCsv(std::string& out, size_t start) {
+    bool needQuotes = false;
+    for (size_t i = start; i < out.size(); i++) {
+        if (out[i] == ',' || out[i] == '"' || out[i] == '\n' || out[i] == '\r') {
+            needQuotes = true;
+            break;
+        }
+    }
+    if (needQuotes) {
+        std::string value = out.substr(start);
+        out.resize(start);
+        out.push_back('"');
+        for (char c : value) {
+            if (c == '"') out.push_back('"');
+            out.push_back(c);
+        }
+        out.push_back('"');
+    }
+}
+
+// [host,]oid,name,type,value; host и значение - в кавычках по RFC 4180
+static void SnmpSinkWriteCsv(SnmpSink& sink, const RFC1157VarBind& varBind) {
+    std::string& out = sink.output->buffer;
+    if (sink.host) {
+        size_t hostStart = out.size();
+        out.append(sink.host);
+        SnmpSinkQuoteCsv(out, hostStart);
+        out.push_back(',');
+    }
+    SnmpFormatOid(out, varBind.name.ids, varBind.name.idLength);
+    out.push_back(',');
+    SnmpMibResolve(*sink.mib, varBind.name.ids, varBind.name.idLength, out);
+    out.push_back(',');
+    out.append(SnmpSinkTypeName(varBind.value));
+    out.push_back(',');
+
+    size_t start = out.size();
+    SnmpFormatValueText(out, varBind.value);
+    SnmpSinkQuoteCsv(out, start);
+    out.push_back('\n');
+}
+
+static void SnmpSinkWriteBinary(SnmpSink& sink, const RFC1157VarBind& varBind) {
+    const AsnAny& value = varBind.value;
+    const void* valueData = NULL;
+    size_t valueLength = 0;
+    UINT number;
+    switch (value.asnType) {
+    case ASN_INTEGER:
+    case ASN_COUNTER32:
+    case ASN_GAUGE32:
+    case ASN_TIMETICKS:
+    case ASN_UNSIGNED32:
+        number = value.asnValue.unsigned32;
+        valueData = &number;
+        valueLength = sizeof(number);
+        break;
+    case ASN_COUNTER64:
+        valueData = &value.asnValue.counter64.QuadPart;
+        valueLength = sizeof(ULONGLONG);
+        break;
+    case ASN_OCTETSTRING:
+    case ASN_OPAQUE:
+    case ASN_BITS:
+    case ASN_IPADDRESS:
+        valueData = value.asnValue.string.stream;
+        valueLength = value.asnValue.string.length;
+        break;
+    case ASN_OBJECTIDENTIFIER:
+        valueData = value.asnValue.object.ids;
+        valueLength = value.asnValue.object.idLength * sizeof(UINT);
+        break;
+    default:
+        break;
+    }
+
+    size_t valueOffset = SNMP_SINK_ALIGN(sizeof(SnmpSinkRecordHeader) + varBind.name.idLength * sizeof(UINT));
+    size_t recordLength = SNMP_SINK_ALIGN(valueOffset + valueLength);
+
+    SnmpSinkRecordHeader header;
+    header.recordLength = (UINT)recordLength;
+    header.type = value.asnType;
+    header.oidLength = varBind.name.idLength;
+    header.valueLength = (UINT)valueLength;
+
+    // Запись собирается прямо в буфере вывода; выравнивающие байты нулевые
+    std::string& out = sink.output->buffer;
+    size_t start = out.size();
+    out.resize(start + recordLength, '\0');
+    char* record = &out[start];
+    memcpy(record, &header, sizeof(header));
+    memcpy(record + sizeof(header), varBind.name.ids, varBind.name.idLength * sizeof(UINT));
+    if (valueLength > 0) {
+        memcpy(record + valueOffset, valueData, valueLength);
+    }
+}
+
+// OID|тег|значение: тег - код типа BER, суффикс x - значение в hex.
+// Исключения (endOfMibView и др.) значениями агента не являются и пропускаются.
+static void SnmpSinkWriteSnmprec(SnmpSink& sink, const RFC1157VarBind& varBind) {
+    const AsnAny& value = varBind.value;
+    if (value.asnType >= SNMP_EXCEPTION_NOSUCHOBJECT && value.asnType <= SNMP_EXCEPTION_ENDOFMIBVIEW) return;
+
+    std::string& out = sink.output->buffer;
+    SnmpFormatOid(out, varBind.name.ids, varBind.name.idLength);
+    out.push_back('|');
+    SnmpFormatUnsigned(out, value.asnType);
+
+    // Строка с непечатаемыми байтами (и любой Opaque/BITS) пишется в hex, чтобы файл оставался построчным
+    bool hex = value.asnType == ASN_OPAQUE || value.asnType == ASN_BITS
+        || (value.asnType == ASN_OCTETSTRING
+            && !SnmpFormatIsPrintable(value.asnValue.string.stream, value.asnValue.string.length));
+    if (hex) {
+        out.append("x|");
+        SnmpFormatHex(out, value.asnValue.string.stream, value.asnValue.string.length);
+    }
+    else {
+        out.push_back('|');
+        SnmpFormatValueText(out, value);
+    }
+    out.push_back('\n');
+}
+
+void SnmpSinkWrite(SnmpSink& sink, int itemNumber, const RFC1157VarBind& varBind) {
+    switch (sink.format) {
+    case SNMP_SINK_TEXT:
+        if (sink.host) {
+            // Как в poll и walk_targets: имя агента и строка значения
+            sink.output->buffer.append(sink.host).push_back('\t');
+            SnmpFormatVarBind(sink.output->buffer, varBind, *sink.mib);
+        }
+        else {
+            SnmpFormatWalkItem(sink.output->buffer, itemNumber, varBind, *sink.mib);
+        }
+        break;
+    case SNMP_SINK_NDJSON:
+        SnmpSinkWriteJson(sink, varBind);
+        break;
+    case SNMP_SINK_CSV:
+        SnmpSinkWriteCsv(sink, varBind);
+        break;
+    case SNMP_SINK_BINARY:
+        SnmpSinkWriteBinary(sink, varBind);
+        break;
+    case SNMP_SINK_SNMPREC:
+        SnmpSinkWriteSnmprec(sink, varBind);
+        break;
+    }
+    if (!sink.hold) SnmpOutputCommit(*sink.output);
+}
+
+// Скорость с двумя знаками после запятой
+static void SnmpSinkFormatRate(std::string& out, double rate) {
+    char text[64];
+    int length = snprintf(text, sizeof(text), "%.2f", rate);
+    if (length > 0) out.append(text, (size_t)length);
+}
+
+void SnmpSinkWriteChange(SnmpSink& sink, int itemNumber, const RFC1157VarBind& varBind,
+    const char* change, const double* rate) {
+    std::string& out = sink.output->buffer;
+    switch (sink.format) {
+    case SNMP_SINK_TEXT: {
+        out.append(change[0] == 'a' ? "+ " : change[0] == 'r' ? "- " : "~ ");
+        SnmpFormatWalkItem(out, itemNumber, varBind, *sink.mib);
+        if (rate) {
+            // Скорость - в конце строки значения, перед переводами строки
+            size_t end = out.size();
+            while (end > 0 && out[end - 1] == '\n') end--;
+            std::string tail = out.substr(end);
+            out.resize(end);
+            out.append("\trate: ");
+            SnmpSinkFormatRate(out, *rate);
+            out.append("/s");
+            out.append(tail);
+        }
+        break;
+    }
+    case SNMP_SINK_NDJSON:
+        SnmpSinkWriteJson(sink, varBind);
+        out.resize(out.size() - 2);     // "}\n"
+        out.append(",\"change\":\"");
+        out.append(change);
+        out.append("\",\"rate\":");
+        if (rate) SnmpSinkFormatRate(out, *rate);
+        else out.append("null");
+        out.append("}\n");
+        break;
+    case SNMP_SINK_CSV:
+        SnmpSinkWriteCsv(sink, varBind);
+        out.back() = ',';
+        out.append(change);
+        out.push_back(',');
+        if (rate) SnmpSinkFormatRate(out, *rate);
+        out.push_back('\n');
+        break;
+    default:
+        break;
+    }
+    if (!sink.hold) SnmpOutputCommit(*sink.output);
+}
+
+void SnmpSinkEnd(SnmpSink& sink) {
+    SnmpOutputFlush(*sink.output);
+}
+
+bool SnmpSinkReadHeader(const BYTE* data, size_t size, size_t& offset) {
+    if (size < sizeof(SnmpSinkFileHeader)) return false;
+    const SnmpSinkFileHeader* header = (const SnmpSinkFileHeader*)data;
+    if (header->magic != SNMP_SINK_MAGIC || header->version != SNMP_SINK_VERSION) return false;
+    offset = sizeof(SnmpSinkFileHeader);
+    return true;
+}
+
+bool SnmpSinkReadRecord(const BYTE* data, size_t size, size_t& offset, SnmpSinkRecord& record) {
+    if (offset + sizeof(SnmpSinkRecordHeader) > size) return false;
+    const SnmpSinkRecordHeader* header = (const SnmpSinkRecordHeader*)(data + offset);
+
+    size_t valueOffset = SNMP_SINK_ALIGN(sizeof(SnmpSinkRecordHeader) + (size_t)header->oidLength * sizeof(UINT));
+    if (header->recordLength < valueOffset + header->valueLength || offset + header->recordLength > size
+        || header->recordLength % SNMP_SINK_ALIGNMENT != 0) {
+        return false;
+    }
+
+    record.type = (BYTE)header->type;
+    record.oid = (const UINT*)(header + 1);
+    record.oidLength = header->oidLength;
+    record.value = data + offset + valueOffset;
+    record.valueLength = header->valueLength;
+    offset += header->recordLength;
+    return true;
+}
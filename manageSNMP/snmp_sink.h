@@ -0,0 +1,82 @@
+﻿#pragma once
+
+#include <string>
+#include "snmp_format.h"
+
+// Формат строк результата обхода
+enum SnmpSinkFormat {
+    SNMP_SINK_TEXT,               // "1. OID: ... = INTEGER: 5", как раньше
+    SNMP_SINK_NDJSON,             // один объект JSON на строку
+    SNMP_SINK_CSV,                // oid,name,type,value с заголовком
+    SNMP_SINK_BINARY,             // записи SnmpSinkRecordHeader, см. ниже
+    SNMP_SINK_SNMPREC             // OID|тег|значение - данные для имитатора агента snmpAgent
+};
+
+// Двоичный формат: заголовок файла, затем записи одна за другой.
+// Все поля в порядке байт записавшей машины (magic позволяет его проверить),
+// записи и значения выровнены на 8 байт, поэтому файл можно отобразить в память
+// и читать поля прямо по указателям, без копирования и разбора.
+#define SNMP_SINK_MAGIC 0x4B4C5753    // "SWLK"
+#define SNMP_SINK_VERSION 1
+#define SNMP_SINK_ALIGNMENT 8
+
+struct SnmpSinkFileHeader {
+    UINT magic;
+    UINT version;
+};
+
+// Запись: заголовок, oidLength дуг UINT, выравнивание до 8, valueLength байт значения,
+// выравнивание до 8. Значение: INTEGER - int32, Counter32/Gauge32/TimeTicks - uint32,
+// Counter64 - uint64, OCTET STRING/Opaque - байты, OID - дуги UINT, IpAddress - 4 байта,
+// NULL и исключения (noSuchObject, endOfMibView...) - пусто.
+struct SnmpSinkRecordHeader {
+    UINT recordLength;            // вся запись вместе с выравниванием
+    UINT type;                    // asnType значения
+    UINT oidLength;
+    UINT valueLength;
+};
+
+// Запись двоичного формата, прочитанная на месте: указатели смотрят в исходный буфер
+struct SnmpSinkRecord {
+    BYTE type;
+    const UINT* oid;
+    UINT oidLength;
+    const BYTE* value;
+    UINT valueLength;
+};
+
+// Приёмник строк обхода: строки форматируются в output по мере получения
+struct SnmpSink {
+    SnmpSinkFormat format = SNMP_SINK_TEXT;
+    SnmpOutput* output = NULL;
+    const SnmpMibIndex* mib = NULL;
+    bool changes = false;         // строки изменений (SnmpSinkWriteChange): в CSV две дополнительные колонки
+    const char* host = NULL;      // имя агента первым полем строки (вывод по многим агентам)
+    bool hold = false;            // строки только копятся в output, в поток их переносит владелец буфера
+};
+
+// "text", "ndjson", "csv", "binary" или "snmprec"
+bool SnmpSinkParseFormat(const std::string& name, SnmpSinkFormat& format);
+
+// Поток для служебных строк обхода ("=== Found N items ==="): если данные
+// в машинном формате идут в stdout, служебные строки уходят в stderr
+std::ostream& SnmpSinkLog(const SnmpSink& sink);
+
+// Заголовок CSV или двоичного файла (с host - с колонкой host)
+void SnmpSinkBegin(SnmpSink& sink);
+
+// Одна строка результата; в поток пишется блоками (см. SnmpOutputCommit)
+void SnmpSinkWrite(SnmpSink& sink, int itemNumber, const RFC1157VarBind& varBind);
+
+// Строка опроса изменений: change - "added", "changed" или "removed", rate - скорость счётчика
+// в секунду (NULL - не вычислена). В тексте изменение помечается знаком +, ~ или -,
+// в NDJSON и CSV - полями change и rate. Двоичный формат и snmprec изменения не поддерживают.
+void SnmpSinkWriteChange(SnmpSink& sink, int itemNumber, const RFC1157VarBind& varBind,
+    const char* change, const double* rate);
+
+// Сбрасывает накопленное в поток
+void SnmpSinkEnd(SnmpSink& sink);
+
+// Чтение двоичного формата: проверка заголовка файла и очередной записи по смещению offset
+bool SnmpSinkReadHeader(const BYTE* data, size_t size, size_t& offset);
+bool SnmpSinkReadRecord(const BYTE* data, size_t size, size_t& offset, SnmpSinkRecord& record);
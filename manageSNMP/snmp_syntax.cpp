@@ -0,0 +1,451 @@
+﻿#include "snmp_syntax.h"
+
+#include <array>
+#include <charconv>
+#include <utility>
+#include "snmp_format.h"
+
+// Имена значений перечислений; индекс - значение
+static constexpr const char* ifStatusLabels[] = {
+    NULL, "up", "down", "testing", "unknown", "dormant", "notPresent", "lowerLayerDown"
+};
+static constexpr const char* truthValueLabels[] = { NULL, "true", "false" };
+static constexpr const char* enabledLabels[] = { NULL, "enabled", "disabled" };
+static constexpr const char* ipForwardingLabels[] = { NULL, "forwarding", "notForwarding" };
+static constexpr const char* ipNetToMediaTypeLabels[] = { NULL, "other", "invalid", "dynamic", "static" };
+static constexpr const char* tcpRtoAlgorithmLabels[] = { NULL, "other", "constant", "rsre", "vanj", "rfc2988" };
+static constexpr const char* tcpConnStateLabels[] = {
+    NULL, "closed", "listen", "synSent", "synReceived", "established", "finWait1",
+    "finWait2", "closeWait", "lastAck", "closing", "timeWait", "deleteTCB"
+};
+static constexpr const char* hrDeviceStatusLabels[] = { NULL, "unknown", "running", "warning", "testing", "down" };
+static constexpr const char* hrSWRunTypeLabels[] = { NULL, "unknown", "operatingSystem", "deviceDriver", "application" };
+static constexpr const char* hrSWRunStatusLabels[] = { NULL, "running", "runnable", "notRunnable", "invalid" };
+static constexpr const char* inetAddressTypeLabels[] = {
+    "unknown", "ipv4", "ipv6", "ipv4z", "ipv6z", NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, "dns"
+};
+
+#define SNMP_SYNTAX_LABELS(labels) labels, (UINT)(sizeof(labels) / sizeof(labels[0]))
+
+// Привязки в порядке возрастания OID (проверяется при компиляции). Привязка группы
+// действует на всё поддерево, кроме объектов со своей привязкой (snmp и snmpEnableAuthenTraps).
+static constexpr SnmpSyntaxBinding syntaxBindings[] = {
+    // SNMPv2-MIB: system
+    { { 1, 3, 6, 1, 2, 1, 1, 1 }, SNMP_SYNTAX_DISPLAY_STRING },          // sysDescr
+    { { 1, 3, 6, 1, 2, 1, 1, 2 }, SNMP_SYNTAX_OBJECT_ID },               // sysObjectID
+    { { 1, 3, 6, 1, 2, 1, 1, 3 }, SNMP_SYNTAX_TIMETICKS },               // sysUpTime
+    { { 1, 3, 6, 1, 2, 1, 1, 4 }, SNMP_SYNTAX_DISPLAY_STRING },          // sysContact
+    { { 1, 3, 6, 1, 2, 1, 1, 5 }, SNMP_SYNTAX_DISPLAY_STRING },          // sysName
+    { { 1, 3, 6, 1, 2, 1, 1, 6 }, SNMP_SYNTAX_DISPLAY_STRING },          // sysLocation
+    { { 1, 3, 6, 1, 2, 1, 1, 7 }, SNMP_SYNTAX_INTEGER },                 // sysServices
+    { { 1, 3, 6, 1, 2, 1, 1, 8 }, SNMP_SYNTAX_TIMETICKS },               // sysORLastChange
+    { { 1, 3, 6, 1, 2, 1, 1, 9, 1, 1 }, SNMP_SYNTAX_INTEGER },           // sysORIndex
+    { { 1, 3, 6, 1, 2, 1, 1, 9, 1, 2 }, SNMP_SYNTAX_OBJECT_ID },         // sysORID
+    { { 1, 3, 6, 1, 2, 1, 1, 9, 1, 3 }, SNMP_SYNTAX_DISPLAY_STRING },    // sysORDescr
+    { { 1, 3, 6, 1, 2, 1, 1, 9, 1, 4 }, SNMP_SYNTAX_TIMETICKS },         // sysORUpTime
+
+    // IF-MIB: interfaces, ifTable
+    { { 1, 3, 6, 1, 2, 1, 2, 1 }, SNMP_SYNTAX_INTEGER },                 // ifNumber
+    { { 1, 3, 6, 1, 2, 1, 2, 2, 1, 1 }, SNMP_SYNTAX_INTEGER },           // ifIndex
+    { { 1, 3, 6, 1, 2, 1, 2, 2, 1, 2 }, SNMP_SYNTAX_DISPLAY_STRING },    // ifDescr
+    { { 1, 3, 6, 1, 2, 1, 2, 2, 1, 3 }, SNMP_SYNTAX_INTEGER },           // ifType
+    { { 1, 3, 6, 1, 2, 1, 2, 2, 1, 4 }, SNMP_SYNTAX_INTEGER },           // ifMtu
+    { { 1, 3, 6, 1, 2, 1, 2, 2, 1, 5 }, SNMP_SYNTAX_GAUGE32 },           // ifSpeed
+    { { 1, 3, 6, 1, 2, 1, 2, 2, 1, 6 }, SNMP_SYNTAX_PHYS_ADDRESS },      // ifPhysAddress
+    { { 1, 3, 6, 1, 2, 1, 2, 2, 1, 7 }, SNMP_SYNTAX_ENUM, SNMP_SYNTAX_LABELS(ifStatusLabels) },   // ifAdminStatus
+    { { 1, 3, 6, 1, 2, 1, 2, 2, 1, 8 }, SNMP_SYNTAX_ENUM, SNMP_SYNTAX_LABELS(ifStatusLabels) },   // ifOperStatus
+    { { 1, 3, 6, 1, 2, 1, 2, 2, 1, 9 }, SNMP_SYNTAX_TIMETICKS },         // ifLastChange
+    { { 1, 3, 6, 1, 2, 1, 2, 2, 1, 10 }, SNMP_SYNTAX_COUNTER32 },        // ifInOctets
+    { { 1, 3, 6, 1, 2, 1, 2, 2, 1, 11 }, SNMP_SYNTAX_COUNTER32 },        // ifInUcastPkts
+    { { 1, 3, 6, 1, 2, 1, 2, 2, 1, 12 }, SNMP_SYNTAX_COUNTER32 },        // ifInNUcastPkts
+    { { 1, 3, 6, 1, 2, 1, 2, 2, 1, 13 }, SNMP_SYNTAX_COUNTER32 },        // ifInDiscards
+    { { 1, 3, 6, 1, 2, 1, 2, 2, 1, 14 }, SNMP_SYNTAX_COUNTER32 },        // ifInErrors
+    { { 1, 3, 6, 1, 2, 1, 2, 2, 1, 15 }, SNMP_SYNTAX_COUNTER32 },        // ifInUnknownProtos
+    { { 1, 3, 6, 1, 2, 1, 2, 2, 1, 16 }, SNMP_SYNTAX_COUNTER32 },        // ifOutOctets
+    { { 1, 3, 6, 1, 2, 1, 2, 2, 1, 17 }, SNMP_SYNTAX_COUNTER32 },        // ifOutUcastPkts
+    { { 1, 3, 6, 1, 2, 1, 2, 2, 1, 18 }, SNMP_SYNTAX_COUNTER32 },        // ifOutNUcastPkts
+    { { 1, 3, 6, 1, 2, 1, 2, 2, 1, 19 }, SNMP_SYNTAX_COUNTER32 },        // ifOutDiscards
+    { { 1, 3, 6, 1, 2, 1, 2, 2, 1, 20 }, SNMP_SYNTAX_COUNTER32 },        // ifOutErrors
+    { { 1, 3, 6, 1, 2, 1, 2, 2, 1, 21 }, SNMP_SYNTAX_GAUGE32 },          // ifOutQLen
+    { { 1, 3, 6, 1, 2, 1, 2, 2, 1, 22 }, SNMP_SYNTAX_OBJECT_ID },        // ifSpecific
+
+    // RFC1213-MIB: atTable
+    { { 1, 3, 6, 1, 2, 1, 3, 1, 1, 1 }, SNMP_SYNTAX_INTEGER },           // atIfIndex
+    { { 1, 3, 6, 1, 2, 1, 3, 1, 1, 2 }, SNMP_SYNTAX_PHYS_ADDRESS },      // atPhysAddress
+    { { 1, 3, 6, 1, 2, 1, 3, 1, 1, 3 }, SNMP_SYNTAX_IP_ADDRESS },        // atNetAddress
+
+    // IP-MIB: ip
+    { { 1, 3, 6, 1, 2, 1, 4, 1 }, SNMP_SYNTAX_ENUM, SNMP_SYNTAX_LABELS(ipForwardingLabels) },     // ipForwarding
+    { { 1, 3, 6, 1, 2, 1, 4, 2 }, SNMP_SYNTAX_INTEGER },                 // ipDefaultTTL
+    { { 1, 3, 6, 1, 2, 1, 4, 3 }, SNMP_SYNTAX_COUNTER32 },               // ipInReceives
+    { { 1, 3, 6, 1, 2, 1, 4, 4 }, SNMP_SYNTAX_COUNTER32 },               // ipInHdrErrors
+    { { 1, 3, 6, 1, 2, 1, 4, 5 }, SNMP_SYNTAX_COUNTER32 },               // ipInAddrErrors
+    { { 1, 3, 6, 1, 2, 1, 4, 6 }, SNMP_SYNTAX_COUNTER32 },               // ipForwDatagrams
+    { { 1, 3, 6, 1, 2, 1, 4, 7 }, SNMP_SYNTAX_COUNTER32 },               // ipInUnknownProtos
+    { { 1, 3, 6, 1, 2, 1, 4, 8 }, SNMP_SYNTAX_COUNTER32 },               // ipInDiscards
+    { { 1, 3, 6, 1, 2, 1, 4, 9 }, SNMP_SYNTAX_COUNTER32 },               // ipInDelivers
+    { { 1, 3, 6, 1, 2, 1, 4, 10 }, SNMP_SYNTAX_COUNTER32 },              // ipOutRequests
+    { { 1, 3, 6, 1, 2, 1, 4, 11 }, SNMP_SYNTAX_COUNTER32 },              // ipOutDiscards
+    { { 1, 3, 6, 1, 2, 1, 4, 12 }, SNMP_SYNTAX_COUNTER32 },              // ipOutNoRoutes
+    { { 1, 3, 6, 1, 2, 1, 4, 13 }, SNMP_SYNTAX_INTEGER },                // ipReasmTimeout
+    { { 1, 3, 6, 1, 2, 1, 4, 14 }, SNMP_SYNTAX_COUNTER32 },              // ipReasmReqds
+    { { 1, 3, 6, 1, 2, 1, 4, 15 }, SNMP_SYNTAX_COUNTER32 },              // ipReasmOKs
+    { { 1, 3, 6, 1, 2, 1, 4, 16 }, SNMP_SYNTAX_COUNTER32 },              // ipReasmFails
+    { { 1, 3, 6, 1, 2, 1, 4, 17 }, SNMP_SYNTAX_COUNTER32 },              // ipFragOKs
+    { { 1, 3, 6, 1, 2, 1, 4, 18 }, SNMP_SYNTAX_COUNTER32 },              // ipFragFails
+    { { 1, 3, 6, 1, 2, 1, 4, 19 }, SNMP_SYNTAX_COUNTER32 },              // ipFragCreates
+    { { 1, 3, 6, 1, 2, 1, 4, 20, 1, 1 }, SNMP_SYNTAX_IP_ADDRESS },       // ipAdEntAddr
+    { { 1, 3, 6, 1, 2, 1, 4, 20, 1, 2 }, SNMP_SYNTAX_INTEGER },          // ipAdEntIfIndex
+    { { 1, 3, 6, 1, 2, 1, 4, 20, 1, 3 }, SNMP_SYNTAX_IP_ADDRESS },       // ipAdEntNetMask
+    { { 1, 3, 6, 1, 2, 1, 4, 20, 1, 4 }, SNMP_SYNTAX_INTEGER },          // ipAdEntBcastAddr
+    { { 1, 3, 6, 1, 2, 1, 4, 20, 1, 5 }, SNMP_SYNTAX_INTEGER },          // ipAdEntReasmMaxSize
+    { { 1, 3, 6, 1, 2, 1, 4, 21, 1, 1 }, SNMP_SYNTAX_IP_ADDRESS },       // ipRouteDest
+    { { 1, 3, 6, 1, 2, 1, 4, 21, 1, 2 }, SNMP_SYNTAX_INTEGER },          // ipRouteIfIndex
+    { { 1, 3, 6, 1, 2, 1, 4, 21, 1, 3 }, SNMP_SYNTAX_INTEGER },          // ipRouteMetric1
+    { { 1, 3, 6, 1, 2, 1, 4, 21, 1, 7 }, SNMP_SYNTAX_IP_ADDRESS },       // ipRouteNextHop
+    { { 1, 3, 6, 1, 2, 1, 4, 21, 1, 8 }, SNMP_SYNTAX_INTEGER },          // ipRouteType
+    { { 1, 3, 6, 1, 2, 1, 4, 21, 1, 9 }, SNMP_SYNTAX_INTEGER },          // ipRouteProto
+    { { 1, 3, 6, 1, 2, 1, 4, 21, 1, 11 }, SNMP_SYNTAX_IP_ADDRESS },      // ipRouteMask
+    { { 1, 3, 6, 1, 2, 1, 4, 22, 1, 1 }, SNMP_SYNTAX_INTEGER },          // ipNetToMediaIfIndex
+    { { 1, 3, 6, 1, 2, 1, 4, 22, 1, 2 }, SNMP_SYNTAX_PHYS_ADDRESS },     // ipNetToMediaPhysAddress
+    { { 1, 3, 6, 1, 2, 1, 4, 22, 1, 3 }, SNMP_SYNTAX_IP_ADDRESS },       // ipNetToMediaNetAddress
+    { { 1, 3, 6, 1, 2, 1, 4, 22, 1, 4 }, SNMP_SYNTAX_ENUM, SNMP_SYNTAX_LABELS(ipNetToMediaTypeLabels) },
+    { { 1, 3, 6, 1, 2, 1, 4, 23 }, SNMP_SYNTAX_COUNTER32 },              // ipRoutingDiscards
+
+    // IP-MIB: icmp - только счётчики
+    { { 1, 3, 6, 1, 2, 1, 5 }, SNMP_SYNTAX_COUNTER32 },
+
+    // TCP-MIB: tcp
+    { { 1, 3, 6, 1, 2, 1, 6, 1 }, SNMP_SYNTAX_ENUM, SNMP_SYNTAX_LABELS(tcpRtoAlgorithmLabels) },  // tcpRtoAlgorithm
+    { { 1, 3, 6, 1, 2, 1, 6, 2 }, SNMP_SYNTAX_INTEGER },                 // tcpRtoMin
+    { { 1, 3, 6, 1, 2, 1, 6, 3 }, SNMP_SYNTAX_INTEGER },                 // tcpRtoMax
+    { { 1, 3, 6, 1, 2, 1, 6, 4 }, SNMP_SYNTAX_INTEGER },                 // tcpMaxConn
+    { { 1, 3, 6, 1, 2, 1, 6, 5 }, SNMP_SYNTAX_COUNTER32 },               // tcpActiveOpens
+    { { 1, 3, 6, 1, 2, 1, 6, 6 }, SNMP_SYNTAX_COUNTER32 },               // tcpPassiveOpens
+    { { 1, 3, 6, 1, 2, 1, 6, 7 }, SNMP_SYNTAX_COUNTER32 },               // tcpAttemptFails
+    { { 1, 3, 6, 1, 2, 1, 6, 8 }, SNMP_SYNTAX_COUNTER32 },               // tcpEstabResets
+    { { 1, 3, 6, 1, 2, 1, 6, 9 }, SNMP_SYNTAX_GAUGE32 },                 // tcpCurrEstab
+    { { 1, 3, 6, 1, 2, 1, 6, 10 }, SNMP_SYNTAX_COUNTER32 },              // tcpInSegs
+    { { 1, 3, 6, 1, 2, 1, 6, 11 }, SNMP_SYNTAX_COUNTER32 },              // tcpOutSegs
+    { { 1, 3, 6, 1, 2, 1, 6, 12 }, SNMP_SYNTAX_COUNTER32 },              // tcpRetransSegs
+    { { 1, 3, 6, 1, 2, 1, 6, 13, 1, 1 }, SNMP_SYNTAX_ENUM, SNMP_SYNTAX_LABELS(tcpConnStateLabels) },  // tcpConnState
+    { { 1, 3, 6, 1, 2, 1, 6, 13, 1, 2 }, SNMP_SYNTAX_IP_ADDRESS },       // tcpConnLocalAddress
+    { { 1, 3, 6, 1, 2, 1, 6, 13, 1, 3 }, SNMP_SYNTAX_INTEGER },          // tcpConnLocalPort
+    { { 1, 3, 6, 1, 2, 1, 6, 13, 1, 4 }, SNMP_SYNTAX_IP_ADDRESS },       // tcpConnRemAddress
+    { { 1, 3, 6, 1, 2, 1, 6, 13, 1, 5 }, SNMP_SYNTAX_INTEGER },          // tcpConnRemPort
+    { { 1, 3, 6, 1, 2, 1, 6, 14 }, SNMP_SYNTAX_COUNTER32 },              // tcpInErrs
+    { { 1, 3, 6, 1, 2, 1, 6, 15 }, SNMP_SYNTAX_COUNTER32 },              // tcpOutRsts
+
+    // UDP-MIB: udp
+    { { 1, 3, 6, 1, 2, 1, 7, 1 }, SNMP_SYNTAX_COUNTER32 },               // udpInDatagrams
+    { { 1, 3, 6, 1, 2, 1, 7, 2 }, SNMP_SYNTAX_COUNTER32 },               // udpNoPorts
+    { { 1, 3, 6, 1, 2, 1, 7, 3 }, SNMP_SYNTAX_COUNTER32 },               // udpInErrors
+    { { 1, 3, 6, 1, 2, 1, 7, 4 }, SNMP_SYNTAX_COUNTER32 },               // udpOutDatagrams
+    { { 1, 3, 6, 1, 2, 1, 7, 5, 1, 1 }, SNMP_SYNTAX_IP_ADDRESS },        // udpLocalAddress
+    { { 1, 3, 6, 1, 2, 1, 7, 5, 1, 2 }, SNMP_SYNTAX_INTEGER },           // udpLocalPort
+
+    // SNMPv2-MIB: snmp - счётчики, кроме snmpEnableAuthenTraps
+    { { 1, 3, 6, 1, 2, 1, 11 }, SNMP_SYNTAX_COUNTER32 },
+    { { 1, 3, 6, 1, 2, 1, 11, 30 }, SNMP_SYNTAX_ENUM, SNMP_SYNTAX_LABELS(enabledLabels) },        // snmpEnableAuthenTraps
+
+    // HOST-RESOURCES-MIB
+    { { 1, 3, 6, 1, 2, 1, 25, 1, 1 }, SNMP_SYNTAX_TIMETICKS },           // hrSystemUptime
+    { { 1, 3, 6, 1, 2, 1, 25, 1, 2 }, SNMP_SYNTAX_DATE_AND_TIME },       // hrSystemDate
+    { { 1, 3, 6, 1, 2, 1, 25, 1, 3 }, SNMP_SYNTAX_INTEGER },             // hrSystemInitialLoadDevice
+    { { 1, 3, 6, 1, 2, 1, 25, 1, 4 }, SNMP_SYNTAX_DISPLAY_STRING },      // hrSystemInitialLoadParameters
+    { { 1, 3, 6, 1, 2, 1, 25, 1, 5 }, SNMP_SYNTAX_GAUGE32 },             // hrSystemNumUsers
+    { { 1, 3, 6, 1, 2, 1, 25, 1, 6 }, SNMP_SYNTAX_GAUGE32 },             // hrSystemProcesses
+    { { 1, 3, 6, 1, 2, 1, 25, 1, 7 }, SNMP_SYNTAX_INTEGER },             // hrSystemMaxProcesses
+    { { 1, 3, 6, 1, 2, 1, 25, 2, 2 }, SNMP_SYNTAX_INTEGER },             // hrMemorySize
+    { { 1, 3, 6, 1, 2, 1, 25, 2, 3, 1, 1 }, SNMP_SYNTAX_INTEGER },       // hrStorageIndex
+    { { 1, 3, 6, 1, 2, 1, 25, 2, 3, 1, 2 }, SNMP_SYNTAX_OBJECT_ID },     // hrStorageType
+    { { 1, 3, 6, 1, 2, 1, 25, 2, 3, 1, 3 }, SNMP_SYNTAX_DISPLAY_STRING },    // hrStorageDescr
+    { { 1, 3, 6, 1, 2, 1, 25, 2, 3, 1, 4 }, SNMP_SYNTAX_INTEGER },       // hrStorageAllocationUnits
+    { { 1, 3, 6, 1, 2, 1, 25, 2, 3, 1, 5 }, SNMP_SYNTAX_INTEGER },       // hrStorageSize
+    { { 1, 3, 6, 1, 2, 1, 25, 2, 3, 1, 6 }, SNMP_SYNTAX_INTEGER },       // hrStorageUsed
+    { { 1, 3, 6, 1, 2, 1, 25, 2, 3, 1, 7 }, SNMP_SYNTAX_COUNTER32 },     // hrStorageAllocationFailures
+    { { 1, 3, 6, 1, 2, 1, 25, 3, 2, 1, 1 }, SNMP_SYNTAX_INTEGER },       // hrDeviceIndex
+    { { 1, 3, 6, 1, 2, 1, 25, 3, 2, 1, 2 }, SNMP_SYNTAX_OBJECT_ID },     // hrDeviceType
+    { { 1, 3, 6, 1, 2, 1, 25, 3, 2, 1, 3 }, SNMP_SYNTAX_DISPLAY_STRING },    // hrDeviceDescr
+    { { 1, 3, 6, 1, 2, 1, 25, 3, 2, 1, 4 }, SNMP_SYNTAX_OBJECT_ID },     // hrDeviceID
+    { { 1, 3, 6, 1, 2, 1, 25, 3, 2, 1, 5 }, SNMP_SYNTAX_ENUM, SNMP_SYNTAX_LABELS(hrDeviceStatusLabels) },   // hrDeviceStatus
+    { { 1, 3, 6, 1, 2, 1, 25, 3, 2, 1, 6 }, SNMP_SYNTAX_COUNTER32 },     // hrDeviceErrors
+    { { 1, 3, 6, 1, 2, 1, 25, 3, 3, 1, 1 }, SNMP_SYNTAX_OBJECT_ID },     // hrProcessorFrwID
+    { { 1, 3, 6, 1, 2, 1, 25, 3, 3, 1, 2 }, SNMP_SYNTAX_INTEGER },       // hrProcessorLoad
+    { { 1, 3, 6, 1, 2, 1, 25, 4, 2, 1, 1 }, SNMP_SYNTAX_INTEGER },       // hrSWRunIndex
+    { { 1, 3, 6, 1, 2, 1, 25, 4, 2, 1, 2 }, SNMP_SYNTAX_DISPLAY_STRING },    // hrSWRunName
+    { { 1, 3, 6, 1, 2, 1, 25, 4, 2, 1, 3 }, SNMP_SYNTAX_OBJECT_ID },     // hrSWRunID
+    { { 1, 3, 6, 1, 2, 1, 25, 4, 2, 1, 4 }, SNMP_SYNTAX_DISPLAY_STRING },    // hrSWRunPath
+    { { 1, 3, 6, 1, 2, 1, 25, 4, 2, 1, 5 }, SNMP_SYNTAX_DISPLAY_STRING },    // hrSWRunParameters
+    { { 1, 3, 6, 1, 2, 1, 25, 4, 2, 1, 6 }, SNMP_SYNTAX_ENUM, SNMP_SYNTAX_LABELS(hrSWRunTypeLabels) },      // hrSWRunType
+    { { 1, 3, 6, 1, 2, 1, 25, 4, 2, 1, 7 }, SNMP_SYNTAX_ENUM, SNMP_SYNTAX_LABELS(hrSWRunStatusLabels) },    // hrSWRunStatus
+
+    // IF-MIB: ifXTable
+    { { 1, 3, 6, 1, 2, 1, 31, 1, 1, 1, 1 }, SNMP_SYNTAX_DISPLAY_STRING },    // ifName
+    { { 1, 3, 6, 1, 2, 1, 31, 1, 1, 1, 2 }, SNMP_SYNTAX_COUNTER32 },     // ifInMulticastPkts
+    { { 1, 3, 6, 1, 2, 1, 31, 1, 1, 1, 3 }, SNMP_SYNTAX_COUNTER32 },     // ifInBroadcastPkts
+    { { 1, 3, 6, 1, 2, 1, 31, 1, 1, 1, 4 }, SNMP_SYNTAX_COUNTER32 },     // ifOutMulticastPkts
+    { { 1, 3, 6, 1, 2, 1, 31, 1, 1, 1, 5 }, SNMP_SYNTAX_COUNTER32 },     // ifOutBroadcastPkts
+    { { 1, 3, 6, 1, 2, 1, 31, 1, 1, 1, 6 }, SNMP_SYNTAX_COUNTER64 },     // ifHCInOctets
+    { { 1, 3, 6, 1, 2, 1, 31, 1, 1, 1, 7 }, SNMP_SYNTAX_COUNTER64 },     // ifHCInUcastPkts
+    { { 1, 3, 6, 1, 2, 1, 31, 1, 1, 1, 8 }, SNMP_SYNTAX_COUNTER64 },     // ifHCInMulticastPkts
+    { { 1, 3, 6, 1, 2, 1, 31, 1, 1, 1, 9 }, SNMP_SYNTAX_COUNTER64 },     // ifHCInBroadcastPkts
+    { { 1, 3, 6, 1, 2, 1, 31, 1, 1, 1, 10 }, SNMP_SYNTAX_COUNTER64 },    // ifHCOutOctets
+    { { 1, 3, 6, 1, 2, 1, 31, 1, 1, 1, 11 }, SNMP_SYNTAX_COUNTER64 },    // ifHCOutUcastPkts
+    { { 1, 3, 6, 1, 2, 1, 31, 1, 1, 1, 12 }, SNMP_SYNTAX_COUNTER64 },    // ifHCOutMulticastPkts
+    { { 1, 3, 6, 1, 2, 1, 31, 1, 1, 1, 13 }, SNMP_SYNTAX_COUNTER64 },    // ifHCOutBroadcastPkts
+    { { 1, 3, 6, 1, 2, 1, 31, 1, 1, 1, 14 }, SNMP_SYNTAX_ENUM, SNMP_SYNTAX_LABELS(enabledLabels) },     // ifLinkUpDownTrapEnable
+    { { 1, 3, 6, 1, 2, 1, 31, 1, 1, 1, 15 }, SNMP_SYNTAX_GAUGE32 },      // ifHighSpeed
+    { { 1, 3, 6, 1, 2, 1, 31, 1, 1, 1, 16 }, SNMP_SYNTAX_ENUM, SNMP_SYNTAX_LABELS(truthValueLabels) },  // ifPromiscuousMode
+    { { 1, 3, 6, 1, 2, 1, 31, 1, 1, 1, 17 }, SNMP_SYNTAX_ENUM, SNMP_SYNTAX_LABELS(truthValueLabels) },  // ifConnectorPresent
+    { { 1, 3, 6, 1, 2, 1, 31, 1, 1, 1, 18 }, SNMP_SYNTAX_DISPLAY_STRING },   // ifAlias
+    { { 1, 3, 6, 1, 2, 1, 31, 1, 1, 1, 19 }, SNMP_SYNTAX_TIMETICKS },    // ifCounterDiscontinuityTime
+    { { 1, 3, 6, 1, 2, 1, 31, 1, 5 }, SNMP_SYNTAX_TIMETICKS },           // ifTableLastChange
+    { { 1, 3, 6, 1, 2, 1, 31, 1, 6 }, SNMP_SYNTAX_TIMETICKS },           // ifStackLastChange
+
+    // DISMAN-PING-MIB: pingCtlTable, адрес цели - InetAddress
+    { { 1, 3, 6, 1, 2, 1, 80, 1, 2, 1, 3 }, SNMP_SYNTAX_ENUM, SNMP_SYNTAX_LABELS(inetAddressTypeLabels) },  // pingCtlTargetAddressType
+    { { 1, 3, 6, 1, 2, 1, 80, 1, 2, 1, 4 }, SNMP_SYNTAX_INET_ADDRESS },  // pingCtlTargetAddress
+};
+
+#define SNMP_SYNTAX_BINDING_COUNT (sizeof(syntaxBindings) / sizeof(syntaxBindings[0]))
+
+constexpr int SnmpSyntaxCompare(const SnmpOidLiteral& oid1, const SnmpOidLiteral& oid2) {
+    UINT length = oid1.length < oid2.length ? oid1.length : oid2.length;
+    for (UINT i = 0; i < length; i++) {
+        if (oid1.arcs[i] != oid2.arcs[i]) return oid1.arcs[i] < oid2.arcs[i] ? -1 : 1;
+    }
+    if (oid1.length == oid2.length) return 0;
+    return oid1.length < oid2.length ? -1 : 1;
+}
+
+constexpr bool SnmpSyntaxSorted() {
+    for (size_t i = 1; i < SNMP_SYNTAX_BINDING_COUNT; i++) {
+        if (SnmpSyntaxCompare(syntaxBindings[i - 1].oid, syntaxBindings[i].oid) >= 0) return false;
+    }
+    return true;
+}
+
+static_assert(SnmpSyntaxSorted(), "syntaxBindings must be sorted by OID without duplicates");
+
+// Хеш-таблица привязок с открытой адресацией по хешу OID (SnmpOidLiteral::hash), собранная
+// при компиляции. Поиск хеширует префиксы OID за один проход и пробует их от длинного к короткому:
+// двоичный поиск сравнивал бы общие дуги 1.3.6.1.2.1 на каждом шаге.
+#define SNMP_SYNTAX_HASH_SIZE 512
+
+static_assert(SNMP_SYNTAX_BINDING_COUNT * 2 <= SNMP_SYNTAX_HASH_SIZE, "SNMP_SYNTAX_HASH_SIZE is too small");
+
+struct SnmpSyntaxHash {
+    WORD slots[SNMP_SYNTAX_HASH_SIZE] = {};   // номер привязки + 1, 0 - пусто
+    UINT minLength = SNMP_OID_INLINE_ARCS;
+    UINT maxLength = 0;
+};
+
+constexpr SnmpSyntaxHash SnmpSyntaxBuildHash() {
+    SnmpSyntaxHash table;
+    for (size_t i = 0; i < SNMP_SYNTAX_BINDING_COUNT; i++) {
+        const SnmpOidLiteral& oid = syntaxBindings[i].oid;
+        size_t slot = (size_t)oid.hash & (SNMP_SYNTAX_HASH_SIZE - 1);
+        while (table.slots[slot] != 0) slot = (slot + 1) & (SNMP_SYNTAX_HASH_SIZE - 1);
+        table.slots[slot] = (WORD)(i + 1);
+        if (oid.length < table.minLength) table.minLength = oid.length;
+        if (oid.length > table.maxLength) table.maxLength = oid.length;
+    }
+    return table;
+}
+
+static constexpr SnmpSyntaxHash syntaxHash = SnmpSyntaxBuildHash();
+
+constexpr BYTE SnmpSyntaxType(SnmpSyntax syntax) {
+    switch (syntax) {
+    case SNMP_SYNTAX_INTEGER:
+    case SNMP_SYNTAX_ENUM:
+        return ASN_INTEGER;
+    case SNMP_SYNTAX_COUNTER32:
+        return ASN_COUNTER32;
+    case SNMP_SYNTAX_COUNTER64:
+        return ASN_COUNTER64;
+    case SNMP_SYNTAX_GAUGE32:
+        return ASN_GAUGE32;
+    case SNMP_SYNTAX_TIMETICKS:
+        return ASN_TIMETICKS;
+    case SNMP_SYNTAX_DISPLAY_STRING:
+    case SNMP_SYNTAX_PHYS_ADDRESS:
+    case SNMP_SYNTAX_INET_ADDRESS:
+    case SNMP_SYNTAX_DATE_AND_TIME:
+        return ASN_OCTETSTRING;
+    case SNMP_SYNTAX_IP_ADDRESS:
+        return ASN_IPADDRESS;
+    case SNMP_SYNTAX_OBJECT_ID:
+        return ASN_OBJECTIDENTIFIER;
+    default:
+        return 0;
+    }
+}
+
+static void SnmpSyntaxFormatIpv4(std::string& out, const BYTE* data) {
+    for (UINT i = 0; i < 4; i++) {
+        if (i > 0) out.push_back('.');
+        SnmpFormatUnsigned(out, data[i]);
+    }
+}
+
+// IPv6 в сокращённой записи RFC 5952: группы без ведущих нулей, самая длинная серия нулевых групп - "::"
+static void SnmpSyntaxFormatIpv6(std::string& out, const BYTE* data) {
+    UINT groups[8];
+    for (UINT i = 0; i < 8; i++) {
+        groups[i] = (UINT)data[2 * i] << 8 | data[2 * i + 1];
+    }
+
+    UINT zeroStart = 8, zeroLength = 1;
+    for (UINT i = 0; i < 8; ) {
+        UINT end = i;
+        while (end < 8 && groups[end] == 0) end++;
+        if (end - i > zeroLength) {
+            zeroStart = i;
+            zeroLength = end - i;
+        }
+        i = end > i ? end : i + 1;
+    }
+
+    char digits[8];
+    for (UINT i = 0; i < 8; i++) {
+        if (i == zeroStart) {
+            out.append("::");
+            i += zeroLength - 1;
+            continue;
+        }
+        if (i > 0 && i != zeroStart + zeroLength) out.push_back(':');
+        std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), groups[i], 16);
+        out.append(digits, result.ptr);
+    }
+}
+
+// Разбор значения синтаксиса syntax. Ветвь выбирается при компиляции, во время
+// разбора проверяется только тип значения.
+template <SnmpSyntax syntax>
+static bool SnmpSyntaxDecode(std::string& out, const AsnAny& value, const SnmpSyntaxBinding& binding) {
+    if (syntax == SNMP_SYNTAX_UNKNOWN || value.asnType != SnmpSyntaxType(syntax)) return false;
+
+    const BYTE* bytes = value.asnValue.string.stream;
+    UINT length = value.asnValue.string.length;
+    if constexpr (syntax == SNMP_SYNTAX_INTEGER) {
+        SnmpFormatSigned(out, value.asnValue.number);
+    }
+    else if constexpr (syntax == SNMP_SYNTAX_ENUM) {
+        AsnInteger32 number = value.asnValue.number;
+        if (number >= 0 && (UINT)number < binding.labelCount && binding.labels[number] != NULL) {
+            out.append(binding.labels[number]);
+            out.push_back('(');
+            SnmpFormatSigned(out, number);
+            out.push_back(')');
+        }
+        else {
+            SnmpFormatSigned(out, number);
+        }
+    }
+    else if constexpr (syntax == SNMP_SYNTAX_COUNTER32 || syntax == SNMP_SYNTAX_GAUGE32 || syntax == SNMP_SYNTAX_TIMETICKS) {
+        SnmpFormatUnsigned(out, value.asnValue.unsigned32);
+    }
+    else if constexpr (syntax == SNMP_SYNTAX_COUNTER64) {
+        SnmpFormatUnsigned(out, value.asnValue.counter64.QuadPart);
+    }
+    else if constexpr (syntax == SNMP_SYNTAX_DISPLAY_STRING) {
+        while (length > 0 && bytes[length - 1] == 0) length--;
+        if (SnmpFormatIsPrintable(bytes, length)) {
+            out.append((const char*)bytes, length);
+        }
+        else {
+            // Не DisplayString вопреки MIB (например, UTF-8): байты в hex, чтобы не портить вывод
+            SnmpFormatHexSeparated(out, bytes, length, ' ');
+        }
+    }
+    else if constexpr (syntax == SNMP_SYNTAX_PHYS_ADDRESS) {
+        SnmpFormatHexSeparated(out, bytes, length, '-');
+    }
+    else if constexpr (syntax == SNMP_SYNTAX_IP_ADDRESS) {
+        if (length == 4) SnmpSyntaxFormatIpv4(out, bytes);
+        else SnmpFormatHexSeparated(out, bytes, length, ' ');
+    }
+    else if constexpr (syntax == SNMP_SYNTAX_INET_ADDRESS) {
+        // ipv4 (4), ipv6 (16) и они же с индексом зоны (8, 20); остальное (dns) - текст или hex
+        if (length == 4 || length == 8) SnmpSyntaxFormatIpv4(out, bytes);
+        else if (length == 16 || length == 20) SnmpSyntaxFormatIpv6(out, bytes);
+        else if (SnmpFormatIsPrintable(bytes, length)) out.append((const char*)bytes, length);
+        else SnmpFormatHexSeparated(out, bytes, length, ' ');
+
+        if (length == 8 || length == 20) {
+            const BYTE* zone = bytes + length - 4;
+            out.push_back('%');
+            SnmpFormatUnsigned(out, (UINT)zone[0] << 24 | (UINT)zone[1] << 16 | (UINT)zone[2] << 8 | zone[3]);
+        }
+    }
+    else if constexpr (syntax == SNMP_SYNTAX_DATE_AND_TIME) {
+        // год (2 байта), месяц, день, часы, минуты, секунды, десятые; с 11 байтами - смещение от UTC
+        if (length != 8 && length != 11) {
+            SnmpFormatHexSeparated(out, bytes, length, ' ');
+            return true;
+        }
+        SnmpFormatUnsigned(out, (UINT)bytes[0] << 8 | bytes[1]);
+        static const char separators[] = "--,::.";
+        for (UINT i = 2; i < 8; i++) {
+            out.push_back(separators[i - 2]);
+            SnmpFormatUnsigned(out, bytes[i]);
+        }
+        if (length == 11) {
+            out.push_back(',');
+            out.push_back((char)bytes[8]);
+            SnmpFormatUnsigned(out, bytes[9]);
+            out.push_back(':');
+            SnmpFormatUnsigned(out, bytes[10]);
+        }
+    }
+    else if constexpr (syntax == SNMP_SYNTAX_OBJECT_ID) {
+        SnmpFormatOid(out, value.asnValue.object.ids, value.asnValue.object.idLength);
+    }
+    (void)binding;
+    (void)bytes;
+    return true;
+}
+
+// Таблица разборщиков по синтаксису, собранная из экземпляров шаблона при компиляции
+typedef std::array<SnmpSyntaxDecoder, SNMP_SYNTAX_COUNT> SnmpSyntaxDecoders;
+
+template <size_t... syntaxes>
+constexpr SnmpSyntaxDecoders SnmpSyntaxBuildDecoders(std::index_sequence<syntaxes...>) {
+    return SnmpSyntaxDecoders{ { &SnmpSyntaxDecode<(SnmpSyntax)syntaxes>... } };
+}
+
+static constexpr SnmpSyntaxDecoders syntaxDecoders = SnmpSyntaxBuildDecoders(std::make_index_sequence<SNMP_SYNTAX_COUNT>());
+
+const SnmpSyntaxBinding* SnmpSyntaxFind(const UINT* ids, size_t length) {
+    // hashes[n] - хеш первых n дуг, как у SnmpOidLiteral той же длины
+    ULONGLONG hashes[SNMP_OID_INLINE_ARCS + 1];
+    size_t longest = length < syntaxHash.maxLength ? length : syntaxHash.maxLength;
+    hashes[0] = SNMP_OID_HASH_BASIS;
+    for (size_t i = 0; i < longest; i++) {
+        hashes[i + 1] = SnmpOidHashStep(hashes[i], ids[i]);
+    }
+
+    for (size_t prefix = longest; prefix >= syntaxHash.minLength; prefix--) {
+        size_t slot = (size_t)hashes[prefix] & (SNMP_SYNTAX_HASH_SIZE - 1);
+        while (syntaxHash.slots[slot] != 0) {
+            const SnmpSyntaxBinding& binding = syntaxBindings[syntaxHash.slots[slot] - 1];
+            if (binding.oid.hash == hashes[prefix] && binding.oid.length == prefix
+                && SnmpOidStartsWith(ids, length, binding.oid.arcs, prefix)) {
+                return &binding;
+            }
+            slot = (slot + 1) & (SNMP_SYNTAX_HASH_SIZE - 1);
+        }
+    }
+    return NULL;
+}
+
+SnmpSyntaxDecoder SnmpSyntaxGetDecoder(SnmpSyntax syntax) {
+    return syntax < SNMP_SYNTAX_COUNT ? syntaxDecoders[syntax] : syntaxDecoders[SNMP_SYNTAX_UNKNOWN];
+}
+
+BYTE SnmpSyntaxAsnType(SnmpSyntax syntax) {
+    return SnmpSyntaxType(syntax);
+}
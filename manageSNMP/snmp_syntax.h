@@ -0,0 +1,48 @@
+﻿#pragma once
+
+#include <string>
+#include "snmp_oid.h"
+
+// Синтаксис объекта MIB (тип SMI с текстовым соглашением): определяет, как разбирать значение.
+// Общий разбор смотрит только на asnType и длину строки, поэтому путает 6-байтовую строку
+// с MAC-адресом и 4-байтовую - с IP; по синтаксису объекта значение разбирается однозначно.
+enum SnmpSyntax : BYTE {
+    SNMP_SYNTAX_UNKNOWN,          // объект не описан: общий разбор
+    SNMP_SYNTAX_INTEGER,
+    SNMP_SYNTAX_ENUM,             // INTEGER с именованными значениями: "up(1)"
+    SNMP_SYNTAX_COUNTER32,
+    SNMP_SYNTAX_COUNTER64,
+    SNMP_SYNTAX_GAUGE32,
+    SNMP_SYNTAX_TIMETICKS,
+    SNMP_SYNTAX_DISPLAY_STRING,   // текст; завершающие нули, которые шлют некоторые агенты, отбрасываются
+    SNMP_SYNTAX_PHYS_ADDRESS,     // "00-1B-21-0A-FF-01" при любой длине и любых байтах
+    SNMP_SYNTAX_IP_ADDRESS,
+    SNMP_SYNTAX_INET_ADDRESS,     // InetAddress (RFC 4001): IPv4 или IPv6 по длине, с зоной
+    SNMP_SYNTAX_DATE_AND_TIME,    // "2024-3-15,10:20:30.0,+3:0"
+    SNMP_SYNTAX_OBJECT_ID,
+    SNMP_SYNTAX_COUNT
+};
+
+// Привязка поддерева OID (колонки таблицы, скаляра или целой группы) к синтаксису.
+// Для перечисления labels[значение] - имя значения или NULL.
+struct SnmpSyntaxBinding {
+    SnmpOidLiteral oid;
+    SnmpSyntax syntax;
+    const char* const* labels = NULL;
+    UINT labelCount = 0;
+};
+
+// Разбор значения одного синтаксиса: дописывает текст значения без типа (как SnmpFormatValueText).
+// false, если тип значения не тот, что у синтаксиса (исключение, ошибка агента) - тогда ничего не пишется.
+typedef bool (*SnmpSyntaxDecoder)(std::string& out, const AsnAny& value, const SnmpSyntaxBinding& binding);
+
+// Привязка с самым длинным префиксом OID: поиск в хеш-таблице, собранной при компиляции
+// из подмножества MIB-2 (system, interfaces, ip, tcp, udp, ifXTable, HOST-RESOURCES-MIB, ping).
+// NULL, если OID не описан.
+const SnmpSyntaxBinding* SnmpSyntaxFind(const UINT* ids, size_t length);
+
+// Разборщик синтаксиса: выбирается один раз на колонку, а не на каждое значение
+SnmpSyntaxDecoder SnmpSyntaxGetDecoder(SnmpSyntax syntax);
+
+// Тип ASN.1, которым синтаксис передаётся в PDU (0 для SNMP_SYNTAX_UNKNOWN)
+BYTE SnmpSyntaxAsnType(SnmpSyntax syntax);
@@ -0,0 +1,305 @@
+﻿#include "snmp_table.h"
+
+#include <cmath>
+#include <cstring>
+
+// Функция хеша индекса строки
+static ULONGLONG SnmpTableHash(const UINT* index, size_t length) {
+    ULONGLONG hash = SNMP_OID_HASH_BASIS;
+    for (size_t i = 0; i < length; i++) {
+        hash = SnmpOidHashStep(hash, index[i]);
+    }
+    return hash;
+}
+
+// Функция сравнения индекса строки row с index
+static bool SnmpTableRowIs(const SnmpTable& table, size_t row, const UINT* index, size_t length) {
+    size_t rowLength;
+    const UINT* rowIndex = SnmpTableRowIndex(table, row, rowLength);
+    return rowLength == length && memcmp(rowIndex, index, length * sizeof(UINT)) == 0;
+}
+
+// Функция поиска ячейки хеш-таблицы: строка с этим индексом или пустое место для неё
+static size_t SnmpTableProbe(const SnmpTable& table, const UINT* index, size_t length) {
+    size_t mask = table.slots.size() - 1;
+    size_t slot = (size_t)SnmpTableHash(index, length) & mask;
+    while (table.slots[slot] != 0) {
+        if (SnmpTableRowIs(table, table.slots[slot] - 1, index, length)) break;
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+// Функция удвоения хеш-таблицы; заполнение держится не выше половины
+static void SnmpTableGrow(SnmpTable& table) {
+    table.slots.assign(table.slots.empty() ? 64 : table.slots.size() * 2, 0);
+    for (size_t row = 0; row < SnmpTableRows(table); row++) {
+        size_t length;
+        const UINT* index = SnmpTableRowIndex(table, row, length);
+        table.slots[SnmpTableProbe(table, index, length)] = (UINT)row + 1;
+    }
+}
+
+void SnmpTableInit(SnmpTable& table, const SnmpOid& tableOid) {
+    table.entry = tableOid;
+    table.entry.Append(1);
+    table.indexArcs.clear();
+    table.indexOffsets.assign(1, 0);
+    table.slots.clear();
+    table.columns.clear();
+    table.lastColumn = 0;
+    table.lastRow = 0;
+}
+
+bool SnmpTableFindRow(const SnmpTable& table, const UINT* index, size_t length, size_t& row) {
+    if (table.slots.empty()) return false;
+    size_t slot = SnmpTableProbe(table, index, length);
+    if (table.slots[slot] == 0) return false;
+    row = table.slots[slot] - 1;
+    return true;
+}
+
+const SnmpTableColumn* SnmpTableFindColumn(const SnmpTable& table, UINT arc) {
+    for (const SnmpTableColumn& column : table.columns) {
+        if (column.arc == arc) return &column;
+    }
+    return NULL;
+}
+
+// Функция поиска строки по индексу с добавлением новой
+static size_t SnmpTableRow(SnmpTable& table, const UINT* index, size_t length) {
+    if ((SnmpTableRows(table) + 1) * 2 > table.slots.size()) {
+        SnmpTableGrow(table);
+    }
+    size_t slot = SnmpTableProbe(table, index, length);
+    if (table.slots[slot] != 0) return table.slots[slot] - 1;
+
+    size_t row = SnmpTableRows(table);
+    table.indexArcs.insert(table.indexArcs.end(), index, index + length);
+    table.indexOffsets.push_back((UINT)table.indexArcs.size());
+    table.slots[slot] = (UINT)row + 1;
+    return row;
+}
+
+// Функция записи значения в ячейку колонки
+static void SnmpTableStore(SnmpTableColumn& column, size_t row, const AsnAny& value) {
+    if (column.types.size() <= row) column.types.resize(row + 1, 0);
+    if (column.types[row] == 0) column.count++;
+    column.types[row] = value.asnType;
+    if (column.type == 0) column.type = value.asnType;
+    else if (column.type != value.asnType) column.type = SNMP_TABLE_MIXED;
+
+    const BYTE* bytes = NULL;
+    size_t length = 0;
+    ULONGLONG number = 0;
+    bool isNumber = true;
+    switch (value.asnType) {
+    case ASN_INTEGER:
+        number = (ULONGLONG)(long long)value.asnValue.number;
+        break;
+    case ASN_COUNTER32:
+    case ASN_GAUGE32:
+    case ASN_TIMETICKS:
+    case ASN_UNSIGNED32:
+        number = value.asnValue.unsigned32;
+        break;
+    case ASN_COUNTER64:
+        number = value.asnValue.counter64.QuadPart;
+        break;
+    case ASN_OCTETSTRING:
+    case ASN_OPAQUE:
+    case ASN_BITS:
+    case ASN_IPADDRESS:
+        isNumber = false;
+        bytes = value.asnValue.string.stream;
+        length = value.asnValue.string.length;
+        break;
+    case ASN_OBJECTIDENTIFIER:
+        // Дуги читаются обратно как UINT, поэтому их начало выравнивается
+        isNumber = false;
+        column.data.resize((column.data.size() + sizeof(UINT) - 1) & ~(sizeof(UINT) - 1));
+        bytes = (const BYTE*)value.asnValue.object.ids;
+        length = value.asnValue.object.idLength * sizeof(UINT);
+        break;
+    default:
+        isNumber = false;
+        break;
+    }
+
+    // Числа и байты одной строки исключают друг друга: второе поле ячейки обнуляется
+    if (isNumber || !column.numbers.empty()) {
+        if (column.numbers.size() <= row) column.numbers.resize(row + 1, 0);
+        column.numbers[row] = number;
+    }
+    if (!isNumber || !column.offsets.empty()) {
+        if (column.offsets.size() <= row) {
+            column.offsets.resize(row + 1, 0);
+            column.lengths.resize(row + 1, 0);
+        }
+        column.offsets[row] = (UINT)column.data.size();
+        column.lengths[row] = (UINT)length;
+        if (length > 0) column.data.insert(column.data.end(), bytes, bytes + length);
+    }
+}
+
+bool SnmpTableAdd(SnmpTable& table, const RFC1157VarBind& varBind) {
+    const AsnObjectIdentifier& name = varBind.name;
+    size_t prefix = table.entry.Length();
+    // После OID записи - номер колонки и хотя бы одна дуга индекса
+    if (name.idLength < prefix + 2 || !SnmpOidStartsWith(name.ids, name.idLength, table.entry.Data(), prefix)) {
+        SetLastError(ERROR_INVALID_PARAMETER);
+        return false;
+    }
+    BYTE type = varBind.value.asnType;
+    if (type >= SNMP_EXCEPTION_NOSUCHOBJECT && type <= SNMP_EXCEPTION_ENDOFMIBVIEW) return true;
+
+    UINT arc = name.ids[prefix];
+    bool columnChanged = table.lastColumn >= table.columns.size() || table.columns[table.lastColumn].arc != arc;
+    if (columnChanged) {
+        size_t i = 0;
+        while (i < table.columns.size() && table.columns[i].arc != arc) i++;
+        if (i == table.columns.size()) {
+            table.columns.emplace_back();
+            table.columns.back().arc = arc;
+        }
+        table.lastColumn = i;
+    }
+
+    // Обход идёт по колонкам, и строки следующей колонки обычно идут в том же порядке:
+    // сначала проверяется строка после предыдущей, хеш считается только при промахе
+    const UINT* index = name.ids + prefix + 1;
+    size_t length = name.idLength - prefix - 1;
+    size_t row = columnChanged ? 0 : table.lastRow + 1;
+    if (row >= SnmpTableRows(table) || !SnmpTableRowIs(table, row, index, length)) {
+        row = SnmpTableRow(table, index, length);
+    }
+    table.lastRow = row;
+    SnmpTableStore(table.columns[table.lastColumn], row, varBind.value);
+    return true;
+}
+
+bool SnmpTableGet(const SnmpTableColumn& column, size_t row, AsnAny& value) {
+    memset(&value, 0, sizeof(value));
+    if (row >= column.types.size() || column.types[row] == 0) return false;
+
+    value.asnType = column.types[row];
+    ULONGLONG number = row < column.numbers.size() ? column.numbers[row] : 0;
+    BYTE* bytes = row < column.offsets.size() ? (BYTE*)column.data.data() + column.offsets[row] : NULL;
+    UINT length = row < column.lengths.size() ? column.lengths[row] : 0;
+    switch (value.asnType) {
+    case ASN_INTEGER:
+        value.asnValue.number = (AsnInteger32)(long long)number;
+        break;
+    case ASN_COUNTER32:
+    case ASN_GAUGE32:
+    case ASN_TIMETICKS:
+    case ASN_UNSIGNED32:
+        value.asnValue.unsigned32 = (AsnUnsigned32)number;
+        break;
+    case ASN_COUNTER64:
+        value.asnValue.counter64.QuadPart = number;
+        break;
+    case ASN_OCTETSTRING:
+    case ASN_OPAQUE:
+    case ASN_BITS:
+    case ASN_IPADDRESS:
+        value.asnValue.string.stream = bytes;
+        value.asnValue.string.length = length;
+        value.asnValue.string.dynamic = FALSE;
+        break;
+    case ASN_OBJECTIDENTIFIER:
+        value.asnValue.object.ids = (UINT*)bytes;
+        value.asnValue.object.idLength = length / sizeof(UINT);
+        break;
+    default:
+        break;
+    }
+    return true;
+}
+
+ULONGLONG SnmpTableSum(const SnmpTableColumn& column) {
+    // Простой цикл по непрерывному массиву - компилятор векторизует его (SSE2/AVX2)
+    const ULONGLONG* numbers = column.numbers.data();
+    size_t count = column.numbers.size();
+    ULONGLONG sum = 0;
+    for (size_t i = 0; i < count; i++) {
+        sum += numbers[i];
+    }
+    return sum;
+}
+
+// Функция прироста счётчика: Counter32 по модулю 2^32, уменьшение Counter64 - сброс (-1)
+static inline double SnmpTableDelta(BYTE type, ULONGLONG before, ULONGLONG after) {
+    if (type == ASN_COUNTER32) return (double)((after - before) & 0xFFFFFFFFULL);
+    return after >= before ? (double)(after - before) : -1;
+}
+
+// Функция проверки, что строки двух снимков совпадают по порядку и индексам
+static bool SnmpTableSameRows(const SnmpTable& table1, const SnmpTable& table2) {
+    return table1.indexOffsets == table2.indexOffsets && table1.indexArcs == table2.indexArcs;
+}
+
+double SnmpTableRates(const SnmpTable& previous, const SnmpTable& current, UINT arc, double seconds,
+    std::vector<double>& rates) {
+    size_t rows = SnmpTableRows(current);
+    rates.assign(rows, NAN);
+
+    const SnmpTableColumn* before = SnmpTableFindColumn(previous, arc);
+    const SnmpTableColumn* after = SnmpTableFindColumn(current, arc);
+    if (before == NULL || after == NULL || seconds <= 0) return 0;
+    BYTE type = after->type;
+    if ((type != ASN_COUNTER32 && type != ASN_COUNTER64) || before->type != type) return 0;
+
+    double total = 0;
+    if (after->count == rows && before->count == rows && SnmpTableSameRows(previous, current)) {
+        // Те же строки в том же порядке и все ячейки заполнены: поэлементный проход
+        // по двум массивам без поиска строк, который компилятор векторизует
+        const ULONGLONG* oldNumbers = before->numbers.data();
+        const ULONGLONG* newNumbers = after->numbers.data();
+        double* out = rates.data();
+        double scale = 1 / seconds;
+        if (type == ASN_COUNTER32) {
+            for (size_t row = 0; row < rows; row++) {
+                out[row] = (double)((newNumbers[row] - oldNumbers[row]) & 0xFFFFFFFFULL) * scale;
+            }
+        }
+        else {
+            for (size_t row = 0; row < rows; row++) {
+                out[row] = newNumbers[row] >= oldNumbers[row]
+                    ? (double)(newNumbers[row] - oldNumbers[row]) * scale : NAN;
+            }
+        }
+        for (size_t row = 0; row < rows; row++) {
+            total += std::isnan(out[row]) ? 0 : out[row];
+        }
+        return total;
+    }
+
+    for (size_t row = 0; row < rows; row++) {
+        if (row >= after->types.size() || after->types[row] != type) continue;
+        size_t length;
+        const UINT* index = SnmpTableRowIndex(current, row, length);
+        size_t oldRow;
+        if (!SnmpTableFindRow(previous, index, length, oldRow) ||
+            oldRow >= before->types.size() || before->types[oldRow] != type) {
+            continue;
+        }
+        double delta = SnmpTableDelta(type, before->numbers[oldRow], after->numbers[row]);
+        if (delta < 0) continue;
+        rates[row] = delta / seconds;
+        total += rates[row];
+    }
+    return total;
+}
+
+size_t SnmpTableMemory(const SnmpTable& table) {
+    size_t bytes = sizeof(SnmpTable) + table.indexArcs.capacity() * sizeof(UINT)
+        + table.indexOffsets.capacity() * sizeof(UINT) + table.slots.capacity() * sizeof(UINT)
+        + table.columns.capacity() * sizeof(SnmpTableColumn);
+    for (const SnmpTableColumn& column : table.columns) {
+        bytes += column.types.capacity() + column.numbers.capacity() * sizeof(ULONGLONG)
+            + column.offsets.capacity() * sizeof(UINT) + column.lengths.capacity() * sizeof(UINT)
+            + column.data.capacity();
+    }
+    return bytes;
+}
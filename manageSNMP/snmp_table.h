@@ -0,0 +1,73 @@
+﻿#pragma once
+
+#include <vector>
+#include "snmp_oid.h"
+
+// Тип колонки, в которой встретились значения разных типов
+#define SNMP_TABLE_MIXED 0xFF
+
+// Колонка таблицы: значения по строкам в непрерывных массивах без отдельных выделений памяти.
+// Числа (INTEGER, Counter32/64, Gauge32, TimeTicks) - в numbers, INTEGER со знаковым расширением.
+// Байты строк и дуги OID-значений - в общем data, ячейка ссылается на них через offsets/lengths.
+// Пустая ячейка - тип 0 и число 0, поэтому сумма по numbers её не учитывает.
+// Массивы растут по мере записи строк, поэтому бывают короче числа строк таблицы.
+struct SnmpTableColumn {
+    UINT arc = 0;                 // номер колонки: дуга после OID записи (ifDescr - 2)
+    BYTE type = 0;                // тип значений колонки или SNMP_TABLE_MIXED
+    size_t count = 0;             // заполненных ячеек
+    std::vector<BYTE> types;      // тип ячейки по строке, 0 - нет значения
+    std::vector<ULONGLONG> numbers;
+    std::vector<UINT> offsets;    // начало байтов ячейки в data
+    std::vector<UINT> lengths;    // длина в байтах
+    std::vector<BYTE> data;
+};
+
+// Таблица, собранная из обхода: колонки по OID колонки, строки по индексу (дугам после колонки).
+// Индексы строк хранятся подряд в indexArcs; поиск строки по индексу - через открытую
+// хеш-таблицу slots (номер строки + 1, 0 - пусто) без выделения памяти на строку.
+struct SnmpTable {
+    SnmpOid entry;                // OID записи таблицы: таблица + .1 (ifEntry)
+    std::vector<UINT> indexArcs;
+    std::vector<UINT> indexOffsets;           // начало индекса строки; строк + 1 элементов
+    std::vector<UINT> slots;
+    std::vector<SnmpTableColumn> columns;     // в порядке появления в обходе
+    size_t lastColumn = 0;        // колонка и строка прошлого varbind: обход идёт по колонкам
+    size_t lastRow = 0;
+};
+
+// Подготовка к сборке таблицы tableOid (ifTable 1.3.6.1.2.1.2.2), ёмкость массивов сохраняется
+void SnmpTableInit(SnmpTable& table, const SnmpOid& tableOid);
+
+// Очередной varbind обхода таблицы. false (ERROR_INVALID_PARAMETER), если OID не из таблицы.
+// Исключения (noSuchInstance, endOfMibView) пропускаются; повтор ячейки заменяет значение.
+bool SnmpTableAdd(SnmpTable& table, const RFC1157VarBind& varBind);
+
+inline size_t SnmpTableRows(const SnmpTable& table) {
+    return table.indexOffsets.empty() ? 0 : table.indexOffsets.size() - 1;
+}
+
+// Индекс строки row (например, одна дуга ifIndex или четыре дуги IP-адреса)
+inline const UINT* SnmpTableRowIndex(const SnmpTable& table, size_t row, size_t& length) {
+    length = table.indexOffsets[row + 1] - table.indexOffsets[row];
+    return table.indexArcs.data() + table.indexOffsets[row];
+}
+
+bool SnmpTableFindRow(const SnmpTable& table, const UINT* index, size_t length, size_t& row);
+
+// Колонка по номеру (дуге после OID записи); NULL, если её не было в обходе
+const SnmpTableColumn* SnmpTableFindColumn(const SnmpTable& table, UINT arc);
+
+// Значение ячейки; байты и дуги ссылаются на массивы колонки. false, если ячейка пуста.
+bool SnmpTableGet(const SnmpTableColumn& column, size_t row, AsnAny& value);
+
+// Сумма чисел колонки (для INTEGER - в дополнительном коде). Нечисловые и пустые ячейки дают 0.
+ULONGLONG SnmpTableSum(const SnmpTableColumn& column);
+
+// Скорость счётчика колонки arc между двумя снимками одной таблицы, снятыми с интервалом seconds.
+// rates - по строкам current, NaN для строк без пары, не-счётчиков и сброшенных Counter64;
+// Counter32 при уменьшении считается переполнившимся. Возвращает суммарную скорость строк.
+double SnmpTableRates(const SnmpTable& previous, const SnmpTable& current, UINT arc, double seconds,
+    std::vector<double>& rates);
+
+// Память под данные таблицы в байтах (по ёмкости массивов)
+size_t SnmpTableMemory(const SnmpTable& table);
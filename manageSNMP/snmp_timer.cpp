@@ -0,0 +1,47 @@
+﻿#include "snmp_timer.h"
+
+void SnmpTimerWheelInit(SnmpTimerWheel& wheel, DWORD tickMs, size_t slotCount, ULONGLONG nowMs) {
+    wheel.tickMs = tickMs ? tickMs : 1;
+    wheel.slots.assign(slotCount ? slotCount : 1, SnmpTimer());
+    for (SnmpTimer& head : wheel.slots) {
+        head.prev = head.next = &head;
+    }
+    wheel.currentTick = nowMs / wheel.tickMs;
+    wheel.count = 0;
+}
+
+void SnmpTimerSchedule(SnmpTimerWheel& wheel, SnmpTimer& timer, ULONGLONG expireMs) {
+    if (SnmpTimerIsScheduled(timer)) {
+        SnmpTimerCancel(wheel, timer);
+    }
+
+    // Округляем вверх: таймер не должен сработать раньше срока
+    ULONGLONG tick = (expireMs + wheel.tickMs - 1) / wheel.tickMs;
+    if (tick <= wheel.currentTick) {
+        tick = wheel.currentTick + 1;
+    }
+    timer.expireTick = tick;
+
+    SnmpTimer& head = wheel.slots[(size_t)(tick % wheel.slots.size())];
+    timer.prev = head.prev;
+    timer.next = &head;
+    head.prev->next = &timer;
+    head.prev = &timer;
+    wheel.count++;
+}
+
+void SnmpTimerCancel(SnmpTimerWheel& wheel, SnmpTimer& timer) {
+    if (!SnmpTimerIsScheduled(timer)) return;
+
+    timer.prev->next = timer.next;
+    timer.next->prev = timer.prev;
+    timer.prev = timer.next = NULL;
+    wheel.count--;
+}
+
+int SnmpTimerWheelTimeout(const SnmpTimerWheel& wheel, ULONGLONG nowMs) {
+    if (wheel.count == 0) return -1;
+
+    ULONGLONG nextTickMs = (wheel.currentTick + 1) * wheel.tickMs;
+    return nextTickMs > nowMs ? (int)(nextTickMs - nowMs) : 0;
+}
@@ -0,0 +1,81 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "snmp_compat.h"
+
+// Таймер для колеса таймеров. Узел встраивается в объект-владелец,
+// поэтому планирование и отмена не выделяют память.
+struct SnmpTimer {
+    SnmpTimer* prev = NULL;
+    SnmpTimer* next = NULL;
+    ULONGLONG expireTick = 0;
+    void* owner = NULL;
+    int kind = 0;                 // вид владельца, если на одном колесе таймеры разных объектов
+};
+
+// Хешированное колесо таймеров: слот = тик срабатывания по модулю числа слотов.
+// Таймеры дальше одного оборота остаются в слоте до своего тика.
+struct SnmpTimerWheel {
+    std::vector<SnmpTimer> slots;   // заголовки кольцевых списков
+    DWORD tickMs = 10;
+    ULONGLONG currentTick = 0;
+    size_t count = 0;
+};
+
+void SnmpTimerWheelInit(SnmpTimerWheel& wheel, DWORD tickMs, size_t slotCount, ULONGLONG nowMs);
+
+// Планирует таймер на абсолютное время expireMs (в единицах GetTickCount64).
+// Уже запланированный таймер переносится.
+void SnmpTimerSchedule(SnmpTimerWheel& wheel, SnmpTimer& timer, ULONGLONG expireMs);
+
+void SnmpTimerCancel(SnmpTimerWheel& wheel, SnmpTimer& timer);
+
+inline bool SnmpTimerIsScheduled(const SnmpTimer& timer) {
+    return timer.next != NULL;
+}
+
+// Сколько миллисекунд можно ждать событий до следующего тика (-1, если таймеров нет)
+int SnmpTimerWheelTimeout(const SnmpTimerWheel& wheel, ULONGLONG nowMs);
+
+// Снимает с колеса все таймеры, истёкшие к nowMs, и вызывает для них onExpire.
+// Обработчик может снова запланировать тот же таймер.
+template <typename Callback>
+void SnmpTimerWheelAdvance(SnmpTimerWheel& wheel, ULONGLONG nowMs, Callback&& onExpire) {
+    ULONGLONG targetTick = nowMs / wheel.tickMs;
+    if (targetTick <= wheel.currentTick) return;
+
+    // При большом разрыве достаточно одного прохода по всем слотам
+    ULONGLONG steps = targetTick - wheel.currentTick;
+    if (steps > wheel.slots.size()) steps = wheel.slots.size();
+
+    SnmpTimer expired;
+    expired.prev = expired.next = &expired;
+
+    for (ULONGLONG step = 1; step <= steps; step++) {
+        SnmpTimer& head = wheel.slots[(size_t)((wheel.currentTick + step) % wheel.slots.size())];
+        SnmpTimer* timer = head.next;
+        while (timer != &head) {
+            SnmpTimer* next = timer->next;
+            if (timer->expireTick <= targetTick) {
+                timer->prev->next = timer->next;
+                timer->next->prev = timer->prev;
+                timer->prev = expired.prev;
+                timer->next = &expired;
+                expired.prev->next = timer;
+                expired.prev = timer;
+            }
+            timer = next;
+        }
+    }
+    wheel.currentTick = targetTick;
+
+    while (expired.next != &expired) {
+        SnmpTimer* timer = expired.next;
+        expired.next = timer->next;
+        timer->next->prev = &expired;
+        timer->prev = timer->next = NULL;
+        wheel.count--;
+        onExpire(*timer);
+    }
+}
@@ -0,0 +1,296 @@
+﻿#include "snmp_udp.h"
+#include "snmp_metrics.h"
+
+#include <cstring>
+#include <random>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/select.h>
+#endif
+
+bool SnmpUdpSetNonBlocking(SOCKET sock) {
+#ifdef _WIN32
+    u_long nonBlocking = 1;
+    return ioctlsocket(sock, FIONBIO, &nonBlocking) == 0;
+#else
+    int flags = fcntl(sock, F_GETFL, 0);
+    return flags != -1 && fcntl(sock, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+bool SnmpUdpResolve(const std::string& target, sockaddr_storage& address, int& addressLength) {
+    std::string host = target;
+    std::string port = "161";
+
+    // Порт отделяем только если двоеточие одно (иначе это голый IPv6-адрес)
+    if (!target.empty() && target[0] == '[') {
+        size_t close = target.find(']');
+        if (close == std::string::npos) {
+            SetLastError(ERROR_INVALID_PARAMETER);
+            return false;
+        }
+        host = target.substr(1, close - 1);
+        if (close + 1 < target.size() && target[close + 1] == ':') {
+            port = target.substr(close + 2);
+        }
+    }
+    else {
+        size_t colon = target.find(':');
+        if (colon != std::string::npos && target.find(':', colon + 1) == std::string::npos) {
+            host = target.substr(0, colon);
+            port = target.substr(colon + 1);
+        }
+    }
+
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_protocol = IPPROTO_UDP;
+
+    addrinfo* result = NULL;
+    int error = getaddrinfo(host.c_str(), port.c_str(), &hints, &result);
+    if (error != 0 || result == NULL) {
+        SetLastError(error);
+        return false;
+    }
+
+    memcpy(&address, result->ai_addr, result->ai_addrlen);
+    addressLength = (int)result->ai_addrlen;
+    freeaddrinfo(result);
+    return true;
+}
+
+bool SnmpUdpSameAddress(const sockaddr_storage& a, const sockaddr_storage& b) {
+    if (a.ss_family != b.ss_family) return false;
+
+    if (a.ss_family == AF_INET) {
+        const sockaddr_in& a4 = (const sockaddr_in&)a;
+        const sockaddr_in& b4 = (const sockaddr_in&)b;
+        return a4.sin_port == b4.sin_port && a4.sin_addr.s_addr == b4.sin_addr.s_addr;
+    }
+    if (a.ss_family == AF_INET6) {
+        const sockaddr_in6& a6 = (const sockaddr_in6&)a;
+        const sockaddr_in6& b6 = (const sockaddr_in6&)b;
+        return a6.sin6_port == b6.sin6_port && memcmp(&a6.sin6_addr, &b6.sin6_addr, sizeof(a6.sin6_addr)) == 0;
+    }
+    return false;
+}
+
+bool SnmpUdpSetHeader(SnmpUdpSession& session) {
+    BYTE header[SNMP_UDP_DEFAULT_MESSAGE_SIZE];
+    size_t length = BerEncodeMessageHeader(session.version, session.community.data(), session.community.size(),
+        header, sizeof(header));
+    if (length == 0) {
+        session.header.clear();
+        SetLastError(ERROR_INVALID_PARAMETER);
+        return false;
+    }
+    session.header.assign(header, header + length);
+    return true;
+}
+
+// Функция начальной настройки полей сессии (без сокета и адреса)
+static void SnmpUdpInit(SnmpUdpSession& session, const std::string& target, const std::string& community,
+    DWORD timeout, int retries, AsnInteger version) {
+    session.sock = INVALID_SOCKET;
+    session.target = target;
+    session.version = version;
+    session.community = community;
+    SnmpUdpSetHeader(session);
+    session.timeout = timeout;
+    session.retries = retries;
+    session.adaptiveTimeout = true;
+    SnmpRttInit(session.rtt, timeout);
+    session.requestCount = 0;
+    session.maxMessageSize = SNMP_UDP_DEFAULT_MESSAGE_SIZE;
+    session.maxVarBinds = 0;
+    session.sendBuffer.resize(SNMP_UDP_MAX_DATAGRAM);
+    session.receiveBuffer.resize(SNMP_UDP_MAX_DATAGRAM);
+
+    // Начальный request-id выбираем случайно, чтобы не путать ответы разных запусков
+    std::random_device random;
+    session.nextRequestId = (AsnInteger)(random() & 0x3FFFFFFF);
+}
+
+// Функция создания неблокирующего сокета под семейство адреса сессии
+static bool SnmpUdpOpenSocket(SnmpUdpSession& session) {
+    session.sock = socket(session.address.ss_family, SOCK_DGRAM, IPPROTO_UDP);
+    if (session.sock == INVALID_SOCKET) {
+        SetLastError(WSAGetLastError());
+        return false;
+    }
+
+    if (!SnmpUdpSetNonBlocking(session.sock)) {
+        SetLastError(WSAGetLastError());
+        closesocket(session.sock);
+        session.sock = INVALID_SOCKET;
+        return false;
+    }
+
+    return true;
+}
+
+bool SnmpUdpOpen(SnmpUdpSession& session, const std::string& hostname, const std::string& community,
+    DWORD timeout, int retries, AsnInteger version) {
+    SnmpUdpInit(session, hostname, community, timeout, retries, version);
+
+    if (!SnmpUdpResolve(hostname, session.address, session.addressLength)) {
+        return false;
+    }
+
+    return SnmpUdpOpenSocket(session);
+}
+
+bool SnmpUdpOpenAddress(SnmpUdpSession& session, const std::string& target, const sockaddr_storage& address,
+    int addressLength, const std::string& community, DWORD timeout, int retries, AsnInteger version) {
+    SnmpUdpInit(session, target, community, timeout, retries, version);
+    session.address = address;
+    session.addressLength = addressLength;
+    return SnmpUdpOpenSocket(session);
+}
+
+void SnmpUdpClose(SnmpUdpSession& session) {
+    if (session.sock != INVALID_SOCKET) {
+        closesocket(session.sock);
+        session.sock = INVALID_SOCKET;
+    }
+}
+
+// Функция ожидания ответа с нужным request-id до истечения таймаута
+static bool SnmpUdpReceive(SnmpUdpSession& session, AsnInteger requestId, DWORD timeout,
+    SnmpPdu& response, size_t& length) {
+    BYTE* buffer = session.receiveBuffer.data();
+    ULONGLONG deadline = GetTickCount64() + timeout;
+
+    while (true) {
+        ULONGLONG now = GetTickCount64();
+        if (now >= deadline) {
+            SetLastError(SNMP_UDP_ERROR_TIMEOUT);
+            return false;
+        }
+
+        ULONGLONG remaining = deadline - now;
+        timeval tv;
+        tv.tv_sec = (long)(remaining / 1000);
+        tv.tv_usec = (long)((remaining % 1000) * 1000);
+
+        fd_set readSet;
+        FD_ZERO(&readSet);
+        FD_SET(session.sock, &readSet);
+
+        int ready = select((int)session.sock + 1, &readSet, NULL, NULL, &tv);
+        if (ready == SOCKET_ERROR) {
+            SetLastError(WSAGetLastError());
+            return false;
+        }
+        if (ready == 0) {
+            continue;
+        }
+
+        sockaddr_storage from;
+        socklen_t fromLength = sizeof(from);
+        int received = recvfrom(session.sock, (char*)buffer, (int)session.receiveBuffer.size(), 0,
+            (sockaddr*)&from, &fromLength);
+        if (received == SOCKET_ERROR) {
+            int error = WSAGetLastError();
+            // ICMP port unreachable от прошлой отправки или ложное пробуждение - просто ждём дальше
+            if (error == WSAEWOULDBLOCK || error == WSAECONNRESET) continue;
+            SetLastError(error);
+            return false;
+        }
+
+        // Запоздавший ответ агента, которого сокет обслуживал раньше
+        if (!SnmpUdpSameAddress(from, session.address)) {
+            continue;
+        }
+
+        SnmpArenaReset(session.arena);
+
+        SnmpMessage message;
+        if (!BerDecodeMessage(buffer, received, session.arena, message)) {
+            continue;
+        }
+
+        // Ответ на предыдущий (уже повторённый) запрос отбрасываем
+        if (message.pdu.type != SNMP_PDU_RESPONSE || message.pdu.requestId != requestId) {
+            continue;
+        }
+
+        response = message.pdu;
+        length = received;
+        return true;
+    }
+}
+
+size_t SnmpUdpEncode(SnmpUdpSession& session, AsnInteger version, const SnmpPdu& request) {
+    if (version == session.version && !session.header.empty()) {
+        return BerEncodeMessagePrefixed(session.header.data(), session.header.size(), request,
+            session.sendBuffer.data(), session.sendBuffer.size());
+    }
+    return BerEncodeMessage(version, session.community.data(), session.community.size(),
+        request, session.sendBuffer.data(), session.sendBuffer.size());
+}
+
+bool SnmpUdpRequest(SnmpUdpSession& session, SnmpPdu& request, SnmpPdu& response) {
+    request.requestId = session.nextRequestId;
+    session.nextRequestId = (session.nextRequestId + 1) & 0x7FFFFFFF;
+
+    // GETBULK определён только начиная с SNMPv2c
+    AsnInteger version = request.type == SNMP_PDU_GETBULK ? SNMP_VERSION_V2C : session.version;
+
+    size_t length = SnmpUdpEncode(session, version, request);
+    if (length == 0) {
+        SetLastError(ERROR_INVALID_PARAMETER);
+        return false;
+    }
+
+    // Недоступному агенту - только проба в одну попытку, и не чаще интервала проб
+    int attempts = session.retries + 1;
+    if (session.adaptiveTimeout) {
+        SnmpRttDecision decision = SnmpRttAdmit(session.rtt, GetTickCount64());
+        if (decision == SNMP_RTT_SKIP) {
+            SetLastError(SNMP_UDP_ERROR_DOWN);
+            return false;
+        }
+        if (decision == SNMP_RTT_PROBE) attempts = 1;
+    }
+
+    // Задержка считается от первой отправки: повторы входят во время ответа
+    SnmpMetricsSeries* metrics = SnmpMetricsSeriesFor(session.target, request.type);
+    ULONGLONG firstSent = SnmpMetricsNowUs();
+
+    for (int attempt = 0; attempt < attempts; attempt++) {
+        session.requestCount++;
+
+        int sent = sendto(session.sock, (const char*)session.sendBuffer.data(), (int)length, 0,
+            (const sockaddr*)&session.address, session.addressLength);
+        if (sent == SOCKET_ERROR) {
+            SetLastError(WSAGetLastError());
+            return false;
+        }
+        SnmpMetricsOnSend(metrics, length, attempt > 0);
+
+        DWORD timeout = session.adaptiveTimeout ? SnmpRttTimeout(session.rtt, attempt + 1) : session.timeout;
+        size_t received = 0;
+        if (SnmpUdpReceive(session, request.requestId, timeout, response, received)) {
+            ULONGLONG latencyUs = SnmpMetricsNowUs() - firstSent;
+            if (session.adaptiveTimeout) {
+                if (attempt == 0) SnmpRttSample(session.rtt, latencyUs / 1000.0);
+                SnmpRttSuccess(session.rtt);
+            }
+            SnmpMetricsOnResponse(metrics, latencyUs, response.errorStatus, received, response.varBinds.len);
+            return true;
+        }
+
+        if (GetLastError() != SNMP_UDP_ERROR_TIMEOUT) {
+            return false;
+        }
+    }
+
+    if (session.adaptiveTimeout) {
+        SnmpRttFailure(session.rtt, GetTickCount64());
+    }
+    SnmpMetricsOnTimeout(metrics);
+    return false;
+}
@@ -0,0 +1,78 @@
+﻿#pragma once
+
+#include <string>
+#include <vector>
+#include "snmp_ber.h"
+#include "snmp_rtt.h"
+
+// Ошибка ожидания ответа (совпадает с кодом SNMP_MGMTAPI_TIMEOUT из mgmtapi.h)
+#define SNMP_UDP_ERROR_TIMEOUT 40
+
+// Агент ответил ошибкой (error-status), продолжить операцию нельзя
+#define SNMP_UDP_ERROR_AGENT 41
+
+// Агент признан недоступным (см. SnmpRtt), запрос не отправлялся
+#define SNMP_UDP_ERROR_DOWN 42
+
+// Максимальный размер UDP-датаграммы
+#define SNMP_UDP_MAX_DATAGRAM 65535
+
+// Размер сообщения по умолчанию: помещается в кадр Ethernet без фрагментации
+#define SNMP_UDP_DEFAULT_MESSAGE_SIZE 1472
+
+// Сессия SNMP поверх собственного неблокирующего UDP-сокета.
+// GET/GETNEXT отправляются с версией сессии, GETBULK - всегда как SNMPv2c.
+// Буферы и арена выделяются один раз и переиспользуются всеми запросами.
+// Сокет может обслуживать по очереди несколько агентов (см. SnmpSessionPool),
+// поэтому ответы принимаются только с адреса текущего агента.
+struct SnmpUdpSession {
+    SOCKET sock;
+    sockaddr_storage address;
+    int addressLength;
+    std::string target;           // адрес агента в том виде, как его задал пользователь (метка метрик)
+    AsnInteger version;
+    std::string community;
+    std::vector<BYTE> header;     // version и community в BER - общее начало всех запросов сессии
+    DWORD timeout;                // таймаут попытки; при adaptiveTimeout - его предел
+    int retries;
+    bool adaptiveTimeout;         // таймаут по измеренному времени ответа и отключение недоступного агента
+    SnmpRtt rtt;
+    AsnInteger nextRequestId;
+    unsigned long requestCount;   // количество отправленных PDU (с повторами)
+    size_t maxMessageSize;        // предел размера запроса при упаковке нескольких OID
+    UINT maxVarBinds;             // предел varbind в PDU, выясненный по tooBig (0 - не ограничен)
+    std::vector<BYTE> sendBuffer;
+    std::vector<BYTE> receiveBuffer;
+    SnmpArena arena;              // сбрасывается в начале каждого запроса
+};
+
+// Разрешает адрес агента вида "host", "host:port" или "[ipv6]:port" (порт по умолчанию 161)
+bool SnmpUdpResolve(const std::string& target, sockaddr_storage& address, int& addressLength);
+
+// Функция сравнения адресов (семейство, адрес и порт)
+bool SnmpUdpSameAddress(const sockaddr_storage& a, const sockaddr_storage& b);
+
+// Функция для перевода сокета в неблокирующий режим
+bool SnmpUdpSetNonBlocking(SOCKET sock);
+
+// Открывает неблокирующий UDP-сокет и разрешает имя агента
+bool SnmpUdpOpen(SnmpUdpSession& session, const std::string& hostname, const std::string& community,
+    DWORD timeout, int retries, AsnInteger version = SNMP_VERSION_V2C);
+
+// То же для уже разрешённого адреса (target - метка агента для метрик)
+bool SnmpUdpOpenAddress(SnmpUdpSession& session, const std::string& target, const sockaddr_storage& address,
+    int addressLength, const std::string& community, DWORD timeout, int retries, AsnInteger version = SNMP_VERSION_V2C);
+
+// Пересобирает session.header после смены community или version
+bool SnmpUdpSetHeader(SnmpUdpSession& session);
+
+void SnmpUdpClose(SnmpUdpSession& session);
+
+// Кодирует запрос в sendBuffer сессии. Возвращает длину или 0, если запрос не поместился.
+size_t SnmpUdpEncode(SnmpUdpSession& session, AsnInteger version, const SnmpPdu& request);
+
+// Отправляет PDU и ждёт ответ с тем же request-id с учётом таймаута и повторов.
+// При adaptiveTimeout таймаут попытки - RTO агента, удваивающийся с каждым повтором;
+// недоступному агенту запрос не отправляется (SNMP_UDP_ERROR_DOWN), кроме редких проб в одну попытку.
+// Ответ ссылается на буфер приёма и арену сессии и действителен до следующего запроса.
+bool SnmpUdpRequest(SnmpUdpSession& session, SnmpPdu& request, SnmpPdu& response);
@@ -0,0 +1,155 @@
+﻿// Имитатор агента SNMP для нагрузочных испытаний manageSNMP на локальной машине.
+// Отвечает на GET, GETNEXT и GETBULK (SNMPv1/v2c) данными из записанного обхода
+// (snmprec или архив snmp_archive) и/или синтетической ifTable; задержка, потери
+// и предел размера ответа задаются ключами.
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include "snmp_agent.h"
+#include "snmp_archive.h"
+
+#ifdef _WIN32
+#pragma comment(lib, "ws2_32.lib")
+#endif
+
+static volatile std::sig_atomic_t stopRequested = 0;
+
+static void OnSignal(int) {
+    stopRequested = 1;
+}
+
+static void PrintUsage() {
+    std::cout << "Usage: snmpAgent [options]\n"
+        << "  -a host[:port]   listen address (default 127.0.0.1:161)\n"
+        << "  -c community     accepted community (default: any)\n"
+        << "  -f file          load a recorded walk in snmprec format (OID|tag|value)\n"
+        << "                   or a walk archive saved by manageSNMP archive_save, may repeat\n"
+        << "  -r rows          add system group and a synthetic ifTable/ifXTable with rows interfaces\n"
+        << "                   (default 10 when no -f is given)\n"
+        << "  -t threads       worker threads (default 1)\n"
+        << "  -l ms            response latency\n"
+        << "  -j ms            random extra latency from 0 to ms\n"
+        << "  -d percent       drop this share of requests without a response\n"
+        << "  -m bytes         maximum response size; larger responses get tooBig (GETBULK is truncated)\n"
+        << "  -b count         cap for GETBULK max-repetitions\n"
+        << "  -s seconds       print statistics every N seconds (default 5, 0 - only at exit)\n";
+}
+
+// Функция для разбора числа из аргумента командной строки
+static bool ParseNumberArgument(const char* text, double& value) {
+    char* end = NULL;
+    value = std::strtod(text, &end);
+    return end != text && *end == '\0' && value >= 0;
+}
+
+static void PrintStats(const SnmpAgentTotals& totals, unsigned long long previousRequests, double seconds) {
+    std::cout << "requests " << totals.requests << ", responses " << totals.responses
+        << ", dropped " << totals.dropped << ", invalid " << totals.invalid << ", tooBig " << totals.tooBig;
+    if (seconds > 0) {
+        std::cout << ", " << (unsigned long long)((totals.requests - previousRequests) / seconds) << " req/s";
+    }
+    std::cout << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    SnmpAgentOptions options;
+    std::vector<std::string> files;
+    double rows = -1;
+    double statsInterval = 5;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            PrintUsage();
+            return 0;
+        }
+        if (arg.size() != 2 || arg[0] != '-' || i + 1 >= argc) {
+            std::cerr << "Invalid argument: " << arg << std::endl;
+            PrintUsage();
+            return 1;
+        }
+
+        const char* value = argv[++i];
+        double number = 0;
+        bool numeric = ParseNumberArgument(value, number);
+        switch (arg[1]) {
+        case 'a': options.address = value; continue;
+        case 'c': options.community = value; continue;
+        case 'f': files.push_back(value); continue;
+        case 'r': rows = number; break;
+        case 't': options.threads = (UINT)number; break;
+        case 'l': options.latencyUs = (DWORD)(number * 1000); break;
+        case 'j': options.jitterUs = (DWORD)(number * 1000); break;
+        case 'd': options.lossPercent = number; break;
+        case 'm': options.maxMessageSize = (size_t)number; break;
+        case 'b': options.maxRepetitions = (UINT)number; break;
+        case 's': statsInterval = number; break;
+        default: numeric = false; break;
+        }
+        if (!numeric) {
+            std::cerr << "Invalid value for " << arg << ": " << value << std::endl;
+            return 1;
+        }
+    }
+
+#ifdef _WIN32
+    // Инициализация Winsock
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        std::cerr << "WSAStartup failed" << std::endl;
+        return 1;
+    }
+#endif
+
+    SnmpAgentData data;
+    for (const std::string& file : files) {
+        bool loaded = SnmpArchiveDetect(file) ? SnmpAgentLoadArchive(data, file) : SnmpAgentLoadRecords(data, file);
+        if (!loaded) return 1;
+    }
+    if (rows < 0 && files.empty()) rows = 10;
+    if (rows >= 0) SnmpAgentAddTables(data, (UINT)rows);
+    SnmpAgentSort(data);
+
+    SnmpAgent agent;
+    if (!SnmpAgentStart(agent, data, options)) {
+        std::cerr << "Cannot listen on " << options.address << ". Error code: " << GetLastError() << std::endl;
+        return 1;
+    }
+
+    std::cout << "Serving " << data.entries.size() << " variables on " << options.address
+        << " with " << agent.options.threads << " thread(s). Press Ctrl+C to stop." << std::endl;
+
+    std::signal(SIGINT, OnSignal);
+    std::signal(SIGTERM, OnSignal);
+
+    auto start = std::chrono::steady_clock::now();
+    auto lastReport = start;
+    unsigned long long lastRequests = 0;
+    while (!stopRequested) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        auto now = std::chrono::steady_clock::now();
+        double elapsed = std::chrono::duration<double>(now - lastReport).count();
+        if (statsInterval > 0 && elapsed >= statsInterval) {
+            SnmpAgentTotals totals = SnmpAgentGetTotals(agent);
+            PrintStats(totals, lastRequests, elapsed);
+            lastRequests = totals.requests;
+            lastReport = now;
+        }
+    }
+
+    SnmpAgentStop(agent);
+    std::cout << "Stopped: ";
+    PrintStats(SnmpAgentGetTotals(agent), 0,
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    return 0;
+}
@@ -0,0 +1,680 @@
+﻿#include "snmp_agent.h"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <queue>
+#include <random>
+#include "snmp_archive.h"
+#include "snmp_udp.h"
+
+#ifndef _WIN32
+#include <sys/select.h>
+#endif
+
+// Ожидание в цикле обслуживания не дольше этого времени, чтобы вовремя заметить остановку
+#define SNMP_AGENT_POLL_MS 100
+
+// Буфер сокета: выдерживает пачки запросов от многопоточного клиента
+#define SNMP_AGENT_SOCKET_BUFFER (4 * 1024 * 1024)
+
+ULONGLONG SnmpAgentNowUs() {
+    return (ULONGLONG)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool SnmpAgentAdd(SnmpAgentData& data, const SnmpOid& name, const AsnAny& value) {
+    SnmpAgentEntry entry;
+    entry.name = name;
+    if (!SnmpCopyValue(data.arena, value, entry.value)) {
+        SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+        return false;
+    }
+    data.entries.push_back(std::move(entry));
+    return true;
+}
+
+void SnmpAgentSort(SnmpAgentData& data) {
+    std::stable_sort(data.entries.begin(), data.entries.end(),
+        [](const SnmpAgentEntry& entry1, const SnmpAgentEntry& entry2) { return entry1.name < entry2.name; });
+
+    // Из группы одинаковых OID оставляем последнюю запись
+    size_t count = 0;
+    for (size_t i = 0; i < data.entries.size(); i++) {
+        if (i + 1 < data.entries.size() && data.entries[i + 1].name == data.entries[i].name) continue;
+        if (count != i) data.entries[count] = std::move(data.entries[i]);
+        count++;
+    }
+    data.entries.resize(count);
+
+    static const SnmpOid sysUpTime = { 1, 3, 6, 1, 2, 1, 1, 3, 0 };
+    auto it = std::lower_bound(data.entries.begin(), data.entries.end(), sysUpTime,
+        [](const SnmpAgentEntry& entry, const SnmpOid& name) { return entry.name < name; });
+    data.upTimeIndex = it != data.entries.end() && it->name == sysUpTime && it->value.asnType == ASN_TIMETICKS
+        ? (size_t)(it - data.entries.begin()) : (size_t)-1;
+}
+
+// Значение из hex-строки "001b21" (регистр не важен)
+static bool SnmpAgentParseHex(const std::string& text, std::string& bytes) {
+    if (text.size() % 2 != 0) return false;
+    bytes.clear();
+    for (size_t i = 0; i < text.size(); i += 2) {
+        unsigned value = 0;
+        std::from_chars_result result = std::from_chars(text.data() + i, text.data() + i + 2, value, 16);
+        if (result.ec != std::errc() || result.ptr != text.data() + i + 2) return false;
+        bytes.push_back((char)value);
+    }
+    return true;
+}
+
+template <typename T>
+static bool SnmpAgentParseNumber(const std::string& text, T& value) {
+    std::from_chars_result result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+// Значение записи snmprec по коду тега. bytes хранит строку, на которую ссылается value.
+static bool SnmpAgentParseValue(int tag, bool hex, const std::string& text, std::string& bytes,
+    SnmpOid& oidValue, AsnAny& value) {
+    memset(&value, 0, sizeof(value));
+    value.asnType = (BYTE)tag;
+
+    if (hex) {
+        if (tag != ASN_OCTETSTRING && tag != ASN_IPADDRESS && tag != ASN_OPAQUE) return false;
+        if (!SnmpAgentParseHex(text, bytes)) return false;
+        if (tag == ASN_IPADDRESS && bytes.size() != 4) return false;
+    }
+
+    switch (tag) {
+    case ASN_INTEGER:
+        return SnmpAgentParseNumber(text, value.asnValue.number);
+    case ASN_COUNTER32:
+    case ASN_GAUGE32:
+    case ASN_TIMETICKS:
+        return SnmpAgentParseNumber(text, value.asnValue.unsigned32);
+    case ASN_COUNTER64:
+        return SnmpAgentParseNumber(text, value.asnValue.counter64.QuadPart);
+    case ASN_NULL:
+        return true;
+    case ASN_OBJECTIDENTIFIER:
+        if (!SnmpOidParse(text, oidValue)) return false;
+        value.asnValue.object = oidValue.AsAsn();
+        return true;
+    case ASN_IPADDRESS:
+        if (!hex) {
+            // Адрес в точечной записи
+            bytes.clear();
+            size_t start = 0;
+            for (int i = 0; i < 4; i++) {
+                size_t end = i < 3 ? text.find('.', start) : text.size();
+                unsigned octet = 0;
+                if (end == std::string::npos || !SnmpAgentParseNumber(text.substr(start, end - start), octet)
+                    || octet > 255) {
+                    return false;
+                }
+                bytes.push_back((char)octet);
+                start = end + 1;
+            }
+        }
+        break;
+    case ASN_OCTETSTRING:
+    case ASN_OPAQUE:
+        if (!hex) bytes = text;
+        break;
+    default:
+        return false;
+    }
+
+    value.asnValue.string.stream = (BYTE*)bytes.data();
+    value.asnValue.string.length = (UINT)bytes.size();
+    value.asnValue.string.dynamic = FALSE;
+    return true;
+}
+
+bool SnmpAgentLoadRecords(SnmpAgentData& data, const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Cannot open records file: " << path << std::endl;
+        return false;
+    }
+
+    std::string line, bytes;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty() || line[0] == '#') continue;
+
+        // OID|тег|значение; в самом значении '|' допустим
+        size_t bar1 = line.find('|');
+        size_t bar2 = bar1 == std::string::npos ? bar1 : line.find('|', bar1 + 1);
+        if (bar2 == std::string::npos) {
+            std::cerr << "Line " << lineNumber << ": expected 'OID|tag|value'" << std::endl;
+            continue;
+        }
+
+        SnmpOid name;
+        if (!SnmpOidParse(line.data(), bar1, name) || name.Empty()) {
+            std::cerr << "Line " << lineNumber << ": invalid OID" << std::endl;
+            continue;
+        }
+
+        // Тег: число, за ним необязательный x (hex) и ":модификатор" snmpsim, который не поддерживается
+        std::string tagText = line.substr(bar1 + 1, bar2 - bar1 - 1);
+        size_t colon = tagText.find(':');
+        if (colon != std::string::npos) tagText.resize(colon);
+        bool hex = !tagText.empty() && tagText.back() == 'x';
+        if (hex) tagText.pop_back();
+
+        int tag = 0;
+        SnmpOid oidValue;
+        AsnAny value;
+        if (!SnmpAgentParseNumber(tagText, tag)
+            || !SnmpAgentParseValue(tag, hex, line.substr(bar2 + 1), bytes, oidValue, value)) {
+            std::cerr << "Line " << lineNumber << ": unsupported type or invalid value" << std::endl;
+            continue;
+        }
+
+        if (!SnmpAgentAdd(data, name, value)) {
+            std::cerr << "Line " << lineNumber << ": out of memory" << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool SnmpAgentLoadArchive(SnmpAgentData& data, const std::string& path) {
+    SnmpArchive archive;
+    if (!SnmpArchiveOpen(archive, path)) {
+        std::cerr << "Cannot open archive: " << path << ". Error code: " << GetLastError() << std::endl;
+        return false;
+    }
+
+    data.entries.reserve(data.entries.size() + (size_t)archive.records);
+    bool added = true;
+    bool success = SnmpArchiveScan(archive, NULL, 0, [&data, &added](const RFC1157VarBind& varBind) {
+        // Исключения обхода агент и так вернёт для отсутствующих OID
+        if (varBind.value.asnType >= SNMP_EXCEPTION_NOSUCHOBJECT) return true;
+        added = SnmpAgentAdd(data, SnmpOid(varBind.name), varBind.value);
+        return added;
+    });
+    if (!added) {
+        std::cerr << "Out of memory loading archive: " << path << std::endl;
+    }
+    else if (!success) {
+        std::cerr << "Archive is damaged, loaded the records before the damage: " << path << std::endl;
+    }
+    SnmpArchiveClose(archive);
+    return added;
+}
+
+static void SnmpAgentAddNumber(SnmpAgentData& data, const SnmpOid& name, BYTE type, ULONGLONG number) {
+    AsnAny value;
+    memset(&value, 0, sizeof(value));
+    value.asnType = type;
+    if (type == ASN_COUNTER64) value.asnValue.counter64.QuadPart = number;
+    else value.asnValue.unsigned32 = (AsnUnsigned32)number;
+    SnmpAgentAdd(data, name, value);
+}
+
+static void SnmpAgentAddBytes(SnmpAgentData& data, const SnmpOid& name, BYTE type, const std::string& bytes) {
+    AsnAny value;
+    memset(&value, 0, sizeof(value));
+    value.asnType = type;
+    value.asnValue.string.stream = (BYTE*)bytes.data();
+    value.asnValue.string.length = (UINT)bytes.size();
+    SnmpAgentAdd(data, name, value);
+}
+
+// OID столбца таблицы: prefix.column.index
+static SnmpOid SnmpAgentColumn(const SnmpOid& prefix, UINT column, UINT index) {
+    SnmpOid name = prefix;
+    name.Append(column);
+    name.Append(index);
+    return name;
+}
+
+void SnmpAgentAddTables(SnmpAgentData& data, UINT rows) {
+    static const SnmpOid system = { 1, 3, 6, 1, 2, 1, 1 };
+    static const SnmpOid ifTable = { 1, 3, 6, 1, 2, 1, 2, 2, 1 };
+    static const SnmpOid ifXTable = { 1, 3, 6, 1, 2, 1, 31, 1, 1, 1 };
+
+    SnmpAgentAddBytes(data, SnmpAgentColumn(system, 1, 0), ASN_OCTETSTRING, "manageSNMP simulated agent");
+    AsnAny objectId;
+    memset(&objectId, 0, sizeof(objectId));
+    SnmpOid enterprise = { 1, 3, 6, 1, 4, 1, 8072, 3, 2, 10 };
+    objectId.asnType = ASN_OBJECTIDENTIFIER;
+    objectId.asnValue.object = enterprise.AsAsn();
+    SnmpAgentAdd(data, SnmpAgentColumn(system, 2, 0), objectId);
+    // sysUpTime.0: значение подставляет SnmpAgentHandle
+    SnmpAgentAddNumber(data, SnmpAgentColumn(system, 3, 0), ASN_TIMETICKS, 0);
+    SnmpAgentAddBytes(data, SnmpAgentColumn(system, 4, 0), ASN_OCTETSTRING, "admin@localhost");
+    SnmpAgentAddBytes(data, SnmpAgentColumn(system, 5, 0), ASN_OCTETSTRING, "snmpAgent");
+    SnmpAgentAddBytes(data, SnmpAgentColumn(system, 6, 0), ASN_OCTETSTRING, "localhost");
+    SnmpAgentAddNumber(data, SnmpAgentColumn(system, 7, 0), ASN_INTEGER, 72);
+
+    SnmpAgentAddNumber(data, SnmpOid{ 1, 3, 6, 1, 2, 1, 2, 1, 0 }, ASN_INTEGER, rows);
+
+    std::string name, mac(6, '\0');
+    for (UINT i = 1; i <= rows; i++) {
+        name = "eth" + std::to_string(i - 1);
+        mac[0] = 0x00;
+        mac[1] = 0x1B;
+        mac[2] = 0x21;
+        mac[3] = (char)(i >> 16);
+        mac[4] = (char)(i >> 8);
+        mac[5] = (char)i;
+
+        SnmpAgentAddNumber(data, SnmpAgentColumn(ifTable, 1, i), ASN_INTEGER, i);
+        SnmpAgentAddBytes(data, SnmpAgentColumn(ifTable, 2, i), ASN_OCTETSTRING, name);
+        SnmpAgentAddNumber(data, SnmpAgentColumn(ifTable, 3, i), ASN_INTEGER, 6);
+        SnmpAgentAddNumber(data, SnmpAgentColumn(ifTable, 4, i), ASN_INTEGER, 1500);
+        SnmpAgentAddNumber(data, SnmpAgentColumn(ifTable, 5, i), ASN_GAUGE32, 1000000000);
+        SnmpAgentAddBytes(data, SnmpAgentColumn(ifTable, 6, i), ASN_OCTETSTRING, mac);
+        SnmpAgentAddNumber(data, SnmpAgentColumn(ifTable, 7, i), ASN_INTEGER, 1);
+        SnmpAgentAddNumber(data, SnmpAgentColumn(ifTable, 8, i), ASN_INTEGER, 1);
+        SnmpAgentAddNumber(data, SnmpAgentColumn(ifTable, 9, i), ASN_TIMETICKS, 0);
+        SnmpAgentAddNumber(data, SnmpAgentColumn(ifTable, 10, i), ASN_COUNTER32, (ULONGLONG)i * 1000);
+        SnmpAgentAddNumber(data, SnmpAgentColumn(ifTable, 14, i), ASN_COUNTER32, 0);
+        SnmpAgentAddNumber(data, SnmpAgentColumn(ifTable, 16, i), ASN_COUNTER32, (ULONGLONG)i * 2000);
+        SnmpAgentAddNumber(data, SnmpAgentColumn(ifTable, 20, i), ASN_COUNTER32, 0);
+
+        SnmpAgentAddBytes(data, SnmpAgentColumn(ifXTable, 1, i), ASN_OCTETSTRING, name);
+        SnmpAgentAddNumber(data, SnmpAgentColumn(ifXTable, 6, i), ASN_COUNTER64, (ULONGLONG)i * 1000000000);
+        SnmpAgentAddNumber(data, SnmpAgentColumn(ifXTable, 10, i), ASN_COUNTER64, (ULONGLONG)i * 2000000000);
+        SnmpAgentAddNumber(data, SnmpAgentColumn(ifXTable, 15, i), ASN_GAUGE32, 1000);
+        SnmpAgentAddBytes(data, SnmpAgentColumn(ifXTable, 18, i), ASN_OCTETSTRING, "port " + std::to_string(i));
+    }
+}
+
+// Первая запись с OID >= name (или > name, если strict)
+static const SnmpAgentEntry* SnmpAgentSeek(const SnmpAgentData& data, const AsnObjectIdentifier& name, bool strict) {
+    auto compare = [strict](const SnmpAgentEntry& entry, const AsnObjectIdentifier& oid) {
+        int order = SnmpOidCompare(entry.name.Data(), entry.name.Length(), oid.ids, oid.idLength);
+        return strict ? order <= 0 : order < 0;
+    };
+    auto it = std::lower_bound(data.entries.begin(), data.entries.end(), name, compare);
+    return it == data.entries.end() ? NULL : &*it;
+}
+
+// Исключение для GET по отсутствующему OID: noSuchInstance, если есть соседние
+// экземпляры того же объекта (OID отличается последней дугой), иначе noSuchObject
+static BYTE SnmpAgentMissing(const SnmpAgentData& data, const AsnObjectIdentifier& name) {
+    if (name.idLength > 1) {
+        AsnObjectIdentifier object = { name.idLength - 1, name.ids };
+        const SnmpAgentEntry* entry = SnmpAgentSeek(data, object, false);
+        if (entry && SnmpOidStartsWith(entry->name.Data(), entry->name.Length(), object.ids, object.idLength)) {
+            return SNMP_EXCEPTION_NOSUCHINSTANCE;
+        }
+    }
+    return SNMP_EXCEPTION_NOSUCHOBJECT;
+}
+
+static RFC1157VarBind SnmpAgentVarBind(const AsnObjectIdentifier& name, const AsnAny& value) {
+    RFC1157VarBind varBind;
+    varBind.name = name;
+    varBind.value = value;
+    return varBind;
+}
+
+static RFC1157VarBind SnmpAgentException(const AsnObjectIdentifier& name, BYTE type) {
+    AsnAny value;
+    memset(&value, 0, sizeof(value));
+    value.asnType = type;
+    return SnmpAgentVarBind(name, value);
+}
+
+// Значение записи; sysUpTime.0 - сотые доли секунды от запуска агента, как у настоящего
+static AsnAny SnmpAgentValue(const SnmpAgentData& data, const SnmpAgentOptions& options, const SnmpAgentEntry& entry) {
+    if ((size_t)(&entry - data.entries.data()) != data.upTimeIndex) return entry.value;
+    AsnAny value = entry.value;
+    value.asnValue.ticks = (AsnTimeticks)((SnmpAgentNowUs() - options.startUs) / 10000);
+    return value;
+}
+
+static RFC1157VarBind SnmpAgentEntryVarBind(const SnmpAgentData& data, const SnmpAgentOptions& options,
+    const SnmpAgentEntry& entry) {
+    return SnmpAgentVarBind(entry.name.AsAsn(), SnmpAgentValue(data, options, entry));
+}
+
+static size_t SnmpAgentEncode(const SnmpMessage& message, SnmpPdu& reply, RFC1157VarBind* list, size_t count,
+    BYTE* response, size_t capacity) {
+    reply.varBinds.list = list;
+    reply.varBinds.len = (UINT)count;
+    return BerEncodeMessage(message.version, (const char*)message.community, message.communityLength,
+        reply, response, capacity);
+}
+
+size_t SnmpAgentHandle(const SnmpAgentData& data, const SnmpAgentOptions& options,
+    const BYTE* request, size_t length, SnmpArena& arena, std::vector<RFC1157VarBind>& varBinds,
+    BYTE* response, size_t capacity, SnmpAgentStats& stats) {
+    SnmpArenaReset(arena);
+
+    SnmpMessage message;
+    if (!BerDecodeMessage(request, length, arena, message)
+        || (message.version != SNMP_VERSION_V1 && message.version != SNMP_VERSION_V2C)) {
+        stats.invalid.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+
+    // С чужим community агент молчит, как настоящий
+    if (!options.community.empty() && (message.communityLength != options.community.size()
+        || memcmp(message.community, options.community.data(), message.communityLength) != 0)) {
+        stats.invalid.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+
+    const SnmpPdu& pdu = message.pdu;
+    const RFC1157VarBindList& requested = pdu.varBinds;
+    bool v1 = message.version == SNMP_VERSION_V1;
+
+    SnmpPdu reply;
+    reply.type = SNMP_PDU_RESPONSE;
+    reply.requestId = pdu.requestId;
+    reply.errorStatus = SNMP_ERRORSTATUS_NOERROR;
+    reply.errorIndex = 0;
+    varBinds.clear();
+
+    switch (pdu.type) {
+    case SNMP_PDU_GET:
+        for (UINT i = 0; i < requested.len && reply.errorStatus == SNMP_ERRORSTATUS_NOERROR; i++) {
+            const AsnObjectIdentifier& name = requested.list[i].name;
+            const SnmpAgentEntry* entry = SnmpAgentSeek(data, name, false);
+            if (entry && SnmpOidCompare(entry->name.Data(), entry->name.Length(), name.ids, name.idLength) == 0) {
+                varBinds.push_back(SnmpAgentVarBind(name, SnmpAgentValue(data, options, *entry)));
+            }
+            else if (v1) {
+                reply.errorStatus = SNMP_ERRORSTATUS_NOSUCHNAME;
+                reply.errorIndex = i + 1;
+            }
+            else {
+                varBinds.push_back(SnmpAgentException(name, SnmpAgentMissing(data, name)));
+            }
+        }
+        break;
+    case SNMP_PDU_GETNEXT:
+        for (UINT i = 0; i < requested.len && reply.errorStatus == SNMP_ERRORSTATUS_NOERROR; i++) {
+            const AsnObjectIdentifier& name = requested.list[i].name;
+            const SnmpAgentEntry* entry = SnmpAgentSeek(data, name, true);
+            if (entry) {
+                varBinds.push_back(SnmpAgentEntryVarBind(data, options, *entry));
+            }
+            else if (v1) {
+                reply.errorStatus = SNMP_ERRORSTATUS_NOSUCHNAME;
+                reply.errorIndex = i + 1;
+            }
+            else {
+                varBinds.push_back(SnmpAgentException(name, SNMP_EXCEPTION_ENDOFMIBVIEW));
+            }
+        }
+        break;
+    case SNMP_PDU_GETBULK: {
+        if (v1) {
+            stats.invalid.fetch_add(1, std::memory_order_relaxed);
+            return 0;
+        }
+
+        // RFC 3416, 4.2.3: сначала non-repeaters по одному GETNEXT, затем до
+        // max-repetitions строк из следующих OID для каждого из остальных
+        UINT nonRepeaters = (UINT)std::max<AsnInteger>(pdu.errorStatus, 0);
+        if (nonRepeaters > requested.len) nonRepeaters = requested.len;
+        UINT maxRepetitions = (UINT)std::max<AsnInteger>(pdu.errorIndex, 0);
+        if (options.maxRepetitions > 0 && maxRepetitions > options.maxRepetitions) {
+            maxRepetitions = options.maxRepetitions;
+        }
+        UINT repeaters = requested.len - nonRepeaters;
+
+        for (UINT i = 0; i < nonRepeaters; i++) {
+            const AsnObjectIdentifier& name = requested.list[i].name;
+            const SnmpAgentEntry* entry = SnmpAgentSeek(data, name, true);
+            varBinds.push_back(entry ? SnmpAgentEntryVarBind(data, options, *entry)
+                : SnmpAgentException(name, SNMP_EXCEPTION_ENDOFMIBVIEW));
+        }
+
+        size_t rowStart = varBinds.size();
+        for (UINT row = 0; row < maxRepetitions && repeaters > 0; row++) {
+            if (varBinds.size() + repeaters > SNMP_AGENT_MAX_VARBINDS) break;
+
+            // Следующая строка продолжает предыдущую; после конца MIB дальше повторяется endOfMibView
+            bool allEnded = true;
+            for (UINT i = 0; i < repeaters; i++) {
+                const AsnObjectIdentifier name = row == 0
+                    ? requested.list[nonRepeaters + i].name : varBinds[rowStart + i].name;
+                const SnmpAgentEntry* entry = row > 0 && varBinds[rowStart + i].value.asnType == SNMP_EXCEPTION_ENDOFMIBVIEW
+                    ? NULL : SnmpAgentSeek(data, name, true);
+                if (entry) allEnded = false;
+                varBinds.push_back(entry ? SnmpAgentEntryVarBind(data, options, *entry)
+                    : SnmpAgentException(name, SNMP_EXCEPTION_ENDOFMIBVIEW));
+            }
+            rowStart = varBinds.size() - repeaters;
+            if (allEnded) break;
+        }
+        break;
+    }
+    case SNMP_PDU_SET:
+        reply.errorStatus = v1 ? SNMP_ERRORSTATUS_NOSUCHNAME : SNMP_ERRORSTATUS_NOTWRITABLE;
+        reply.errorIndex = requested.len > 0 ? 1 : 0;
+        break;
+    default:
+        stats.invalid.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+
+    size_t limit = std::min(capacity, options.maxMessageSize);
+    size_t encoded;
+    if (reply.errorStatus != SNMP_ERRORSTATUS_NOERROR) {
+        // Ответ с ошибкой повторяет varbind запроса
+        encoded = SnmpAgentEncode(message, reply, requested.list, requested.len, response, limit);
+    }
+    else {
+        encoded = SnmpAgentEncode(message, reply, varBinds.data(), varBinds.size(), response, limit);
+        if (encoded == 0 && pdu.type == SNMP_PDU_GETBULK && varBinds.size() > 1) {
+            // GETBULK не превышает предел, а теряет хвост: ищем наибольшее число varbind, которое помещается
+            size_t low = 0, high = varBinds.size() - 1;
+            while (low < high) {
+                size_t middle = (low + high + 1) / 2;
+                if (SnmpAgentEncode(message, reply, varBinds.data(), middle, response, limit) != 0) low = middle;
+                else high = middle - 1;
+            }
+            if (low > 0) encoded = SnmpAgentEncode(message, reply, varBinds.data(), low, response, limit);
+        }
+    }
+
+    if (encoded == 0) {
+        // tooBig: SNMPv2c отвечает пустым списком, SNMPv1 - списком запроса
+        stats.tooBig.fetch_add(1, std::memory_order_relaxed);
+        reply.errorStatus = SNMP_ERRORSTATUS_TOOBIG;
+        reply.errorIndex = 0;
+        encoded = v1 ? SnmpAgentEncode(message, reply, requested.list, requested.len, response, limit) : 0;
+        if (encoded == 0) encoded = SnmpAgentEncode(message, reply, NULL, 0, response, limit);
+    }
+
+    return encoded;
+}
+
+// Ответ, ожидающий отправки из-за имитируемой задержки
+struct SnmpAgentDelayed {
+    ULONGLONG due;
+    sockaddr_storage address;
+    socklen_t addressLength;
+    std::vector<BYTE> data;
+
+    bool operator>(const SnmpAgentDelayed& other) const { return due > other.due; }
+};
+
+// Функция обслуживания одного сокета
+static void SnmpAgentServe(SnmpAgent& agent, SOCKET sock, SnmpAgentStats& stats, UINT threadIndex) {
+    const SnmpAgentOptions& options = agent.options;
+    std::vector<BYTE> receiveBuffer(SNMP_UDP_MAX_DATAGRAM);
+    std::vector<BYTE> sendBuffer(SNMP_UDP_MAX_DATAGRAM);
+    std::vector<RFC1157VarBind> varBinds;
+    SnmpArena arena;
+
+    std::random_device seed;
+    std::mt19937 random(seed() + threadIndex);
+    std::uniform_real_distribution<double> percent(0.0, 100.0);
+    std::uniform_int_distribution<DWORD> jitter(0, options.jitterUs);
+    std::priority_queue<SnmpAgentDelayed, std::vector<SnmpAgentDelayed>, std::greater<SnmpAgentDelayed>> delayed;
+
+    while (!agent.stop.load(std::memory_order_relaxed)) {
+        // Ждём до ближайшего отложенного ответа, но не дольше SNMP_AGENT_POLL_MS
+        ULONGLONG waitUs = SNMP_AGENT_POLL_MS * 1000;
+        if (!delayed.empty()) {
+            ULONGLONG now = SnmpAgentNowUs();
+            waitUs = delayed.top().due > now ? std::min(waitUs, delayed.top().due - now) : 0;
+        }
+
+        fd_set readSet;
+        FD_ZERO(&readSet);
+        FD_SET(sock, &readSet);
+        timeval wait;
+        wait.tv_sec = (long)(waitUs / 1000000);
+        wait.tv_usec = (long)(waitUs % 1000000);
+        int ready = select((int)sock + 1, &readSet, NULL, NULL, &wait);
+
+        // Вычитываем всё, что накопилось в сокете
+        while (ready > 0) {
+            sockaddr_storage from;
+            socklen_t fromLength = sizeof(from);
+            int received = recvfrom(sock, (char*)receiveBuffer.data(), (int)receiveBuffer.size(), 0,
+                (sockaddr*)&from, &fromLength);
+            if (received == SOCKET_ERROR) {
+                if (WSAGetLastError() == WSAECONNRESET) continue;
+                break;
+            }
+
+            stats.requests.fetch_add(1, std::memory_order_relaxed);
+            if (options.lossPercent > 0 && percent(random) < options.lossPercent) {
+                stats.dropped.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+
+            size_t length = SnmpAgentHandle(*agent.data, options, receiveBuffer.data(), (size_t)received,
+                arena, varBinds, sendBuffer.data(), sendBuffer.size(), stats);
+            if (length == 0) continue;
+
+            if (options.latencyUs > 0 || options.jitterUs > 0) {
+                SnmpAgentDelayed reply;
+                reply.due = SnmpAgentNowUs() + options.latencyUs + (options.jitterUs > 0 ? jitter(random) : 0);
+                reply.address = from;
+                reply.addressLength = fromLength;
+                reply.data.assign(sendBuffer.data(), sendBuffer.data() + length);
+                delayed.push(std::move(reply));
+                continue;
+            }
+
+            sendto(sock, (const char*)sendBuffer.data(), (int)length, 0, (const sockaddr*)&from, fromLength);
+            stats.responses.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        ULONGLONG now = delayed.empty() ? 0 : SnmpAgentNowUs();
+        while (!delayed.empty() && delayed.top().due <= now) {
+            const SnmpAgentDelayed& reply = delayed.top();
+            sendto(sock, (const char*)reply.data.data(), (int)reply.data.size(), 0,
+                (const sockaddr*)&reply.address, reply.addressLength);
+            stats.responses.fetch_add(1, std::memory_order_relaxed);
+            delayed.pop();
+        }
+    }
+}
+
+// Функция создания и привязки сокета агента
+static SOCKET SnmpAgentOpenSocket(const sockaddr_storage& address, int addressLength, bool reusePort) {
+    SOCKET sock = socket(address.ss_family, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock == INVALID_SOCKET) {
+        SetLastError(WSAGetLastError());
+        return INVALID_SOCKET;
+    }
+
+    int enable = 1;
+#ifdef SO_REUSEPORT
+    // Несколько сокетов на одном порту: ядро распределяет клиентов между потоками
+    if (reusePort) {
+        setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, (const char*)&enable, sizeof(enable));
+    }
+#else
+    (void)reusePort;
+    (void)enable;
+#endif
+
+    int bufferSize = SNMP_AGENT_SOCKET_BUFFER;
+    setsockopt(sock, SOL_SOCKET, SO_RCVBUF, (const char*)&bufferSize, sizeof(bufferSize));
+    setsockopt(sock, SOL_SOCKET, SO_SNDBUF, (const char*)&bufferSize, sizeof(bufferSize));
+
+    if (bind(sock, (const sockaddr*)&address, addressLength) == SOCKET_ERROR || !SnmpUdpSetNonBlocking(sock)) {
+        SetLastError(WSAGetLastError());
+        closesocket(sock);
+        return INVALID_SOCKET;
+    }
+
+    return sock;
+}
+
+bool SnmpAgentStart(SnmpAgent& agent, const SnmpAgentData& data, const SnmpAgentOptions& options) {
+    agent.data = &data;
+    agent.options = options;
+    agent.options.startUs = SnmpAgentNowUs();
+    agent.stop = false;
+    if (agent.options.threads == 0) agent.options.threads = 1;
+
+    sockaddr_storage address;
+    int addressLength;
+    if (!SnmpUdpResolve(agent.options.address, address, addressLength)) {
+        return false;
+    }
+
+    // Где нет SO_REUSEPORT, все потоки читают один сокет
+#ifdef SO_REUSEPORT
+    UINT socketCount = agent.options.threads;
+#else
+    UINT socketCount = 1;
+#endif
+    for (UINT i = 0; i < socketCount; i++) {
+        SOCKET sock = SnmpAgentOpenSocket(address, addressLength, socketCount > 1);
+        if (sock == INVALID_SOCKET) {
+            DWORD error = GetLastError();
+            SnmpAgentStop(agent);
+            SetLastError(error);
+            return false;
+        }
+        agent.sockets.push_back(sock);
+    }
+
+    agent.stats.reset(new SnmpAgentStats[agent.options.threads]);
+    for (UINT i = 0; i < agent.options.threads; i++) {
+        SOCKET sock = agent.sockets[i % agent.sockets.size()];
+        agent.threads.emplace_back(SnmpAgentServe, std::ref(agent), sock, std::ref(agent.stats[i]), i);
+    }
+    return true;
+}
+
+void SnmpAgentStop(SnmpAgent& agent) {
+    agent.stop = true;
+    for (std::thread& thread : agent.threads) {
+        thread.join();
+    }
+    agent.threads.clear();
+
+    for (SOCKET sock : agent.sockets) {
+        closesocket(sock);
+    }
+    agent.sockets.clear();
+}
+
+SnmpAgentTotals SnmpAgentGetTotals(const SnmpAgent& agent) {
+    SnmpAgentTotals totals;
+    if (!agent.stats) return totals;
+    for (UINT i = 0; i < agent.options.threads; i++) {
+        const SnmpAgentStats& stats = agent.stats[i];
+        totals.requests += stats.requests.load(std::memory_order_relaxed);
+        totals.responses += stats.responses.load(std::memory_order_relaxed);
+        totals.dropped += stats.dropped.load(std::memory_order_relaxed);
+        totals.invalid += stats.invalid.load(std::memory_order_relaxed);
+        totals.tooBig += stats.tooBig.load(std::memory_order_relaxed);
+    }
+    return totals;
+}
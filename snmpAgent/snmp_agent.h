@@ -0,0 +1,104 @@
+﻿#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "snmp_ber.h"
+#include "snmp_oid.h"
+
+// Размер ответа по умолчанию: наибольшая UDP-датаграмма IPv4
+#define SNMP_AGENT_DEFAULT_MESSAGE_SIZE 65507
+
+// Предел varbind в одном ответе на GETBULK (дальше ответ всё равно обрезается по размеру)
+#define SNMP_AGENT_MAX_VARBINDS 4096
+
+// Одна переменная агента. Строки и OID значений лежат в арене SnmpAgentData.
+struct SnmpAgentEntry {
+    SnmpOid name;
+    AsnAny value;
+};
+
+// Дерево переменных агента: записи упорядочены по OID, поиск - двоичный
+struct SnmpAgentData {
+    std::vector<SnmpAgentEntry> entries;
+    SnmpArena arena;
+    size_t upTimeIndex = (size_t)-1;   // запись sysUpTime.0 (находит SnmpAgentSort), (size_t)-1 - нет
+};
+
+// Загружает записанный обход в формате snmprec ("OID|тип|значение", тип - код тега BER:
+// 2, 4, 5, 6, 64, 65, 66, 67, 68, 70; суффикс x - значение в hex). Строки с ошибками
+// пропускаются с сообщением. Возвращает false, если файл не открылся.
+bool SnmpAgentLoadRecords(SnmpAgentData& data, const std::string& path);
+
+// Загружает архив обхода (snmp_archive). Значения копируются в арену: агенту нужен
+// массив записей для двоичного поиска, а архив после загрузки закрывается.
+bool SnmpAgentLoadArchive(SnmpAgentData& data, const std::string& path);
+
+// Добавляет группу system и синтетические ifTable/ifXTable на rows интерфейсов
+void SnmpAgentAddTables(SnmpAgentData& data, UINT rows);
+
+// Добавляет переменную, копируя значение в арену
+bool SnmpAgentAdd(SnmpAgentData& data, const SnmpOid& name, const AsnAny& value);
+
+// Сортирует записи; из повторяющихся OID остаётся добавленная последней.
+// Запоминает запись sysUpTime.0: её значение агент заменяет временем работы.
+void SnmpAgentSort(SnmpAgentData& data);
+
+// Время по steady_clock, мкс: отсчёт sysUpTime.0 и задержек ответа
+ULONGLONG SnmpAgentNowUs();
+
+struct SnmpAgentOptions {
+    std::string address = "127.0.0.1:161";
+    std::string community;        // пустая строка - принимается любая
+    UINT threads = 1;
+    DWORD latencyUs = 0;          // задержка перед отправкой ответа
+    DWORD jitterUs = 0;           // случайная добавка к задержке от 0 до jitterUs
+    double lossPercent = 0;       // процент запросов, оставленных без ответа
+    size_t maxMessageSize = SNMP_AGENT_DEFAULT_MESSAGE_SIZE;
+    UINT maxRepetitions = 0;      // ограничение max-repetitions GETBULK, 0 - как в запросе
+    ULONGLONG startUs = SnmpAgentNowUs();   // отсчёт sysUpTime.0; SnmpAgentStart ставит время запуска
+};
+
+// Счётчики одного потока агента; читаются во время работы, поэтому атомарные
+struct alignas(64) SnmpAgentStats {
+    std::atomic<unsigned long long> requests{0};
+    std::atomic<unsigned long long> responses{0};
+    std::atomic<unsigned long long> dropped{0};     // отброшены имитацией потерь
+    std::atomic<unsigned long long> invalid{0};     // не разобраны, чужое community, неизвестный PDU
+    std::atomic<unsigned long long> tooBig{0};
+};
+
+// Запущенный агент: по сокету и потоку обслуживания на каждый из options.threads
+struct SnmpAgent {
+    const SnmpAgentData* data = NULL;
+    SnmpAgentOptions options;
+    std::vector<SOCKET> sockets;
+    std::vector<std::thread> threads;
+    std::unique_ptr<SnmpAgentStats[]> stats;
+    std::atomic<bool> stop{false};
+};
+
+// Обрабатывает одно сообщение-запрос и кодирует ответ в response.
+// Возвращает длину ответа или 0, если на запрос отвечать не нужно.
+size_t SnmpAgentHandle(const SnmpAgentData& data, const SnmpAgentOptions& options,
+    const BYTE* request, size_t length, SnmpArena& arena, std::vector<RFC1157VarBind>& varBinds,
+    BYTE* response, size_t capacity, SnmpAgentStats& stats);
+
+// Открывает сокеты и запускает потоки обслуживания. data должны жить до SnmpAgentStop.
+bool SnmpAgentStart(SnmpAgent& agent, const SnmpAgentData& data, const SnmpAgentOptions& options);
+
+// Останавливает потоки и закрывает сокеты
+void SnmpAgentStop(SnmpAgent& agent);
+
+// Сумма счётчиков всех потоков
+struct SnmpAgentTotals {
+    unsigned long long requests = 0;
+    unsigned long long responses = 0;
+    unsigned long long dropped = 0;
+    unsigned long long invalid = 0;
+    unsigned long long tooBig = 0;
+};
+
+SnmpAgentTotals SnmpAgentGetTotals(const SnmpAgent& agent);
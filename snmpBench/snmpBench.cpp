@@ -0,0 +1,1402 @@
+﻿// Замеры горячих путей manageSNMP: разбор и сравнение OID, кодек BER, форматирование
+// строк результата и сетевые операции (GET, пакетный GET, обходы, опрос) против
+// встроенного имитатора агента на loopback. Результаты сохраняются в JSON,
+// два прогона сравниваются с порогом регрессии.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include "snmp_agent.h"
+#include "snmp_archive.h"
+#include "snmp_async.h"
+#include "snmp_batch.h"
+#include "snmp_bench.h"
+#include "snmp_cache.h"
+#include "snmp_delta.h"
+#include "snmp_metrics.h"
+#include "snmp_mib.h"
+#include "snmp_poller.h"
+#include "snmp_pwalk.h"
+#include "snmp_resolve.h"
+#include "snmp_sched.h"
+#include "snmp_simd.h"
+#include "snmp_table.h"
+#include "snmp_session.h"
+#include "snmp_sink.h"
+#include "snmp_syntax.h"
+#include "snmp_udp.h"
+
+#ifdef _WIN32
+#pragma comment(lib, "ws2_32.lib")
+#endif
+
+// Адрес встроенного агента: нестандартный порт, чтобы не мешать настоящему агенту на 161
+#define SNMP_BENCH_AGENT_ADDRESS "127.0.0.1:16161"
+
+// Агент с потерями и задержкой для тестов таймаутов и адрес, на котором агента нет
+#define SNMP_BENCH_LOSSY_AGENT_ADDRESS "127.0.0.1:16162"
+#define SNMP_BENCH_DEAD_AGENT_ADDRESS "127.0.0.1:16163"
+
+// Медленный агент для тестов кэша ответов: его счётчик запросов показывает нагрузку от сборщиков
+#define SNMP_BENCH_CACHE_AGENT_ADDRESS "127.0.0.1:16164"
+
+// Сборщиков (потоков со своей сессией), одновременно опрашивающих одного агента
+#define SNMP_BENCH_CACHE_COLLECTORS 8
+
+// Число целей в тесте опроса
+#define SNMP_BENCH_POLL_TARGETS 1000
+
+// Одновременных процессов "обход, затем GET" в тесте корутин
+#define SNMP_BENCH_ASYNC_WORKFLOWS 1000
+
+// Групп заданий в тесте масштабирования обхода: каждая четвёртая обходит ifTable, остальные - system
+#define SNMP_BENCH_SCHED_GROUPS 32
+
+// Размер списка агентов в тестах запуска (разрешение имён и пул сессий)
+#define SNMP_BENCH_INVENTORY_TARGETS 10000
+
+// Наибольшая длина строки при сверке векторных путей со скалярным: несколько блоков AVX2 и хвосты
+#define SNMP_BENCH_SIMD_CHECK_LENGTH 200
+
+// Строк ifTable в тестах колоночного снимка
+#define SNMP_BENCH_TABLE_ROWS 100000
+
+// Строк ifTable в тестах архива обхода (13 колонок - записей в 13 раз больше)
+#define SNMP_BENCH_ARCHIVE_ROWS 10000
+
+// Строк ifTable в замерах разбора значений по синтаксису объекта
+#define SNMP_BENCH_SYNTAX_ROWS 1000
+
+// Выдержка soak.walk_1m: varbind всего, шаг замера RSS, допустимый рост RSS после разогрева
+// (первых 10% varbind), байт
+#define SNMP_BENCH_SOAK_VARBINDS 1000000
+#define SNMP_BENCH_SOAK_SAMPLE 10000
+#define SNMP_BENCH_SOAK_RSS_SLACK (2 * 1024 * 1024)
+
+struct SnmpBenchContext {
+    SnmpBenchOptions options;
+    std::string filter;
+    std::string agentAddress = SNMP_BENCH_AGENT_ADDRESS;
+    UINT rows = 200;
+    SnmpAgentData data;           // те же переменные, что отдаёт встроенный агент
+    SnmpMibIndex mib;
+    std::vector<SnmpBenchResult> results;
+    bool simdMismatch = false;    // векторные пути разошлись со скалярным
+    bool berMismatch = false;     // декодер принял неверный или отверг верный OID
+    bool soakGrowth = false;      // RSS рос во время выдержки
+};
+
+static bool SnmpBenchSelected(const SnmpBenchContext& context, const std::string& name) {
+    return context.filter.empty() || name.find(context.filter) != std::string::npos;
+}
+
+// Долгие тесты выполняются, только если фильтр задан и выбирает их
+static bool SnmpBenchExplicit(const SnmpBenchContext& context, const std::string& name) {
+    return !context.filter.empty() && name.find(context.filter) != std::string::npos;
+}
+
+static void SnmpBenchAdd(SnmpBenchContext& context, const SnmpBenchResult& result) {
+    SnmpBenchPrint(std::cout, result);
+    context.results.push_back(result);
+}
+
+// Varbind записи агента (значения в арене данных агента)
+static RFC1157VarBind SnmpBenchVarBind(const SnmpAgentEntry& entry) {
+    RFC1157VarBind varBind;
+    varBind.name = entry.name.AsAsn();
+    varBind.value = entry.value;
+    return varBind;
+}
+
+static void BenchOid(SnmpBenchContext& context) {
+    // ParseOIDString: числовая запись и имя из MIB
+    if (SnmpBenchSelected(context, "oid.parse")) {
+        static const char text[] = "1.3.6.1.2.1.2.2.1.10.1234";
+        SnmpOid oid;
+        SnmpBenchAdd(context, SnmpBenchRun("oid.parse", context.options, [&]() {
+            SnmpOidParse(text, sizeof(text) - 1, oid);
+        }));
+    }
+    if (SnmpBenchSelected(context, "oid.parse_name")) {
+        std::string text = "IF-MIB::ifInOctets.1234";
+        SnmpOid oid;
+        SnmpBenchAdd(context, SnmpBenchRun("oid.parse_name", context.options, [&]() {
+            SnmpMibLookup(context.mib, text, oid);
+        }));
+    }
+    if (SnmpBenchSelected(context, "oid.compare")) {
+        SnmpOid oid1 = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 10, 1234 };
+        SnmpOid oid2 = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 10, 1235 };
+        volatile int order = 0;
+        SnmpBenchAdd(context, SnmpBenchRun("oid.compare", context.options, [&]() {
+            order = oid1.Compare(oid2);
+        }));
+    }
+    if (SnmpBenchSelected(context, "oid.hash_lookup")) {
+        std::unordered_set<SnmpOid> set;
+        for (const SnmpAgentEntry& entry : context.data.entries) set.insert(entry.name);
+        size_t index = 0;
+        volatile bool found = false;
+        SnmpBenchAdd(context, SnmpBenchRun("oid.hash_lookup", context.options, [&]() {
+            found = set.count(context.data.entries[index].name) != 0;
+            if (++index == context.data.entries.size()) index = 0;
+        }));
+    }
+    if (SnmpBenchSelected(context, "mib.resolve")) {
+        SnmpOid oid = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 10, 1234 };
+        std::string out;
+        SnmpBenchAdd(context, SnmpBenchRun("mib.resolve", context.options, [&]() {
+            out.clear();
+            SnmpMibResolve(context.mib, oid.Data(), oid.Length(), out);
+        }));
+    }
+}
+
+// Ответ GetResponse с одним varbind: OID из подидентификаторов subIds (первый - 40 * X + Y)
+// и NULL. Подидентификаторы кодируются как есть, в том числе не помещающиеся в UINT.
+static std::vector<BYTE> BenchBerResponse(const std::vector<unsigned long long>& subIds) {
+    auto tlv = [](BYTE tag, const std::vector<BYTE>& content) {
+        std::vector<BYTE> out;
+        out.reserve(content.size() + 2);
+        out.push_back(tag);
+        out.push_back((BYTE)content.size());
+        for (BYTE byte : content) out.push_back(byte);
+        return out;
+    };
+    auto concat = [](std::initializer_list<std::vector<BYTE>> parts) {
+        std::vector<BYTE> out;
+        for (const std::vector<BYTE>& part : parts) out.insert(out.end(), part.begin(), part.end());
+        return out;
+    };
+
+    std::vector<BYTE> oid;
+    for (unsigned long long subId : subIds) {
+        BYTE groups[10];
+        int count = 0;
+        do {
+            groups[count++] = (BYTE)(subId & 0x7F);
+            subId >>= 7;
+        } while (subId != 0);
+        while (count > 0) {
+            count--;
+            oid.push_back((BYTE)(groups[count] | (count > 0 ? 0x80 : 0)));
+        }
+    }
+
+    std::vector<BYTE> varBind = tlv(ASN_SEQUENCE, concat({ tlv(ASN_OBJECTIDENTIFIER, oid), tlv(ASN_NULL, {}) }));
+    std::vector<BYTE> pdu = tlv(SNMP_PDU_RESPONSE, concat({ tlv(ASN_INTEGER, { 1 }), tlv(ASN_INTEGER, { 0 }),
+        tlv(ASN_INTEGER, { 0 }), tlv(ASN_SEQUENCE, varBind) }));
+    return tlv(ASN_SEQUENCE, concat({ tlv(ASN_INTEGER, { 1 }),
+        tlv(ASN_OCTETSTRING, { 'p', 'u', 'b', 'l', 'i', 'c' }), pdu }));
+}
+
+// Проверка границ дуг OID в декодере: первый подидентификатор может быть на 80 больше
+// UINT (2.4294967295), остальные дуги - не больше 4294967295, без усечения
+static bool BenchCheckBer() {
+    static const struct {
+        std::vector<unsigned long long> subIds;
+        bool valid;
+        SnmpOidLiteral expected;
+    } cases[] = {
+        { { 0xFFFFFFFFULL + 80 }, true, { 2, 0xFFFFFFFF } },
+        { { 0xFFFFFFFFULL + 81 }, false, {} },
+        { { 43, 0xFFFFFFFFULL }, true, { 1, 3, 0xFFFFFFFF } },
+        { { 43, 0x100000000ULL }, false, {} },
+        { { 43, 0xFFFFFFFFULL + 17 }, false, {} },
+    };
+
+    bool success = true;
+    SnmpArena arena;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        std::vector<BYTE> message = BenchBerResponse(cases[i].subIds);
+        SnmpArenaReset(arena);
+        SnmpMessage decoded;
+        bool valid = BerDecodeMessage(message.data(), message.size(), arena, decoded) && decoded.pdu.varBinds.len == 1;
+        if (valid && cases[i].valid) {
+            const AsnObjectIdentifier& name = decoded.pdu.varBinds.list[0].name;
+            valid = SnmpOid(name) == SnmpOid(cases[i].expected);
+            if (!valid) {
+                std::cerr << "ber.check: case " << i + 1 << " decoded as " << SnmpOid(name).ToString() << std::endl;
+                success = false;
+                continue;
+            }
+        }
+        if (valid != cases[i].valid) {
+            std::cerr << "ber.check: case " << i + 1 << (valid ? " accepted" : " rejected") << std::endl;
+            success = false;
+        }
+    }
+
+    std::cout << "ber.check: " << (success ? "OID arc bounds are enforced" : "MISMATCH") << std::endl;
+    return success;
+}
+
+static void BenchBer(SnmpBenchContext& context) {
+    if (SnmpBenchSelected(context, "ber.check") && !BenchCheckBer()) {
+        context.berMismatch = true;
+    }
+
+    // Запрос GET на 10 OID и ответ на него со значениями разных типов
+    std::vector<RFC1157VarBind> varBinds;
+    for (size_t i = 0; i < 10 && i < context.data.entries.size(); i++) {
+        varBinds.push_back(SnmpBenchVarBind(context.data.entries[i * context.data.entries.size() / 10]));
+    }
+
+    SnmpPdu pdu;
+    pdu.type = SNMP_PDU_GET;
+    pdu.requestId = 12345;
+    pdu.errorStatus = 0;
+    pdu.errorIndex = 0;
+    pdu.varBinds.list = varBinds.data();
+    pdu.varBinds.len = (UINT)varBinds.size();
+
+    std::vector<BYTE> buffer(SNMP_UDP_MAX_DATAGRAM);
+    if (SnmpBenchSelected(context, "ber.encode_get10")) {
+        SnmpBenchAdd(context, SnmpBenchRun("ber.encode_get10", context.options, [&]() {
+            BerEncodeMessage(SNMP_VERSION_V2C, "public", 6, pdu, buffer.data(), buffer.size());
+        }));
+    }
+
+    // То же с заранее закодированными version и community, как в сессии
+    if (SnmpBenchSelected(context, "ber.encode_get10_prefixed")) {
+        BYTE header[64];
+        size_t headerLength = BerEncodeMessageHeader(SNMP_VERSION_V2C, "public", 6, header, sizeof(header));
+        SnmpBenchAdd(context, SnmpBenchRun("ber.encode_get10_prefixed", context.options, [&]() {
+            BerEncodeMessagePrefixed(header, headerLength, pdu, buffer.data(), buffer.size());
+        }));
+    }
+
+    pdu.type = SNMP_PDU_RESPONSE;
+    size_t length = BerEncodeMessage(SNMP_VERSION_V2C, "public", 6, pdu, buffer.data(), buffer.size());
+    if (SnmpBenchSelected(context, "ber.decode_response10")) {
+        SnmpArena arena;
+        SnmpMessage message;
+        SnmpBenchAdd(context, SnmpBenchRun("ber.decode_response10", context.options, [&]() {
+            SnmpArenaReset(arena);
+            BerDecodeMessage(buffer.data(), length, arena, message);
+        }));
+    }
+
+    // Обработка GETBULK агентом: поиск и кодирование 25 строк
+    if (SnmpBenchSelected(context, "agent.handle_getbulk25")) {
+        SnmpOid start = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 2 };
+        RFC1157VarBind requestVarBind;
+        requestVarBind.name = start.AsAsn();
+        requestVarBind.value.asnType = ASN_NULL;
+        SnmpPdu request;
+        request.type = SNMP_PDU_GETBULK;
+        request.requestId = 1;
+        request.errorStatus = 0;
+        request.errorIndex = 25;
+        request.varBinds.list = &requestVarBind;
+        request.varBinds.len = 1;
+        std::vector<BYTE> requestBuffer(512);
+        size_t requestLength = BerEncodeMessage(SNMP_VERSION_V2C, "public", 6, request,
+            requestBuffer.data(), requestBuffer.size());
+
+        SnmpAgentOptions agentOptions;
+        SnmpAgentStats stats;
+        SnmpArena arena;
+        std::vector<RFC1157VarBind> agentVarBinds;
+        SnmpBenchAdd(context, SnmpBenchRun("agent.handle_getbulk25", context.options, [&]() {
+            SnmpAgentHandle(context.data, agentOptions, requestBuffer.data(), requestLength, arena, agentVarBinds,
+                buffer.data(), buffer.size(), stats);
+        }));
+    }
+}
+
+// Строки результата: PrintSnmpValue/PrintWalkItem и форматы приёмника обхода
+static void BenchFormat(SnmpBenchContext& context) {
+    std::ostream nullStream(NULL);
+    SnmpOutput output;
+    output.stream = &nullStream;
+
+    std::vector<RFC1157VarBind> varBinds;
+    for (const SnmpAgentEntry& entry : context.data.entries) varBinds.push_back(SnmpBenchVarBind(entry));
+
+    if (SnmpBenchSelected(context, "format.varbind")) {
+        size_t index = 0;
+        SnmpBenchAdd(context, SnmpBenchRun("format.varbind", context.options, [&]() {
+            SnmpFormatVarBind(output.buffer, varBinds[index], context.mib);
+            SnmpOutputCommit(output);
+            if (++index == varBinds.size()) index = 0;
+        }));
+    }
+
+    static const struct { const char* name; SnmpSinkFormat format; } sinks[] = {
+        { "sink.text", SNMP_SINK_TEXT },
+        { "sink.ndjson", SNMP_SINK_NDJSON },
+        { "sink.csv", SNMP_SINK_CSV },
+        { "sink.binary", SNMP_SINK_BINARY },
+        { "sink.snmprec", SNMP_SINK_SNMPREC },
+    };
+    for (const auto& item : sinks) {
+        if (!SnmpBenchSelected(context, item.name)) continue;
+        SnmpSink sink;
+        sink.format = item.format;
+        sink.output = &output;
+        sink.mib = &context.mib;
+        SnmpSinkBegin(sink);
+        size_t index = 0;
+        SnmpBenchAdd(context, SnmpBenchRun(item.name, context.options, [&]() {
+            SnmpSinkWrite(sink, (int)index + 1, varBinds[index]);
+            if (++index == varBinds.size()) index = 0;
+        }));
+        SnmpSinkEnd(sink);
+    }
+}
+
+// Сверка векторных путей форматирования байтов со скалярным на длинах 0..SNMP_BENCH_SIMD_CHECK_LENGTH:
+// случайные байты и граничные значения печатаемости в каждой позиции печатаемой строки
+static bool BenchCheckSimd() {
+    static const BYTE edges[] = { 0x00, 0x1F, 0x20, 0x7E, 0x7F, 0x80, 0xFF };
+    std::vector<BYTE> random(SNMP_BENCH_SIMD_CHECK_LENGTH), printable(SNMP_BENCH_SIMD_CHECK_LENGTH);
+    unsigned int seed = 12345;
+    for (size_t i = 0; i < random.size(); i++) {
+        seed = seed * 1103515245 + 12345;
+        random[i] = (BYTE)(seed >> 16);
+        printable[i] = (BYTE)(0x20 + (seed >> 16) % 0x5F);
+    }
+
+    std::string expected, actual;
+    auto render = [](std::string& out, const BYTE* data, size_t length) {
+        out.clear();
+        out.push_back(SnmpFormatIsPrintable(data, length) ? 'P' : 'N');
+        SnmpFormatHex(out, data, length);
+        out.push_back('|');
+        SnmpFormatHexSeparated(out, data, length, '-');
+    };
+    auto same = [&](SnmpSimdLevel level, const BYTE* data, size_t length) {
+        SnmpSimdSelect(SNMP_SIMD_SCALAR);
+        render(expected, data, length);
+        SnmpSimdSelect(level);
+        render(actual, data, length);
+        if (expected == actual) return true;
+        std::cerr << "simd.check: " << SnmpSimdName(level) << " differs from scalar at length " << length << std::endl;
+        return false;
+    };
+
+    bool success = true;
+    SnmpSimdLevel supported = SnmpSimdSupported();
+    for (int level = SNMP_SIMD_SSE2; level <= supported && success; level++) {
+        for (size_t length = 0; length <= SNMP_BENCH_SIMD_CHECK_LENGTH && success; length++) {
+            success = same((SnmpSimdLevel)level, random.data(), length) && same((SnmpSimdLevel)level, printable.data(), length);
+            std::vector<BYTE> data(printable.begin(), printable.begin() + length);
+            for (size_t position = 0; position < length && success; position++) {
+                for (BYTE edge : edges) {
+                    data[position] = edge;
+                    if (!same((SnmpSimdLevel)level, data.data(), length)) {
+                        success = false;
+                        break;
+                    }
+                }
+                data[position] = printable[position];
+            }
+        }
+    }
+    SnmpSimdSelect(supported);
+
+    std::cout << "simd.check: " << (success ? "vector paths match scalar" : "MISMATCH") << " (best: "
+        << SnmpSimdName(supported) << ")" << std::endl;
+    return success;
+}
+
+// Классификация и hex байтов OCTET STRING: каждый доступный уровень SIMD и строки значений целиком
+static void BenchSimd(SnmpBenchContext& context) {
+    if (SnmpBenchSelected(context, "simd.check") && !BenchCheckSimd()) {
+        context.simdMismatch = true;
+    }
+
+    std::vector<BYTE> printable(256), binary(256);
+    for (size_t i = 0; i < printable.size(); i++) {
+        printable[i] = (BYTE)('a' + i % 26);
+        binary[i] = (BYTE)(i * 37);
+    }
+
+    std::string out;
+    SnmpSimdLevel supported = SnmpSimdSupported();
+    for (int level = SNMP_SIMD_SCALAR; level <= supported; level++) {
+        SnmpSimdSelect((SnmpSimdLevel)level);
+        std::string suffix = SnmpSimdName((SnmpSimdLevel)level);
+
+        if (SnmpBenchSelected(context, "simd.classify256_" + suffix)) {
+            volatile bool result = false;
+            SnmpBenchAdd(context, SnmpBenchRun("simd.classify256_" + suffix, context.options, [&]() {
+                result = SnmpFormatIsPrintable(printable.data(), printable.size());
+            }));
+            (void)result;
+        }
+        if (SnmpBenchSelected(context, "simd.hex256_" + suffix)) {
+            SnmpBenchAdd(context, SnmpBenchRun("simd.hex256_" + suffix, context.options, [&]() {
+                out.clear();
+                SnmpFormatHex(out, binary.data(), binary.size());
+            }));
+        }
+    }
+    SnmpSimdSelect(supported);
+
+    // Строки значений, как в обходе ipNetToMediaTable / FDB / LLDP
+    static const BYTE mac[] = { 0x00, 0x1B, 0x21, 0x0A, 0xFF, 0x01 };
+    const struct { const char* name; const BYTE* data; UINT length; } values[] = {
+        { "format.octets_mac", mac, sizeof(mac) },
+        { "format.octets_hex64", binary.data(), 64 },
+        { "format.octets_text64", printable.data(), 64 },
+    };
+    for (const auto& item : values) {
+        if (!SnmpBenchSelected(context, item.name)) continue;
+        AsnAny value;
+        value.asnType = ASN_OCTETSTRING;
+        value.asnValue.string.stream = (BYTE*)item.data;
+        value.asnValue.string.length = item.length;
+        value.asnValue.string.dynamic = FALSE;
+        SnmpBenchAdd(context, SnmpBenchRun(item.name, context.options, [&]() {
+            out.clear();
+            SnmpFormatValue(out, value, context.mib);
+        }));
+    }
+}
+
+// Обход ifTable из rows строк в порядке GETBULK (по колонкам), колонки - как у встроенного агента.
+// Varbind собирается на месте и действителен только внутри onVarBind.
+template <typename Callback>
+static void BenchTableWalk(UINT rows, ULONGLONG counterBase, Callback&& onVarBind) {
+    static const UINT columns[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 14, 16, 20 };
+    UINT name[] = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 0, 0 };
+    char text[32];
+    BYTE mac[6] = { 0x00, 0x1B, 0x21, 0, 0, 0 };
+
+    RFC1157VarBind varBind;
+    varBind.name.ids = name;
+    varBind.name.idLength = sizeof(name) / sizeof(name[0]);
+    for (UINT column : columns) {
+        name[9] = column;
+        for (UINT i = 1; i <= rows; i++) {
+            name[10] = i;
+            AsnAny& value = varBind.value;
+            memset(&value, 0, sizeof(value));
+            switch (column) {
+            case 2:
+                value.asnType = ASN_OCTETSTRING;
+                value.asnValue.string.length = (UINT)snprintf(text, sizeof(text), "eth%u", i - 1);
+                value.asnValue.string.stream = (BYTE*)text;
+                break;
+            case 6:
+                mac[3] = (BYTE)(i >> 16);
+                mac[4] = (BYTE)(i >> 8);
+                mac[5] = (BYTE)i;
+                value.asnType = ASN_OCTETSTRING;
+                value.asnValue.string.length = sizeof(mac);
+                value.asnValue.string.stream = mac;
+                break;
+            case 5:
+                value.asnType = ASN_GAUGE32;
+                value.asnValue.unsigned32 = 1000000000;
+                break;
+            case 9:
+                value.asnType = ASN_TIMETICKS;
+                break;
+            case 10:
+            case 16:
+                value.asnType = ASN_COUNTER32;
+                value.asnValue.unsigned32 = (AsnUnsigned32)(counterBase + (ULONGLONG)i * column * 100);
+                break;
+            case 14:
+            case 20:
+                value.asnType = ASN_COUNTER32;
+                break;
+            default:
+                value.asnType = ASN_INTEGER;
+                value.asnValue.number = column == 1 ? (AsnInteger)i : 1;
+                break;
+            }
+            onVarBind(varBind);
+        }
+    }
+}
+
+// Память блока malloc (glibc на 64 битах): 8 байт заголовка, кратно 16, не меньше 32
+static size_t BenchHeapBlock(size_t size) {
+    size_t block = (size + 8 + 15) & ~(size_t)15;
+    return block < 32 ? 32 : block;
+}
+
+// Колоночный снимок таблицы на SNMP_BENCH_TABLE_ROWS строк: сборка из обхода, поиск строки,
+// сумма и скорость счётчика; память на строку - против varbind с OID и строками в куче
+static void BenchTable(SnmpBenchContext& context) {
+    SnmpBenchOptions tableOptions = context.options;
+    tableOptions.minSamples = 5;
+    static const SnmpOid ifTable = { 1, 3, 6, 1, 2, 1, 2, 2 };
+
+    SnmpTable table, previous;
+    if (SnmpBenchSelected(context, "table.build_100k")) {
+        SnmpBenchAdd(context, SnmpBenchRun("table.build_100k", tableOptions, [&]() {
+            SnmpTableInit(table, ifTable);
+            BenchTableWalk(SNMP_BENCH_TABLE_ROWS, 0, [&](RFC1157VarBind& varBind) { SnmpTableAdd(table, varBind); });
+        }));
+    }
+
+    SnmpTableInit(table, ifTable);
+    BenchTableWalk(SNMP_BENCH_TABLE_ROWS, 0, [&](RFC1157VarBind& varBind) { SnmpTableAdd(table, varBind); });
+    SnmpTableInit(previous, ifTable);
+    BenchTableWalk(SNMP_BENCH_TABLE_ROWS, 0x100000000ULL - 500000, [&](RFC1157VarBind& varBind) {
+        SnmpTableAdd(previous, varBind);
+    });
+
+    if (SnmpBenchSelected(context, "table.memory_100k")) {
+        // Прежнее представление: массив varbind, у каждого имя и байты строки - отдельные блоки в куче
+        size_t heapBytes = 0, rows = SNMP_BENCH_TABLE_ROWS;
+        BenchTableWalk(SNMP_BENCH_TABLE_ROWS, 0, [&](RFC1157VarBind& varBind) {
+            heapBytes += sizeof(RFC1157VarBind) + BenchHeapBlock(varBind.name.idLength * sizeof(UINT));
+            if (varBind.value.asnType == ASN_OCTETSTRING) heapBytes += BenchHeapBlock(varBind.value.asnValue.string.length);
+        });
+        size_t tableBytes = SnmpTableMemory(table);
+        std::cout << "table.memory_100k: varbinds " << heapBytes / rows << " B/row, columnar "
+            << tableBytes / rows << " B/row (" << table.columns.size() << " columns)" << std::endl;
+    }
+
+    if (SnmpBenchSelected(context, "table.lookup")) {
+        UINT index = 1;
+        size_t row = 0;
+        SnmpBenchAdd(context, SnmpBenchRun("table.lookup", context.options, [&]() {
+            SnmpTableFindRow(table, &index, 1, row);
+            index = index * 7 % SNMP_BENCH_TABLE_ROWS + 1;
+        }));
+    }
+
+    const SnmpTableColumn* inOctets = SnmpTableFindColumn(table, 10);
+    if (SnmpBenchSelected(context, "table.sum_100k") && inOctets) {
+        volatile ULONGLONG sum = 0;
+        SnmpBenchAdd(context, SnmpBenchRun("table.sum_100k", context.options, [&]() {
+            sum = SnmpTableSum(*inOctets);
+        }));
+        (void)sum;
+    }
+
+    if (SnmpBenchSelected(context, "table.rate_100k")) {
+        std::vector<double> rates;
+        volatile double total = 0;
+        SnmpBenchAdd(context, SnmpBenchRun("table.rate_100k", context.options, [&]() {
+            total = SnmpTableRates(previous, table, 10, 60, rates);
+        }));
+        (void)total;
+    }
+}
+
+// Разбор значений по синтаксису объекта против общего разбора по asnType: строки обхода
+// (поиск привязки на каждый varbind) и ячейки таблицы (разборщик выбран один раз на колонку)
+static void BenchSyntax(SnmpBenchContext& context) {
+    SnmpBenchOptions syntaxOptions = context.options;
+    syntaxOptions.minSamples = 5;
+    static const SnmpOid ifTable = { 1, 3, 6, 1, 2, 1, 2, 2 };
+    std::string out;
+
+    if (SnmpBenchSelected(context, "syntax.find")) {
+        std::vector<SnmpOid> names;
+        BenchTableWalk(SNMP_BENCH_SYNTAX_ROWS / 10, 0, [&](RFC1157VarBind& varBind) {
+            names.push_back(SnmpOid(varBind.name.ids, varBind.name.idLength));
+        });
+        names.push_back(SnmpOid({ 1, 3, 6, 1, 2, 1, 11, 4, 0 }));
+        names.push_back(SnmpOid({ 1, 3, 6, 1, 4, 1, 9, 9, 1 }));
+        size_t index = 0;
+        volatile const SnmpSyntaxBinding* found = NULL;
+        SnmpBenchAdd(context, SnmpBenchRun("syntax.find", context.options, [&]() {
+            found = SnmpSyntaxFind(names[index].Data(), names[index].Length());
+            if (++index == names.size()) index = 0;
+        }));
+        (void)found;
+    }
+
+    if (SnmpBenchSelected(context, "syntax.walk_generic_1k_rows")) {
+        SnmpBenchAdd(context, SnmpBenchRun("syntax.walk_generic_1k_rows", syntaxOptions, [&]() {
+            out.clear();
+            BenchTableWalk(SNMP_BENCH_SYNTAX_ROWS, 0, [&](RFC1157VarBind& varBind) {
+                SnmpFormatValue(out, varBind.value, context.mib);
+            });
+        }));
+    }
+
+    if (SnmpBenchSelected(context, "syntax.walk_typed_1k_rows")) {
+        SnmpBenchAdd(context, SnmpBenchRun("syntax.walk_typed_1k_rows", syntaxOptions, [&]() {
+            out.clear();
+            BenchTableWalk(SNMP_BENCH_SYNTAX_ROWS, 0, [&](RFC1157VarBind& varBind) {
+                SnmpFormatTypedValue(out, varBind.name.ids, varBind.name.idLength, varBind.value, context.mib);
+            });
+        }));
+    }
+
+    SnmpTable table;
+    SnmpTableInit(table, ifTable);
+    BenchTableWalk(SNMP_BENCH_SYNTAX_ROWS, 0, [&](RFC1157VarBind& varBind) { SnmpTableAdd(table, varBind); });
+
+    if (SnmpBenchSelected(context, "syntax.cells_generic_1k_rows")) {
+        SnmpBenchAdd(context, SnmpBenchRun("syntax.cells_generic_1k_rows", syntaxOptions, [&]() {
+            out.clear();
+            for (const SnmpTableColumn& column : table.columns) {
+                for (size_t row = 0; row < SnmpTableRows(table); row++) {
+                    AsnAny value;
+                    if (SnmpTableGet(column, row, value)) SnmpFormatValueText(out, value);
+                }
+            }
+        }));
+    }
+
+    if (SnmpBenchSelected(context, "syntax.cells_typed_1k_rows")) {
+        SnmpBenchAdd(context, SnmpBenchRun("syntax.cells_typed_1k_rows", syntaxOptions, [&]() {
+            out.clear();
+            SnmpOid columnOid = table.entry;
+            for (const SnmpTableColumn& column : table.columns) {
+                columnOid.Append(column.arc);
+                const SnmpSyntaxBinding* binding = SnmpSyntaxFind(columnOid.Data(), columnOid.Length());
+                columnOid.Truncate(table.entry.Length());
+                SnmpSyntaxDecoder decoder = SnmpSyntaxGetDecoder(binding ? binding->syntax : SNMP_SYNTAX_UNKNOWN);
+                for (size_t row = 0; row < SnmpTableRows(table); row++) {
+                    AsnAny value;
+                    if (!SnmpTableGet(column, row, value)) continue;
+                    if (binding == NULL || !decoder(out, value, *binding)) SnmpFormatValueText(out, value);
+                }
+            }
+        }));
+    }
+}
+
+// Функция записи синтетической ifTable в архив; counterBase различает два снимка
+static bool BenchArchiveWrite(const std::string& path, ULONGLONG counterBase) {
+    SnmpArchiveWriter writer;
+    if (!SnmpArchiveCreate(writer, path)) return false;
+    BenchTableWalk(SNMP_BENCH_ARCHIVE_ROWS, counterBase, [&](RFC1157VarBind& varBind) { SnmpArchiveAppend(writer, varBind); });
+    return SnmpArchiveFinish(writer);
+}
+
+// Архив обхода ifTable: запись, поиск OID, чтение колонки и сравнение двух снимков;
+// размер на запись - против текстового вывода get_all
+static void BenchArchive(SnmpBenchContext& context) {
+    static const char* const names[] = {
+        "archive.write_10k_rows", "archive.size", "archive.lookup", "archive.scan_column_10k", "archive.diff_10k_rows"
+    };
+    bool selected = false;
+    for (const char* name : names) {
+        if (SnmpBenchSelected(context, name)) selected = true;
+    }
+    if (!selected) return;
+
+    SnmpBenchOptions archiveOptions = context.options;
+    archiveOptions.minSamples = 5;
+    std::error_code error;
+    std::filesystem::path directory = std::filesystem::temp_directory_path(error);
+    std::string beforePath = (directory / "snmpBench_before.swar").string();
+    std::string afterPath = (directory / "snmpBench_after.swar").string();
+
+    if (SnmpBenchSelected(context, "archive.write_10k_rows")) {
+        SnmpBenchAdd(context, SnmpBenchRun("archive.write_10k_rows", archiveOptions, [&]() {
+            BenchArchiveWrite(afterPath, 0);
+        }));
+    }
+
+    SnmpArchive before, after;
+    if (!BenchArchiveWrite(beforePath, 0x100000000ULL - 500000) || !BenchArchiveWrite(afterPath, 0)
+        || !SnmpArchiveOpen(before, beforePath) || !SnmpArchiveOpen(after, afterPath)) {
+        std::cerr << "Cannot prepare archives in " << directory.string() << std::endl;
+        return;
+    }
+
+    if (SnmpBenchSelected(context, "archive.size")) {
+        std::string text;
+        BenchTableWalk(SNMP_BENCH_ARCHIVE_ROWS, 0, [&](RFC1157VarBind& varBind) {
+            SnmpFormatWalkItem(text, 1, varBind, context.mib);
+        });
+        ULONGLONG records = after.records;
+        std::cout << "archive.size: " << after.viewSize / records << " B/item, " << after.blockCount
+            << " blocks; text walk " << text.size() / records << " B/item" << std::endl;
+    }
+
+    if (SnmpBenchSelected(context, "archive.lookup")) {
+        UINT name[] = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 2, 1 };
+        SnmpArchiveCursor cursor;
+        SnmpBenchAdd(context, SnmpBenchRun("archive.lookup", context.options, [&]() {
+            SnmpArchiveGet(after, cursor, name, sizeof(name) / sizeof(name[0]));
+            name[10] = name[10] * 7 % SNMP_BENCH_ARCHIVE_ROWS + 1;
+        }));
+    }
+
+    if (SnmpBenchSelected(context, "archive.scan_column_10k")) {
+        static const UINT inOctets[] = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 10 };
+        volatile ULONGLONG sum = 0;
+        SnmpBenchAdd(context, SnmpBenchRun("archive.scan_column_10k", context.options, [&]() {
+            ULONGLONG total = 0;
+            SnmpArchiveScan(after, inOctets, sizeof(inOctets) / sizeof(inOctets[0]), [&total](const RFC1157VarBind& varBind) {
+                total += varBind.value.asnValue.unsigned32;
+                return true;
+            });
+            sum = total;
+        }));
+        (void)sum;
+    }
+
+    if (SnmpBenchSelected(context, "archive.diff_10k_rows")) {
+        volatile size_t changes = 0;
+        SnmpBenchAdd(context, SnmpBenchRun("archive.diff_10k_rows", archiveOptions, [&]() {
+            size_t count = 0;
+            SnmpArchiveDiff(before, after, NULL, 0, [&count](const SnmpArchiveChange&) { count++; });
+            changes = count;
+        }));
+        (void)changes;
+    }
+
+    SnmpArchiveClose(before);
+    SnmpArchiveClose(after);
+    std::filesystem::remove(beforePath, error);
+    std::filesystem::remove(afterPath, error);
+}
+
+static void BenchDelta(SnmpBenchContext& context) {
+    // Сравнение с прошлым циклом неизменившихся значений - обычный случай при опросе изменений
+    if (SnmpBenchSelected(context, "delta.update")) {
+        std::vector<RFC1157VarBind> varBinds;
+        for (const SnmpAgentEntry& entry : context.data.entries) varBinds.push_back(SnmpBenchVarBind(entry));
+
+        SnmpDeltaCache cache;
+        size_t changes = 0;
+        SnmpDeltaCallback onChange = [&changes](const SnmpDeltaChange&) { changes++; };
+        ULONGLONG now = 0;
+        size_t index = 0;
+        SnmpDeltaBegin(cache, false, 0, now);
+        SnmpBenchAdd(context, SnmpBenchRun("delta.update", context.options, [&]() {
+            SnmpDeltaUpdate(cache, varBinds[index], onChange);
+            if (++index == varBinds.size()) {
+                SnmpDeltaEnd(cache, onChange);
+                SnmpDeltaBegin(cache, false, 0, now += 1000);
+                index = 0;
+            }
+        }));
+    }
+}
+
+static void BenchMetrics(SnmpBenchContext& context) {
+    // Запись одного запроса с ответом: поиск ряда, счётчики и гистограмма
+    if (SnmpBenchSelected(context, "metrics.record")) {
+        std::string target = "10.0.0.1:161";
+        ULONGLONG latencyUs = 1;
+        SnmpBenchAdd(context, SnmpBenchRun("metrics.record", context.options, [&]() {
+            SnmpMetricsSeries* series = SnmpMetricsSeriesFor(target, SNMP_PDU_GET);
+            SnmpMetricsOnSend(series, 48, false);
+            SnmpMetricsOnResponse(series, latencyUs, 0, 52, 1);
+            latencyUs = latencyUs * 7 % 100003;
+        }));
+    }
+
+    // Экспорт в формате Prometheus
+    if (SnmpBenchSelected(context, "metrics.export")) {
+        std::string text;
+        SnmpBenchAdd(context, SnmpBenchRun("metrics.export", context.options, [&]() {
+            text.clear();
+            SnmpMetricsFormatPrometheus(text);
+        }));
+    }
+}
+
+// Запуск с большим списком агентов: разрешение имён (без кэша - параллельно и в один поток,
+// из кэша) и заполнение пула сессий. Имена разные, поэтому каждое разрешается отдельно.
+static void BenchStartup(SnmpBenchContext& context) {
+    SnmpBenchOptions startupOptions = context.options;
+    startupOptions.minSamples = 5;
+
+    std::vector<std::string> targets;
+    for (int i = 0; i < SNMP_BENCH_INVENTORY_TARGETS; i++) {
+        targets.push_back("localhost:" + std::to_string(20000 + i));
+    }
+    std::vector<SnmpResolveEntry> resolved;
+
+    static const struct { const char* name; int threads; } cold[] = {
+        { "startup.resolve_10k", SNMP_RESOLVE_THREADS },
+        { "startup.resolve_10k_serial", 1 },
+    };
+    for (const auto& item : cold) {
+        if (!SnmpBenchSelected(context, item.name)) continue;
+        SnmpResolveCache cache;
+        SnmpBenchAdd(context, SnmpBenchRun(item.name, startupOptions, [&]() {
+            SnmpResolveClear(cache);
+            SnmpResolveAll(cache, targets, resolved, item.threads);
+        }));
+    }
+
+    SnmpResolveCache cache;
+    SnmpResolveAll(cache, targets, resolved);
+    if (SnmpBenchSelected(context, "startup.resolve_10k_cached")) {
+        SnmpBenchAdd(context, SnmpBenchRun("startup.resolve_10k_cached", startupOptions, [&]() {
+            SnmpResolveAll(cache, targets, resolved);
+        }));
+    }
+
+    if (SnmpBenchSelected(context, "startup.pool_10k")) {
+        SnmpBenchAdd(context, SnmpBenchRun("startup.pool_10k", startupOptions, [&]() {
+            SnmpSessionPool pool;
+            SnmpPoolInit(pool, 1000, 2, SNMP_VERSION_V2C, &cache);
+            SnmpPoolAdd(pool, targets, "public");
+            SnmpPoolClose(pool);
+        }));
+    }
+}
+
+// Одиночный GET sysName.0 - операция тестов отказов
+static bool BenchGetSysName(SnmpUdpSession& session) {
+    SnmpOid oid = { 1, 3, 6, 1, 2, 1, 1, 5, 0 };
+    RFC1157VarBind requestVarBind;
+    requestVarBind.name = oid.AsAsn();
+    requestVarBind.value.asnType = ASN_NULL;
+    SnmpPdu request;
+    request.type = SNMP_PDU_GET;
+    request.errorStatus = 0;
+    request.errorIndex = 0;
+    request.varBinds.list = &requestVarBind;
+    request.varBinds.len = 1;
+    SnmpPdu response;
+    return SnmpUdpRequest(session, request, response);
+}
+
+// Тесты отказов: агент теряет 5% запросов и отвечает через 1-2 мс. Таймаут по измеренному
+// времени ответа повторяет потерянный запрос через ~100 мс, фиксированный - через секунду.
+// Запросы к адресу без агента после двух неудач не отправляются до пробы.
+static void BenchFaults(SnmpBenchContext& context) {
+    SnmpBenchOptions faultOptions = context.options;
+    faultOptions.minSamples = 5;
+
+    SnmpAgentOptions agentOptions;
+    agentOptions.address = SNMP_BENCH_LOSSY_AGENT_ADDRESS;
+    agentOptions.lossPercent = 5;
+    agentOptions.latencyUs = 1000;
+    agentOptions.jitterUs = 1000;
+    SnmpAgent agent;
+    if (!SnmpAgentStart(agent, context.data, agentOptions)) {
+        std::cerr << "Cannot start agent on " << agentOptions.address << ". Error code: " << GetLastError() << std::endl;
+        return;
+    }
+
+    static const struct { const char* name; bool adaptive; } lossy[] = {
+        { "fault.loss5_get_adaptive", true },
+        { "fault.loss5_get_fixed", false },
+    };
+    for (const auto& item : lossy) {
+        if (!SnmpBenchSelected(context, item.name)) continue;
+        SnmpUdpSession session;
+        if (!SnmpUdpOpen(session, agentOptions.address, "public", 1000, 2, SNMP_VERSION_V2C)) continue;
+        session.adaptiveTimeout = item.adaptive;
+        SnmpBenchAdd(context, SnmpBenchRun(item.name, faultOptions, [&]() {
+            BenchGetSysName(session);
+        }));
+        SnmpUdpClose(session);
+    }
+
+    SnmpAgentStop(agent);
+
+    if (SnmpBenchSelected(context, "fault.dead_get")) {
+        SnmpUdpSession session;
+        if (SnmpUdpOpen(session, SNMP_BENCH_DEAD_AGENT_ADDRESS, "public", 200, 2, SNMP_VERSION_V2C)) {
+            SnmpBenchAdd(context, SnmpBenchRun("fault.dead_get", faultOptions, [&]() {
+                BenchGetSysName(session);
+            }));
+            SnmpUdpClose(session);
+        }
+    }
+}
+
+// Цикл одного сборщика: sysName.0 и обходы ifDescr и ifOperStatus, как у сборщиков
+// интерфейсов, инвентаризации и аварий. cache == NULL - запросы прямо к агенту.
+static void BenchCollectorRound(SnmpUdpSession& session, SnmpCache* cache) {
+    static const SnmpOid sysName = { 1, 3, 6, 1, 2, 1, 1, 5, 0 };
+    static const SnmpOid ifDescr = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 2 };
+    static const SnmpOid ifOperStatus = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 8 };
+
+    size_t count = 0;
+    auto onVarBind = [&count](RFC1157VarBind&) { count++; };
+    if (cache == NULL) {
+        BenchGetSysName(session);
+        SnmpBulkWalk(session, ifDescr, 25, onVarBind);
+        SnmpBulkWalk(session, ifOperStatus, 25, onVarBind);
+        return;
+    }
+
+    AsnAny value;
+    AsnInteger errorStatus;
+    SnmpCacheGet(*cache, session, sysName, value, errorStatus);
+    SnmpCacheWalk(*cache, session, ifDescr, 25, onVarBind);
+    SnmpCacheWalk(*cache, session, ifOperStatus, 25, onVarBind);
+}
+
+// Нагрузка сборщиков на агента, отвечающего через 1-2 мс: операция - цикл всех
+// SNMP_BENCH_CACHE_COLLECTORS сборщиков одновременно. Без кэша, только с объединением
+// запросов в полёте (TTL 0) и с кэшем (TTL по умолчанию); печатается число запросов к агенту.
+static void BenchCache(SnmpBenchContext& context) {
+    static const char* const names[] = { "cache.collectors8_direct", "cache.collectors8_merged", "cache.collectors8_ttl" };
+    bool selected = false;
+    for (const char* name : names) {
+        if (SnmpBenchSelected(context, name)) selected = true;
+    }
+    if (!selected) return;
+
+    SnmpAgentOptions agentOptions;
+    agentOptions.address = SNMP_BENCH_CACHE_AGENT_ADDRESS;
+    agentOptions.latencyUs = 1000;
+    agentOptions.jitterUs = 1000;
+    SnmpAgent agent;
+    if (!SnmpAgentStart(agent, context.data, agentOptions)) {
+        std::cerr << "Cannot start agent on " << agentOptions.address << ". Error code: " << GetLastError() << std::endl;
+        return;
+    }
+
+    std::vector<SnmpUdpSession> sessions(SNMP_BENCH_CACHE_COLLECTORS);
+    for (SnmpUdpSession& session : sessions) {
+        SnmpUdpOpen(session, agentOptions.address, "public", 1000, 2, SNMP_VERSION_V2C);
+    }
+
+    SnmpBenchOptions cacheOptions = context.options;
+    cacheOptions.minSamples = 5;
+    for (int mode = 0; mode < 3; mode++) {
+        if (!SnmpBenchSelected(context, names[mode])) continue;
+
+        SnmpCache cache;
+        if (mode == 1) cache.ttl = 0;
+        SnmpCache* shared = mode == 0 ? NULL : &cache;
+
+        unsigned long long rounds = 0;
+        unsigned long long requestsBefore = SnmpAgentGetTotals(agent).requests;
+        SnmpBenchAdd(context, SnmpBenchRun(names[mode], cacheOptions, [&]() {
+            std::vector<std::thread> collectors;
+            for (SnmpUdpSession& session : sessions) {
+                collectors.emplace_back([&session, shared]() { BenchCollectorRound(session, shared); });
+            }
+            for (std::thread& collector : collectors) collector.join();
+            rounds++;
+        }));
+
+        unsigned long long requests = SnmpAgentGetTotals(agent).requests - requestsBefore;
+        std::cout << names[mode] << ": " << (rounds > 0 ? (double)requests / rounds : 0)
+            << " agent requests per round";
+        if (shared) {
+            std::cout << " (hits " << cache.hits << ", merged " << cache.merged << ", misses " << cache.misses << ")";
+        }
+        std::cout << std::endl;
+    }
+
+    for (SnmpUdpSession& session : sessions) {
+        SnmpUdpClose(session);
+    }
+    SnmpAgentStop(agent);
+}
+
+// Процесс теста корутин: обход system через GETBULK, затем GET sysName.0.
+// peakFrames - наибольший объём кадров корутин за время обхода.
+static SnmpTask<> BenchAsyncWorkflow(SnmpLoop& loop, size_t agent, size_t& completed, size_t& peakFrames) {
+    static const SnmpOid system = { 1, 3, 6, 1, 2, 1, 1 };
+    static const SnmpOid sysName = { 1, 3, 6, 1, 2, 1, 1, 5, 0 };
+
+    DWORD error = co_await SnmpAsyncWalk(loop, agent, system, 25, [&peakFrames](RFC1157VarBind&) {
+        size_t frames = SnmpTaskFrameBytes();
+        if (frames > peakFrames) peakFrames = frames;
+    });
+    if (error != 0) co_return;
+
+    SnmpAsyncResult result = co_await SnmpAsyncGet(loop, agent, sysName);
+    if (result.response && result.response->errorStatus == SNMP_ERRORSTATUS_NOERROR) completed++;
+}
+
+static void BenchNetwork(SnmpBenchContext& context) {
+    SnmpUdpSession session;
+    if (!SnmpUdpOpen(session, context.agentAddress, "public", 1000, 2, SNMP_VERSION_V2C)) {
+        std::cerr << "Cannot open session to " << context.agentAddress << ". Error code: " << GetLastError() << std::endl;
+        return;
+    }
+
+    // Сетевые операции долгие: пачка - одна операция, поэтому перцентили - по операциям
+    SnmpBenchOptions walkOptions = context.options;
+    walkOptions.minSamples = 5;
+
+    if (SnmpBenchSelected(context, "e2e.get") || SnmpBenchSelected(context, "e2e.get_nometrics")) {
+        SnmpOid oid = { 1, 3, 6, 1, 2, 1, 1, 5, 0 };
+        RFC1157VarBind requestVarBind;
+        requestVarBind.name = oid.AsAsn();
+        requestVarBind.value.asnType = ASN_NULL;
+        SnmpPdu request;
+        request.type = SNMP_PDU_GET;
+        request.errorStatus = 0;
+        request.errorIndex = 0;
+        request.varBinds.list = &requestVarBind;
+        request.varBinds.len = 1;
+        SnmpPdu response;
+        if (SnmpBenchSelected(context, "e2e.get")) {
+            SnmpBenchAdd(context, SnmpBenchRun("e2e.get", context.options, [&]() {
+                SnmpUdpRequest(session, request, response);
+            }));
+        }
+
+        // Тот же GET без записи метрик - цена инструментирования
+        if (SnmpBenchSelected(context, "e2e.get_nometrics")) {
+            SnmpMetricsEnable(false);
+            SnmpBenchAdd(context, SnmpBenchRun("e2e.get_nometrics", context.options, [&]() {
+                SnmpUdpRequest(session, request, response);
+            }));
+            SnmpMetricsEnable(true);
+        }
+    }
+
+    if (SnmpBenchSelected(context, "e2e.batch_get100")) {
+        std::vector<SnmpOid> oids;
+        for (UINT i = 1; i <= 100; i++) {
+            SnmpOid oid = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 10 };
+            oid.Append((i - 1) % context.rows + 1);
+            oids.push_back(oid);
+        }
+        SnmpArena resultArena;
+        std::vector<SnmpBatchResult> results;
+        SnmpBenchAdd(context, SnmpBenchRun("e2e.batch_get100", walkOptions, [&]() {
+            SnmpArenaReset(resultArena);
+            SnmpGetBatch(session, oids, resultArena, results);
+        }));
+    }
+
+    // Обходы всей ifTable теми же функциями, что у get_all и get_bulk: одна операция - полный обход.
+    // Число PDU на обход печатается отдельно: на локальном агенте ns/op почти не зависит
+    // от числа обменов, а на реальной сети время обхода определяют именно они
+    SnmpOid ifTable = { 1, 3, 6, 1, 2, 1, 2, 2 };
+    auto skipVarBind = [](RFC1157VarBind&) {};
+    if (SnmpBenchSelected(context, "e2e.walk_getnext")) {
+        unsigned long long walks = 0;
+        unsigned long requestsBefore = session.requestCount;
+        SnmpBenchAdd(context, SnmpBenchRun("e2e.walk_getnext", walkOptions, [&]() {
+            SnmpWalk(session, ifTable, skipVarBind);
+            walks++;
+        }));
+        std::cout << "e2e.walk_getnext: " << (walks > 0 ? (double)(session.requestCount - requestsBefore) / walks : 0)
+            << " PDUs per walk" << std::endl;
+    }
+    if (SnmpBenchSelected(context, "e2e.walk_getbulk")) {
+        unsigned long long walks = 0;
+        unsigned long requestsBefore = session.requestCount;
+        SnmpBenchAdd(context, SnmpBenchRun("e2e.walk_getbulk", walkOptions, [&]() {
+            SnmpBulkWalk(session, ifTable, 25, skipVarBind);
+            walks++;
+        }));
+        std::cout << "e2e.walk_getbulk: " << (walks > 0 ? (double)(session.requestCount - requestsBefore) / walks : 0)
+            << " PDUs per walk" << std::endl;
+    }
+    if (SnmpBenchSelected(context, "e2e.walk_parallel")) {
+        size_t count = 0;
+        auto onVarBind = [&count](RFC1157VarBind&) { count++; };
+        SnmpBenchAdd(context, SnmpBenchRun("e2e.walk_parallel", walkOptions, [&]() {
+            SnmpParallelWalk(session, ifTable, 4, 25, onVarBind);
+        }));
+    }
+
+    // Выдержка: обходы ifTable, пока не придёт SNMP_BENCH_SOAK_VARBINDS varbind, с замерами RSS.
+    // Операция - один обход; с -r 80000 (13 колонок) один обход - больше миллиона строк. Рост RSS после
+    // разогрева больше SNMP_BENCH_SOAK_RSS_SLACK - ошибка (код выхода 5).
+    if (SnmpBenchExplicit(context, "soak.walk_1m")) {
+        size_t received = 0;
+        size_t baseline = 0, peak = 0, last = 0;
+        auto onVarBind = [&](RFC1157VarBind&) {
+            if (++received % SNMP_BENCH_SOAK_SAMPLE != 0) return;
+            last = SnmpBenchRssBytes();
+            if (received == SNMP_BENCH_SOAK_VARBINDS / 10) baseline = last;
+            if (last > peak) peak = last;
+        };
+
+        std::vector<double> samples;
+        unsigned long long allocationsBefore = SnmpBenchAllocations();
+        ULONGLONG begin = SnmpBenchNowNs();
+        bool success = true;
+        while (received < SNMP_BENCH_SOAK_VARBINDS && success) {
+            ULONGLONG start = SnmpBenchNowNs();
+            success = SnmpBulkWalk(session, ifTable, 25, onVarBind);
+            samples.push_back((double)(SnmpBenchNowNs() - start));
+            // Пик до конца разогрева не считается
+            if (baseline == 0) peak = 0;
+        }
+        ULONGLONG elapsed = SnmpBenchNowNs() - begin;
+        unsigned long long allocations = SnmpBenchAllocations() - allocationsBefore;
+        unsigned long long walks = samples.size();
+        SnmpBenchAdd(context, SnmpBenchSummarize("soak.walk_1m", samples, walks, (double)elapsed, allocations));
+
+        if (!success) {
+            std::cerr << "soak.walk_1m: walk failed after " << received << " varbinds. Error code: "
+                << GetLastError() << std::endl;
+            context.soakGrowth = true;
+        }
+        else if (baseline == 0) {
+            std::cout << "soak.walk_1m: RSS is not available on this system" << std::endl;
+        }
+        else {
+            bool flat = peak <= baseline + SNMP_BENCH_SOAK_RSS_SLACK;
+            std::cout << "soak.walk_1m: " << received << " varbinds in " << walks << " walk(s), RSS after warm-up "
+                << baseline / 1024 << " KB, peak " << peak / 1024 << " KB, end " << last / 1024 << " KB: "
+                << (flat ? "flat" : "GROWING") << std::endl;
+            if (!flat) context.soakGrowth = true;
+        }
+    }
+
+    SnmpUdpClose(session);
+
+    // GET по очереди к 100 агентам пула через один сокет: к цене запроса добавляется смена агента
+    if (SnmpBenchSelected(context, "e2e.pool_get")) {
+        SnmpSessionPool pool;
+        SnmpPoolInit(pool, 1000, 2, SNMP_VERSION_V2C);
+        SnmpPoolAdd(pool, std::vector<std::string>(100, context.agentAddress), "public");
+        size_t next = 0;
+        SnmpBenchAdd(context, SnmpBenchRun("e2e.pool_get", context.options, [&]() {
+            SnmpUdpSession* pooled = SnmpPoolAcquire(pool, next++ % pool.agents.size());
+            if (pooled) BenchGetSysName(*pooled);
+        }));
+        SnmpPoolClose(pool);
+    }
+
+    // Масштабирование обхода многих агентов с 1 до N потоков. Агенты различаются community,
+    // обходы разного размера, поэтому освободившиеся потоки забирают чужие задания.
+    std::vector<SnmpWalkJob> jobs;
+    for (int i = 0; i < SNMP_BENCH_SCHED_GROUPS; i++) {
+        SnmpWalkJob job;
+        job.hostname = context.agentAddress;
+        job.community = "public" + std::to_string(i);
+        job.baseOid = i % 4 == 0 ? ifTable : SnmpOid{ 1, 3, 6, 1, 2, 1, 1 };
+        jobs.push_back(job);
+    }
+    unsigned cores = std::thread::hardware_concurrency();
+    for (unsigned threads = 1; threads == 1 || threads <= cores; threads *= 2) {
+        std::string name = "sched.walk_t" + std::to_string(threads);
+        if (!SnmpBenchSelected(context, name)) continue;
+
+        SnmpSchedulerOptions schedulerOptions;
+        schedulerOptions.threads = (int)threads;
+        schedulerOptions.timeout = 1000;
+        auto onVarBind = [](int, size_t, RFC1157VarBind&) {};
+        auto onDone = [](const SnmpWalkJobResult&) {};
+        SnmpBenchAdd(context, SnmpBenchRun(name, walkOptions, [&]() {
+            SnmpSchedulerStats stats;
+            SnmpSchedulerRun(jobs, schedulerOptions, onVarBind, onDone, stats);
+        }));
+    }
+
+    // Асинхронный опрос SNMP_BENCH_POLL_TARGETS целей: операция - один ответ,
+    // перцентили - задержка отдельных запросов
+    if (SnmpBenchSelected(context, "e2e.poll")) {
+        std::vector<SnmpPollTarget> targets(SNMP_BENCH_POLL_TARGETS);
+        for (SnmpPollTarget& target : targets) {
+            target.hostname = context.agentAddress;
+            target.community = "public";
+            target.oids.push_back(SnmpOid{ 1, 3, 6, 1, 2, 1, 1, 5, 0 });
+            SnmpUdpResolve(target.hostname, target.address, target.addressLength);
+        }
+
+        SnmpPollerOptions pollOptions;
+        pollOptions.cycles = 1;
+        pollOptions.timeout = 1000;
+
+        std::vector<double> samples;
+        samples.reserve(SNMP_BENCH_POLL_TARGETS * 16);
+        auto onResult = [&samples](const SnmpPollResult& result) {
+            if (result.response) samples.push_back((double)result.latencyUs * 1000);
+        };
+
+        unsigned long long allocations = 0;
+        ULONGLONG begin = SnmpBenchNowNs();
+        ULONGLONG now = begin;
+        while (now - begin < (ULONGLONG)(context.options.minTimeMs * 1e6)) {
+            SnmpPollerStats stats;
+            unsigned long long allocationsBefore = SnmpBenchAllocations();
+            SnmpPollerRun(targets, pollOptions, onResult, stats);
+            allocations += SnmpBenchAllocations() - allocationsBefore;
+            now = SnmpBenchNowNs();
+        }
+        unsigned long long responses = samples.size();
+        SnmpBenchAdd(context, SnmpBenchSummarize("e2e.poll", samples, responses, (double)(now - begin), allocations));
+    }
+
+    // SNMP_BENCH_ASYNC_WORKFLOWS процессов-корутин в одном потоке: операция - все процессы,
+    // каждый - обход system (один GETBULK) и GET
+    if (SnmpBenchSelected(context, "e2e.async_workflows_1k")) {
+        sockaddr_storage address;
+        int addressLength = 0;
+        SnmpUdpResolve(context.agentAddress, address, addressLength);
+
+        SnmpLoop loop;
+        SnmpLoopInit(loop, 1000, 2);
+        std::vector<size_t> agents;
+        for (int i = 0; i < SNMP_BENCH_ASYNC_WORKFLOWS; i++) {
+            agents.push_back(SnmpLoopAddAgent(loop, context.agentAddress, address, addressLength, "public"));
+        }
+
+        size_t completed = 0, peakFrames = 0, runs = 0;
+        SnmpBenchAdd(context, SnmpBenchRun("e2e.async_workflows_1k", walkOptions, [&]() {
+            for (size_t agent : agents) {
+                SnmpLoopSpawn(loop, BenchAsyncWorkflow(loop, agent, completed, peakFrames));
+            }
+            SnmpLoopRun(loop);
+            runs++;
+        }));
+        std::cout << "e2e.async_workflows_1k: " << completed << " of " << runs * SNMP_BENCH_ASYNC_WORKFLOWS
+            << " workflows completed, " << peakFrames / SNMP_BENCH_ASYNC_WORKFLOWS
+            << " B of coroutine frames per workflow, " << loop.stats.sent << " datagrams sent" << std::endl;
+        SnmpLoopClose(loop);
+    }
+}
+
+static void PrintUsage() {
+    std::cout << "Usage: snmpBench [options]\n"
+        << "  -f text          run only benchmarks whose name contains text\n"
+        << "  -t ms            minimum measuring time per benchmark (default 300)\n"
+        << "  -r rows          ifTable rows served by the built-in agent (default 200)\n"
+        << "  -a host[:port]   run network benchmarks against this agent instead of the built-in one\n"
+        << "  -o file          save results as JSON\n"
+        << "  -b file          compare results with a saved baseline\n"
+        << "  -c old new       only compare two saved result files\n"
+        << "  -T percent       regression threshold for -b and -c (default 10)\n"
+        << "Exit code is 2 when a regression exceeds the threshold,\n"
+        << "3 when the vector (SSE2/AVX2) byte formatting differs from the scalar one,\n"
+        << "4 when the BER decoder check of OID arc bounds fails,\n"
+        << "5 when RSS grows (or the walk fails) in soak.walk_1m. The soak test runs only when\n"
+        << "selected with -f; use -r 80000 to make a single walk over a million rows.\n";
+}
+
+int main(int argc, char* argv[]) {
+    SnmpBenchContext context;
+    std::string outputPath, baselinePath, comparePath;
+    bool externalAgent = false;
+    double threshold = 10;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            PrintUsage();
+            return 0;
+        }
+        if (arg.size() != 2 || arg[0] != '-' || i + 1 >= argc) {
+            std::cerr << "Invalid argument: " << arg << std::endl;
+            PrintUsage();
+            return 1;
+        }
+
+        std::string value = argv[++i];
+        switch (arg[1]) {
+        case 'f': context.filter = value; break;
+        case 't': context.options.minTimeMs = std::atof(value.c_str()); break;
+        case 'r': context.rows = (UINT)std::atoi(value.c_str()); break;
+        case 'a': context.agentAddress = value; externalAgent = true; break;
+        case 'o': outputPath = value; break;
+        case 'b': baselinePath = value; break;
+        case 'T': threshold = std::atof(value.c_str()); break;
+        case 'c':
+            if (i + 1 >= argc) {
+                PrintUsage();
+                return 1;
+            }
+            baselinePath = value;
+            comparePath = argv[++i];
+            break;
+        default:
+            std::cerr << "Invalid argument: " << arg << std::endl;
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    // Сравнение двух сохранённых прогонов без замеров
+    if (!comparePath.empty()) {
+        std::vector<SnmpBenchResult> baseline, current;
+        if (!SnmpBenchReadJson(baselinePath, baseline) || !SnmpBenchReadJson(comparePath, current)) return 1;
+        return SnmpBenchCompare(baseline, current, threshold, std::cout) ? 0 : 2;
+    }
+
+#ifdef _WIN32
+    // Инициализация Winsock
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        std::cerr << "WSAStartup failed" << std::endl;
+        return 1;
+    }
+#endif
+
+    std::vector<SnmpMibDefinition> definitions;
+    SnmpMibBuiltinDefinitions(definitions);
+    std::vector<UINT> image;
+    size_t unresolved = 0;
+    SnmpMibBuild(definitions, image, unresolved);
+    SnmpMibAttach(context.mib, std::move(image));
+
+    SnmpAgentAddTables(context.data, context.rows);
+    SnmpAgentSort(context.data);
+
+    SnmpBenchPrintHeader(std::cout);
+    BenchOid(context);
+    BenchBer(context);
+    BenchFormat(context);
+    BenchSimd(context);
+    BenchTable(context);
+    BenchSyntax(context);
+    BenchArchive(context);
+    BenchDelta(context);
+    BenchMetrics(context);
+    BenchStartup(context);
+
+    // Агент запускается, только если выбран хотя бы один сетевой тест
+    static const char* networkBenchmarks[] = {
+        "e2e.get", "e2e.get_nometrics", "e2e.batch_get100", "e2e.walk_getnext", "e2e.walk_getbulk", "e2e.walk_parallel", "e2e.pool_get", "e2e.poll", "e2e.async_workflows_1k", "sched.walk_t1", "soak.walk_1m"
+    };
+    bool network = false;
+    for (const char* name : networkBenchmarks) {
+        if (SnmpBenchSelected(context, name)) network = true;
+    }
+
+    BenchCache(context);
+
+    static const char* faultBenchmarks[] = { "fault.loss5_get_adaptive", "fault.loss5_get_fixed", "fault.dead_get" };
+    for (const char* name : faultBenchmarks) {
+        if (SnmpBenchSelected(context, name)) {
+            BenchFaults(context);
+            break;
+        }
+    }
+
+    if (network) {
+        SnmpAgent agent;
+        bool agentStarted = false;
+        if (!externalAgent) {
+            SnmpAgentOptions agentOptions;
+            agentOptions.address = context.agentAddress;
+            // Поток агента на ядро, чтобы в тестах масштабирования упираться в клиента
+            agentOptions.threads = std::thread::hardware_concurrency() > 0 ? std::thread::hardware_concurrency() : 1;
+            agentStarted = SnmpAgentStart(agent, context.data, agentOptions);
+            if (!agentStarted) {
+                std::cerr << "Cannot start agent on " << context.agentAddress
+                    << ". Error code: " << GetLastError() << std::endl;
+            }
+        }
+        if (externalAgent || agentStarted) {
+            BenchNetwork(context);
+        }
+        if (agentStarted) {
+            SnmpAgentStop(agent);
+        }
+    }
+
+    int exitCode = context.simdMismatch ? 3 : (context.berMismatch ? 4 : (context.soakGrowth ? 5 : 0));
+    if (!outputPath.empty() && !SnmpBenchWriteJson(outputPath, context.results)) {
+        exitCode = 1;
+    }
+    if (!baselinePath.empty()) {
+        std::vector<SnmpBenchResult> baseline;
+        if (!SnmpBenchReadJson(baselinePath, baseline)) {
+            exitCode = 1;
+        }
+        else if (!SnmpBenchCompare(baseline, context.results, threshold, std::cout)) {
+            exitCode = 2;
+        }
+    }
+
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    return exitCode;
+}
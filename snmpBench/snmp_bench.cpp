@@ -0,0 +1,215 @@
+﻿#include "snmp_bench.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+
+#ifdef _WIN32
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#endif
+
+static thread_local unsigned long long allocationCount = 0;
+
+// Подсчёт выделений: все operator new/new[] приложения проходят через эту функцию
+void* operator new(size_t size) {
+    allocationCount++;
+    void* memory = std::malloc(size ? size : 1);
+    if (!memory) throw std::bad_alloc();
+    return memory;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept {
+    std::free(memory);
+}
+
+unsigned long long SnmpBenchAllocations() {
+    return allocationCount;
+}
+
+size_t SnmpBenchRssBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+    return counters.WorkingSetSize;
+#else
+    // Второе поле statm - резидентные страницы
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0, resident = 0;
+    if (!(statm >> pages >> resident)) return 0;
+    return resident * (size_t)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+ULONGLONG SnmpBenchNowNs() {
+    return (ULONGLONG)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Перцентиль отсортированной выборки (ближайший ранг)
+static double SnmpBenchPercentile(const std::vector<double>& sorted, double percent) {
+    if (sorted.empty()) return 0;
+    size_t index = (size_t)(percent / 100.0 * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+SnmpBenchResult SnmpBenchSummarize(const std::string& name, std::vector<double>& samples,
+    unsigned long long iterations, double totalNs, unsigned long long allocations) {
+    std::sort(samples.begin(), samples.end());
+
+    SnmpBenchResult result;
+    result.name = name;
+    result.iterations = iterations;
+    if (iterations > 0) {
+        result.nsPerOp = totalNs / iterations;
+        result.allocsPerOp = (double)allocations / iterations;
+    }
+    result.p50Ns = SnmpBenchPercentile(samples, 50);
+    result.p90Ns = SnmpBenchPercentile(samples, 90);
+    result.p99Ns = SnmpBenchPercentile(samples, 99);
+    return result;
+}
+
+void SnmpBenchPrintHeader(std::ostream& out) {
+    out << std::left << std::setw(28) << "benchmark" << std::right
+        << std::setw(12) << "iterations" << std::setw(14) << "ns/op" << std::setw(12) << "allocs/op"
+        << std::setw(14) << "p50 ns" << std::setw(14) << "p90 ns" << std::setw(14) << "p99 ns" << "\n";
+}
+
+void SnmpBenchPrint(std::ostream& out, const SnmpBenchResult& result) {
+    out << std::left << std::setw(28) << result.name << std::right << std::fixed
+        << std::setw(12) << result.iterations
+        << std::setw(14) << std::setprecision(1) << result.nsPerOp
+        << std::setw(12) << std::setprecision(2) << result.allocsPerOp
+        << std::setw(14) << std::setprecision(1) << result.p50Ns
+        << std::setw(14) << result.p90Ns
+        << std::setw(14) << result.p99Ns << std::endl;
+}
+
+bool SnmpBenchWriteJson(const std::string& path, const std::vector<SnmpBenchResult>& results) {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file) {
+        std::cerr << "Cannot create results file: " << path << std::endl;
+        return false;
+    }
+
+    // Одна запись на строку: файл удобно сравнивать diff'ом и читать SnmpBenchReadJson
+    file << "{\n  \"benchmarks\": [\n" << std::setprecision(17);
+    for (size_t i = 0; i < results.size(); i++) {
+        const SnmpBenchResult& result = results[i];
+        file << "    {\"name\": \"" << result.name << "\", \"iterations\": " << result.iterations
+            << ", \"ns_per_op\": " << result.nsPerOp << ", \"allocs_per_op\": " << result.allocsPerOp
+            << ", \"p50_ns\": " << result.p50Ns << ", \"p90_ns\": " << result.p90Ns
+            << ", \"p99_ns\": " << result.p99Ns << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    file << "  ]\n}\n";
+    return (bool)file;
+}
+
+// Значение поля "key": в строке записи; для name - строка в кавычках
+static bool SnmpBenchField(const std::string& line, const char* key, std::string& value) {
+    std::string pattern = std::string("\"") + key + "\":";
+    size_t position = line.find(pattern);
+    if (position == std::string::npos) return false;
+    position = line.find_first_not_of(' ', position + pattern.size());
+    if (position == std::string::npos) return false;
+
+    if (line[position] == '"') {
+        size_t end = line.find('"', position + 1);
+        if (end == std::string::npos) return false;
+        value = line.substr(position + 1, end - position - 1);
+    }
+    else {
+        size_t end = line.find_first_of(",}", position);
+        value = line.substr(position, end == std::string::npos ? std::string::npos : end - position);
+    }
+    return true;
+}
+
+static double SnmpBenchNumberField(const std::string& line, const char* key) {
+    std::string value;
+    return SnmpBenchField(line, key, value) ? std::strtod(value.c_str(), NULL) : 0;
+}
+
+bool SnmpBenchReadJson(const std::string& path, std::vector<SnmpBenchResult>& results) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Cannot open results file: " << path << std::endl;
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        SnmpBenchResult result;
+        if (!SnmpBenchField(line, "name", result.name)) continue;
+        result.iterations = (unsigned long long)SnmpBenchNumberField(line, "iterations");
+        result.nsPerOp = SnmpBenchNumberField(line, "ns_per_op");
+        result.allocsPerOp = SnmpBenchNumberField(line, "allocs_per_op");
+        result.p50Ns = SnmpBenchNumberField(line, "p50_ns");
+        result.p90Ns = SnmpBenchNumberField(line, "p90_ns");
+        result.p99Ns = SnmpBenchNumberField(line, "p99_ns");
+        results.push_back(result);
+    }
+    return true;
+}
+
+// Метрика хуже базовой больше чем на threshold процентов. Для выделений памяти
+// допускается дробный шум (рост ёмкости буферов): регрессия - не меньше 0.1 выделения на операцию.
+static bool SnmpBenchWorse(double baseline, double current, double thresholdPercent, double slack) {
+    return current > baseline * (1 + thresholdPercent / 100.0) && current - baseline > slack;
+}
+
+bool SnmpBenchCompare(const std::vector<SnmpBenchResult>& baseline, const std::vector<SnmpBenchResult>& current,
+    double thresholdPercent, std::ostream& out) {
+    bool passed = true;
+    out << std::left << std::setw(28) << "benchmark" << std::setw(12) << "metric" << std::right
+        << std::setw(14) << "baseline" << std::setw(14) << "current" << std::setw(10) << "change" << "\n";
+
+    for (const SnmpBenchResult& result : current) {
+        auto base = std::find_if(baseline.begin(), baseline.end(),
+            [&result](const SnmpBenchResult& item) { return item.name == result.name; });
+        if (base == baseline.end()) {
+            out << std::left << std::setw(28) << result.name << "(no baseline)" << "\n";
+            continue;
+        }
+
+        struct { const char* metric; double baseline; double current; double slack; } metrics[] = {
+            { "ns/op", base->nsPerOp, result.nsPerOp, 0 },
+            { "p99 ns", base->p99Ns, result.p99Ns, 0 },
+            { "allocs/op", base->allocsPerOp, result.allocsPerOp, 0.1 },
+        };
+        for (const auto& metric : metrics) {
+            bool worse = SnmpBenchWorse(metric.baseline, metric.current, thresholdPercent, metric.slack);
+            double change = metric.baseline > 0 ? (metric.current / metric.baseline - 1) * 100 : 0;
+            out << std::left << std::setw(28) << result.name << std::setw(12) << metric.metric << std::right
+                << std::fixed << std::setprecision(2)
+                << std::setw(14) << metric.baseline << std::setw(14) << metric.current
+                << std::setw(9) << std::showpos << change << std::noshowpos << "%"
+                << (worse ? "  REGRESSION" : "") << "\n";
+            if (worse) passed = false;
+        }
+    }
+
+    out << (passed ? "No regressions" : "Regressions found") << " (threshold " << thresholdPercent << "%)" << std::endl;
+    return passed;
+}
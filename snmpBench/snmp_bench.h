@@ -0,0 +1,96 @@
+﻿#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include "snmp_compat.h"
+
+// Пачка повторов короткой операции длится не меньше этого времени,
+// чтобы чтение часов не искажало замер
+#define SNMP_BENCH_BATCH_NS 20000
+
+// Разогрев перед замером: кэши, предсказатель переходов, частота процессора
+#define SNMP_BENCH_WARMUP_NS 50000000
+
+// Предел размера пачки для самых быстрых операций
+#define SNMP_BENCH_MAX_BATCH (1u << 20)
+
+struct SnmpBenchOptions {
+    double minTimeMs = 300;       // минимальное время замера одного теста
+    size_t minSamples = 30;       // и минимальное число пачек
+};
+
+// Результат теста. Перцентили - по пачкам (для сетевых тестов пачка - одна операция).
+struct SnmpBenchResult {
+    std::string name;
+    unsigned long long iterations = 0;
+    double nsPerOp = 0;
+    double allocsPerOp = 0;
+    double p50Ns = 0;
+    double p90Ns = 0;
+    double p99Ns = 0;
+};
+
+// Число выделений памяти в текущем потоке с начала работы
+// (глобальный operator new переопределён в snmp_bench.cpp)
+unsigned long long SnmpBenchAllocations();
+
+// Резидентная память процесса (RSS, на Windows - рабочий набор), байт; 0 - не удалось узнать
+size_t SnmpBenchRssBytes();
+
+ULONGLONG SnmpBenchNowNs();
+
+// Итоги по выборке: samples - время одной операции в нс, totalNs - общее время iterations операций
+SnmpBenchResult SnmpBenchSummarize(const std::string& name, std::vector<double>& samples,
+    unsigned long long iterations, double totalNs, unsigned long long allocations);
+
+// Замер операции: разогрев, подбор размера пачки, затем пачки до minTimeMs и minSamples
+template <typename Operation>
+SnmpBenchResult SnmpBenchRun(const std::string& name, const SnmpBenchOptions& options, Operation&& operation) {
+    ULONGLONG warmupStart = SnmpBenchNowNs();
+    do {
+        operation();
+    } while (SnmpBenchNowNs() - warmupStart < SNMP_BENCH_WARMUP_NS);
+
+    size_t batch = 1;
+    while (batch < SNMP_BENCH_MAX_BATCH) {
+        ULONGLONG start = SnmpBenchNowNs();
+        for (size_t i = 0; i < batch; i++) operation();
+        if (SnmpBenchNowNs() - start >= SNMP_BENCH_BATCH_NS) break;
+        batch *= 2;
+    }
+
+    std::vector<double> samples;
+    unsigned long long iterations = 0;
+    unsigned long long allocations = 0;
+    ULONGLONG begin = SnmpBenchNowNs();
+    ULONGLONG now = begin;
+    ULONGLONG minTimeNs = (ULONGLONG)(options.minTimeMs * 1e6);
+    while (now - begin < minTimeNs || samples.size() < options.minSamples) {
+        unsigned long long allocationsBefore = SnmpBenchAllocations();
+        ULONGLONG start = SnmpBenchNowNs();
+        for (size_t i = 0; i < batch; i++) operation();
+        now = SnmpBenchNowNs();
+        allocations += SnmpBenchAllocations() - allocationsBefore;
+
+        samples.push_back((double)(now - start) / batch);
+        iterations += batch;
+    }
+
+    return SnmpBenchSummarize(name, samples, iterations, (double)(now - begin), allocations);
+}
+
+// Таблица результатов для человека
+void SnmpBenchPrintHeader(std::ostream& out);
+void SnmpBenchPrint(std::ostream& out, const SnmpBenchResult& result);
+
+// Результаты в JSON: {"benchmarks": [{"name": ..., "ns_per_op": ...}, ...]}
+bool SnmpBenchWriteJson(const std::string& path, const std::vector<SnmpBenchResult>& results);
+
+// Читает файл, записанный SnmpBenchWriteJson
+bool SnmpBenchReadJson(const std::string& path, std::vector<SnmpBenchResult>& results);
+
+// Сравнивает с базовыми результатами. Регрессия - рост ns/op, p99 или allocs/op
+// больше чем на thresholdPercent процентов. Возвращает false, если регрессии есть.
+bool SnmpBenchCompare(const std::vector<SnmpBenchResult>& baseline, const std::vector<SnmpBenchResult>& current,
+    double thresholdPercent, std::ostream& out);